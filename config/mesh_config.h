@@ -8,8 +8,141 @@
 
 #define MAX_NETWORK_HOPS 6
 #define HEARTBEAT_INTERVAL 10000  // 10 seconds
+#define HEARTBEAT_MIN_INTERVAL 5000    // Interval right after a topology change
+#define HEARTBEAT_MAX_INTERVAL 60000   // Interval ceiling on a stable mesh
+#define HEARTBEAT_KEYFRAME_EVERY 6     // Full snapshot every N heartbeats
+#define MESH_MAX_PEERS 64              // Peers tracked from heartbeats
 #define NODE_JOIN_TIMEOUT 45000   // 45 seconds
 
 #define MESH_ENCRYPTION AES256
 
+// Binary wire frame (header + ciphertext, before base64 armor)
+#define MESH_MAX_FRAME_SIZE 1024
+
+// Duplicate suppression (seen-message cache, SETS must be a power of two)
+#define MESH_SEEN_CACHE_SETS 64
+#define MESH_SEEN_CACHE_WAYS 4
+#define MESH_SEEN_CACHE_TTL_MS 30000  // 30 seconds
+
+// Outbound scheduler (drained from MeshNetworkManager::update)
+#define MESH_OUTBOUND_QUEUE_DEPTH 8      // Entries per priority class
+#define MESH_OUTBOUND_MAX_RECORD 240     // Larger messages bypass the queue
+#define MESH_COALESCE_MAX_BYTES 512      // Plaintext budget for one coalesced frame
+#define MESH_COALESCE_DELAY_MS 50        // Max wait for telemetry/logs to gain company
+#define MESH_OUTBOUND_BURST 8            // Frames sent per update() call
+#define MESH_WAIT_HISTOGRAM_BUCKETS 12   // Power-of-two ms buckets (<1ms .. >=1024ms)
+
+// Topology graph (link-state adverts, hop distances, next-hop cache)
+#define MESH_TOPOLOGY_MAX_NODES 64       // Nodes held in the graph, self included
+#define MESH_TOPOLOGY_MAX_LINKS 8        // Direct links recorded per node
+#define MESH_LINK_STATE_REFRESH_MS 60000 // Unchanged adverts are re-sent this often
+#define MESH_LINK_STATE_READVERTISE_MS 2000 // Minimum gap between adverts prompted by mesh changes
+#define MESH_LINK_STATE_MAX_AGE_MS 180000
+
+// Reliable unicast (per-peer sliding window with selective ACKs)
+#define MESH_RELIABLE_PEERS 8            // Peers with send state (and, separately, receive state)
+#define MESH_RELIABLE_WINDOW 8           // Unacknowledged messages in flight per peer
+#define MESH_RELIABLE_MAX_RETRIES 6
+#define MESH_RELIABLE_RTO_INITIAL_MS 1000
+#define MESH_RELIABLE_RTO_MIN_MS 100
+#define MESH_RELIABLE_RTO_MAX_MS 10000
+
+// Fragmentation and reassembly (payloads larger than one frame)
+#define MESH_FRAGMENT_SIZE 512             // Payload bytes per fragment (the last may be shorter)
+#define MESH_REASSEMBLY_POOL_BLOCKS 32     // FRAGMENT_SIZE blocks shared by all senders (max 32)
+#define MESH_REASSEMBLY_SLOTS 8            // Messages reassembled concurrently
+#define MESH_REASSEMBLY_TIMEOUT_MS 5000    // Abandon a message this long after its last fragment
+
+// Per-neighbor credit flow control (unicast below control priority)
+#define MESH_FLOW_PEERS 16                 // Neighbors with credit state
+#define MESH_FLOW_WINDOW 16                // Credited frames a receiver accepts in flight
+#define MESH_FLOW_LOW_HEAP 32768           // Free heap below which credits are withheld
+#define MESH_FLOW_GRANT_INTERVAL_MS 1000   // Spacing of grant refreshes between window halves
+#define MESH_FLOW_STALL_MS 3000            // A stalled sender resyncs after this long without a grant
+
+// Payload compression (before encryption)
+#define MESH_COMPRESS_MIN_BYTES 48         // Smaller payloads are sent as-is
+#define MESH_COMPRESS_MIN_SAVING 8         // Bytes a frame must shrink by to go out compressed
+#define MESH_COMPRESS_HASH_BITS 9          // Match finder table: 2^bits x 2 bytes
+#define MESH_COMPRESS_MAX_DICTIONARY 256   // Static dictionary bytes per message type
+#define MESH_COMPRESS_BACKOFF 16           // Messages of a type sent raw after repeated misses
+
+// Topic publish/subscribe
+#define MESH_TOPIC_MAX_LOCAL 16            // Topics this node can subscribe to
+#define MESH_TOPIC_DIGEST_BYTES 16         // Bloom digest each node advertises (two bits per topic)
+#define MESH_TOPIC_FORWARD_MEMORY 32       // Recent topic frames remembered so each is forwarded once
+#define MESH_TOPIC_READVERTISE_MS 2000     // Minimum gap between digest adverts prompted by new nodes
+#define MESH_TOPIC_RELAY_FRAMES 4          // Authenticated topic frames awaiting forwarding by update()
+#define MESH_TOPIC_RELAY_BYTES 2048        // Frame space those share
+
+// SMS job distribution (coordinator placement and work pulling)
+#define MESH_JOB_QUEUE_SLOTS 8             // Jobs held per node (submitted, waiting or running)
+#define MESH_JOB_MAX_BODY 200              // Opaque job bytes (destination number and text)
+#define MESH_JOB_MAX_ATTEMPTS 3            // Sends tried before a job is reported failed
+#define MESH_JOB_DEFAULT_SEND_MS 5000      // Assumed send time for nodes with no history yet
+#define MESH_JOB_COORDINATOR_MIN_HEAP 8    // Free heap (4 KB units) a node needs to coordinate
+#define MESH_JOB_PULL_THRESHOLD 3          // Queue depth that makes a node a pull target
+#define MESH_JOB_PULL_INTERVAL_MS 2000     // Minimum gap between pull requests from an idle node
+#define MESH_JOB_PLACE_TIMEOUT_MS 5000     // Unanswered placement requests are repeated after this long
+#define MESH_JOB_REPLY_SLOTS 8             // Placement answers waiting to leave the coordinator
+#define MESH_JOB_RESULT_SLOTS 8            // Completion reports waiting to reach the coordinator
+#define MESH_JOB_DECISION_LOG 8            // Recent placement decisions kept for inspection
+#define MESH_JOB_WAIT_BUCKETS 16           // Power-of-two ms buckets (<1ms .. >=16s)
+
+// Mesh time synchronization (NTP-style exchanges toward the lowest live node ID)
+#define MESH_TIME_POLL_MS 16000            // Spacing of exchanges with the parent once settled
+#define MESH_TIME_FAST_POLL_MS 2000        // Spacing until the sample filter is half full
+#define MESH_TIME_SAMPLES 8                // Recent exchanges the best estimate is chosen from
+#define MESH_TIME_MAX_DELAY_MS 1000        // Exchanges with a longer round trip are discarded
+#define MESH_TIME_DRIFT_PPM 50             // Clock drift assumed when widening the error bound
+#define MESH_TIME_MAX_SKEW_PPM 500         // Largest rate correction believed
+#define MESH_TIME_SKEW_SPAN_MS 120000      // Minimum gap between samples a rate is measured over
+#define MESH_TIME_MAX_HOLD_MS 1000         // Backward corrections up to this are absorbed by holding the clock
+#define MESH_TIME_MASTER_TIMEOUT_MS 64000  // A master heard of only through responses is dropped after this
+#define MESH_TIME_MAX_STRATUM 32           // Responses this far from their master are refused (stale master loops)
+
+// Latency histograms (per stage, message type and hop count)
+#define MESH_LATENCY_MAX_SERIES 32         // Histograms kept, ~400 bytes each (power of two)
+#define MESH_LATENCY_REPORT_MS 60000       // Spacing of reports to the collector, once one is set
+
+// Link quality (per-neighbor probes, ETX-style costs for routing)
+#define MESH_LINK_PROBE_MS 5000            // Spacing of probes to each neighbor
+#define MESH_LINK_WINDOW 16                // Recent probes each delivery ratio is taken over (<= 32)
+#define MESH_LINK_COST_UNIT 16             // Cost of a clean link (one expected transmission)
+#define MESH_LINK_COST_HYSTERESIS 25       // Percent the estimate must drift before routing sees it
+#define MESH_LINK_RTT_UNIT_MS 50           // Probe round trip worth one cost point
+
+// Store-and-forward (flash-backed queue for messages that must survive partitions)
+#define MESH_STORE_PARTITION "meshq"       // Data partition label (see partitions.csv)
+#define MESH_STORE_SECTOR_SIZE 4096        // Flash erase unit
+#define MESH_STORE_SECTORS 16              // Sectors of the partition used, one always kept erased
+#define MESH_STORE_MAX_RECORDS 64          // Records waiting at once (RAM index entries)
+#define MESH_STORE_MAX_AGE_MS 86400000     // Records unacknowledged this long are given up
+#define MESH_STORE_RETRY_MS 5000           // First retransmission wait, doubled per attempt
+#define MESH_STORE_RETRY_MAX_MS 300000     // Retransmission wait ceiling
+#define MESH_STORE_REPLAY_PER_SEC 4        // Transmissions per second, also the burst after reconnecting
+#define MESH_STORE_DEDUP_ENTRIES 64        // Receiver: (origin, ID) pairs remembered
+#define MESH_STORE_DEDUP_MS 21600000       // Receiver: how long each is remembered
+
+// Frame buffer pool (fixed slabs for the send/receive path)
+#define MESH_BUFFER_SMALL_SIZE 64          // Control records and their frames
+#define MESH_BUFFER_SMALL_COUNT 16
+#define MESH_BUFFER_MEDIUM_SIZE 384        // Queued records, small frames and their armor
+#define MESH_BUFFER_MEDIUM_COUNT 8
+#define MESH_BUFFER_LARGE_SIZE 1376        // Full frames and their base64 armor
+#define MESH_BUFFER_LARGE_COUNT 6
+
+// Receive worker (decryption and dispatch off the loop() task)
+#define MESH_RX_RING_SLOTS 8               // Frames buffered between receive and the worker (power of two)
+#define MESH_RX_TASK_CORE 0                // Core for the worker (loop() runs on 1); -1 leaves it unpinned
+#define MESH_RX_TASK_PRIORITY 2
+#define MESH_RX_TASK_STACK 6144            // Bytes; handlers run on this stack
+#define MESH_RX_LATENCY_BUCKETS 16         // Power-of-two us buckets (<1us .. >=16ms)
+#define MESH_RX_STATS_PUBLISH_MS 1000      // How often the worker copies its statistics for other tasks
+#define MESH_RX_DEFERRED_SENDS 4           // Handler sends too large to queue, held for the next update()
+#define MESH_RX_DEFERRED_BYTES 4096        // Payload space those sends share
+
+// Receive dispatch (message types 0..MESH_DISPATCH_TABLE_SIZE-1)
+#define MESH_DISPATCH_TABLE_SIZE 32
+
 #endif // MESH_CONFIG_H
\ No newline at end of file
@@ -2,7 +2,9 @@
 #ifndef SECURITY_CONFIG_H
 #define SECURITY_CONFIG_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#endif
 
 // Security configuration flags
 // NOTE: AES and HMAC keys must NOT be hardcoded. Use `SecureKeyManager` to
@@ -11,6 +13,17 @@
 // Key rotation interval (ms)
 #define KEY_ROTATION_INTERVAL 86400000  // 24 hours in milliseconds
 
+// HMAC replay filter (see HMACReplayFilter)
+#define HMAC_REPLAY_WINDOW_MS 300000       // Timestamps older than this are stale
+#define HMAC_REPLAY_FUTURE_MS 60000        // Clock skew tolerated ahead of the local clock
+#define HMAC_REPLAY_PEERS 256              // Senders tracked by sequence number (4-way sets)
+#define HMAC_REPLAY_SEQ_WINDOW 128         // Sequence numbers tracked behind each sender's newest (bits)
+#define HMAC_REPLAY_REORDER_MS 2000        // Timestamp regression tolerated for a newer sequence number
+#define HMAC_REPLAY_BUCKET_MS 40000        // Time slice per nonce bucket
+#define HMAC_REPLAY_BUCKET_SLOTS 2400      // Nonces held per bucket (multiple of 8): about 2800 a minute
+#define HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT 0 // 1: past that, accept nonces unrecorded instead of refusing them
+#define HMAC_REPLAY_MEMORY_LIMIT 65536     // Ceiling for the tables above, checked at compile time
+
 // Build flags to enable platform-level security features (set via build system)
 #define SECURE_BOOT_ENABLED 1
 #define FLASH_ENCRYPTION_ENABLED 1
@@ -3,17 +3,30 @@
 #define AES256_ENCRYPTION_H
 
 #include <Arduino.h>
-#include <AES256.h>
-
+#include "aes_cipher.h"
+
+/**
+ * @brief AES-256 ECB with PKCS#7 padding, as hex Strings or over byte spans
+ *
+ * The String calls keep their wire format (uppercase hex, 32 characters per
+ * block) and work through the bulk cipher a chunk at a time. The span calls
+ * produce the same bytes without the hex. Callers that want CBC, CTR or GCM
+ * use getCipher(), which shares the key schedule.
+ */
 class AES256Encryption {
 public:
     AES256Encryption();
-    bool begin();
+    bool begin();                                   // Key from SecureKeyManager
+    bool begin(const uint8_t* key, size_t keyLen);
 
     // Core encryption/decryption
     String encrypt(const String& plaintext);
     String decrypt(const String& ciphertext);
 
+    // Byte spans; output needs room for len rounded up to the next whole block
+    bool encrypt(const uint8_t* input, size_t len, uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool decrypt(const uint8_t* input, size_t len, uint8_t* output, size_t outputCap, size_t* outputLen);
+
     // HMAC for integrity
     String generateHMAC(const String& message);
     bool verifyHMAC(const String& message, const String& hmac);
@@ -21,14 +34,11 @@ public:
     // Key management
     bool rotateKey();
     bool isInitialized();
+    AesCipher& getCipher();
 
 private:
-    AES256 aes;
+    AesCipher cipher;
     bool initialized;
-
-    // Padding helpers
-    String padString(const String& input);
-    String unpadString(const String& input);
 };
 
-#endif // AES256_ENCRYPTION_H
\ No newline at end of file
+#endif // AES256_ENCRYPTION_H
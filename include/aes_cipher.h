@@ -0,0 +1,97 @@
+// AES Cipher Header
+#ifndef AES_CIPHER_H
+#define AES_CIPHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
+#endif
+
+enum AesBackend {
+    AES_BACKEND_PORTABLE = 0,   // Table-driven software, any CPU
+    AES_BACKEND_AESNI = 1,      // x86 AES-NI instructions (host, when the CPU has them)
+    AES_BACKEND_HARDWARE = 2    // mbedtls on the ESP32-S3 AES peripheral
+};
+
+/**
+ * @brief AES-256 over byte spans with the backend chosen per platform
+ *
+ * The key schedule is expanded once in setKey() and reused for every call;
+ * nothing is allocated per call. On target everything goes through mbedtls,
+ * which drives the ESP32-S3 AES accelerator (bulk CBC/CTR/GCM by DMA). Host
+ * builds use AES-NI when the CPU has it, several blocks in flight at a time,
+ * and otherwise a table-driven portable implementation (not constant-time:
+ * for tests, the simulator and benchmarks, not for secrets on shared hosts).
+ *
+ * Modes: ECB and CBC over whole blocks (padding is the caller's), CTR over
+ * any length with a full 128-bit big-endian counter as in SP 800-38A, and
+ * GCM with a 96-bit nonce and a 16-byte tag. Input and output may be the
+ * same buffer.
+ */
+class AesCipher {
+public:
+    static const size_t BLOCK_SIZE = 16;
+    static const size_t KEY_SIZE = 32;
+    static const size_t GCM_NONCE_SIZE = 12;
+    static const size_t GCM_TAG_SIZE = 16;
+
+    AesCipher();
+    ~AesCipher();
+
+    // Key setup (expands the schedule); a backend that is not available here is refused
+    bool setKey(const uint8_t* key, size_t keyLen);
+    void clearKey();
+    bool useBackend(AesBackend backend);
+    AesBackend getBackend() const;
+    bool hasKey() const;
+    static const char* backendName(AesBackend backend);
+
+    // Whole blocks only (len a multiple of BLOCK_SIZE)
+    bool encryptEcb(const uint8_t* input, uint8_t* output, size_t len);
+    bool decryptEcb(const uint8_t* input, uint8_t* output, size_t len);
+    // iv is updated to the last ciphertext block, so calls chain
+    bool encryptCbc(uint8_t* iv, const uint8_t* input, uint8_t* output, size_t len);
+    bool decryptCbc(uint8_t* iv, const uint8_t* input, uint8_t* output, size_t len);
+
+    // Any length; counter is the first counter block and is left untouched
+    bool cryptCtr(const uint8_t* counter, const uint8_t* input, uint8_t* output, size_t len);
+
+    // openGcm leaves output zeroed when the tag does not match
+    bool sealGcm(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* input, uint8_t* output,
+                 size_t len, uint8_t* tag);
+    bool openGcm(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* input, uint8_t* output,
+                 size_t len, const uint8_t* tag);
+
+private:
+    bool keyed;
+    AesBackend backend;
+
+#ifdef ARDUINO
+    mbedtls_aes_context encryptContext;
+    mbedtls_aes_context decryptContext;
+    mbedtls_gcm_context gcm;
+#else
+    static const int ROUNDS = 14;
+
+    uint8_t key[KEY_SIZE];                              // Kept to re-expand on a backend switch
+    alignas(16) uint32_t encryptKeys[4 * (ROUNDS + 1)]; // Portable: big-endian words
+    alignas(16) uint32_t decryptKeys[4 * (ROUNDS + 1)]; // Equivalent inverse cipher
+    alignas(16) uint8_t niEncryptKeys[16 * (ROUNDS + 1)];
+    alignas(16) uint8_t niDecryptKeys[16 * (ROUNDS + 1)];
+    uint64_t ghashHigh[16];                             // 4-bit multiples of the GCM hash key H
+    uint64_t ghashLow[16];
+
+    void expandKey();
+    void encryptBlocks(const uint8_t* input, uint8_t* output, size_t blocks);
+    void decryptBlocks(const uint8_t* input, uint8_t* output, size_t blocks);
+    void ghashMultiply(uint8_t* x);
+    void ghash(uint8_t* state, const uint8_t* data, size_t len);
+    void gcmTag(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* ciphertext, size_t len,
+                uint8_t* tag);
+#endif
+};
+
+#endif // AES_CIPHER_H
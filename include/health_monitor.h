@@ -22,6 +22,8 @@ struct SystemHealth {
     // Network
     uint32_t meshConnections;
     float networkHealth; // 0.0 to 1.0
+    float meshBufferPeak; // Fullest frame buffer class at its high-water mark, 0.0 to 1.0
+    uint32_t meshBufferFailures; // Frames dropped for want of a pool buffer
 
     // SIM cards
     uint32_t activeSims;
@@ -50,6 +52,7 @@ private:
     unsigned long lastHealthCheck;
     uint32_t consecutiveFailures;
     bool systemHealthy;
+    uint32_t lastBufferFailures;
 
     void performHealthCheck();
     float calculateOverallHealth(const SystemHealth& health);
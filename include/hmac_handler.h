@@ -2,9 +2,29 @@
 #define HMAC_HANDLER_H
 
 #include <Arduino.h>
-#include <mbedtls/md.h>
 #include <mbedtls/sha256.h>
 #include "secure_key_manager.h"
+#include "hmac_replay_filter.h"
+
+// Clock for message timestamps; millis() when none is set
+typedef uint32_t (*HMACTimeSource)(void* context);
+
+// One piece of a message that is signed as the concatenation of its pieces
+struct HMACSegment {
+    const uint8_t* data;
+    size_t len;
+};
+
+// One sealed frame for verifyMany(); verified and messageLen are filled in
+struct HMACFrame {
+    const uint8_t* sealed;
+    size_t sealedLen;
+    uint32_t peer;          // From the signed header, as for unsealFrom()
+    uint32_t sequence;
+    bool sequenced;         // Track by sequence number rather than nonce
+    bool verified;
+    size_t messageLen;
+};
 
 /**
  * @brief HMAC-SHA256 Message Authentication Handler
@@ -17,7 +37,36 @@
  * - Security: Prevents message tampering and replay attacks
  * 
  * Message Format:
- * [Payload (variable)] + [HMAC (32 bytes)] + [Timestamp (4 bytes)] + [Nonce (4 bytes)]
+ * [Payload (variable)] + [Timestamp (4 bytes)] + [Nonce (4 bytes)] + [HMAC (32 bytes)]
+ *
+ * The 40-byte trailer is computed by streaming each payload segment and the
+ * timestamp/nonce straight into the HMAC, so nothing is allocated or
+ * concatenated: seal() writes it into tail room the caller left after the
+ * payload, and sealSegments() signs a payload split across buffers (header,
+ * body) into a separate trailer.
+ *
+ * Replays are caught by an HMACReplayFilter (see security_config.h for its
+ * window and memory ceiling). Plain verification keys the nonce check on the
+ * trailer alone; unsealFrom() adds the sending node, and unsealSequenced()
+ * uses a per-sender sequence number. Both values must be read from the signed
+ * payload (e.g. the frame header), never from the transport, or a capture can
+ * be replayed under another sender's name.
+ *
+ * Nonce-keyed checks (verifyMessage(), unseal(), unsealFrom()) share one
+ * fixed table that holds about 2800 messages a minute across all senders
+ * with the defaults. Past that, new messages are refused as REPLAY_OVERFLOW
+ * until older time slices age out, or with HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT
+ * let through unrecorded. unsealSequenced() has no such ceiling.
+ *
+ * The SHA-256 states after the key's inner and outer pad blocks are computed
+ * once per key (begin(), reloadKey()) and cloned per message, so an HMAC
+ * costs the message's own blocks plus one outer block. verifyMany() checks a
+ * burst of queued frames in one pass, reading the clock once and logging
+ * once for the whole batch.
+ *
+ * Mesh frames do not come through here: MeshNetworkManager seals and opens
+ * them with MeshAEAD (AES-256-GCM), whose tag already authenticates them.
+ * verifyMany() is for callers that queue HMAC-sealed messages of their own.
  */
 class HMACHandler {
 public:
@@ -27,24 +76,51 @@ public:
     // Initialization
     bool begin();
     
+    // Picks up a rotated key from the key manager and rebuilds the midstates
+    bool reloadKey();
+    
+    // Timestamps come from millis() unless a shared clock is supplied; replay
+    // windows only mean something across nodes on a synchronized clock
+    void setTimeSource(HMACTimeSource source, void* context);
+    
     // Message signing
     bool signMessage(const uint8_t* message, size_t messageLen, 
                     uint8_t* signature, size_t* signatureLen);
     
-    // Message verification
+    // Message verification; nonce-keyed, so subject to the replay table's ceiling (see above)
     bool verifyMessage(const uint8_t* message, size_t messageLen,
                       const uint8_t* signature, size_t signatureLen);
     
-    // Combined operations (message + HMAC)
+    // Combined operations (message + HMAC); output needs messageLen + OVERHEAD bytes
     bool appendHMAC(const uint8_t* message, size_t messageLen,
-                   uint8_t* output, size_t* outputLen);
+                   uint8_t* output, size_t outputCap, size_t* outputLen);
     
     bool verifyAndExtract(const uint8_t* signedMessage, size_t signedLen,
                          uint8_t* message, size_t* messageLen);
     
+    // In place: the trailer goes into buffer[messageLen..], bufferCap must leave OVERHEAD bytes
+    bool seal(uint8_t* buffer, size_t messageLen, size_t bufferCap, size_t* sealedLen);
+    // Nonce-keyed like verifyMessage(): refused as overflow past the ceiling
+    bool unseal(const uint8_t* sealed, size_t sealedLen, size_t* messageLen);
+    
+    // Scatter/gather: the message is the segments in order, the trailer is kept apart
+    bool sealSegments(const HMACSegment* segments, size_t count,
+                     uint8_t* trailer, size_t trailerCap, size_t* trailerLen);
+    bool verifySegments(const HMACSegment* segments, size_t count,
+                       const uint8_t* trailer, size_t trailerLen);
+    
+    // Returns how many frames verified; each frame's verified flag says which
+    size_t verifyMany(HMACFrame* frames, size_t count);
+    
+    // Per-sender replay tracking; peer and sequence come from the signed message
+    bool unsealFrom(uint32_t peer, const uint8_t* sealed, size_t sealedLen, size_t* messageLen);
+    bool unsealSequenced(uint32_t peer, uint32_t sequence,
+                        const uint8_t* sealed, size_t sealedLen, size_t* messageLen);
+    
     // Replay attack prevention
     bool isReplayAttack(uint32_t timestamp, uint32_t nonce);
     void updateReplayCache(uint32_t timestamp, uint32_t nonce);
+    HMACReplayStats getReplayStats() const;
     
     // Constants
     static const size_t HMAC_SIZE = 32;  // SHA256 output size
@@ -54,25 +130,33 @@ public:
     
 private:
     SecureKeyManager* keyManager;
-    mbedtls_md_context_t md_ctx;
     uint8_t hmacKey[32];
     
+    // SHA-256 states after absorbing (key ^ ipad) and (key ^ opad)
+    mbedtls_sha256_context innerMidstate;
+    mbedtls_sha256_context outerMidstate;
+    bool midstatesReady;
+    HMACTimeSource timeSource;
+    void* timeSourceContext;
+    
     // Replay attack prevention
-    static const size_t REPLAY_CACHE_SIZE = 100;
-    struct ReplayCacheEntry {
-        uint32_t timestamp;
-        uint32_t nonce;
-        bool used;
-    };
-    ReplayCacheEntry replayCache[REPLAY_CACHE_SIZE];
-    size_t replayCacheIndex;
-    
-    // Replay attack time window (5 minutes)
-    static const uint32_t REPLAY_WINDOW_MS = 300000;
-    
-    bool computeHMAC(const uint8_t* data, size_t dataLen,
-                    const uint8_t* key, size_t keyLen,
-                    uint8_t* hmac, size_t* hmacLen);
+    HMACReplayFilter replayFilter;
+    
+    // HMAC over the segments followed by the stamp (timestamp + nonce, may be null)
+    bool computeHMAC(const HMACSegment* segments, size_t count,
+                    const uint8_t* stamp, uint8_t* hmac);
+    void loadMidstates();
+    
+    // Replay check, HMAC check, then record; verdict says why a fresh-looking
+    // message failed (REPLAY_ACCEPT there means the HMAC did not match)
+    bool authenticate(const HMACSegment* segments, size_t count, const uint8_t* trailer,
+                     uint32_t peer, const uint32_t* sequence, uint32_t now, HMACReplayVerdict* verdict);
+    
+    // sequence is null for nonce-keyed replay tracking
+    bool checkTrailer(const HMACSegment* segments, size_t count, const uint8_t* trailer,
+                     uint32_t peer, const uint32_t* sequence);
+    bool unsealWith(uint32_t peer, const uint32_t* sequence,
+                   const uint8_t* sealed, size_t sealedLen, size_t* messageLen);
     
     uint32_t getCurrentTimestamp();
     uint32_t generateNonce();
@@ -0,0 +1,119 @@
+// HMAC Replay Filter Header
+#ifndef HMAC_REPLAY_FILTER_H
+#define HMAC_REPLAY_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/security_config.h"
+
+// Why a message was refused; REPLAY_ACCEPT lets it through to the HMAC check
+enum HMACReplayVerdict : uint8_t {
+    REPLAY_ACCEPT = 0,
+    REPLAY_STALE,           // Timestamp older than HMAC_REPLAY_WINDOW_MS
+    REPLAY_FUTURE,          // Timestamp further ahead than HMAC_REPLAY_FUTURE_MS
+    REPLAY_DUPLICATE,       // Sequence number or nonce already recorded
+    REPLAY_OUT_OF_WINDOW,   // Sequence number behind the sender's sliding window
+    REPLAY_OVERFLOW         // Nonce bucket full: refused rather than forgetting an older nonce
+                            // (unless HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT)
+};
+
+struct HMACReplayStats {
+    uint32_t accepted;
+    uint32_t stale;
+    uint32_t future;
+    uint32_t duplicate;
+    uint32_t outOfWindow;
+    uint32_t overflow;      // Nonces refused, or accepted unrecorded, because their bucket was full
+    uint32_t restarts;      // Senders whose sequence numbers started over with a newer timestamp
+    uint32_t evictions;     // Tracked senders displaced by new ones while still live
+    uint32_t peers;         // Senders tracked by sequence number now
+    uint32_t memoryBytes;
+};
+
+/**
+ * @brief Replay filter with constant-time checks per message
+ *
+ * Two ways to recognise a message already seen, both bounded in memory:
+ *
+ * - Sequenced senders: HMAC_REPLAY_PEERS entries in 4-way sets, each sender
+ *   hashed to two candidate sets. An entry holds the sender's newest sequence
+ *   number and a bitmap of the HMAC_REPLAY_SEQ_WINDOW numbers behind it
+ *   (IPsec-style sliding window). When both sets are full the least recently
+ *   heard sender is displaced, and loses its replay history.
+ * - Nonce-only messages: 16-bit fingerprints of (peer, timestamp, nonce) in
+ *   a ring of time buckets covering the replay window plus the future skew;
+ *   a bucket is wiped when its slot comes round to a new time slice, so
+ *   aging costs nothing per message. Within a bucket each nonce hashes to
+ *   two 8-way rows and goes into the emptier one, so a bucket is about 80%
+ *   full before a nonce finds both its rows taken. A check compares at most
+ *   16 fingerprints: an authentic nonce is mistaken for a replay about once
+ *   in 4000 checks with its rows full, and far more rarely at lower load.
+ *   When both rows are full the nonce is refused (REPLAY_OVERFLOW), or with
+ *   HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT let through without being recorded.
+ *
+ * check*() leave the filter untouched (counting only rejections) so a forged
+ * message cannot poison it; record*() is called once the HMAC has verified.
+ * The peer and sequence number must themselves be covered by the HMAC.
+ */
+class HMACReplayFilter {
+public:
+    HMACReplayFilter();
+
+    void reset();
+
+    HMACReplayVerdict checkSequence(uint32_t peer, uint32_t sequence, uint32_t timestamp, uint32_t now);
+    void recordSequence(uint32_t peer, uint32_t sequence, uint32_t timestamp, uint32_t now);
+
+    HMACReplayVerdict checkNonce(uint32_t peer, uint32_t timestamp, uint32_t nonce, uint32_t now);
+    void recordNonce(uint32_t peer, uint32_t timestamp, uint32_t nonce);
+
+    HMACReplayStats getStats() const;
+    static const char* verdictName(HMACReplayVerdict verdict);
+
+    static const size_t WAYS = 4;
+    static const size_t SETS = HMAC_REPLAY_PEERS / WAYS;
+    static const size_t WINDOW_WORDS = HMAC_REPLAY_SEQ_WINDOW / 32;
+    static const size_t BUCKETS = (HMAC_REPLAY_WINDOW_MS + HMAC_REPLAY_FUTURE_MS) / HMAC_REPLAY_BUCKET_MS + 2;
+    static const size_t NONCE_WAYS = 8;
+    static const size_t NONCE_ROWS = HMAC_REPLAY_BUCKET_SLOTS / NONCE_WAYS;
+
+private:
+    struct PeerWindow {
+        uint32_t peer;
+        uint32_t top;               // Newest sequence number accepted
+        uint32_t topTimestamp;      // Its timestamp
+        uint32_t lastSeen;          // Local time of the last accepted message, for displacement
+        uint32_t bitmap[WINDOW_WORDS]; // Bit i set: top - i was accepted
+        bool active;
+    };
+
+    struct NonceBucket {
+        uint32_t epoch;             // Time slice (timestamp / HMAC_REPLAY_BUCKET_MS) held now
+        uint16_t count;
+        uint16_t slots[HMAC_REPLAY_BUCKET_SLOTS]; // Rows of NONCE_WAYS fingerprints, filled in order, 0 = empty
+    };
+
+    PeerWindow peers[SETS][WAYS];
+    NonceBucket buckets[BUCKETS];
+    HMACReplayStats stats;
+
+    HMACReplayVerdict checkAge(uint32_t timestamp, uint32_t now) const;
+    HMACReplayVerdict reject(HMACReplayVerdict verdict);
+    PeerWindow* candidateSet(uint32_t peer, size_t choice);
+    PeerWindow* findPeer(uint32_t peer, uint32_t now);
+    bool isLive(const PeerWindow& entry, uint32_t now) const;
+    static uint16_t fingerprint(uint32_t peer, uint32_t timestamp, uint32_t nonce, size_t* rows);
+    static void shiftWindow(uint32_t* bitmap, uint32_t count);
+};
+
+static_assert(HMAC_REPLAY_PEERS % HMACReplayFilter::WAYS == 0 && HMACReplayFilter::SETS >= 2,
+              "HMAC_REPLAY_PEERS must be a multiple of 4, at least 8");
+static_assert(HMAC_REPLAY_SEQ_WINDOW % 32 == 0 && HMAC_REPLAY_SEQ_WINDOW > 0,
+              "HMAC_REPLAY_SEQ_WINDOW must be a multiple of 32");
+static_assert(HMAC_REPLAY_BUCKET_SLOTS % HMACReplayFilter::NONCE_WAYS == 0 && HMACReplayFilter::NONCE_ROWS >= 2 &&
+              HMAC_REPLAY_BUCKET_SLOTS <= 65535,
+              "HMAC_REPLAY_BUCKET_SLOTS must be a multiple of 8, from 16 to 65528");
+static_assert(sizeof(HMACReplayFilter) <= HMAC_REPLAY_MEMORY_LIMIT,
+              "HMAC replay tables exceed HMAC_REPLAY_MEMORY_LIMIT");
+
+#endif // HMAC_REPLAY_FILTER_H
@@ -0,0 +1,62 @@
+#ifndef MESH_AEAD_H
+#define MESH_AEAD_H
+
+#include <Arduino.h>
+#include <mbedtls/gcm.h>
+#include "mesh_wire_frame.h"
+
+/**
+ * @brief AES-256-GCM authenticated encryption for mesh payloads
+ *
+ * Encrypts whole payloads of any length into a caller-owned buffer in a
+ * single pass. The GCM context is keyed once per key epoch and reused for
+ * every message; nothing is allocated per message.
+ *
+ * Nonce (96 bit): [boot salt (4)] + [source node (4)] + [frame seq (4)]
+ * The boot salt is random per boot so a reset sequence counter never
+ * repeats a nonce under the same key. The frame header fields that do not
+ * change in transit (type, flags, source, dest, seq, sentMs, key epoch) are
+ * authenticated as associated data, so the time-sync t3 and mesh-time
+ * transit stamps cannot be rewritten. Relays update hops, so it is excluded;
+ * version and length are checked by decode and by the tag over the payload.
+ *
+ * Sealed Payload Format:
+ * [Salt (4 bytes)] + [Ciphertext (plaintext length)] + [GCM Tag (16 bytes)]
+ */
+class MeshAEAD {
+public:
+    MeshAEAD();
+    ~MeshAEAD();
+
+    // Initialization / key rotation
+    bool begin(const uint8_t* key, size_t keyLen, uint16_t keyEpoch);
+    bool setKey(const uint8_t* key, size_t keyLen, uint16_t keyEpoch);
+    uint16_t getKeyEpoch();
+    void refreshSalt();
+
+    // Payload protection (output must hold len + OVERHEAD bytes)
+    bool seal(const MeshFrameHeader& header, const uint8_t* plaintext, size_t len,
+              uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool open(const MeshFrameHeader& header, const uint8_t* sealed, size_t sealedLen,
+              uint8_t* output, size_t outputCap, size_t* outputLen);
+
+    // Constants
+    static const size_t KEY_SIZE = 32;
+    static const size_t SALT_SIZE = 4;
+    static const size_t NONCE_SIZE = 12;
+    static const size_t TAG_SIZE = 16;
+    static const size_t OVERHEAD = SALT_SIZE + TAG_SIZE; // 20 bytes
+
+private:
+    mbedtls_gcm_context gcm;
+    bool initialized;
+    uint16_t epoch;
+    uint8_t salt[SALT_SIZE];
+
+    static const size_t AAD_SIZE = 20;
+
+    void buildNonce(const uint8_t* saltBytes, const MeshFrameHeader& header, uint8_t* nonce);
+    void buildAAD(const MeshFrameHeader& header, uint8_t* aad);
+};
+
+#endif // MESH_AEAD_H
@@ -0,0 +1,113 @@
+// Mesh Buffer Pool Header
+#ifndef MESH_BUFFER_POOL_H
+#define MESH_BUFFER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+enum MeshBufferClass : uint8_t {
+    MESH_BUFFER_SMALL = 0,
+    MESH_BUFFER_MEDIUM = 1,
+    MESH_BUFFER_LARGE = 2,
+    MESH_BUFFER_CLASS_COUNT = 3
+};
+
+struct MeshBufferPoolStats {
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint32_t inUse;
+    uint32_t highWater;     // Most blocks held at once
+    uint32_t acquired;
+    uint32_t fallbacks;     // Served from a larger class because this one was empty
+    uint32_t failures;      // Requests that found no block large enough
+};
+
+class MeshBufferPool;
+
+/**
+ * @brief Owning handle to one pool block
+ *
+ * Move-only: ownership passes along the frame path with the handle and the
+ * block goes back to its pool when the last owner goes out of scope. A
+ * default-constructed or moved-from handle owns nothing.
+ */
+class MeshBuffer {
+public:
+    MeshBuffer();
+    ~MeshBuffer();
+    MeshBuffer(MeshBuffer&& other);
+    MeshBuffer& operator=(MeshBuffer&& other);
+    MeshBuffer(const MeshBuffer&) = delete;
+    MeshBuffer& operator=(const MeshBuffer&) = delete;
+
+    uint8_t* data() { return block; }
+    const uint8_t* data() const { return block; }
+    size_t capacity() const { return blockSize; }
+    bool valid() const { return block != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    void release();
+
+private:
+    friend class MeshBufferPool;
+    MeshBuffer(MeshBufferPool* owner, uint8_t bufferClass, uint16_t index, uint8_t* block, size_t blockSize);
+
+    MeshBufferPool* owner;
+    uint8_t* block;
+    size_t blockSize;
+    uint16_t index;
+    uint8_t bufferClass;
+};
+
+/**
+ * @brief Fixed slab pools for frame-sized scratch buffers
+ *
+ * Three size classes are carved out of storage inside the pool object, so
+ * taking and returning a block is a free-list pop/push and never touches the
+ * heap. A request is served from the smallest class that fits and moves up
+ * a class when that one is exhausted; only when no class can serve it does
+ * acquire() return an empty handle and count a failure.
+ *
+ * Blocks are handed out uninitialized. Not thread-safe; the manager uses
+ * its pool from loop() only.
+ */
+class MeshBufferPool {
+public:
+    MeshBufferPool();
+
+    MeshBuffer acquire(size_t size);
+
+    // Statistics (high-water marks survive resetStats)
+    MeshBufferPoolStats getStats(MeshBufferClass bufferClass);
+    void resetStats();
+
+private:
+    friend class MeshBuffer;
+
+    struct SizeClass {
+        uint8_t* storage;
+        size_t blockSize;
+        uint16_t* freeList;
+        uint16_t freeCount;
+        MeshBufferPoolStats stats;
+    };
+
+    SizeClass classes[MESH_BUFFER_CLASS_COUNT];
+
+    uint8_t smallBlocks[MESH_BUFFER_SMALL_COUNT * MESH_BUFFER_SMALL_SIZE];
+    uint8_t mediumBlocks[MESH_BUFFER_MEDIUM_COUNT * MESH_BUFFER_MEDIUM_SIZE];
+    uint8_t largeBlocks[MESH_BUFFER_LARGE_COUNT * MESH_BUFFER_LARGE_SIZE];
+    uint16_t smallFree[MESH_BUFFER_SMALL_COUNT];
+    uint16_t mediumFree[MESH_BUFFER_MEDIUM_COUNT];
+    uint16_t largeFree[MESH_BUFFER_LARGE_COUNT];
+
+    void initClass(SizeClass& sizeClass, uint8_t* storage, size_t blockSize, uint16_t* freeList, uint16_t count);
+    void release(uint8_t bufferClass, uint16_t index);
+
+    // Copying would duplicate blocks that live handles point into
+    MeshBufferPool(const MeshBufferPool&) = delete;
+    MeshBufferPool& operator=(const MeshBufferPool&) = delete;
+};
+
+#endif // MESH_BUFFER_POOL_H
@@ -0,0 +1,44 @@
+// Mesh Byte Helpers - little-endian field access and slot reuse shared by the mesh modules
+#ifndef MESH_BYTES_H
+#define MESH_BYTES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+inline void putU16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+inline void putU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+inline uint16_t getU16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+inline uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Free slot (nodeId 0) first, otherwise the one whose timestamp is oldest
+template <typename Slot>
+Slot* meshOldestSlot(Slot* slots, size_t count, uint32_t Slot::*stampMs) {
+    Slot* slot = &slots[0];
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].nodeId == 0) {
+            return &slots[i];
+        }
+        if ((int32_t)(slots[i].*stampMs - slot->*stampMs) < 0) {
+            slot = &slots[i];
+        }
+    }
+    return slot;
+}
+
+#endif // MESH_BYTES_H
@@ -0,0 +1,77 @@
+// Mesh Compressor Header
+#ifndef MESH_COMPRESSOR_H
+#define MESH_COMPRESSOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+struct MeshCompressionStats {
+    uint32_t attempted;
+    uint32_t compressed;      // Sent with FLAG_COMPRESSED
+    uint32_t notSmaller;      // Tried but saved less than MESH_COMPRESS_MIN_SAVING
+    uint32_t skipped;         // Not tried: too small or type backing off
+    uint32_t bytesIn;         // Plaintext bytes of compressed frames
+    uint32_t bytesOut;        // Their compressed size
+    uint32_t decompressed;
+    uint32_t decompressFailures;
+};
+
+/**
+ * @brief LZ77 payload compression with static per-type dictionaries
+ *
+ * An LZ4-style block codec sized for the ESP32: one hash table of
+ * 2^MESH_COMPRESS_HASH_BITS positions and a work buffer of one dictionary plus
+ * one frame, both members, so nothing is allocated per message. Each message
+ * type may have a static dictionary of typical content (JSON keys, operator
+ * names) that matches can reference from the first byte; sender and receiver
+ * must agree on it, so changing a dictionary is a protocol change.
+ *
+ * compress() refuses small payloads and results that save less than
+ * MESH_COMPRESS_MIN_SAVING bytes; a type that misses four times in a row is
+ * sent raw for the next MESH_COMPRESS_BACKOFF messages before trying again.
+ *
+ * Block Format: sequences of
+ * [token: literal count (4 bits) | match length - 4 (4 bits)]
+ * + [literal count extension] + [literals] + [offset (2, LE)] + [match length extension]
+ * Counts of 15 continue in extension bytes (255 = more follows). The last
+ * sequence has literals only. Offsets reach back into the dictionary.
+ */
+class MeshCompressor {
+public:
+    MeshCompressor();
+
+    bool setDictionary(uint8_t type, const uint8_t* dictionary, size_t len);
+
+    bool compress(uint8_t type, const uint8_t* input, size_t len,
+                  uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool decompress(uint8_t type, const uint8_t* input, size_t len,
+                    uint8_t* output, size_t outputCap, size_t* outputLen);
+
+    MeshCompressionStats getStats();
+    // Each side's counters alone, for when compress() and decompress() run on different tasks
+    MeshCompressionStats getEncodeStats();
+    MeshCompressionStats getDecodeStats();
+    void resetStats();
+
+    static const size_t MATCH_MIN_LENGTH = 4;
+    static const size_t MAX_BLOCK = MESH_MAX_FRAME_SIZE;
+
+private:
+    struct TypeState {
+        const uint8_t* dictionary;
+        uint16_t dictionaryLen;
+        uint8_t misses;
+        uint8_t backoff;
+    };
+
+    TypeState types[MESH_DISPATCH_TABLE_SIZE];
+    uint16_t hashTable[1 << MESH_COMPRESS_HASH_BITS];
+    uint8_t work[MESH_COMPRESS_MAX_DICTIONARY + MAX_BLOCK];
+    MeshCompressionStats stats;         // compress() counters
+    MeshCompressionStats decodeStats;   // decompress() counters
+
+    bool encodeBlock(size_t start, size_t end, uint8_t* output, size_t outputCap, size_t* outputLen);
+};
+
+#endif // MESH_COMPRESSOR_H
@@ -0,0 +1,63 @@
+// Mesh Dispatcher Header
+#ifndef MESH_DISPATCHER_H
+#define MESH_DISPATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+// Frame metadata handed to every handler alongside the decrypted payload
+struct MeshMessageInfo {
+    uint32_t from;      // Neighbour that delivered the frame
+    uint32_t source;    // Originating node
+    uint32_t seq;
+    uint32_t sentMs;    // Sender's mesh clock at transmission
+    uint32_t receivedMs;  // Our local clock when the frame arrived
+    uint32_t topic;     // Topic ID for published messages, 0 otherwise
+    uint8_t type;
+    uint8_t hops;
+};
+
+struct MeshHandlerStats {
+    uint32_t count;
+    uint32_t maxMicros;
+    uint64_t totalMicros;
+};
+
+typedef void (*MeshMessageHandler)(void* context, const MeshMessageInfo& info,
+                                   const uint8_t* data, size_t len);
+
+/**
+ * @brief Table-driven receive dispatch keyed by message type
+ *
+ * Replaces the string-compare chain in MeshNetworkManager::onReceive with a
+ * direct index into a fixed table of MESH_DISPATCH_TABLE_SIZE slots. Modules
+ * register a plain function plus context pointer at startup; each slot tracks
+ * call count and handler execution time.
+ */
+class MeshDispatcher {
+public:
+    MeshDispatcher();
+
+    bool registerHandler(uint8_t type, MeshMessageHandler handler, void* context);
+    bool unregisterHandler(uint8_t type);
+    bool hasHandler(uint8_t type);
+
+    bool dispatch(const MeshMessageInfo& info, const uint8_t* data, size_t len, uint32_t* elapsedUs = nullptr);
+
+    MeshHandlerStats getStats(uint8_t type);
+    uint32_t getUnhandledCount();
+    void resetStats();
+
+private:
+    struct Slot {
+        MeshMessageHandler handler;
+        void* context;
+        MeshHandlerStats stats;
+    };
+
+    Slot slots[MESH_DISPATCH_TABLE_SIZE];
+    uint32_t unhandled;
+};
+
+#endif // MESH_DISPATCHER_H
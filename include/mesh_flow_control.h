@@ -0,0 +1,92 @@
+// Mesh Flow Control Header
+#ifndef MESH_FLOW_CONTROL_H
+#define MESH_FLOW_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+struct MeshFlowStats {
+    uint32_t nodeId;
+    uint16_t credits;         // Frames we may still send to this neighbor
+    uint16_t peerWindow;      // Window the neighbor last granted us
+    uint32_t sent;            // Credited frames sent
+    uint32_t received;        // Credited frames received
+    uint32_t stalls;          // Times sending was held for lack of credit
+    uint32_t resyncs;         // Stalls cleared by timeout rather than a grant
+    uint32_t grantsSent;
+    uint32_t grantsReceived;
+};
+
+/**
+ * @brief Credit-based flow control between neighboring nodes
+ *
+ * Each frame flagged MeshWireFrame::FLAG_CREDITED costs the sender one credit
+ * with the neighbor it is handed to. Receivers return cumulative grants as
+ * they take frames in, sized by how much they can currently absorb (the
+ * manager shrinks the window as free heap falls), and senders hold queued
+ * traffic while a neighbor's window is full. Counts are cumulative, so a lost
+ * grant is repaired by the next one; a sender left without any grant for
+ * MESH_FLOW_STALL_MS writes off what is in flight and probes again.
+ *
+ * Grant Format (MESH_MSG_CREDIT):
+ * [frames received from you (4)] + [window (2)]
+ * Both little-endian. The sender may have received + window frames sent.
+ */
+class MeshFlowControl {
+public:
+    static const size_t GRANT_SIZE = 6;
+
+    MeshFlowControl();
+
+    // Sender side
+    bool canSend(uint32_t nodeId, uint32_t nowMs);
+    void onSent(uint32_t nodeId, uint32_t nowMs);
+    bool onGrant(uint32_t nodeId, const uint8_t* grant, size_t len, uint32_t nowMs);
+
+    // Receiver side
+    void setWindow(uint16_t frames);
+    uint16_t getWindow();
+    void onReceived(uint32_t nodeId, uint32_t nowMs);
+    bool nextGrant(uint32_t nowMs, uint32_t* nodeId, uint8_t* grant, size_t grantCap, size_t* grantLen);
+
+    void removePeer(uint32_t nodeId);
+
+    // Statistics
+    MeshFlowStats getStats(uint32_t nodeId);
+    size_t getPeers(MeshFlowStats* output, size_t outputCap);
+
+private:
+    struct Peer {
+        uint32_t nodeId;          // 0 = free
+        uint32_t lastUsedMs;
+
+        // Toward the neighbor
+        uint32_t sent;
+        uint32_t acknowledged;    // Its received count from the latest grant
+        uint32_t lastGrantMs;
+        uint32_t blockedSinceMs;
+        uint16_t peerWindow;
+        bool blocked;
+
+        // From the neighbor
+        uint32_t received;
+        uint32_t grantedAt;       // Our received count when we last granted
+        uint32_t lastGrantSentMs;
+        uint16_t grantedWindow;
+
+        uint32_t stalls;
+        uint32_t resyncs;
+        uint32_t grantsSent;
+        uint32_t grantsReceived;
+    };
+
+    Peer peers[MESH_FLOW_PEERS];
+    uint16_t window;
+
+    Peer* findPeer(uint32_t nodeId, uint32_t nowMs, bool create);
+    bool needsGrant(const Peer& peer, uint32_t nowMs);
+    MeshFlowStats statsFor(const Peer& peer);
+};
+
+#endif // MESH_FLOW_CONTROL_H
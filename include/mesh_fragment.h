@@ -0,0 +1,93 @@
+// Mesh Fragmentation Header
+#ifndef MESH_FRAGMENT_H
+#define MESH_FRAGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+#if MESH_REASSEMBLY_POOL_BLOCKS > 32
+#error "MESH_REASSEMBLY_POOL_BLOCKS must fit the 32-bit block and fragment bitmaps"
+#endif
+
+/**
+ * @brief Splits payloads too large for one frame into fixed-size fragments
+ *
+ * Fragment Format:
+ * [message id (2)] + [offset (2)] + [total length (2)] + [type (1)] + [data]
+ * All fields little-endian. Every fragment but the last carries exactly
+ * MESH_FRAGMENT_SIZE bytes, so offset / MESH_FRAGMENT_SIZE is its index.
+ */
+class MeshFragmenter {
+public:
+    static const size_t HEADER_SIZE = 7;
+    static const size_t MAX_MESSAGE = MESH_REASSEMBLY_POOL_BLOCKS * MESH_FRAGMENT_SIZE;
+
+    static size_t fragmentCount(size_t len);
+    static bool writeFragment(uint16_t messageId, uint8_t type, const uint8_t* data, size_t len,
+                              size_t index, uint8_t* output, size_t outputCap, size_t* outputLen);
+};
+
+struct MeshReassemblyStats {
+    uint32_t started;
+    uint32_t completed;
+    uint32_t timedOut;
+    uint32_t evicted;         // Dropped to make room for newer messages
+    uint32_t rejected;        // Malformed, inconsistent or larger than the pool
+    uint32_t duplicates;      // Fragments already held
+    uint32_t blocksInUse;
+    uint32_t blocksHighWater;
+};
+
+enum MeshReassemblyResult {
+    MESH_REASSEMBLY_PENDING,
+    MESH_REASSEMBLY_COMPLETE,
+    MESH_REASSEMBLY_DROPPED
+};
+
+/**
+ * @brief Bounded-memory reassembly straight into a shared block pool
+ *
+ * The first fragment of a message reserves a contiguous run of
+ * MESH_FRAGMENT_SIZE blocks for its total length; each fragment is copied
+ * once, to its final offset, and tracked in a 32-bit bitmap. A completed
+ * message is handed back in place and stays valid until the next call into
+ * the reassembler. Messages idle for MESH_REASSEMBLY_TIMEOUT_MS are dropped,
+ * and when the pool or slot table is exhausted the least recently active
+ * message is evicted, so memory stays fixed however many senders are busy.
+ */
+class MeshReassembler {
+public:
+    MeshReassembler();
+
+    MeshReassemblyResult onFragment(uint32_t source, const uint8_t* fragment, size_t len, uint32_t nowMs,
+                                    uint8_t* type, const uint8_t** message, size_t* messageLen);
+    void expire(uint32_t nowMs);
+
+    MeshReassemblyStats getStats();
+
+private:
+    struct Slot {
+        uint32_t source;        // 0 = free
+        uint32_t lastMs;
+        uint32_t received;      // Bit per fragment index
+        uint16_t messageId;
+        uint16_t total;
+        uint8_t type;
+        uint8_t firstBlock;
+        uint8_t blockCount;
+        bool complete;          // Handed out; freed on the next call
+    };
+
+    uint8_t pool[MESH_REASSEMBLY_POOL_BLOCKS * MESH_FRAGMENT_SIZE];
+    uint32_t usedBlocks;
+    Slot slots[MESH_REASSEMBLY_SLOTS];
+    MeshReassemblyStats stats;
+
+    void releaseSlot(Slot& slot);
+    void releaseCompleted();
+    int reserveBlocks(size_t count);
+    Slot* startMessage(uint32_t source, uint16_t messageId, uint16_t total, uint8_t type, uint32_t nowMs);
+};
+
+#endif // MESH_FRAGMENT_H
@@ -0,0 +1,84 @@
+// Mesh Heartbeat Header
+#ifndef MESH_HEARTBEAT_H
+#define MESH_HEARTBEAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+// Fields carried by a heartbeat; a keyframe carries all of them
+struct MeshHeartbeatSnapshot {
+    uint8_t freeHeapBucket;   // Free heap in 4 KB units (saturating)
+    uint16_t nodeCount;
+    uint32_t simActiveMask;   // Bit per SIM slot holding a healthy SIM
+    uint8_t smsQueueDepth;    // SMS jobs waiting or running here
+    uint8_t smsSendTime;      // Recent SMS send time in 100 ms units (saturating)
+};
+
+struct MeshPeerState {
+    uint32_t nodeId;
+    uint32_t lastSeenMs;
+    uint8_t keyframeId;
+    bool synced;              // False until a keyframe matching the deltas arrives
+    MeshHeartbeatSnapshot snapshot;   // Current view (keyframe + latest delta)
+    MeshHeartbeatSnapshot keyframe;   // Reference the deltas are taken against
+};
+
+/**
+ * @brief Delta-encoded heartbeats with an adaptive send interval
+ *
+ * Every HEARTBEAT_KEYFRAME_EVERY beats a keyframe carries the full snapshot.
+ * Beats in between carry only the fields that differ from that keyframe, so
+ * a lost delta never corrupts receiver state and a stable node sends a
+ * 3-byte liveness beat. The interval grows by half on each stable beat up to
+ * HEARTBEAT_MAX_INTERVAL and drops to HEARTBEAT_MIN_INTERVAL (with a forced
+ * keyframe) whenever connections change.
+ *
+ * Heartbeat Format:
+ * [flags (1)] + [keyframe id (1)] + [field mask (1)] + [present fields]
+ * Fields in mask order: heap bucket (1), node count (2, LE), SIM mask (4, LE),
+ * SMS queue depth (1), SMS send time (1)
+ */
+class MeshHeartbeatEncoder {
+public:
+    MeshHeartbeatEncoder();
+
+    bool encode(const MeshHeartbeatSnapshot& snapshot, uint8_t* output, size_t outputCap, size_t* outputLen);
+    void onTopologyChange();
+    uint32_t getIntervalMs();
+
+    static const size_t MAX_SIZE = 12;
+
+private:
+    MeshHeartbeatSnapshot keyframe;
+    uint8_t keyframeId;
+    uint8_t beatsSinceKeyframe;
+    bool forceKeyframe;
+    bool topologyChanged;
+    uint32_t intervalMs;
+};
+
+/**
+ * @brief Receiver-side peer table rebuilt from keyframes and deltas
+ *
+ * Fixed MESH_MAX_PEERS entries; when full the longest-silent peer is replaced.
+ */
+class MeshHeartbeatTable {
+public:
+    MeshHeartbeatTable();
+
+    bool apply(uint32_t nodeId, const uint8_t* data, size_t len, uint32_t nowMs);
+    const MeshPeerState* find(uint32_t nodeId);
+    bool isAlive(uint32_t nodeId, uint32_t nowMs);
+    size_t getPeerCount();
+    const MeshPeerState* getPeer(size_t index);
+    bool remove(uint32_t nodeId);
+
+private:
+    MeshPeerState peers[MESH_MAX_PEERS];
+    size_t peerCount;
+
+    MeshPeerState* slotFor(uint32_t nodeId, uint32_t nowMs);
+};
+
+#endif // MESH_HEARTBEAT_H
@@ -0,0 +1,233 @@
+// Mesh SMS Job Balancer Header
+#ifndef MESH_JOB_BALANCER_H
+#define MESH_JOB_BALANCER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mesh_heartbeat.h"
+#include "../config/mesh_config.h"
+
+struct MeshSmsJob {
+    uint32_t jobId;           // Unique per submitter
+    uint32_t submitter;
+    uint32_t waitMs;          // Queue wait so far, summed across the nodes that held it
+    uint8_t attempts;         // Sends already tried
+    uint16_t length;
+    uint8_t body[MESH_JOB_MAX_BODY];
+};
+
+struct MeshJobDecision {
+    uint32_t submitter;
+    uint32_t jobId;
+    uint32_t worker;          // Node the job was placed on
+    uint32_t expectedWaitMs;  // Its estimated wait when chosen
+    uint32_t atMs;
+    uint8_t candidates;       // Capable nodes considered
+};
+
+struct MeshJobStats {
+    uint32_t coordinator;
+    uint32_t elections;       // Times the elected coordinator changed
+    uint32_t submitted;       // Jobs submitted on this node
+    uint32_t placements;      // Placement decisions made here as coordinator
+    uint32_t unplaceable;     // Placements that found no node with a healthy SIM and a free slot
+    uint32_t assigned;        // Jobs sent here to run
+    uint32_t pulledIn;        // Jobs taken over from overloaded nodes
+    uint32_t pulledOut;       // Jobs handed to idle nodes that asked
+    uint32_t completed;       // Jobs sent from this node
+    uint32_t failed;          // Jobs given up after MESH_JOB_MAX_ATTEMPTS
+    uint32_t retried;         // Failed sends put back for placement
+    uint32_t dropped;         // Jobs arriving with no free slot
+    uint32_t queueDepth;      // Waiting or running here
+    uint32_t queueHighWater;
+
+    // Fleet view, from results reported to this node while coordinator
+    uint32_t reported;
+    uint32_t fleetSmsPerMinute;
+    uint32_t maxWaitMs;
+    uint32_t waitHistogram[MESH_JOB_WAIT_BUCKETS];
+};
+
+/**
+ * @brief Load-balanced SMS job placement across the mesh
+ *
+ * Every node advertises its SMS queue depth and recent send time in its
+ * heartbeat, alongside the healthy SIM mask and free heap already there.
+ * The coordinator is the lowest node ID among live, synced peers (and self)
+ * with at least MESH_JOB_COORDINATOR_MIN_HEAP free; every node derives the
+ * same choice from the same heartbeats, so no election traffic is needed.
+ * Only peers within reliable unicast range count, so on a mesh deeper than
+ * MAX_NETWORK_HOPS distant regions elect coordinators of their own.
+ *
+ * A submitted job stays on its submitter, which asks the coordinator where
+ * to run it and then sends it straight there; the coordinator holds no job
+ * bodies. It picks the capable node with the lowest expected wait:
+ *   (queue depth + jobs placed since its last report + 1) x send time / SIMs
+ *   + transfer penalty
+ * where the penalty, supplied with each heartbeat, prices the retransmits a
+ * lossy path toward that node is expected to cost (see MeshLinkQuality).
+ * Ties go to the shorter queue, then the lower ID; nodes whose slots would
+ * overflow are skipped. Queue depths in heartbeats lag, so idle nodes also
+ * pull: a node with SIMs and nothing queued asks the deepest peer at or above
+ * MESH_JOB_PULL_THRESHOLD for half its backlog, and that peer hands over up
+ * to half of its waiting jobs, newest first.
+ *
+ * Messages travel over reliable unicast; nextOutgoing() hands them out one at
+ * a time and outgoingDone() reports whether the send was accepted, so a job
+ * leaves its slot only once it has been handed on. Unanswered requests are
+ * repeated after MESH_JOB_PLACE_TIMEOUT_MS, possibly to a new coordinator.
+ * Queue wait is carried with the job and reported back on completion, giving
+ * the coordinator a fleet wait histogram and SMS/minute rate without
+ * synchronized clocks.
+ *
+ * Job Message Format (MESH_MSG_JOB), integers little-endian:
+ * REQUEST: [op (1)] + [submitter (4)] + [job id (4)]
+ * PLACE:   [op (1)] + [submitter (4)] + [job id (4)] + [worker (4)] + [expected wait ms (4)]
+ * ASSIGN / HANDOVER: [op (1)] + [submitter (4)] + [job id (4)] + [wait ms (4)] + [attempts (1)] + [body]
+ * RESULT:  [op (1)] + [submitter (4)] + [job id (4)] + [sent (1)] + [wait ms (4)] + [send ms (4)] + [depth (1)]
+ * PULL:    [op (1)] + [jobs wanted (1)] + [depth (1)]
+ */
+class MeshJobBalancer {
+public:
+    static const size_t JOB_HEADER_SIZE = 14;
+    static const size_t MAX_MESSAGE = JOB_HEADER_SIZE + MESH_JOB_MAX_BODY;
+
+    MeshJobBalancer();
+
+    // Local and peer state
+    void setSelf(uint32_t nodeId);
+    void setLocalCapacity(uint8_t heapBucket, uint32_t simActiveMask);
+    void onHeartbeat(const MeshPeerState& peer, bool reachable, uint32_t nowMs, uint32_t transferPenaltyMs = 0);
+    uint32_t getCoordinator(uint32_t nowMs);
+
+    // Submitting node
+    bool submit(const uint8_t* body, size_t len, uint32_t nowMs, uint32_t* jobId);
+
+    // Mesh traffic
+    bool receive(uint32_t from, const uint8_t* data, size_t len, uint32_t nowMs);
+    bool nextOutgoing(uint32_t nowMs, uint32_t* destId, uint8_t* output, size_t outputCap, size_t* outputLen);
+    void outgoingDone(bool sent, uint32_t nowMs);
+
+    // Executing node (sendMs is how long the modem took)
+    bool takeJob(uint32_t nowMs, MeshSmsJob* job);
+    bool completeJob(uint32_t jobId, uint32_t submitter, bool sent, uint32_t sendMs, uint32_t nowMs);
+
+    // Heartbeat fields
+    uint8_t getQueueDepth();
+    uint8_t getSendTimeUnits();
+
+    // Statistics
+    MeshJobStats getStats(uint32_t nowMs);
+    size_t getDecisions(MeshJobDecision* output, size_t outputCap);
+
+private:
+    enum Outgoing : uint8_t {
+        OUT_NONE = 0,
+        OUT_RESULT,
+        OUT_REPLY,
+        OUT_PULL,
+        OUT_JOB
+    };
+
+    enum SlotState : uint8_t {
+        SLOT_FREE = 0,
+        SLOT_UNPLACED,    // Needs a placement (asked for, or made here when coordinator)
+        SLOT_REQUESTED,   // Waiting for the coordinator's answer
+        SLOT_QUEUED,      // Waiting for a modem here
+        SLOT_RUNNING,     // Taken by the executor
+        SLOT_HANDOFF      // Waiting to be sent to the node that will run it
+    };
+
+    struct Slot {
+        uint8_t state;
+        uint8_t op;               // ASSIGN or HANDOVER while handing off
+        uint8_t fallback;         // State to return to if the handoff is refused
+        bool noted;               // Already counted as unplaceable
+        uint32_t destId;          // Handoff target
+        uint32_t arrivedMs;       // Start of the current local wait
+        uint32_t requestedMs;
+        MeshSmsJob job;
+    };
+
+    struct Worker {
+        uint32_t nodeId;          // 0 = free
+        uint32_t lastSeenMs;
+        uint32_t sendTimeMs;
+        uint32_t transferMs;      // Expected extra delivery time over the path to it
+        uint8_t heapBucket;
+        uint8_t sims;
+        uint8_t queueDepth;
+        uint8_t pending;          // Placed there since its last report
+        bool synced;
+        bool reachable;           // Within reliable unicast range of us
+    };
+
+    struct Reply {
+        uint32_t destId;
+        MeshJobDecision decision;
+    };
+
+    struct Result {
+        uint32_t submitter;
+        uint32_t jobId;
+        uint32_t waitMs;
+        uint32_t sendMs;
+        bool sent;
+    };
+
+    uint32_t self;
+    uint32_t coordinator;
+    uint8_t selfHeap;
+    uint8_t selfSims;
+    uint32_t selfSendTimeMs;
+    uint32_t nextJobId;
+    uint32_t lastPullMs;
+    bool pulledBefore;
+    uint32_t pullTarget;
+    uint8_t pullCount;
+    uint8_t inFlight;             // What nextOutgoing last handed out
+    size_t inFlightSlot;
+
+    Slot slots[MESH_JOB_QUEUE_SLOTS];
+    Worker workers[MESH_MAX_PEERS];
+    Reply replies[MESH_JOB_REPLY_SLOTS];
+    size_t replyHead;
+    size_t replyCount;
+    Result results[MESH_JOB_RESULT_SLOTS];
+    size_t resultHead;
+    size_t resultCount;
+    MeshJobDecision decisions[MESH_JOB_DECISION_LOG];
+    size_t decisionNext;
+    size_t decisionCount;
+
+    // Coordinator's SMS/minute: six 10 s buckets
+    static const size_t RATE_BUCKETS = 6;
+    static const uint32_t RATE_BUCKET_MS = 10000;
+    uint32_t rateCounts[RATE_BUCKETS];
+    uint32_t rateEpoch;           // Index of the current bucket since boot
+
+    MeshJobStats stats;
+
+    void elect(uint32_t nowMs);
+    bool usable(const Worker& worker, uint32_t nowMs);
+    Worker* findWorker(uint32_t nodeId);
+    Slot* freeSlot();
+    Slot* findSlot(uint32_t submitter, uint32_t jobId, uint8_t state);
+    uint8_t localDepth();
+    size_t countState(uint8_t state);
+    void noteDepth();
+    bool decide(uint32_t submitter, uint32_t jobId, uint32_t nowMs, MeshJobDecision* decision);
+    void applyPlacement(Slot& slot, uint32_t worker);
+    bool choosePull(uint32_t nowMs);
+    void handOver(uint32_t puller, uint8_t wanted);
+    bool acceptJob(uint8_t op, const uint8_t* data, size_t len, uint32_t nowMs);
+    void queueReply(uint32_t destId, const MeshJobDecision& decision);
+    void queueResult(const Result& result);
+    void recordResult(const Result& result, uint32_t nowMs);
+    void logDecision(const MeshJobDecision& decision);
+    void advanceRate(uint32_t nowMs);
+    static size_t waitBucket(uint32_t waitMs);
+    static uint32_t expectedWait(uint8_t depth, uint8_t pending, uint32_t sendTimeMs, uint8_t sims);
+};
+
+#endif // MESH_JOB_BALANCER_H
@@ -0,0 +1,158 @@
+// Mesh Latency Header
+#ifndef MESH_LATENCY_H
+#define MESH_LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+enum MeshLatencyStage : uint8_t {
+    MESH_LATENCY_TRANSIT = 0,     // Sender's transmit to our receive, on the mesh clock
+    MESH_LATENCY_QUEUED = 1,      // Our receive to handler start (ring wait, decryption, reassembly)
+    MESH_LATENCY_HANDLER = 2,     // Handler run time
+    MESH_LATENCY_STAGE_COUNT = 3
+};
+
+struct MeshLatencyKey {
+    uint8_t stage;                // MeshLatencyStage
+    uint8_t type;                 // Message type as dispatched
+    uint8_t hops;                 // Hop count for transit, 0 for the local stages
+};
+
+struct MeshLatencyStats {
+    uint32_t series;              // Histograms in use
+    uint32_t recorded;
+    uint32_t dropped;             // Samples for a new key with every series taken
+    uint32_t clamped;             // Samples at or beyond MeshLatencyHistogram::MAX_VALUE
+};
+
+/**
+ * @brief Log-linear latency histogram in fixed memory (HDR-style)
+ *
+ * Values below 2 x SUB_BUCKETS are counted exactly; above that every
+ * power-of-two range is split into SUB_BUCKETS equal buckets, so a value is
+ * known to within 1/SUB_BUCKETS of itself however large it is. Values from
+ * MAX_VALUE up share the top bucket. Recording is a count-leading-zeros, a
+ * shift and an increment.
+ *
+ * Counters are 16 bits. When one would overflow, all of them are halved,
+ * which keeps the shape (and so the percentiles) while weighting recent
+ * samples a little more; getCount() still reports every sample.
+ *
+ * Compact form (LEB128 varints): [samples][min][max][used buckets] followed
+ * by [bucket index - previous index][count] for each non-empty bucket.
+ */
+class MeshLatencyHistogram {
+public:
+    static const uint32_t SUB_BUCKET_BITS = 3;
+    static const uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static const uint32_t VALUE_BITS = 26;                          // Up to ~67 s in microseconds
+    static const uint32_t MAX_VALUE = (1u << VALUE_BITS) - 1;
+    static const size_t BUCKETS = (VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    static const size_t MAX_ENCODED = 4 * 5 + BUCKETS * 5;
+
+    MeshLatencyHistogram();
+
+    void clear();
+    void record(uint32_t value) {
+        if (value > MAX_VALUE) {
+            value = MAX_VALUE;
+        }
+        size_t bucket = bucketOf(value);
+        if (counts[bucket] == UINT16_MAX) {
+            halve();
+        }
+        counts[bucket]++;
+        total++;
+        samples++;
+        if (value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+    }
+    void merge(const MeshLatencyHistogram& other);
+
+    uint32_t getCount() const { return samples; }
+    uint32_t getMin() const { return samples > 0 ? minValue : 0; }
+    uint32_t getMax() const { return maxValue; }
+    uint32_t getMean() const;
+    uint32_t getPercentile(double percentile) const;   // Highest value in the bucket holding it
+    uint16_t getBucketCount(size_t bucket) const { return bucket < BUCKETS ? counts[bucket] : 0; }
+
+    static size_t bucketOf(uint32_t value) {
+        if (value < 2 * SUB_BUCKETS) {
+            return value;
+        }
+        uint32_t msb = 31 - __builtin_clz(value);
+        return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    }
+    static uint32_t bucketLow(size_t bucket);
+    static uint32_t bucketHigh(size_t bucket);
+
+    bool encode(uint8_t* output, size_t outputCap, size_t* outputLen) const;
+    bool decode(const uint8_t* data, size_t len, size_t* consumed);
+
+private:
+    uint16_t counts[BUCKETS];
+    uint32_t total;               // Sum of counts, reduced by halving
+    uint32_t samples;
+    uint32_t minValue;
+    uint32_t maxValue;
+
+    void halve();
+};
+
+/**
+ * @brief Latency histograms keyed by stage, message type and hop count
+ *
+ * A fixed table of MESH_LATENCY_MAX_SERIES histograms is handed out to keys
+ * as they are first seen, found again through a small open-addressed index.
+ * Once the table is full, samples for new keys are only counted. Not
+ * thread-safe: one task records (the receive worker) and other tasks read
+ * a copy it publishes every MESH_RX_STATS_PUBLISH_MS.
+ *
+ * Report Format (MESH_MSG_LATENCY): [version (1)] followed, per series, by
+ * [stage (1)] + [type (1)] + [hops (1)] + [histogram compact form]. Reports
+ * are cumulative, so a lost one costs nothing but freshness.
+ */
+class MeshLatencyRecorder {
+public:
+    static const uint8_t REPORT_VERSION = 1;
+
+    MeshLatencyRecorder();
+
+    void record(MeshLatencyStage stage, uint8_t type, uint8_t hops, uint32_t valueUs);
+
+    bool get(MeshLatencyStage stage, uint8_t type, uint8_t hops, MeshLatencyHistogram* output) const;
+    size_t getKeys(MeshLatencyKey* output, size_t outputCap) const;
+    MeshLatencyStats getStats() const;
+    void reset();
+
+    // Series that do not fit are left out of the report
+    bool encodeReport(uint8_t* output, size_t outputCap, size_t* outputLen) const;
+    static bool nextSeries(const uint8_t* data, size_t len, size_t* offset,
+                           MeshLatencyKey* key, MeshLatencyHistogram* histogram);
+
+private:
+    static const size_t INDEX_SIZE = 2 * MESH_LATENCY_MAX_SERIES;
+    static_assert((INDEX_SIZE & (INDEX_SIZE - 1)) == 0, "MESH_LATENCY_MAX_SERIES must be a power of two");
+    static_assert(MESH_LATENCY_MAX_SERIES < 255, "Series indices must fit the index table");
+
+    struct Series {
+        uint32_t key;
+        MeshLatencyHistogram histogram;
+    };
+
+    Series series[MESH_LATENCY_MAX_SERIES];
+    uint8_t index[INDEX_SIZE];    // Series + 1, 0 = free
+    size_t seriesCount;
+    MeshLatencyStats stats;
+
+    static uint32_t packKey(uint8_t stage, uint8_t type, uint8_t hops) {
+        return ((uint32_t)stage << 16) | ((uint32_t)type << 8) | hops;
+    }
+    static size_t slotOf(uint32_t key) {
+        return (key * 2654435761u) >> 24 & (INDEX_SIZE - 1);
+    }
+    const Series* find(uint32_t key) const;
+};
+
+#endif // MESH_LATENCY_H
@@ -0,0 +1,108 @@
+// Mesh Link Quality Header
+#ifndef MESH_LINK_QUALITY_H
+#define MESH_LINK_QUALITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+struct MeshLinkStats {
+    uint32_t nodeId;
+    uint8_t forwardHeard;     // Of our last forwardSent probes, how many the neighbor heard
+    uint8_t forwardSent;
+    uint8_t reverseHeard;     // Of the neighbor's last reverseSent probes, how many we heard
+    uint8_t reverseSent;
+    uint32_t srttMs;          // Smoothed probe round trip, 0 before the first echo
+    uint32_t reliableSent;    // Reliable first transmissions handed to this neighbor
+    uint32_t retransmits;     // Reliable retransmissions handed to this neighbor
+    uint8_t measuredCost;     // Current estimate, MESH_LINK_COST_UNIT = one clean transmission
+    uint8_t cost;             // Cost routing uses (follows measuredCost with hysteresis)
+    bool measured;            // Enough probes both ways for measuredCost to mean anything
+};
+
+/**
+ * @brief Per-neighbor delivery, round-trip and retransmission tracking with ETX costs
+ *
+ * Every MESH_LINK_PROBE_MS each neighbor is sent a small probe carrying our
+ * probe sequence and echoing the neighbor's: the highest of its probes we
+ * heard, a bitmap of the ones before it, and its timestamp with how long we
+ * held it. From a neighbor's probes we learn both delivery ratios over the
+ * last MESH_LINK_WINDOW probes (forward from its echo of ours, reverse from
+ * the gaps in its sequence) and the round trip. The cost is
+ *   UNIT / (forward x reverse)                 expected transmissions (ETX)
+ *   + UNIT x retransmit share / (1 - share)    end-to-end retries sent this way
+ *   + srtt / MESH_LINK_RTT_UNIT_MS             slow links
+ * Routing sees a cost that only moves when the estimate drifts more than
+ * MESH_LINK_COST_HYSTERESIS percent from it, so noise does not flap routes
+ * or flood link-state adverts. Unmeasured links cost one UNIT.
+ *
+ * Probe Format (MESH_MSG_LINK_PROBE), integers little-endian:
+ * [seq (2)] + [sent ms (4)] + [highest of your seqs heard (2)] +
+ * [heard bitmap (4), bit i = highest - i] + [your sent ms for highest (4)] + [held ms (2)]
+ */
+class MeshLinkQuality {
+public:
+    static const size_t PROBE_SIZE = 18;
+    static const uint8_t MIN_PROBES = 4;    // Per direction before a link counts as measured
+
+    MeshLinkQuality();
+
+    bool addNeighbor(uint32_t nodeId, uint32_t nowMs);
+    bool removeNeighbor(uint32_t nodeId);
+
+    // Probes (one due neighbor per call)
+    bool nextProbe(uint32_t nowMs, uint32_t* destId, uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool onProbe(uint32_t from, const uint8_t* data, size_t len, uint32_t nowMs);
+
+    // Reliable traffic handed to a neighbor as first hop
+    void onReliableSent(uint32_t nodeId);
+    void onRetransmit(uint32_t nodeId);
+
+    // Routing costs that moved past the hysteresis band since the last call
+    bool nextCostChange(uint32_t nowMs, uint32_t* nodeId, uint8_t* cost);
+    uint8_t getCost(uint32_t nodeId);
+
+    MeshLinkStats getStats(uint32_t nodeId, uint32_t nowMs);
+    size_t getLinks(MeshLinkStats* output, size_t outputCap, uint32_t nowMs);
+
+private:
+    struct Link {
+        uint32_t nodeId;          // 0 = free
+        uint32_t addedMs;
+
+        // Our probes
+        uint16_t txSeq;           // Last sent
+        uint16_t txCount;         // Sent since the link came up (saturating)
+        uint32_t lastProbeMs;
+        uint16_t echoSeq;         // The neighbor's latest echo of our sequence
+        uint32_t echoBitmap;
+        bool hasEcho;
+
+        // The neighbor's probes
+        uint16_t rxSeq;           // Highest heard
+        uint32_t rxBitmap;
+        uint16_t rxCount;         // Span of its sequence seen so far (saturating)
+        uint32_t rxSentMs;        // Its timestamp on rxSeq
+        uint32_t rxAtMs;          // When rxSeq arrived
+        bool hasRx;
+
+        uint32_t srttMs;
+        uint32_t reliableSent;
+        uint32_t retransmits;
+        uint16_t retransmitShare; // EWMA of retransmits / transmissions, 1/65536 units
+        uint8_t cost;
+        bool costChanged;
+    };
+
+    Link links[MESH_TOPOLOGY_MAX_LINKS];
+
+    Link* find(uint32_t nodeId);
+    void forwardRatio(const Link& link, uint8_t* heard, uint8_t* sent);
+    void reverseRatio(const Link& link, uint32_t nowMs, uint8_t* heard, uint8_t* sent);
+    uint8_t measure(const Link& link, uint32_t nowMs, bool* measured);
+    void updateCost(Link& link, uint32_t nowMs);
+    void noteTransmission(Link& link, bool retransmit);
+    MeshLinkStats statsFor(const Link& link, uint32_t nowMs);
+};
+
+#endif // MESH_LINK_QUALITY_H
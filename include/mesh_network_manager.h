@@ -4,29 +4,248 @@
 
 #include <Arduino.h>
 #include <painlessMesh.h>
-#include <AES256.h>
-#include <ArduinoJson.h>
+#include "mesh_wire_frame.h"
+#include "mesh_aead.h"
+#include "mesh_seen_cache.h"
+#include "mesh_outbound_queue.h"
+#include "mesh_heartbeat.h"
+#include "mesh_dispatcher.h"
+#include "mesh_topology.h"
+#include "mesh_reliable.h"
+#include "mesh_fragment.h"
+#include "mesh_flow_control.h"
+#include "mesh_compressor.h"
+#include "mesh_buffer_pool.h"
+#include "mesh_receive_ring.h"
+#include "mesh_pubsub.h"
+#include "mesh_job_balancer.h"
+#include "mesh_time_sync.h"
+#include "mesh_latency.h"
+#include "mesh_link_quality.h"
+#include "mesh_store_forward.h"
+#include "mesh_platform.h"
+#include "../config/mesh_config.h"
 
 class MeshNetworkManager {
 public:
     MeshNetworkManager();
-    bool begin();
+#ifdef ARDUINO
+    bool begin();                                   // Mesh key from SecureKeyManager
+#endif
+    bool begin(const uint8_t* meshKey, size_t keyLen, uint16_t keyEpoch = 0);
     void update();
-    bool sendMessage(uint32_t destId, const String& message, uint8_t hops = 0);
-    bool broadcastMessage(const String& message, uint8_t hops = 0);
+    bool sendMessage(uint32_t destId, const String& message, uint8_t hops = 0,
+                     MeshPriority priority = MESH_PRIORITY_TELEMETRY);
+    bool broadcastMessage(const String& message, uint8_t hops = 0,
+                          MeshPriority priority = MESH_PRIORITY_TELEMETRY);
+    bool sendReliable(uint32_t destId, const String& message, MeshPriority priority = MESH_PRIORITY_SMS);
+    bool sendReliable(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                      MeshPriority priority = MESH_PRIORITY_SMS);
+    // Must-deliver messages (delivery reports, inbound SMS, alarms): persisted to flash
+    // before sending and repeated, across partitions and reboots, until acknowledged
+    bool sendStored(uint32_t destId, const String& message, MeshPriority priority = MESH_PRIORITY_SMS);
+    bool sendStored(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                    MeshPriority priority = MESH_PRIORITY_SMS);
+    MeshStoreStats getStoreStats();
+    size_t getStoreDepth(MeshPriority priority);
     uint32_t getNodeId();
     size_t getNodeCount();
     bool isNetworkConnected();
+    // Receive-side statistics are the worker's as of its last publish (every MESH_RX_STATS_PUBLISH_MS)
+    MeshSeenCacheStats getSeenCacheStats();
+    MeshQueueStats getQueueStats(MeshPriority priority);
+
+    // Receive dispatch (types from MESH_MSG_APP_BASE are free for other modules).
+    // Handlers run on the receive worker task; register them before begin(). They may
+    // use the send API: sends larger than one queue record wait for the next update()
+    // (up to MESH_RX_DEFERRED_SENDS / MESH_RX_DEFERRED_BYTES at a time).
+    bool registerHandler(uint8_t type, MeshMessageHandler handler, void* context);
+    MeshHandlerStats getHandlerStats(uint8_t type);
+
+    // Topic publish/subscribe (published messages reach only nodes subscribed to the topic)
+    bool subscribe(const char* topic);
+    bool unsubscribe(const char* topic);
+    bool publish(const char* topic, const String& message, MeshPriority priority = MESH_PRIORITY_TELEMETRY);
+    bool publish(const char* topic, uint8_t type, const uint8_t* data, size_t len,
+                 MeshPriority priority = MESH_PRIORITY_TELEMETRY);
+    MeshPubSubStats getPubSubStats();
+
+    // SMS job distribution (placed by the elected coordinator; the SMS task in main.cpp runs
+    // takeSmsJob). A job body is the recipient number, a NUL, then the UTF-8 text.
+    bool submitSmsJob(const uint8_t* body, size_t len, uint32_t* jobId = nullptr);
+    bool takeSmsJob(MeshSmsJob* job);
+    bool completeSmsJob(const MeshSmsJob& job, bool sent, uint32_t sendMs);
+    uint32_t getJobCoordinator();
+    MeshJobStats getJobStats();
+    size_t getJobDecisions(MeshJobDecision* output, size_t outputCap);
+
+    // Mesh time (synchronized to the master node; a frame's one-way latency is
+    // toMeshTime(info.receivedMs) - info.sentMs)
+    bool getMeshTime(uint32_t* meshMs, uint32_t* errorMs = nullptr);
+    uint32_t toMeshTime(uint32_t localMs);
+    MeshTimeStats getTimeStats();
+    static uint32_t meshClock(void* context);   // Time source for HMACHandler::setTimeSource
+
+    // Latency histograms: transit per type and hop count, queueing and handler time per type
+    // (hops 0). With a collector set, a cumulative MESH_MSG_LATENCY report goes to it every
+    // MESH_LATENCY_REPORT_MS; the collector decodes it with MeshLatencyRecorder::nextSeries.
+    // Reads see the worker's samples as of its last publish (every MESH_RX_STATS_PUBLISH_MS).
+    bool getLatency(MeshLatencyStage stage, uint8_t type, uint8_t hops, MeshLatencyHistogram* output);
+    size_t getLatencySeries(MeshLatencyKey* output, size_t outputCap);
+    MeshLatencyStats getLatencyStats();
+    void setLatencyCollector(uint32_t nodeId);
+
+    // Link quality toward each neighbor (probe delivery both ways, round trip, retransmits);
+    // the routing cost goes into our link-state adverts and unicast follows least-cost paths
+    MeshLinkStats getLinkStats(uint32_t nodeId);
+    size_t getLinks(MeshLinkStats* output, size_t outputCap);
+
+    // Topology queries (hop distances and routes from link-state adverts)
+    uint8_t getHopDistance(uint32_t nodeId);
+    uint16_t getPathCost(uint32_t nodeId);
+    size_t getNodesWithin(uint8_t maxHops, MeshRouteEntry* output, size_t outputCap);
+    bool setNodeLoad(uint32_t nodeId, uint8_t load);
+    uint32_t findLeastLoadedNode(uint8_t maxHops, bool includeSelf = true);
+    MeshTopologyStats getTopologyStats();
+    MeshReliableStats getReliableStats();
+    MeshReassemblyStats getReassemblyStats();
+
+    // Payload compression (dictionaries must match on every node)
+    bool setCompressionDictionary(uint8_t type, const uint8_t* dictionary, size_t len);
+    MeshCompressionStats getCompressionStats();
+
+    // Frame buffer pool usage (exported to HealthMonitor)
+    MeshBufferPoolStats getBufferStats(MeshBufferClass bufferClass);
+
+    // Receive ring between painlessMesh callbacks and the worker task
+    MeshReceiveRingStats getReceiveStats();
+
+    // Per-neighbor credit state
+    MeshFlowStats getFlowStats(uint32_t nodeId);
+    size_t getFlowPeers(MeshFlowStats* output, size_t outputCap);
+
+    // Heartbeat state
+    void setSimStatus(uint32_t activeMask);
+    const MeshPeerState* getPeerState(uint32_t nodeId);
+    size_t getSyncedPeerCount();
 
 private:
     painlessMesh mesh;
-    AES256 aes;
+    MeshAEAD aead;
+    MeshAEAD rxAead;    // Receive worker's own GCM context
+    MeshSeenCache seenCache;
+    MeshOutboundQueue outbound;
+    MeshHeartbeatEncoder heartbeat;
+    MeshHeartbeatTable peers;
+    MeshDispatcher dispatcher;
+    MeshTopology topology;
+    MeshLinkQuality links;
+    MeshReliable reliable;
+    MeshFlash storeFlash;
+    MeshStoreForward store;
+    MeshReassembler reassembler;
+    MeshFlowControl flow;
+    MeshCompressor compressor;
+    MeshBufferPool buffers;
+    MeshReceiveRing rxRing;
+    MeshSubscriptions subscriptions;
+    MeshJobBalancer jobs;
+    MeshTimeSync timeSync;
+    MeshLatencyRecorder latency;  // Written by the receive worker only, without the lock
+    MeshLatencyRecorder latencyPublished;  // The worker's copy for other tasks, under stateLock
+
+    // Counters the receive worker updates without the lock, as of its last publish; under stateLock
+    struct ReceiveStats {
+        MeshSeenCacheStats seenCache;
+        MeshReassemblyStats reassembly;
+        MeshCompressionStats decompression;
+        MeshHandlerStats handlers[MESH_DISPATCH_TABLE_SIZE];
+    };
+    ReceiveStats rxPublished;
+    MeshLock stateLock;  // Shared by loop() and the receive worker
+    MeshTaskHandle rxTask;
     unsigned long lastHeartbeat;
-    size_t nodeCount;
-    bool isConnected;
+    unsigned long lastLinkState;
+    bool linkStateChanged;
+    bool linkStateStale;
+    unsigned long lastSubscriptionAdvert;
+    size_t advertisedReach;
+    uint32_t txSequence;
+    uint16_t fragmentMessageId;
+    uint32_t simActiveMask;
+    uint32_t latencyCollector;
+    unsigned long lastLatencyReport;
+    unsigned long lastStatsPublish;  // Receive worker only
+
+    // loop() scratch for unarmoring received frames before they are relayed or queued
+    uint8_t rxFrame[MESH_MAX_FRAME_SIZE];
+    // Receive worker scratch for inflating compressed payloads
+    uint8_t rxInflated[MeshCompressor::MAX_BLOCK];
+    // Receive worker scratch for opening topic frames, which stay sealed for forwarding
+    uint8_t rxTopicPlain[MESH_MAX_FRAME_SIZE];
+
+    // Topic frames authenticated by the worker, forwarded by loop(); guarded by stateLock
+    struct TopicRelay {
+        uint32_t from;
+        size_t offset;
+        size_t len;
+    };
+    TopicRelay topicRelays[MESH_TOPIC_RELAY_FRAMES];
+    size_t topicRelayCount;
+    size_t topicRelayBytes;
+    uint8_t topicRelayData[MESH_TOPIC_RELAY_BYTES];
+
+    // Large sends from handlers, taken over by loop() in update(); guarded by stateLock
+    struct DeferredSend {
+        uint32_t destId;
+        uint8_t type;
+        uint8_t hops;
+        uint8_t flags;
+        size_t offset;
+        size_t len;
+    };
+    DeferredSend deferred[MESH_RX_DEFERRED_SENDS];
+    size_t deferredCount;
+    size_t deferredBytes;
+    uint8_t deferredData[MESH_RX_DEFERRED_BYTES];
+
+    // Route list scratch for picking topic branches
+    MeshRouteEntry topicRoutes[MESH_TOPOLOGY_MAX_NODES];
+
+    // Largest plaintext that still fits one sealed frame
+    static const size_t MAX_FRAME_PAYLOAD = MESH_MAX_FRAME_SIZE - MeshWireFrame::HEADER_SIZE - MeshAEAD::OVERHEAD;
 
-    String encryptMessage(const String& message);
-    String decryptMessage(const String& encryptedMessage);
+    bool queueMessage(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                      uint8_t hops, MeshPriority priority, uint8_t flags = 0);
+    bool sendFragmented(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, uint8_t hops,
+                        uint8_t flags);
+    bool deferSend(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, uint8_t hops, uint8_t flags);
+    void flushDeferred();
+    void queueTopicRelay(const uint8_t* frame, size_t frameLen, uint32_t from);
+    void flushTopicRelays();
+    void flushOutbound();
+    void flushReliable();
+    void flushStored();
+    void flushCredits();
+    void flushJobs();
+    void flushTime();
+    void flushLatency();
+    void publishReceiveStats();
+    const MeshLatencyRecorder& receiveLatency();
+    void flushLinks();
+    bool sendFrame(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, uint8_t hops,
+                   uint8_t flags = 0);
+    bool transmitFrame(uint32_t destId, const uint8_t* frame, size_t frameLen, bool credited);
+    size_t forwardTopic(uint32_t topicId, const uint8_t* frame, size_t frameLen, uint8_t hops, uint32_t exclude);
+    uint32_t nextHopFor(uint32_t destId);
+    static bool canSendTo(void* context, uint32_t destId);
+    static bool canReach(void* context, uint32_t destId);
+    void relayFrame(MeshFrameHeader& header, uint8_t* frame, size_t frameLen);
+    static void receiveTask(void* context);
+    void drainReceived();
+    void processFrame(MeshReceiveSlot& slot);
+    void dispatchMessage(MeshMessageInfo& info, uint8_t type, const uint8_t* data, size_t len,
+                         uint32_t enqueuedUs, uint32_t transitUs);
 
     // Callback handlers
     void onReceive(uint32_t from, String &msg);
@@ -36,9 +255,29 @@ private:
 
     // Message handlers
     void sendHeartbeat();
-    void handleHeartbeat(uint32_t from, const String& data);
-    void handleDataMessage(uint32_t from, const String& data, uint8_t hops);
-    void handleCommand(uint32_t from, const String& command, uint8_t hops);
+    bool admitPeer(uint8_t distance);
+    void sendLinkState();
+    void sendSubscriptions();
+    static void handleHeartbeat(void* context, const MeshMessageInfo& info,
+                                const uint8_t* data, size_t len);
+    static void handleLinkState(void* context, const MeshMessageInfo& info,
+                                const uint8_t* data, size_t len);
+    static void handleSubscription(void* context, const MeshMessageInfo& info,
+                                   const uint8_t* data, size_t len);
+    static void handleJob(void* context, const MeshMessageInfo& info,
+                          const uint8_t* data, size_t len);
+    static void handleTime(void* context, const MeshMessageInfo& info,
+                           const uint8_t* data, size_t len);
+    static void handleLinkProbe(void* context, const MeshMessageInfo& info,
+                                const uint8_t* data, size_t len);
+    static void handleAck(void* context, const MeshMessageInfo& info,
+                          const uint8_t* data, size_t len);
+    static void handleCredit(void* context, const MeshMessageInfo& info,
+                             const uint8_t* data, size_t len);
+    static void handleDataMessage(void* context, const MeshMessageInfo& info,
+                                  const uint8_t* data, size_t len);
+    static void handleCommand(void* context, const MeshMessageInfo& info,
+                              const uint8_t* data, size_t len);
 };
 
-#endif // MESH_NETWORK_MANAGER_H
\ No newline at end of file
+#endif // MESH_NETWORK_MANAGER_H
@@ -0,0 +1,104 @@
+// Mesh Outbound Queue Header
+#ifndef MESH_OUTBOUND_QUEUE_H
+#define MESH_OUTBOUND_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+enum MeshPriority : uint8_t {
+    MESH_PRIORITY_CONTROL = 0,
+    MESH_PRIORITY_SMS = 1,
+    MESH_PRIORITY_TELEMETRY = 2,
+    MESH_PRIORITY_LOG = 3,
+    MESH_PRIORITY_COUNT = 4
+};
+
+struct MeshQueueStats {
+    uint32_t depth;
+    uint32_t highWater;
+    uint32_t enqueued;
+    uint32_t dropped;    // Rejected because the class was full
+    uint32_t sent;
+    uint32_t waitHistogram[MESH_WAIT_HISTOGRAM_BUCKETS]; // Bucket i: wait < 2^i ms
+};
+
+// One frame's worth of work produced by the scheduler
+struct MeshOutboundFrame {
+    uint32_t dest;
+    MeshPriority lowestPriority;  // Least urgent class among the records
+    uint8_t type;       // Original type, or MESH_MSG_BATCH when coalesced
+    uint8_t hops;
+    uint8_t flags;      // Header flags shared by every record (see MeshWireFrame)
+    uint8_t records;
+    size_t length;
+};
+
+// Returns false while a destination may not be sent to (e.g. out of credit)
+typedef bool (*MeshSendFilter)(void* context, uint32_t dest);
+
+/**
+ * @brief Bounded priority scheduler for outgoing mesh messages
+ *
+ * Messages are queued per priority class (control > SMS jobs > telemetry >
+ * logs) in fixed rings and drained from MeshNetworkManager::update().
+ * Control and SMS traffic is due immediately; telemetry and logs wait up to
+ * MESH_COALESCE_DELAY_MS so small messages to the same destination can share
+ * one frame; only records with the same destination, hop count and header
+ * flags are coalesced. An optional send filter holds back non-control messages to
+ * blocked destinations without blocking others queued behind them.
+ *
+ * Batch Payload Format (MESH_MSG_BATCH):
+ * { [type (1 byte)] + [length (2 bytes, LE)] + [data (length bytes)] } x N
+ */
+class MeshOutboundQueue {
+public:
+    MeshOutboundQueue();
+
+    bool enqueue(uint32_t dest, uint8_t type, const uint8_t* data, size_t len,
+                 uint8_t hops, MeshPriority priority, uint32_t nowMs, uint8_t flags = 0);
+    bool nextFrame(uint32_t nowMs, MeshOutboundFrame* frame, uint8_t* buffer, size_t bufferCap,
+                   MeshSendFilter filter = nullptr, void* filterContext = nullptr);
+
+    size_t getDepth(MeshPriority priority);
+    bool isEmpty();
+    MeshQueueStats getStats(MeshPriority priority);
+    void resetStats();
+
+    // Batch record parsing (receive side)
+    static bool nextRecord(const uint8_t* batch, size_t batchLen, size_t* offset,
+                           uint8_t* type, const uint8_t** data, size_t* dataLen);
+
+    static const size_t RECORD_OVERHEAD = 3;
+
+private:
+    struct Entry {
+        uint32_t dest;
+        uint32_t enqueuedMs;
+        uint16_t length;
+        uint8_t type;
+        uint8_t hops;
+        uint8_t flags;
+        bool live;     // Cleared when coalesced out of order
+        uint8_t data[MESH_OUTBOUND_MAX_RECORD];
+    };
+
+    struct ClassQueue {
+        Entry entries[MESH_OUTBOUND_QUEUE_DEPTH];
+        uint8_t head;
+        uint8_t count;   // Occupied slots, including coalesced tombstones
+        MeshQueueStats stats;
+    };
+
+    ClassQueue queues[MESH_PRIORITY_COUNT];
+
+    Entry* headEntry(ClassQueue& queue);
+    Entry* firstSendable(ClassQueue& queue, MeshSendFilter filter, void* filterContext);
+    bool isDue(MeshPriority priority, const Entry& entry, uint32_t nowMs);
+    size_t pendingBytesFor(const Entry& lead);
+    Entry* findCoalescable(const MeshOutboundFrame& frame, size_t room, bool controlOnly, ClassQueue** owner);
+    void take(ClassQueue& queue, Entry& entry, uint32_t nowMs);
+    static size_t waitBucket(uint32_t waitMs);
+};
+
+#endif // MESH_OUTBOUND_QUEUE_H
@@ -0,0 +1,139 @@
+// Mesh Platform Shim - clock, lock, task and flash access for portable mesh modules
+#ifndef MESH_PLATFORM_H
+#define MESH_PLATFORM_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_partition.h>
+
+inline uint32_t meshMicros() { return micros(); }
+
+typedef TaskHandle_t MeshTaskHandle;
+
+// Recursive mutex in static storage, safe to construct before the scheduler starts
+class MeshLock {
+public:
+    MeshLock() { handle = xSemaphoreCreateRecursiveMutexStatic(&storage); }
+    void lock() { xSemaphoreTakeRecursive(handle, portMAX_DELAY); }
+    void unlock() { xSemaphoreGiveRecursive(handle); }
+
+private:
+    StaticSemaphore_t storage;
+    SemaphoreHandle_t handle;
+};
+
+// core < 0 leaves the task free to run on either core
+inline bool meshStartTask(void (*entry)(void*), void* context, const char* name, uint32_t stackBytes,
+                          uint8_t priority, int core, MeshTaskHandle* handle) {
+    BaseType_t affinity = core < 0 ? tskNO_AFFINITY : core;
+    return xTaskCreatePinnedToCore(entry, name, stackBytes, context, priority, handle, affinity) == pdPASS;
+}
+inline MeshTaskHandle meshCurrentTask() { return xTaskGetCurrentTaskHandle(); }
+inline void meshNotifyTask(MeshTaskHandle task) { xTaskNotifyGive(task); }
+inline void meshWaitForNotify(uint32_t timeoutMs) { ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)); }
+
+// Raw access to a data partition from the partition table, found by label
+class MeshFlash {
+public:
+    MeshFlash() : partition(nullptr) {}
+    bool begin(const char* label) {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+        return partition != nullptr;
+    }
+    uint32_t size() const { return partition ? partition->size : 0; }
+    bool read(uint32_t offset, void* output, size_t len) {
+        return partition && esp_partition_read(partition, offset, output, len) == ESP_OK;
+    }
+    bool write(uint32_t offset, const void* data, size_t len) {
+        return partition && esp_partition_write(partition, offset, data, len) == ESP_OK;
+    }
+    bool erase(uint32_t offset, size_t len) {
+        return partition && esp_partition_erase_range(partition, offset, len) == ESP_OK;
+    }
+
+private:
+    const esp_partition_t* partition;
+};
+#else
+#include <chrono>
+#include <mutex>
+#include <string.h>
+#include <vector>
+
+// Host builds (native tests, simulator) use the monotonic clock
+inline uint32_t meshMicros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef void* MeshTaskHandle;
+
+class MeshLock {
+public:
+    void lock() { mutex.lock(); }
+    void unlock() { mutex.unlock(); }
+
+private:
+    std::recursive_mutex mutex;
+};
+
+// No worker tasks on the host; callers fall back to doing the work inline
+inline bool meshStartTask(void (*entry)(void*), void* context, const char* name, uint32_t stackBytes,
+                          uint8_t priority, int core, MeshTaskHandle* handle) {
+    return false;
+}
+inline MeshTaskHandle meshCurrentTask() { return nullptr; }
+inline void meshNotifyTask(MeshTaskHandle task) {}
+inline void meshWaitForNotify(uint32_t timeoutMs) {}
+
+// RAM stand-in for a flash partition that keeps NOR semantics: writes can
+// only clear bits, erases set them again. Outlives whatever is mounted on it.
+class MeshFlash {
+public:
+    static const uint32_t HOST_SIZE = 64 * 1024;    // Same as the partition table entry
+
+    bool begin(const char* label) {
+        if (bytes.empty()) bytes.assign(HOST_SIZE, 0xFF);
+        return true;
+    }
+    uint32_t size() const { return bytes.size(); }
+    bool read(uint32_t offset, void* output, size_t len) {
+        if (offset + len > bytes.size()) return false;
+        memcpy(output, bytes.data() + offset, len);
+        return true;
+    }
+    bool write(uint32_t offset, const void* data, size_t len) {
+        if (offset + len > bytes.size()) return false;
+        for (size_t i = 0; i < len; i++) bytes[offset + i] &= ((const uint8_t*)data)[i];
+        return true;
+    }
+    bool erase(uint32_t offset, size_t len) {
+        if (offset + len > bytes.size()) return false;
+        memset(bytes.data() + offset, 0xFF, len);
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> bytes;
+};
+#endif
+
+// Holds a MeshLock for the enclosing scope
+class MeshLockGuard {
+public:
+    explicit MeshLockGuard(MeshLock& target) : lock(target) { lock.lock(); }
+    ~MeshLockGuard() { lock.unlock(); }
+
+private:
+    MeshLock& lock;
+
+    MeshLockGuard(const MeshLockGuard&) = delete;
+    MeshLockGuard& operator=(const MeshLockGuard&) = delete;
+};
+
+#endif // MESH_PLATFORM_H
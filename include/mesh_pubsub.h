@@ -0,0 +1,99 @@
+// Mesh Publish/Subscribe Header
+#ifndef MESH_PUBSUB_H
+#define MESH_PUBSUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mesh_topology.h"
+#include "../config/mesh_config.h"
+
+struct MeshPubSubStats {
+    uint32_t localTopics;
+    uint32_t knownSubscribers;  // Remote nodes advertising at least one topic
+    uint32_t advertsApplied;    // Subscription adverts that changed a digest
+    uint32_t delivered;         // Topic frames accepted for a local subscription
+    uint32_t passedThrough;     // Topic frames seen here only on their way elsewhere
+    uint32_t branchesUsed;      // Copies sent to a neighbor with subscribers behind it
+    uint32_t branchesPruned;    // Neighbors skipped for having none
+    uint32_t duplicatesDropped; // Copies of a frame already forwarded from here
+    uint32_t unrouted;          // Publishes with no known subscriber anywhere
+};
+
+/**
+ * @brief Topic subscriptions and subscriber-aware forwarding
+ *
+ * Topics are named by strings and carried as 32-bit FNV-1a IDs in the frame
+ * dest field (with MeshWireFrame::FLAG_TOPIC set). Each node advertises its
+ * subscriptions as a fixed-size Bloom digest with two bits per topic; every
+ * node keeps the digests it hears and, for a given topic, forwards a frame
+ * only to those neighbors that are the next hop towards at least one node
+ * whose digest matches. A digest can report a topic it does not hold (and
+ * then costs one wasted branch) but never misses one it does. A publisher
+ * sends straight to subscribers missing from its route table (not yet
+ * advertised, or beyond MESH_TOPOLOGY_MAX_NODES) and leaves painlessMesh to
+ * route those copies; relays only follow routes they know.
+ *
+ * Each node forwards a given frame once, to every matching branch except
+ * the neighbor it came from; later copies arriving over other paths are
+ * dropped. Because every hop moves strictly closer to the subscriber it was
+ * sent towards, the first copy a node sees reaches all of its subscribers.
+ *
+ * Subscription Advert Format (MESH_MSG_SUBSCRIPTION):
+ * [version (2, LE)] + [digest (MESH_TOPIC_DIGEST_BYTES)]
+ */
+class MeshSubscriptions {
+public:
+    MeshSubscriptions();
+
+    static uint32_t topicId(const char* name);
+
+    // Local subscriptions
+    bool subscribe(uint32_t topicId);
+    bool unsubscribe(uint32_t topicId);
+    bool isSubscribed(uint32_t topicId);
+
+    // Digest adverts (encodeAdvert fails until something was ever subscribed)
+    bool encodeAdvert(uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool applyAdvert(uint32_t origin, const uint8_t* data, size_t len, uint32_t nowMs);
+    void expire(uint32_t nowMs);
+    bool mayReach(uint32_t nodeId, uint32_t topicId);
+
+    // Forwarding. routes are this node's reachable nodes; subscribers further than maxHops
+    // are skipped. exclude is the neighbor the frame came from, 0 when publishing.
+    bool hasSubscribers(uint32_t topicId, const MeshRouteEntry* routes, size_t routeCount, uint8_t maxHops);
+    size_t selectBranches(uint32_t topicId, uint32_t exclude, const MeshRouteEntry* routes, size_t routeCount,
+                          uint8_t maxHops, uint32_t* branches, size_t branchCap);
+    bool firstCopy(uint32_t source, uint32_t seq);
+    bool deliverLocally(uint32_t topicId);
+
+    MeshPubSubStats getStats();
+
+    static const size_t ADVERT_SIZE = 2 + MESH_TOPIC_DIGEST_BYTES;
+
+private:
+    struct Remote {
+        uint32_t nodeId;     // 0 = free slot
+        uint32_t updatedMs;
+        uint16_t version;
+        uint8_t digest[MESH_TOPIC_DIGEST_BYTES];
+    };
+
+    uint32_t local[MESH_TOPIC_MAX_LOCAL];
+    size_t localCount;
+    uint16_t version;
+    uint8_t digest[MESH_TOPIC_DIGEST_BYTES];
+    Remote remotes[MESH_TOPOLOGY_MAX_NODES];
+    uint32_t forwardedSource[MESH_TOPIC_FORWARD_MEMORY];
+    uint32_t forwardedSeq[MESH_TOPIC_FORWARD_MEMORY];
+    size_t forwardedNext;
+    MeshPubSubStats stats;
+
+    void rebuildDigest();
+    static bool digestHas(const uint8_t* digest, uint32_t topicId);
+    static void digestAdd(uint8_t* digest, uint32_t topicId);
+    Remote* findRemote(uint32_t nodeId);
+    static uint32_t branchFor(uint32_t nodeId, const MeshRouteEntry* routes, size_t routeCount, uint8_t maxHops,
+                              bool* routed);
+};
+
+#endif // MESH_PUBSUB_H
@@ -0,0 +1,80 @@
+// Mesh Receive Ring Header
+#ifndef MESH_RECEIVE_RING_H
+#define MESH_RECEIVE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "../config/mesh_config.h"
+
+struct MeshReceiveSlot {
+    uint32_t from;          // Neighbor the frame arrived from
+    uint32_t enqueuedUs;    // Set by commitPush()
+    uint16_t length;        // 0 = nothing to dispatch (handled by the producer)
+    uint8_t frame[MESH_MAX_FRAME_SIZE];
+    uint32_t ticket;        // Ring bookkeeping, not for callers
+};
+
+struct MeshReceiveRingStats {
+    uint32_t depth;
+    uint32_t highWater;
+    uint32_t enqueued;
+    uint32_t dispatched;
+    uint32_t dropped;       // Frames refused because every slot was full
+    uint32_t maxLatencyUs;  // Longest enqueue-to-dispatch time
+    uint32_t latencyHistogram[MESH_RX_LATENCY_BUCKETS];
+};
+
+/**
+ * @brief Lock-free ring of received frames between producers and one consumer
+ *
+ * Bounded multi-producer/single-consumer queue with a sequence number per
+ * slot. Producers claim a slot with one compare-and-swap, fill it in place
+ * and publish it; the consumer reads the front slot in place and releases
+ * it. Frames are never copied between the two sides and neither side ever
+ * blocks: a producer that finds the ring full gets nullptr and the frame is
+ * counted as dropped.
+ *
+ * Slots are published in claim order, so a producer that stalls between
+ * beginPush() and commitPush() holds back the slots claimed after it.
+ */
+class MeshReceiveRing {
+public:
+    MeshReceiveRing();
+
+    // Producer side (any task or callback)
+    MeshReceiveSlot* beginPush();
+    void commitPush(MeshReceiveSlot* slot, uint32_t nowUs);
+
+    // Consumer side (one task only)
+    MeshReceiveSlot* front();
+    void pop(uint32_t nowUs);
+
+    // Statistics (safe to read from any task)
+    MeshReceiveRingStats getStats();
+    void resetStats();
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        MeshReceiveSlot slot;
+    };
+
+    static const uint32_t MASK = MESH_RX_RING_SLOTS - 1;
+    static_assert((MESH_RX_RING_SLOTS & MASK) == 0, "MESH_RX_RING_SLOTS must be a power of two");
+
+    Cell cells[MESH_RX_RING_SLOTS];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos;
+
+    std::atomic<uint32_t> highWater;
+    std::atomic<uint32_t> enqueued;
+    std::atomic<uint32_t> dispatched;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> maxLatencyUs;
+    std::atomic<uint32_t> latencyHistogram[MESH_RX_LATENCY_BUCKETS];
+
+    static size_t latencyBucket(uint32_t latencyUs);
+};
+
+#endif // MESH_RECEIVE_RING_H
@@ -0,0 +1,118 @@
+// Mesh Reliable Unicast Header
+#ifndef MESH_RELIABLE_H
+#define MESH_RELIABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+#include "mesh_seen_cache.h"
+
+struct MeshReliableStats {
+    uint32_t sent;          // First transmissions
+    uint32_t retransmits;
+    uint32_t acked;
+    uint32_t failed;        // Given up after MESH_RELIABLE_MAX_RETRIES
+    uint32_t windowFull;    // send() refused: window or peer table exhausted
+    uint32_t delivered;     // Received messages handed up
+    uint32_t duplicates;    // Received again and suppressed
+    uint32_t outOfWindow;   // Received beyond the SACK range and dropped
+};
+
+enum MeshReliableVerdict {
+    MESH_RELIABLE_DELIVER,
+    MESH_RELIABLE_DUPLICATE,
+    MESH_RELIABLE_INVALID
+};
+
+/**
+ * @brief End-to-end acknowledged unicast with a per-peer sliding window
+ *
+ * Each destination gets MESH_RELIABLE_WINDOW send slots holding copies of
+ * unacknowledged messages, so memory is fixed per peer. Receivers deliver
+ * each sequence number once (in any order) and answer with one cumulative
+ * ACK + 32-bit selective bitmap per update pass. The retransmission timeout
+ * follows RFC 6298 (SRTT/RTTVAR, Karn's rule, exponential backoff).
+ *
+ * Every data packet carries the sender's window base, so a receiver that
+ * rebooted or evicted the peer resynchronises. Every send-peer entry takes
+ * a new session ID (seeded at boot), so a sender that reboots or recycles
+ * the entry restarts its sequence space without looking like duplicates. Delivered (sender, session, seq) triples
+ * also go into a seen cache so a retransmission that lands after its peer
+ * entry was evicted is still suppressed.
+ *
+ * Data Format:  [session (2)] + [seq (2)] + [window base (2)] + [type (1)] + [payload]
+ * ACK Format:   [session (2)] + [cumulative next seq (2)] + [SACK bitmap (4)]
+ * All fields little-endian; SACK bit i acknowledges seq (cumulative + 1 + i).
+ */
+class MeshReliable {
+public:
+    MeshReliable();
+
+    void begin(uint16_t sessionId);
+
+    // Sender: stores a copy and writes the first transmission into packet
+    bool send(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, uint32_t nowMs,
+              uint8_t* packet, size_t packetCap, size_t* packetLen);
+    bool nextRetransmit(uint32_t nowMs, uint32_t* destId, uint8_t* packet, size_t packetCap, size_t* packetLen);
+    bool onAck(uint32_t fromId, const uint8_t* ack, size_t ackLen, uint32_t nowMs);
+    size_t getInFlight(uint32_t destId);
+    uint32_t getRtoMs(uint32_t destId);
+
+    // Receiver: payload points into packet; ACKs are batched per peer
+    MeshReliableVerdict onData(uint32_t fromId, const uint8_t* packet, size_t packetLen, uint32_t nowMs,
+                               uint8_t* type, const uint8_t** payload, size_t* payloadLen);
+    bool nextAck(uint32_t* destId, uint8_t* ack, size_t ackCap, size_t* ackLen);
+
+    MeshReliableStats getStats();
+    void resetStats();
+
+    static const size_t HEADER_SIZE = 7;
+    static const size_t ACK_SIZE = 8;
+    static const size_t MAX_PAYLOAD = MESH_OUTBOUND_MAX_RECORD - HEADER_SIZE;
+
+private:
+    struct Slot {
+        uint32_t sentMs;        // Last (re)transmission
+        uint16_t seq;
+        uint16_t length;
+        uint8_t type;
+        uint8_t retries;
+        bool inUse;
+        uint8_t data[MAX_PAYLOAD];
+    };
+
+    struct SendPeer {
+        uint32_t nodeId;        // 0 = free
+        uint32_t lastUsedMs;
+        uint16_t session;
+        uint16_t nextSeq;
+        uint16_t base;          // Oldest unacknowledged seq
+        uint32_t srttX8;        // Smoothed RTT, scaled by 8 (0 = no sample yet)
+        uint32_t rttvarX4;      // RTT variance, scaled by 4
+        uint32_t rtoMs;
+        Slot slots[MESH_RELIABLE_WINDOW];
+    };
+
+    struct ReceivePeer {
+        uint32_t nodeId;        // 0 = free
+        uint32_t lastSeenMs;
+        uint16_t session;
+        uint16_t cumulative;    // Next seq not yet received
+        uint32_t sack;          // Bit i: seq cumulative + 1 + i received
+        bool ackPending;
+    };
+
+    SendPeer sendPeers[MESH_RELIABLE_PEERS];
+    ReceivePeer receivePeers[MESH_RELIABLE_PEERS];
+    uint16_t nextSession;
+    MeshSeenCache delivered;
+    MeshReliableStats stats;
+
+    SendPeer* findSendPeer(uint32_t nodeId, uint32_t nowMs, bool create);
+    ReceivePeer* findReceivePeer(uint32_t nodeId, uint32_t nowMs, bool* fresh);
+    void writePacket(const SendPeer& peer, const Slot& slot, uint8_t* packet, size_t* packetLen);
+    void sampleRtt(SendPeer& peer, uint32_t rttMs);
+    void advanceCumulative(ReceivePeer& peer, uint16_t to);
+};
+
+#endif // MESH_RELIABLE_H
@@ -0,0 +1,51 @@
+// Mesh Seen-Message Cache Header
+#ifndef MESH_SEEN_CACHE_H
+#define MESH_SEEN_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+struct MeshSeenCacheStats {
+    uint32_t hits;       // Duplicates dropped
+    uint32_t misses;     // First sightings
+    uint32_t evictions;  // Live entries displaced before expiry (cache undersized)
+};
+
+/**
+ * @brief Fixed-memory duplicate filter keyed by (source, sequence)
+ *
+ * Set-associative hash table: each (source, seq) pair maps to one set of
+ * MESH_SEEN_CACHE_WAYS entries. Entries age out after MESH_SEEN_CACHE_TTL_MS;
+ * when a set is full the oldest entry is replaced. Lookups and inserts are
+ * O(ways) with no allocation.
+ *
+ * Lookup and insert are split so callers only record a frame once it has
+ * been authenticated; forged headers cannot suppress genuine traffic.
+ */
+class MeshSeenCache {
+public:
+    MeshSeenCache();
+
+    bool contains(uint32_t source, uint32_t seq, uint32_t nowMs);
+    void insert(uint32_t source, uint32_t seq, uint32_t nowMs);
+    void clear();
+
+    MeshSeenCacheStats getStats();
+    void resetStats();
+
+private:
+    struct Entry {
+        uint32_t source;  // 0 = empty slot (broadcast ID is never a sender)
+        uint32_t seq;
+        uint32_t seenMs;
+    };
+
+    Entry entries[MESH_SEEN_CACHE_SETS][MESH_SEEN_CACHE_WAYS];
+    MeshSeenCacheStats stats;
+
+    static size_t setIndex(uint32_t source, uint32_t seq);
+    static bool isLive(const Entry& entry, uint32_t nowMs);
+};
+
+#endif // MESH_SEEN_CACHE_H
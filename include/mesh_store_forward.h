@@ -0,0 +1,124 @@
+// Mesh Store-and-Forward Header
+#ifndef MESH_STORE_FORWARD_H
+#define MESH_STORE_FORWARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mesh_outbound_queue.h"
+#include "mesh_platform.h"
+#include "../config/mesh_config.h"
+
+struct MeshStoreStats {
+    uint32_t records;         // Waiting for an acknowledgement
+    uint32_t bytes;           // Their payload bytes
+    uint32_t oldestAgeMs;     // Since queued (or since restored after a reboot)
+    uint32_t appended;
+    uint32_t delivered;       // Acknowledged by the destination
+    uint32_t replayed;        // Transmissions, first ones included
+    uint32_t retries;         // Transmissions after the first
+    uint32_t expired;         // Given up after MESH_STORE_MAX_AGE_MS
+    uint32_t dropped;         // Refused or lost for want of space
+    uint32_t recovered;       // Found in flash at begin()
+    uint32_t erases;          // Flash sectors erased
+    uint32_t received;        // Receiver side: stored messages handed up
+    uint32_t duplicates;      // Receiver side: replays suppressed
+};
+
+/**
+ * @brief Flash-backed outbound queue that survives partitions and reboots
+ *
+ * Messages that must not be lost (delivery reports, inbound SMS, alarms) are
+ * appended to a log on a dedicated flash partition before anything is sent,
+ * and stay there until their destination acknowledges them. The log is a
+ * ring of MESH_STORE_SECTOR_SIZE sectors, each opened with a generation
+ * number; records are only ever appended, and a delivered or expired one is
+ * retired by clearing its state byte, which flash allows without an erase.
+ * The sector after the one being written is always kept erased: when the
+ * writer moves into it, the live records of the oldest sector are copied
+ * forward and that sector is erased to become the next spare. begin()
+ * rebuilds the RAM index from the log, skipping torn writes by their CRC.
+ *
+ * Records go out in priority order, oldest first within a priority, and at
+ * most MESH_STORE_REPLAY_PER_SEC per second, only toward destinations the
+ * caller reports reachable. Unacknowledged records are repeated with
+ * exponential backoff from MESH_STORE_RETRY_MS; a new connection makes every
+ * record due again. Receivers remember (origin, ID) for MESH_STORE_DEDUP_MS,
+ * so a record whose acknowledgement was lost is handed up only once.
+ *
+ * Flash Record Format (16-byte header, padded to 4 bytes):
+ * [state (1)] + [priority (1)] + [length (2)] + [ID (4)] + [destination (4)] +
+ * [type (1)] + [reserved (1)] + [CRC-16 (2)] + [payload]
+ * Sector Header: [magic (4)] + [generation (4)]
+ *
+ * Message Format (MESH_MSG_STORED), integers little-endian:
+ * DATA: [op 0 (1)] + [ID (4)] + [type (1)] + [payload]
+ * ACK:  [op 1 (1)] + [ID (4)]
+ */
+class MeshStoreForward {
+public:
+    static const size_t DATA_HEADER_SIZE = 6;
+    static const size_t ACK_SIZE = 5;
+    static const size_t MAX_PAYLOAD = MESH_OUTBOUND_MAX_RECORD - DATA_HEADER_SIZE;
+
+    MeshStoreForward();
+
+    // Mounts the log (formatting a blank or foreign segment) and restores waiting records
+    bool begin(MeshFlash* flash, uint32_t nowMs);
+
+    // Sender
+    bool append(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, MeshPriority priority,
+                uint32_t nowMs);
+    void onConnectivity(uint32_t nowMs);
+    bool nextReplay(uint32_t nowMs, MeshSendFilter reachable, void* context, uint32_t* destId,
+                    MeshPriority* priority, uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool onAck(uint32_t from, const uint8_t* data, size_t len);
+
+    // Receiver: payload points into data; an ACK to send back is written whenever data is valid
+    bool receive(uint32_t from, const uint8_t* data, size_t len, uint32_t nowMs, uint8_t* type,
+                 const uint8_t** payload, size_t* payloadLen, uint8_t* ack, size_t ackCap, size_t* ackLen);
+
+    size_t getDepth(MeshPriority priority);
+    MeshStoreStats getStats(uint32_t nowMs);
+
+private:
+    struct Record {
+        uint32_t id;              // 0 = free
+        uint32_t offset;          // Of its header in the segment
+        uint32_t destId;
+        uint32_t queuedMs;
+        uint32_t retryAtMs;       // Due for (re)transmission from here
+        uint16_t length;
+        uint8_t type;
+        uint8_t priority;
+        uint8_t attempts;
+        uint8_t backoff;          // Doublings of MESH_STORE_RETRY_MS; reset on a new connection
+    };
+
+    struct Delivered {
+        uint32_t origin;          // 0 = free
+        uint32_t id;
+        uint32_t seenMs;
+    };
+
+    MeshFlash* flash;
+    uint32_t sectors;
+    uint32_t current;             // Sector being appended to
+    uint32_t writeOffset;         // Within the current sector
+    uint32_t generation;          // Of the current sector
+    Record records[MESH_STORE_MAX_RECORDS];
+    Delivered delivered[MESH_STORE_DEDUP_ENTRIES];
+    uint32_t replayTokens;        // Thousandths of a transmission
+    uint32_t lastRefillMs;
+    MeshStoreStats stats;
+
+    Record* findRecord(uint32_t id);
+    Record* freeRecord();
+    bool openSector(uint32_t sector);
+    bool advance();
+    void relocate(uint32_t sector);
+    bool writeRecord(Record& record, const uint8_t* payload);
+    bool scanSector(uint32_t sector, uint32_t nowMs, uint32_t* end);
+    void retire(Record& record);
+};
+
+#endif // MESH_STORE_FORWARD_H
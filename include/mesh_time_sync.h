@@ -0,0 +1,131 @@
+// Mesh Time Sync Header
+#ifndef MESH_TIME_SYNC_H
+#define MESH_TIME_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+struct MeshTimeStats {
+    uint32_t master;          // Node whose clock defines mesh time
+    uint32_t parent;          // Neighbor we exchange with (0 while we are the master)
+    uint8_t stratum;          // Hops from the master, MeshTimeSync::UNSYNCED before the first sample
+    bool synced;
+    int32_t offsetMs;         // Mesh time minus local time, now
+    int32_t skewPpb;          // Local clock rate error being corrected, parts per billion
+    uint32_t errorMs;         // Bound on the distance between our mesh time and the master's clock
+    uint32_t delayMs;         // Round trip of the exchange the estimate comes from
+    uint32_t requests;
+    uint32_t samples;         // Responses accepted
+    uint32_t rejected;        // Stale, slow, unsynced or foreign-master responses
+    uint32_t masterChanges;
+    uint32_t steps;           // Corrections larger than MESH_TIME_MAX_HOLD_MS
+};
+
+/**
+ * @brief Mesh-wide clock synchronized to a master over neighbor exchanges
+ *
+ * Every node's millis() starts at its own boot, so timestamps from different
+ * nodes share no epoch. The master (chosen by the manager, normally the
+ * lowest live node ID) defines mesh time; every other node periodically runs
+ * an NTP-style exchange with its parent, the next hop toward the master:
+ *   t1 = our request leaves (local clock)    t2 = parent receives (mesh clock)
+ *   t3 = parent's response leaves (mesh)     t4 = response arrives (local)
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2     delay = (t4 - t1) - (t3 - t2)
+ * t3 is the sentMs of the response frame, stamped as it is transmitted.
+ *
+ * The estimate in use is the sample with the smallest error bound among the
+ * last MESH_TIME_SAMPLES, where a sample's bound is its parent's bound plus
+ * half its round trip, widened by MESH_TIME_DRIFT_PPM as it ages. Local clock
+ * rate error is measured between samples at least MESH_TIME_SKEW_SPAN_MS
+ * apart and corrected for. now() never runs backwards: backward corrections
+ * up to MESH_TIME_MAX_HOLD_MS are absorbed by holding the clock. A node that
+ * becomes master keeps the mesh time it already had, so a handover does not
+ * move the mesh clock.
+ *
+ * The caller supplies its own view of the master and the route to it, which
+ * on a mesh larger than the peer table may miss the lowest node. Responses
+ * name their master, so a lower one heard from the parent is adopted and
+ * synced through that neighbor until it goes unconfirmed for
+ * MESH_TIME_MASTER_TIMEOUT_MS; MESH_TIME_MAX_STRATUM ends loops that keep
+ * a departed master's ID alive.
+ *
+ * Time Message Format (MESH_MSG_TIME), integers little-endian:
+ * REQUEST:  [op (1)] + [t1 (4)]
+ * RESPONSE: [op (1)] + [t1 (4)] + [t2 (4)] + [master (4)] + [stratum (1)] + [error ms (2)]
+ */
+class MeshTimeSync {
+public:
+    static const uint8_t UNSYNCED = 0xFF;
+    static const size_t MAX_MESSAGE = 16;
+
+    MeshTimeSync();
+
+    void setSelf(uint32_t nodeId);
+    void setUpstream(uint32_t masterId, uint32_t parentId, uint32_t nowMs);    // Caller's view of the master
+
+    // Exchanges (a request yields the response to send back to its source)
+    bool nextRequest(uint32_t nowMs, uint32_t* destId, uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool receive(uint32_t from, uint32_t sentMs, uint32_t receivedMs, const uint8_t* data, size_t len,
+                 uint8_t* reply, size_t replyCap, size_t* replyLen);
+
+    // Clock
+    uint32_t toMesh(uint32_t localMs);
+    bool now(uint32_t localMs, uint32_t* meshMs, uint32_t* errorMs = nullptr);
+    uint32_t getErrorMs(uint32_t localMs);
+
+    MeshTimeStats getStats(uint32_t nowMs);
+
+private:
+    struct Sample {
+        uint32_t localMs;         // Midpoint of the exchange on our clock
+        int32_t offsetMs;
+        uint32_t delayMs;
+        uint32_t errorMs;         // Bound at localMs
+        uint8_t stratum;
+    };
+
+    uint32_t self;
+    uint32_t master;
+    uint32_t parent;
+    uint32_t localMaster;         // From setUpstream()
+    uint32_t localParent;
+    uint32_t heardMaster;         // Lower master named by a response, 0 = none
+    uint32_t heardVia;
+    uint32_t heardMs;
+    bool synced;
+    uint8_t stratum;
+
+    // Mesh time = local + refOffsetMs + (local - refLocalMs) x skewPpb / 1e9
+    uint32_t refLocalMs;
+    int32_t refOffsetMs;
+    uint32_t refErrorMs;
+    uint32_t refDelayMs;
+    int32_t skewPpb;
+
+    Sample samples[MESH_TIME_SAMPLES];
+    size_t sampleNext;
+    size_t sampleCount;
+    Sample skewAnchor;            // Earlier sample the rate is measured from
+    bool hasAnchor;
+    bool hasSkew;                 // First measured rate is taken as is, later ones are averaged in
+
+    uint32_t pendingDest;         // Outstanding request, 0 = none
+    uint32_t pendingT1;
+    uint32_t lastRequestMs;
+    bool requestedBefore;
+
+    uint32_t lastMeshMs;          // Last value handed out by now()
+    bool hasLast;
+
+    MeshTimeStats stats;
+
+    void select(uint32_t nowMs);
+    void addSample(const Sample& sample);
+    void choose(uint32_t nowMs);
+    void updateSkew(const Sample& sample);
+    int32_t offsetAt(uint32_t localMs);
+    static uint32_t widen(uint32_t errorMs, uint32_t ageMs);
+};
+
+#endif // MESH_TIME_SYNC_H
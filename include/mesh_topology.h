@@ -0,0 +1,98 @@
+// Mesh Topology Header
+#ifndef MESH_TOPOLOGY_H
+#define MESH_TOPOLOGY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config/mesh_config.h"
+
+struct MeshRouteEntry {
+    uint32_t nodeId;
+    uint32_t nextHop;   // Direct neighbour to hand the frame to
+    uint8_t hops;
+    uint8_t load;       // Application-reported load (0 = idle, 255 = saturated)
+    uint16_t cost;      // Sum of link costs along the route (MESH_LINK_COST_UNIT per clean hop)
+};
+
+struct MeshTopologyStats {
+    uint32_t recomputes;      // Route table rebuilds (one per batch of deltas)
+    uint32_t advertsApplied;  // Link-state adverts that changed the graph
+    uint32_t evictions;       // Nodes dropped for space or age
+};
+
+/**
+ * @brief Incremental adjacency graph with cached least-cost routes
+ *
+ * Local links come from painlessMesh connection events; remote links come
+ * from link-state adverts each node broadcasts when its own links change
+ * and every MESH_LINK_STATE_REFRESH_MS. Every link carries the cost its
+ * advertiser measured (MeshLinkQuality; MESH_LINK_COST_UNIT until then).
+ * Any change only marks the graph dirty; the next query rebuilds path
+ * costs, hop counts and next hops with one Dijkstra pass from this node
+ * (O(nodes^2 * links)), so a burst of deltas costs one rebuild. Equal-cost
+ * paths go to the one with fewer hops. In a mesh larger than
+ * MESH_TOPOLOGY_MAX_NODES a new node only displaces nodes at least as far
+ * away as itself, so the graph settles on the nearest part of the mesh.
+ *
+ * Link-State Advert Format:
+ * [version (2, LE)] + [link count (1)] + [neighbour ID (4, LE) + link cost (1)] per link
+ */
+class MeshTopology {
+public:
+    MeshTopology();
+
+    void setSelf(uint32_t nodeId);
+
+    // Local links (from connection callbacks)
+    bool addLink(uint32_t neighborId, uint32_t nowMs);
+    bool removeLink(uint32_t neighborId);
+    bool setLinkCost(uint32_t neighborId, uint8_t cost);
+
+    // Link-state adverts
+    bool encodeLinkState(uint8_t* output, size_t outputCap, size_t* outputLen);
+    bool applyLinkState(uint32_t origin, const uint8_t* data, size_t len, uint32_t nowMs);
+    void expire(uint32_t nowMs);
+
+    // Route queries (rebuild the cache first if the graph changed)
+    static const uint8_t UNREACHABLE = 0xFF;
+    uint8_t getHopDistance(uint32_t nodeId);
+    uint32_t getNextHop(uint32_t nodeId);
+    static const uint16_t NO_PATH = 0xFFFF;
+    uint16_t getPathCost(uint32_t nodeId);
+    size_t getReachableCount();
+    size_t getNeighborCount();
+
+    // Load-aware placement
+    bool setLoad(uint32_t nodeId, uint8_t load);
+    size_t getNodesWithin(uint8_t maxHops, MeshRouteEntry* output, size_t outputCap);
+    uint32_t findLeastLoaded(uint8_t maxHops, bool includeSelf);
+
+    MeshTopologyStats getStats();
+
+    static const size_t MAX_ADVERT_SIZE = 3 + MESH_TOPOLOGY_MAX_LINKS * 5;
+
+private:
+    struct Node {
+        uint32_t id;                            // 0 = free slot
+        uint32_t links[MESH_TOPOLOGY_MAX_LINKS];
+        uint8_t costs[MESH_TOPOLOGY_MAX_LINKS];
+        uint32_t updatedMs;
+        uint16_t version;
+        uint8_t linkCount;
+        uint8_t load;
+        uint8_t hops;                           // Cached: links on the least-cost path from self
+        uint16_t pathCost;                      // Cached: cost of that path
+        uint8_t nextHop;                        // Cached: slot of first hop
+    };
+
+    Node nodes[MESH_TOPOLOGY_MAX_NODES];        // Slot 0 is always this node
+    static_assert(MESH_TOPOLOGY_MAX_NODES <= 256, "Slot indices must fit Node::nextHop");
+    bool dirty;
+    MeshTopologyStats stats;
+
+    int findSlot(uint32_t nodeId);
+    int allocateSlot(uint32_t nodeId, uint32_t nowMs, bool evict, uint8_t hops = UNREACHABLE);
+    void refresh();
+};
+
+#endif // MESH_TOPOLOGY_H
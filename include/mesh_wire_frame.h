@@ -0,0 +1,89 @@
+// Mesh Wire Frame Header
+#ifndef MESH_WIRE_FRAME_H
+#define MESH_WIRE_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Versioned binary envelope for mesh messages
+ *
+ * Replaces the JSON + hex envelope previously built in MeshNetworkManager.
+ * All multi-byte fields are little-endian. The payload (ciphertext) follows
+ * the fixed header directly and is referenced in place on decode, so neither
+ * encode nor decode touches the heap.
+ *
+ * Frame Layout (v1, 24-byte header):
+ * [version:1][type:1][flags:1][hops:1][seq:4][source:4][dest:4]
+ * [sentMs:4][keyEpoch:2][length:2][payload (length bytes)]
+ * With FLAG_TOPIC set, dest carries a topic ID instead of a node ID.
+ *
+ * painlessMesh only carries text, so frames are base64-armored for transport.
+ */
+
+// Types below MESH_MSG_APP_BASE belong to the mesh layer; other modules
+// (SIM manager, OTA, logger) register handlers from MESH_MSG_APP_BASE up.
+enum MeshMessageType : uint8_t {
+    MESH_MSG_INVALID = 0,
+    MESH_MSG_HEARTBEAT = 1,
+    MESH_MSG_DATA = 2,
+    MESH_MSG_COMMAND = 3,
+    MESH_MSG_BATCH = 4,     // Coalesced records, see MeshOutboundQueue
+    MESH_MSG_LINK_STATE = 5,
+    MESH_MSG_RELIABLE = 6,  // Sequenced wrapper around another message, see MeshReliable
+    MESH_MSG_ACK = 7,
+    MESH_MSG_FRAGMENT = 8,  // Piece of a larger message, see MeshReassembler
+    MESH_MSG_CREDIT = 9,    // Flow-control grant to a neighbor, see MeshFlowControl
+    MESH_MSG_SUBSCRIPTION = 10, // Topic digest advert, see MeshSubscriptions
+    MESH_MSG_JOB = 11,      // SMS job placement and results, see MeshJobBalancer
+    MESH_MSG_TIME = 12,     // Clock exchange with a neighbor, see MeshTimeSync
+    MESH_MSG_LATENCY = 13,  // Latency histogram report, see MeshLatencyRecorder
+    MESH_MSG_LINK_PROBE = 14, // Delivery and round-trip probe to a neighbor, see MeshLinkQuality
+    MESH_MSG_STORED = 15,   // Flash-persisted message or its acknowledgement, see MeshStoreForward
+    MESH_MSG_APP_BASE = 16
+};
+
+struct MeshFrameHeader {
+    uint8_t version;
+    uint8_t type;
+    uint8_t flags;
+    uint8_t hops;
+    uint32_t seq;       // Per-source sequence number
+    uint32_t source;    // Originating node ID
+    uint32_t dest;      // Destination node ID (0 = broadcast)
+    uint32_t sentMs;    // Sender's mesh clock at transmission (see MeshTimeSync)
+    uint16_t keyEpoch;  // Key generation used for the payload
+    uint16_t length;    // Payload length in bytes
+};
+
+class MeshWireFrame {
+public:
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 24;
+    static const uint32_t BROADCAST_DEST = 0;
+
+    // Header flags (authenticated; relays forward them unchanged)
+    static const uint8_t FLAG_CREDITED = 0x01;    // Charged against the next hop's credits
+    static const uint8_t FLAG_COMPRESSED = 0x02;  // Plaintext is MeshCompressor output
+    static const uint8_t FLAG_TOPIC = 0x04;       // dest is a topic ID, see MeshSubscriptions
+    static const uint8_t FLAG_MESH_TIME = 0x08;   // Sender was synchronized when it stamped sentMs
+
+    // Frame encoding/decoding (in place, caller-owned buffers)
+    static bool encode(const MeshFrameHeader& header, const uint8_t* payload,
+                       uint8_t* output, size_t outputCap, size_t* outputLen);
+    static bool decode(const uint8_t* frame, size_t frameLen,
+                       MeshFrameHeader* header, const uint8_t** payload);
+
+    // Header-only helpers (payload written separately by the caller)
+    static bool writeHeader(const MeshFrameHeader& header, uint8_t* output, size_t outputCap);
+    static bool readHeader(const uint8_t* frame, size_t frameLen, MeshFrameHeader* header);
+
+    // Transport armor (base64) for text-only links
+    static size_t armoredSize(size_t frameLen);
+    static bool armor(const uint8_t* frame, size_t frameLen,
+                      char* output, size_t outputCap, size_t* outputLen);
+    static bool unarmor(const char* text, size_t textLen,
+                        uint8_t* output, size_t outputCap, size_t* outputLen);
+};
+
+#endif // MESH_WIRE_FRAME_H
@@ -73,7 +73,7 @@ private:
     // Firmware signature verification
     bool verifyFirmwareSignature(const uint8_t* firmwareData, size_t dataSize, const String& signature);
     bool calculateSHA256(const uint8_t* data, size_t len, uint8_t* hash);
-    String base64Decode(const String& input);
+    bool base64Decode(const String& input, uint8_t* output, size_t outputCap, size_t* outputLen);
 
     // Update process
     bool downloadFirmware(const String& url, uint8_t*& buffer, size_t& bufferSize);
@@ -0,0 +1,39 @@
+// Text Codec Header
+#ifndef TEXT_CODEC_H
+#define TEXT_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Hex and base64 (RFC 4648) over caller buffers, no allocation
+ *
+ * Scalar kernels are table lookups only, with the tables in flash. Host
+ * builds on x86 switch to SSSE3 kernels, 16 input bytes per step, when the
+ * CPU has them; setAccelerated(false) forces the scalar path for tests and
+ * benchmarks. Both paths produce identical output and accept identical input.
+ *
+ * Encoders write uppercase hex / standard-alphabet base64 with '=' padding
+ * and a terminating NUL, so outputCap needs one byte more than the encoded
+ * size. Decoders are strict: hex must have even length (either case is
+ * accepted); base64 must be padded to a multiple of four, with '=' only at
+ * the end and unused trailing bits zero. On failure the output is undefined.
+ */
+class TextCodec {
+public:
+    static size_t hexEncodedSize(size_t len);
+    static bool hexEncode(const uint8_t* input, size_t len, char* output, size_t outputCap, size_t* outputLen);
+    static bool hexDecode(const char* text, size_t textLen, uint8_t* output, size_t outputCap, size_t* outputLen);
+
+    static size_t base64EncodedSize(size_t len);
+    static size_t base64DecodedMax(size_t textLen);
+    static bool base64Encode(const uint8_t* input, size_t len, char* output, size_t outputCap, size_t* outputLen);
+    static bool base64Decode(const char* text, size_t textLen, uint8_t* output, size_t outputCap,
+                             size_t* outputLen);
+
+    // Returns whether vector kernels are in use afterwards
+    static bool setAccelerated(bool enable);
+    static bool isAccelerated();
+};
+
+#endif // TEXT_CODEC_H
@@ -0,0 +1,362 @@
+// Text Codec - Table-driven hex and base64 with SSSE3 kernels on x86 hosts
+#include <string.h>
+#include "text_codec.h"
+
+#if !defined(ARDUINO) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TEXT_CODEC_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace {
+
+// Two uppercase digits per byte value
+const char HEX_PAIRS[] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+// Nibble value per character, 0xFF for anything that is not a hex digit
+const uint8_t HEX_VALUES[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+const char BASE64_ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Sextet per character, 0xFF for anything outside the alphabet ('=' included)
+const uint8_t BASE64_VALUES[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+#ifdef TEXT_CODEC_SSSE3
+bool& accelerated() {
+    static bool enabled = __builtin_cpu_supports("ssse3");
+    return enabled;
+}
+
+// 16 bytes to 32 digits per step; returns the bytes consumed
+__attribute__((target("ssse3")))
+size_t hexEncodeVector(const uint8_t* input, size_t len, char* output) {
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    const __m128i low = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(input + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), low));
+        __m128i lowDigits = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, low));
+        _mm_storeu_si128((__m128i*)(output + 2 * i), _mm_unpacklo_epi8(high, lowDigits));
+        _mm_storeu_si128((__m128i*)(output + 2 * i + 16), _mm_unpackhi_epi8(high, lowDigits));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+inline bool hexNibbles(__m128i chars, __m128i* values) {
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                   _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    *values = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(chars, _mm_set1_epi8('0'))),
+                           _mm_and_si128(letter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+    return _mm_movemask_epi8(_mm_or_si128(digit, letter)) == 0xFFFF;
+}
+
+// 32 digits to 16 bytes per step; returns the digits consumed, or (size_t)-1 on a bad digit
+__attribute__((target("ssse3")))
+size_t hexDecodeVector(const char* text, size_t textLen, uint8_t* output) {
+    const __m128i weights = _mm_set1_epi16(0x0110);   // High nibble x16, low nibble x1
+    size_t i = 0;
+    for (; i + 32 <= textLen; i += 32) {
+        __m128i first;
+        __m128i second;
+        if (!hexNibbles(_mm_loadu_si128((const __m128i*)(text + i)), &first) ||
+            !hexNibbles(_mm_loadu_si128((const __m128i*)(text + i + 16)), &second)) {
+            return (size_t)-1;
+        }
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+        _mm_storeu_si128((__m128i*)(output + i / 2), bytes);
+    }
+    return i;
+}
+
+// 12 bytes to 16 symbols per step (loads 16); returns the bytes consumed
+__attribute__((target("ssse3")))
+size_t base64EncodeVector(const uint8_t* input, size_t len, char* output) {
+    const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    char* out = output;
+    for (; i + 16 <= len; i += 12, out += 16) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + i)), spread);
+
+        // Move each sextet into its own byte
+        __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        __m128i sextets = _mm_or_si128(ac, bd);
+
+        // Range index 0 (A-Z), 1 (a-z), 2-11 (digits), 12 ('+'), 13 ('/'), 14 (A-Z fixup)
+        __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), sextets);
+        range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+        __m128i symbols = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), sextets);
+        _mm_storeu_si128((__m128i*)out, symbols);
+    }
+    return i;
+}
+
+// 16 symbols to 12 bytes per step (stores 16); returns the symbols consumed, or (size_t)-1 on a bad one
+__attribute__((target("ssse3")))
+size_t base64DecodeVector(const char* text, size_t textLen, uint8_t* output, size_t outputCap) {
+    // Valid high nibbles per low nibble, as a bit per high nibble
+    const __m128i validMask = _mm_setr_epi8((char)0xA8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8,
+                                            (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8,
+                                            (char)0xF0, 0x54, 0x50, 0x50, 0x50, 0x54);
+    const __m128i highBit = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+                                          0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i shifts = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i low = _mm_set1_epi8(0x0F);
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    size_t o = 0;
+    for (; i + 16 <= textLen && o + 16 <= outputCap; i += 16, o += 12) {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i highNibble = _mm_and_si128(_mm_srli_epi32(chars, 4), low);
+        __m128i lowNibble = _mm_and_si128(chars, low);
+        __m128i valid = _mm_and_si128(_mm_shuffle_epi8(validMask, lowNibble), _mm_shuffle_epi8(highBit, highNibble));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(valid, _mm_setzero_si128())) != 0) {
+            return (size_t)-1;
+        }
+
+        // '/' shares its high nibble with '+' but not its offset
+        __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+        __m128i shift = _mm_or_si128(_mm_andnot_si128(slash, _mm_shuffle_epi8(shifts, highNibble)),
+                                     _mm_and_si128(slash, _mm_set1_epi8(16)));
+        __m128i sextets = _mm_add_epi8(chars, shift);
+
+        __m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+        __m128i triples = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*)(output + o), _mm_shuffle_epi8(triples, order));
+    }
+    return i;
+}
+#endif
+
+inline bool useVector() {
+#ifdef TEXT_CODEC_SSSE3
+    return accelerated();
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+bool TextCodec::setAccelerated(bool enable) {
+#ifdef TEXT_CODEC_SSSE3
+    accelerated() = enable && __builtin_cpu_supports("ssse3");
+    return accelerated();
+#else
+    return false;
+#endif
+}
+
+bool TextCodec::isAccelerated() {
+    return useVector();
+}
+
+size_t TextCodec::hexEncodedSize(size_t len) {
+    return len * 2;
+}
+
+bool TextCodec::hexEncode(const uint8_t* input, size_t len, char* output, size_t outputCap, size_t* outputLen) {
+    if ((!input && len > 0) || !output || !outputLen || hexEncodedSize(len) + 1 > outputCap) {
+        return false;
+    }
+
+    size_t i = 0;
+#ifdef TEXT_CODEC_SSSE3
+    if (useVector()) i = hexEncodeVector(input, len, output);
+#endif
+    for (; i < len; i++) {
+        memcpy(output + 2 * i, HEX_PAIRS + 2 * input[i], 2);
+    }
+
+    output[2 * len] = '\0';
+    *outputLen = 2 * len;
+    return true;
+}
+
+bool TextCodec::hexDecode(const char* text, size_t textLen, uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if ((!text && textLen > 0) || !output || !outputLen || textLen % 2 != 0 || textLen / 2 > outputCap) {
+        return false;
+    }
+
+    size_t i = 0;
+#ifdef TEXT_CODEC_SSSE3
+    if (useVector()) {
+        i = hexDecodeVector(text, textLen, output);
+        if (i == (size_t)-1) return false;
+    }
+#endif
+    for (; i < textLen; i += 2) {
+        uint8_t high = HEX_VALUES[(uint8_t)text[i]];
+        uint8_t low = HEX_VALUES[(uint8_t)text[i + 1]];
+        if ((high | low) & 0xF0) {
+            return false;
+        }
+        output[i / 2] = (uint8_t)((high << 4) | low);
+    }
+
+    *outputLen = textLen / 2;
+    return true;
+}
+
+size_t TextCodec::base64EncodedSize(size_t len) {
+    return ((len + 2) / 3) * 4;
+}
+
+size_t TextCodec::base64DecodedMax(size_t textLen) {
+    return (textLen / 4) * 3;
+}
+
+bool TextCodec::base64Encode(const uint8_t* input, size_t len, char* output, size_t outputCap,
+                             size_t* outputLen) {
+    if ((!input && len > 0) || !output || !outputLen) {
+        return false;
+    }
+
+    // Reserve one byte for the terminator
+    size_t needed = base64EncodedSize(len);
+    if (needed + 1 > outputCap) {
+        return false;
+    }
+
+    size_t i = 0;
+#ifdef TEXT_CODEC_SSSE3
+    if (useVector()) i = base64EncodeVector(input, len, output);
+#endif
+    char* out = output + (i / 3) * 4;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t triple = ((uint32_t)input[i] << 16) | ((uint32_t)input[i + 1] << 8) | input[i + 2];
+        *out++ = BASE64_ALPHABET[(triple >> 18) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 6) & 0x3F];
+        *out++ = BASE64_ALPHABET[triple & 0x3F];
+    }
+
+    size_t remaining = len - i;
+    if (remaining > 0) {
+        uint32_t triple = (uint32_t)input[i] << 16;
+        if (remaining == 2) triple |= (uint32_t)input[i + 1] << 8;
+        *out++ = BASE64_ALPHABET[(triple >> 18) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = (remaining == 2) ? BASE64_ALPHABET[(triple >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+
+    *out = '\0';
+    *outputLen = needed;
+    return true;
+}
+
+bool TextCodec::base64Decode(const char* text, size_t textLen, uint8_t* output, size_t outputCap,
+                             size_t* outputLen) {
+    if ((!text && textLen > 0) || !output || !outputLen || textLen % 4 != 0) {
+        return false;
+    }
+    if (textLen == 0) {
+        *outputLen = 0;
+        return true;
+    }
+
+    size_t padding = 0;
+    if (text[textLen - 1] == '=') padding++;
+    if (text[textLen - 2] == '=') padding++;
+
+    size_t decodedLen = base64DecodedMax(textLen) - padding;
+    if (decodedLen > outputCap) {
+        return false;
+    }
+
+    // Every quad but the last is unpadded
+    size_t body = textLen - 4;
+    size_t i = 0;
+#ifdef TEXT_CODEC_SSSE3
+    if (useVector()) {
+        i = base64DecodeVector(text, body, output, outputCap);
+        if (i == (size_t)-1) return false;
+    }
+#endif
+    uint8_t* out = output + (i / 4) * 3;
+    for (; i < body; i += 4) {
+        uint8_t a = BASE64_VALUES[(uint8_t)text[i]];
+        uint8_t b = BASE64_VALUES[(uint8_t)text[i + 1]];
+        uint8_t c = BASE64_VALUES[(uint8_t)text[i + 2]];
+        uint8_t d = BASE64_VALUES[(uint8_t)text[i + 3]];
+        if ((a | b | c | d) & 0x80) {
+            return false;
+        }
+        uint32_t triple = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+        *out++ = (uint8_t)(triple >> 16);
+        *out++ = (uint8_t)(triple >> 8);
+        *out++ = (uint8_t)triple;
+    }
+
+    // Final quad: pad symbols stand in for zero bits, which must really be zero
+    uint8_t a = BASE64_VALUES[(uint8_t)text[body]];
+    uint8_t b = BASE64_VALUES[(uint8_t)text[body + 1]];
+    uint8_t c = padding >= 2 ? 0 : BASE64_VALUES[(uint8_t)text[body + 2]];
+    uint8_t d = padding >= 1 ? 0 : BASE64_VALUES[(uint8_t)text[body + 3]];
+    if ((a | b | c | d) & 0x80) {
+        return false;
+    }
+    if ((padding == 2 && (b & 0x0F)) || (padding == 1 && (c & 0x03))) {
+        return false;
+    }
+    uint32_t triple = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+    *out++ = (uint8_t)(triple >> 16);
+    if (padding < 2) *out++ = (uint8_t)(triple >> 8);
+    if (padding < 1) *out++ = (uint8_t)triple;
+
+    *outputLen = decodedLen;
+    return true;
+}
@@ -3,11 +3,77 @@
 #include "core/persistent_node_manager.h"
 #include "core/configuration_manager.h"
 #include "mesh/mesh_network_manager.h"
+#include "sim_multiplexer.h"
+#include "gsm_at_handler.h"
+#include "persian_sms_handler.h"
+
+#define SIM_RESCAN_INTERVAL_MS 30000    // SIM slots are rescanned (and re-advertised) this often
+#define SMS_TASK_STACK 8192
 
 // Global instances
 PersistentNodeManager nodeManager;
 ConfigurationManager configManager;
 MeshNetworkManager meshManager;
+SIMMultiplexer simMultiplexer;
+GSMATHandler modem(&Serial2);
+PersianSMSHandler smsText;
+
+// SIM slots holding a card, as the mask the mesh advertises in heartbeats
+static uint32_t scanSimMask() {
+    uint32_t mask = 0;
+    for (uint8_t slot : simMultiplexer.scanPresentSIMs()) {
+        mask |= 1UL << slot;
+    }
+    return mask;
+}
+
+// Runs the SMS jobs the mesh places on this node. Modem sends take seconds, so they
+// stay off loop(); the multiplexer and modem are only touched from this task.
+static void smsTask(void* context) {
+    uint32_t simMask = 0;
+    unsigned long lastScan = 0;
+    uint8_t nextSlot = 0;
+    MeshSmsJob job;
+    char number[MESH_JOB_MAX_BODY + 1];
+    char text[MESH_JOB_MAX_BODY + 1];
+
+    for (;;) {
+        if (lastScan == 0 || millis() - lastScan >= SIM_RESCAN_INTERVAL_MS) {
+            simMask = scanSimMask();
+            meshManager.setSimStatus(simMask);
+            lastScan = millis();
+        }
+
+        if (simMask == 0 || !meshManager.takeSmsJob(&job)) {
+            delay(100);
+            continue;
+        }
+
+        // Job body: recipient number, a NUL, then the UTF-8 text
+        size_t numberLen = strnlen((const char*)job.body, job.length);
+        if (numberLen == 0 || numberLen >= job.length) {
+            Serial.printf("Malformed SMS job %u from %u\n", job.jobId, job.submitter);
+            meshManager.completeSmsJob(job, false, 0);
+            continue;
+        }
+        memcpy(number, job.body, numberLen + 1);
+        size_t textLen = job.length - numberLen - 1;
+        memcpy(text, job.body + numberLen + 1, textLen);
+        text[textLen] = '\0';
+
+        // Spread sends across the SIMs present, one after another
+        while (!(simMask & (1UL << nextSlot))) {
+            nextSlot = (nextSlot + 1) % 32;
+        }
+        simMultiplexer.selectSlot(nextSlot);
+        nextSlot = (nextSlot + 1) % 32;
+
+        unsigned long start = millis();
+        bool sent = smsText.isPersianText(text) ? modem.sendSMS_Persian(number, text)
+                                                : modem.sendSMS(number, text);
+        meshManager.completeSmsJob(job, sent, millis() - start);
+    }
+}
 
 void setup() {
     // Initialize serial communication
@@ -34,6 +100,15 @@ void setup() {
         while (1) delay(1000);
     }
 
+    // SMS jobs run here only with a responsive modem; otherwise the node advertises no SIMs
+    // and the coordinator places jobs elsewhere
+    Serial.println("Initializing SIM multiplexer and modem...");
+    if (simMultiplexer.begin() && modem.begin() && smsText.begin()) {
+        xTaskCreatePinnedToCore(smsTask, "sms", SMS_TASK_STACK, nullptr, 1, nullptr, 1);
+    } else {
+        Serial.println("WARNING: Modem unavailable, SMS jobs will run on other nodes");
+    }
+
     // Print node information
     Serial.printf("Node ID: %s\n", nodeManager.getNodeId().c_str());
     Serial.printf("Mesh Node ID: %u\n", meshManager.getNodeId());
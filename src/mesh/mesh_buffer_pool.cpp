@@ -0,0 +1,120 @@
+// Mesh Buffer Pool - Fixed slab allocator for frame scratch buffers
+#include <string.h>
+#include "mesh_buffer_pool.h"
+
+MeshBuffer::MeshBuffer() : owner(nullptr), block(nullptr), blockSize(0), index(0), bufferClass(0) {}
+
+MeshBuffer::MeshBuffer(MeshBufferPool* owner, uint8_t bufferClass, uint16_t index, uint8_t* block,
+                       size_t blockSize) :
+    owner(owner), block(block), blockSize(blockSize), index(index), bufferClass(bufferClass) {}
+
+MeshBuffer::~MeshBuffer() {
+    release();
+}
+
+MeshBuffer::MeshBuffer(MeshBuffer&& other) :
+    owner(other.owner), block(other.block), blockSize(other.blockSize),
+    index(other.index), bufferClass(other.bufferClass) {
+    other.owner = nullptr;
+    other.block = nullptr;
+    other.blockSize = 0;
+}
+
+MeshBuffer& MeshBuffer::operator=(MeshBuffer&& other) {
+    if (this != &other) {
+        release();
+        owner = other.owner;
+        block = other.block;
+        blockSize = other.blockSize;
+        index = other.index;
+        bufferClass = other.bufferClass;
+        other.owner = nullptr;
+        other.block = nullptr;
+        other.blockSize = 0;
+    }
+    return *this;
+}
+
+void MeshBuffer::release() {
+    if (owner) {
+        owner->release(bufferClass, index);
+    }
+    owner = nullptr;
+    block = nullptr;
+    blockSize = 0;
+}
+
+MeshBufferPool::MeshBufferPool() {
+    initClass(classes[MESH_BUFFER_SMALL], smallBlocks, MESH_BUFFER_SMALL_SIZE, smallFree, MESH_BUFFER_SMALL_COUNT);
+    initClass(classes[MESH_BUFFER_MEDIUM], mediumBlocks, MESH_BUFFER_MEDIUM_SIZE, mediumFree,
+              MESH_BUFFER_MEDIUM_COUNT);
+    initClass(classes[MESH_BUFFER_LARGE], largeBlocks, MESH_BUFFER_LARGE_SIZE, largeFree, MESH_BUFFER_LARGE_COUNT);
+}
+
+void MeshBufferPool::initClass(SizeClass& sizeClass, uint8_t* storage, size_t blockSize, uint16_t* freeList,
+                               uint16_t count) {
+    sizeClass.storage = storage;
+    sizeClass.blockSize = blockSize;
+    sizeClass.freeList = freeList;
+    sizeClass.freeCount = count;
+    memset(&sizeClass.stats, 0, sizeof(sizeClass.stats));
+    sizeClass.stats.blockSize = blockSize;
+    sizeClass.stats.blockCount = count;
+
+    // Lowest index on top so a quiet node keeps reusing the same few blocks
+    for (uint16_t i = 0; i < count; i++) {
+        freeList[i] = count - 1 - i;
+    }
+}
+
+MeshBuffer MeshBufferPool::acquire(size_t size) {
+    size_t wanted = 0;
+    while (wanted < MESH_BUFFER_CLASS_COUNT && classes[wanted].blockSize < size) {
+        wanted++;
+    }
+
+    for (size_t c = wanted; c < MESH_BUFFER_CLASS_COUNT; c++) {
+        SizeClass& sizeClass = classes[c];
+        if (sizeClass.freeCount == 0) {
+            continue;
+        }
+
+        uint16_t index = sizeClass.freeList[--sizeClass.freeCount];
+        sizeClass.stats.inUse++;
+        sizeClass.stats.acquired++;
+        if (sizeClass.stats.inUse > sizeClass.stats.highWater) {
+            sizeClass.stats.highWater = sizeClass.stats.inUse;
+        }
+        if (c != wanted) {
+            classes[wanted].stats.fallbacks++;
+        }
+        return MeshBuffer(this, (uint8_t)c, index, sizeClass.storage + index * sizeClass.blockSize,
+                          sizeClass.blockSize);
+    }
+
+    // Oversized requests are charged to the largest class
+    size_t charged = wanted < MESH_BUFFER_CLASS_COUNT ? wanted : (size_t)MESH_BUFFER_LARGE;
+    classes[charged].stats.failures++;
+    return MeshBuffer();
+}
+
+void MeshBufferPool::release(uint8_t bufferClass, uint16_t index) {
+    SizeClass& sizeClass = classes[bufferClass];
+    sizeClass.freeList[sizeClass.freeCount++] = index;
+    sizeClass.stats.inUse--;
+}
+
+MeshBufferPoolStats MeshBufferPool::getStats(MeshBufferClass bufferClass) {
+    MeshBufferPoolStats empty;
+    memset(&empty, 0, sizeof(empty));
+    return bufferClass < MESH_BUFFER_CLASS_COUNT ? classes[bufferClass].stats : empty;
+}
+
+void MeshBufferPool::resetStats() {
+    for (size_t c = 0; c < MESH_BUFFER_CLASS_COUNT; c++) {
+        MeshBufferPoolStats& stats = classes[c].stats;
+        stats.acquired = 0;
+        stats.fallbacks = 0;
+        stats.failures = 0;
+    }
+}
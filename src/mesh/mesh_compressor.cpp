@@ -0,0 +1,236 @@
+// Mesh Compressor - LZ77 block codec with static per-type dictionaries
+#include <string.h>
+#include "mesh_compressor.h"
+#include "mesh_wire_frame.h"
+
+// Common SMS job and status fields, most frequent last (nearest the data)
+static const char dataDictionary[] =
+    "\"imsi\":\"\"operator\":\"MCI\"Irancell\"RighTel\"balance\":\"signal\":"
+    "\"error\":\"retry\":\"status\":\"queued\"sent\"delivered\"failed\""
+    "\"encoding\":\"ucs2\"gsm7\"ts\":\"slot\":\"sim\":\"text\":\"to\":\"+98912"
+    "{\"job\":\"sms\",\"id\":";
+
+static inline uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline size_t hashOf(const uint8_t* p) {
+    return (read32(p) * 2654435761u) >> (32 - MESH_COMPRESS_HASH_BITS);
+}
+
+// Writes a length of 15 or more as extension bytes after its nibble
+static inline bool putLength(size_t value, uint8_t* output, size_t outputCap, size_t* pos) {
+    for (; value >= 255; value -= 255) {
+        if (*pos >= outputCap) return false;
+        output[(*pos)++] = 255;
+    }
+    if (*pos >= outputCap) return false;
+    output[(*pos)++] = (uint8_t)value;
+    return true;
+}
+
+static inline bool getLength(const uint8_t* input, size_t len, size_t* pos, size_t* value) {
+    uint8_t byte;
+    do {
+        if (*pos >= len) return false;
+        byte = input[(*pos)++];
+        *value += byte;
+    } while (byte == 255);
+    return true;
+}
+
+MeshCompressor::MeshCompressor() {
+    memset(types, 0, sizeof(types));
+    memset(&stats, 0, sizeof(stats));
+    memset(&decodeStats, 0, sizeof(decodeStats));
+
+    // Wrappers that mostly carry DATA records share its dictionary
+    const uint8_t dataTypes[] = {MESH_MSG_DATA, MESH_MSG_BATCH, MESH_MSG_RELIABLE, MESH_MSG_FRAGMENT};
+    for (size_t i = 0; i < sizeof(dataTypes); i++) {
+        setDictionary(dataTypes[i], (const uint8_t*)dataDictionary, sizeof(dataDictionary) - 1);
+    }
+}
+
+bool MeshCompressor::setDictionary(uint8_t type, const uint8_t* dictionary, size_t len) {
+    if (type >= MESH_DISPATCH_TABLE_SIZE || len > MESH_COMPRESS_MAX_DICTIONARY || (len > 0 && !dictionary)) {
+        return false;
+    }
+    types[type].dictionary = len > 0 ? dictionary : nullptr;
+    types[type].dictionaryLen = (uint16_t)len;
+    return true;
+}
+
+bool MeshCompressor::encodeBlock(size_t start, size_t end, uint8_t* output, size_t outputCap, size_t* outputLen) {
+    size_t out = 0;
+    size_t anchor = start;
+    size_t pos = start;
+
+    while (pos + MATCH_MIN_LENGTH <= end) {
+        size_t h = hashOf(work + pos);
+        size_t candidate = hashTable[h];
+        hashTable[h] = (uint16_t)(pos + 1);
+
+        if (candidate == 0 || read32(work + candidate - 1) != read32(work + pos)) {
+            pos++;
+            continue;
+        }
+        candidate--;
+
+        size_t matchLen = MATCH_MIN_LENGTH;
+        while (pos + matchLen < end && work[candidate + matchLen] == work[pos + matchLen]) {
+            matchLen++;
+        }
+
+        size_t literals = pos - anchor;
+        size_t matchCode = matchLen - MATCH_MIN_LENGTH;
+        if (out >= outputCap) return false;
+        output[out++] = (uint8_t)(((literals < 15 ? literals : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+        if (literals >= 15 && !putLength(literals - 15, output, outputCap, &out)) return false;
+        if (out + literals + 2 > outputCap) return false;
+        memcpy(output + out, work + anchor, literals);
+        out += literals;
+
+        size_t offset = pos - candidate;
+        output[out++] = (uint8_t)offset;
+        output[out++] = (uint8_t)(offset >> 8);
+        if (matchCode >= 15 && !putLength(matchCode - 15, output, outputCap, &out)) return false;
+
+        // Seed the table inside long matches so the next sequence can find them
+        if (matchLen > 8) {
+            size_t mid = pos + matchLen - 4;
+            hashTable[hashOf(work + mid)] = (uint16_t)(mid + 1);
+        }
+
+        pos += matchLen;
+        anchor = pos;
+    }
+
+    // Trailing literals close the block
+    size_t literals = end - anchor;
+    if (out >= outputCap) return false;
+    output[out++] = (uint8_t)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15 && !putLength(literals - 15, output, outputCap, &out)) return false;
+    if (out + literals > outputCap) return false;
+    memcpy(output + out, work + anchor, literals);
+    out += literals;
+
+    *outputLen = out;
+    return true;
+}
+
+bool MeshCompressor::compress(uint8_t type, const uint8_t* input, size_t len,
+                              uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!input || !output || !outputLen || type >= MESH_DISPATCH_TABLE_SIZE || len > MAX_BLOCK) {
+        return false;
+    }
+
+    TypeState& state = types[type];
+    if (len < MESH_COMPRESS_MIN_BYTES || state.backoff > 0) {
+        if (state.backoff > 0) state.backoff--;
+        stats.skipped++;
+        return false;
+    }
+
+    stats.attempted++;
+
+    // Dictionary and input share one window so matches may start in either
+    size_t start = state.dictionaryLen;
+    if (start > 0) {
+        memcpy(work, state.dictionary, start);
+    }
+    memcpy(work + start, input, len);
+
+    memset(hashTable, 0, sizeof(hashTable));
+    for (size_t pos = 0; pos + MATCH_MIN_LENGTH <= start; pos++) {
+        hashTable[hashOf(work + pos)] = (uint16_t)(pos + 1);
+    }
+
+    // Only worth sending if it saves at least MESH_COMPRESS_MIN_SAVING
+    size_t budget = len - MESH_COMPRESS_MIN_SAVING;
+    if (budget > outputCap) budget = outputCap;
+
+    size_t compressedLen;
+    if (!encodeBlock(start, start + len, output, budget, &compressedLen)) {
+        stats.notSmaller++;
+        if (++state.misses >= 4) {
+            state.misses = 0;
+            state.backoff = MESH_COMPRESS_BACKOFF;
+        }
+        return false;
+    }
+
+    state.misses = 0;
+    stats.compressed++;
+    stats.bytesIn += len;
+    stats.bytesOut += compressedLen;
+    *outputLen = compressedLen;
+    return true;
+}
+
+bool MeshCompressor::decompress(uint8_t type, const uint8_t* input, size_t len,
+                                uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!input || !output || !outputLen || type >= MESH_DISPATCH_TABLE_SIZE) {
+        return false;
+    }
+
+    const uint8_t* dictionary = types[type].dictionary;
+    size_t dictionaryLen = types[type].dictionaryLen;
+    size_t in = 0;
+    size_t out = 0;
+
+    for (;;) {
+        if (in >= len) break;
+        uint8_t token = input[in++];
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(input, len, &in, &literals)) break;
+        if (in + literals > len || out + literals > outputCap) break;
+        memcpy(output + out, input + in, literals);
+        in += literals;
+        out += literals;
+
+        // A block ends after the literals of its last sequence
+        if (in == len) {
+            decodeStats.decompressed++;
+            *outputLen = out;
+            return true;
+        }
+
+        if (in + 2 > len) break;
+        size_t offset = input[in] | (input[in + 1] << 8);
+        in += 2;
+        size_t matchLen = token & 0x0F;
+        if (matchLen == 15 && !getLength(input, len, &in, &matchLen)) break;
+        matchLen += MATCH_MIN_LENGTH;
+
+        if (offset == 0 || offset > out + dictionaryLen || out + matchLen > outputCap) break;
+
+        // Byte by byte: matches may overlap their own output or start in the dictionary
+        for (size_t i = 0; i < matchLen; i++, out++) {
+            output[out] = out >= offset ? output[out - offset] : dictionary[dictionaryLen + out - offset];
+        }
+    }
+
+    decodeStats.decompressFailures++;
+    return false;
+}
+
+MeshCompressionStats MeshCompressor::getStats() {
+    MeshCompressionStats result = stats;
+    result.decompressed = decodeStats.decompressed;
+    result.decompressFailures = decodeStats.decompressFailures;
+    return result;
+}
+
+MeshCompressionStats MeshCompressor::getEncodeStats() {
+    return stats;
+}
+
+MeshCompressionStats MeshCompressor::getDecodeStats() {
+    return decodeStats;
+}
+
+void MeshCompressor::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+    memset(&decodeStats, 0, sizeof(decodeStats));
+}
@@ -0,0 +1,72 @@
+// Mesh Dispatcher - O(1) message-type handler registry
+#include <string.h>
+#include "mesh_dispatcher.h"
+#include "mesh_platform.h"
+
+MeshDispatcher::MeshDispatcher() : unhandled(0) {
+    memset(slots, 0, sizeof(slots));
+}
+
+bool MeshDispatcher::registerHandler(uint8_t type, MeshMessageHandler handler, void* context) {
+    if (type >= MESH_DISPATCH_TABLE_SIZE || !handler) {
+        return false;
+    }
+
+    // Re-registering replaces the previous handler but keeps its counters
+    slots[type].handler = handler;
+    slots[type].context = context;
+    return true;
+}
+
+bool MeshDispatcher::unregisterHandler(uint8_t type) {
+    if (type >= MESH_DISPATCH_TABLE_SIZE || !slots[type].handler) {
+        return false;
+    }
+
+    slots[type].handler = nullptr;
+    slots[type].context = nullptr;
+    return true;
+}
+
+bool MeshDispatcher::hasHandler(uint8_t type) {
+    return type < MESH_DISPATCH_TABLE_SIZE && slots[type].handler != nullptr;
+}
+
+bool MeshDispatcher::dispatch(const MeshMessageInfo& info, const uint8_t* data, size_t len, uint32_t* elapsedUs) {
+    if (info.type >= MESH_DISPATCH_TABLE_SIZE || !slots[info.type].handler) {
+        unhandled++;
+        return false;
+    }
+
+    Slot& slot = slots[info.type];
+    uint32_t start = meshMicros();
+    slot.handler(slot.context, info, data, len);
+    uint32_t elapsed = meshMicros() - start;
+
+    slot.stats.count++;
+    slot.stats.totalMicros += elapsed;
+    if (elapsed > slot.stats.maxMicros) {
+        slot.stats.maxMicros = elapsed;
+    }
+    if (elapsedUs) {
+        *elapsedUs = elapsed;
+    }
+    return true;
+}
+
+MeshHandlerStats MeshDispatcher::getStats(uint8_t type) {
+    MeshHandlerStats empty;
+    memset(&empty, 0, sizeof(empty));
+    return type < MESH_DISPATCH_TABLE_SIZE ? slots[type].stats : empty;
+}
+
+uint32_t MeshDispatcher::getUnhandledCount() {
+    return unhandled;
+}
+
+void MeshDispatcher::resetStats() {
+    for (size_t i = 0; i < MESH_DISPATCH_TABLE_SIZE; i++) {
+        memset(&slots[i].stats, 0, sizeof(slots[i].stats));
+    }
+    unhandled = 0;
+}
@@ -0,0 +1,205 @@
+// Mesh Flow Control - Per-neighbor credits with cumulative grants
+#include <string.h>
+#include "mesh_flow_control.h"
+#include "mesh_bytes.h"
+
+MeshFlowControl::MeshFlowControl() : window(MESH_FLOW_WINDOW) {
+    memset(peers, 0, sizeof(peers));
+}
+
+MeshFlowControl::Peer* MeshFlowControl::findPeer(uint32_t nodeId, uint32_t nowMs, bool create) {
+    Peer* victim = nullptr;
+    for (size_t i = 0; i < MESH_FLOW_PEERS; i++) {
+        Peer& peer = peers[i];
+        if (peer.nodeId == nodeId) {
+            peer.lastUsedMs = nowMs;
+            return &peer;
+        }
+        if (!victim || peer.nodeId == 0 ||
+            (victim->nodeId != 0 && (int32_t)(peer.lastUsedMs - victim->lastUsedMs) < 0)) {
+            victim = &peer;
+        }
+    }
+
+    if (!create || nodeId == 0) {
+        return nullptr;
+    }
+
+    // Neighbors start from the default window until their first grant arrives
+    memset(victim, 0, sizeof(*victim));
+    victim->nodeId = nodeId;
+    victim->lastUsedMs = nowMs;
+    victim->lastGrantMs = nowMs;
+    victim->peerWindow = MESH_FLOW_WINDOW;
+    victim->grantedWindow = MESH_FLOW_WINDOW;
+    return victim;
+}
+
+bool MeshFlowControl::canSend(uint32_t nodeId, uint32_t nowMs) {
+    Peer* peer = findPeer(nodeId, nowMs, false);
+    if (!peer) {
+        return true;
+    }
+
+    if (peer->sent - peer->acknowledged < peer->peerWindow) {
+        peer->blocked = false;
+        return true;
+    }
+
+    if (!peer->blocked) {
+        peer->blocked = true;
+        peer->blockedSinceMs = nowMs;
+        peer->stalls++;
+    }
+
+    // Lost frames or grants would otherwise hold the window shut for good
+    if ((uint32_t)(nowMs - peer->blockedSinceMs) >= MESH_FLOW_STALL_MS &&
+        (uint32_t)(nowMs - peer->lastGrantMs) >= MESH_FLOW_STALL_MS) {
+        peer->acknowledged = peer->sent;
+        if (peer->peerWindow == 0) {
+            peer->peerWindow = 1;
+        }
+        peer->lastGrantMs = nowMs;
+        peer->blocked = false;
+        peer->resyncs++;
+        return true;
+    }
+    return false;
+}
+
+void MeshFlowControl::onSent(uint32_t nodeId, uint32_t nowMs) {
+    Peer* peer = findPeer(nodeId, nowMs, true);
+    if (peer) {
+        peer->sent++;
+    }
+}
+
+bool MeshFlowControl::onGrant(uint32_t nodeId, const uint8_t* grant, size_t len, uint32_t nowMs) {
+    if (!grant || len != GRANT_SIZE) {
+        return false;
+    }
+
+    Peer* peer = findPeer(nodeId, nowMs, true);
+    if (!peer) {
+        return false;
+    }
+
+    uint32_t received = getU32(grant);
+    uint32_t inFlight = peer->sent - peer->acknowledged;
+    uint32_t advance = received - peer->acknowledged;
+
+    // A count behind ours or beyond what we sent means one side restarted
+    peer->acknowledged = advance <= inFlight ? received : peer->sent;
+    peer->peerWindow = grant[4] | (grant[5] << 8);
+    peer->lastGrantMs = nowMs;
+    peer->grantsReceived++;
+    return true;
+}
+
+void MeshFlowControl::setWindow(uint16_t frames) {
+    window = frames;
+}
+
+uint16_t MeshFlowControl::getWindow() {
+    return window;
+}
+
+void MeshFlowControl::onReceived(uint32_t nodeId, uint32_t nowMs) {
+    Peer* peer = findPeer(nodeId, nowMs, true);
+    if (peer) {
+        peer->received++;
+    }
+}
+
+bool MeshFlowControl::needsGrant(const Peer& peer, uint32_t nowMs) {
+    // Only neighbors that send to us are owed grants
+    if (peer.nodeId == 0 || peer.received == 0) {
+        return false;
+    }
+
+    uint32_t consumed = peer.received - peer.grantedAt;
+    if (consumed == 0 && peer.grantedWindow == window) {
+        return false;
+    }
+
+    // Opening or closing the window is urgent; otherwise grant every half window
+    if ((peer.grantedWindow == 0) != (window == 0)) {
+        return true;
+    }
+    uint32_t half = window > 1 ? window / 2 : 1;
+    if (consumed >= half) {
+        return true;
+    }
+    return (uint32_t)(nowMs - peer.lastGrantSentMs) >= MESH_FLOW_GRANT_INTERVAL_MS;
+}
+
+bool MeshFlowControl::nextGrant(uint32_t nowMs, uint32_t* nodeId, uint8_t* grant, size_t grantCap,
+                                size_t* grantLen) {
+    if (!nodeId || !grant || !grantLen || grantCap < GRANT_SIZE) {
+        return false;
+    }
+
+    for (size_t i = 0; i < MESH_FLOW_PEERS; i++) {
+        Peer& peer = peers[i];
+        if (!needsGrant(peer, nowMs)) continue;
+
+        putU32(grant, peer.received);
+        grant[4] = (uint8_t)window;
+        grant[5] = (uint8_t)(window >> 8);
+
+        peer.grantedAt = peer.received;
+        peer.grantedWindow = window;
+        peer.lastGrantSentMs = nowMs;
+        peer.grantsSent++;
+
+        *nodeId = peer.nodeId;
+        *grantLen = GRANT_SIZE;
+        return true;
+    }
+    return false;
+}
+
+void MeshFlowControl::removePeer(uint32_t nodeId) {
+    for (size_t i = 0; i < MESH_FLOW_PEERS; i++) {
+        if (peers[i].nodeId == nodeId) {
+            memset(&peers[i], 0, sizeof(peers[i]));
+        }
+    }
+}
+
+MeshFlowStats MeshFlowControl::statsFor(const Peer& peer) {
+    MeshFlowStats stats;
+    uint32_t inFlight = peer.sent - peer.acknowledged;
+    stats.nodeId = peer.nodeId;
+    stats.credits = inFlight < peer.peerWindow ? (uint16_t)(peer.peerWindow - inFlight) : 0;
+    stats.peerWindow = peer.peerWindow;
+    stats.sent = peer.sent;
+    stats.received = peer.received;
+    stats.stalls = peer.stalls;
+    stats.resyncs = peer.resyncs;
+    stats.grantsSent = peer.grantsSent;
+    stats.grantsReceived = peer.grantsReceived;
+    return stats;
+}
+
+MeshFlowStats MeshFlowControl::getStats(uint32_t nodeId) {
+    for (size_t i = 0; i < MESH_FLOW_PEERS; i++) {
+        if (peers[i].nodeId != 0 && peers[i].nodeId == nodeId) {
+            return statsFor(peers[i]);
+        }
+    }
+
+    MeshFlowStats empty;
+    memset(&empty, 0, sizeof(empty));
+    return empty;
+}
+
+size_t MeshFlowControl::getPeers(MeshFlowStats* output, size_t outputCap) {
+    size_t count = 0;
+    for (size_t i = 0; i < MESH_FLOW_PEERS && count < outputCap; i++) {
+        if (peers[i].nodeId != 0) {
+            output[count++] = statsFor(peers[i]);
+        }
+    }
+    return count;
+}
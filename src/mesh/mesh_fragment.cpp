@@ -0,0 +1,201 @@
+// Mesh Fragmentation - Fixed-size fragments and pooled, bitmap-tracked reassembly
+#include <string.h>
+#include "mesh_fragment.h"
+#include "mesh_bytes.h"
+
+static inline uint32_t runMask(size_t count) {
+    return count >= 32 ? 0xFFFFFFFFu : ((1u << count) - 1);
+}
+
+size_t MeshFragmenter::fragmentCount(size_t len) {
+    return (len + MESH_FRAGMENT_SIZE - 1) / MESH_FRAGMENT_SIZE;
+}
+
+bool MeshFragmenter::writeFragment(uint16_t messageId, uint8_t type, const uint8_t* data, size_t len,
+                                   size_t index, uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!data || !output || !outputLen || len == 0 || len > MAX_MESSAGE) {
+        return false;
+    }
+
+    size_t offset = index * MESH_FRAGMENT_SIZE;
+    if (offset >= len) {
+        return false;
+    }
+
+    size_t chunk = len - offset < MESH_FRAGMENT_SIZE ? len - offset : MESH_FRAGMENT_SIZE;
+    if (HEADER_SIZE + chunk > outputCap) {
+        return false;
+    }
+
+    putU16(output, messageId);
+    putU16(output + 2, (uint16_t)offset);
+    putU16(output + 4, (uint16_t)len);
+    output[6] = type;
+    memcpy(output + HEADER_SIZE, data + offset, chunk);
+
+    *outputLen = HEADER_SIZE + chunk;
+    return true;
+}
+
+MeshReassembler::MeshReassembler() : usedBlocks(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MeshReassembler::releaseSlot(Slot& slot) {
+    usedBlocks &= ~(runMask(slot.blockCount) << slot.firstBlock);
+    stats.blocksInUse -= slot.blockCount;
+    memset(&slot, 0, sizeof(slot));
+}
+
+void MeshReassembler::releaseCompleted() {
+    for (size_t i = 0; i < MESH_REASSEMBLY_SLOTS; i++) {
+        if (slots[i].source != 0 && slots[i].complete) {
+            releaseSlot(slots[i]);
+        }
+    }
+}
+
+int MeshReassembler::reserveBlocks(size_t count) {
+    // First fit over the block bitmap
+    uint32_t mask = runMask(count);
+    for (size_t start = 0; start + count <= MESH_REASSEMBLY_POOL_BLOCKS; start++) {
+        if ((usedBlocks & (mask << start)) == 0) {
+            usedBlocks |= mask << start;
+            return (int)start;
+        }
+    }
+    return -1;
+}
+
+MeshReassembler::Slot* MeshReassembler::startMessage(uint32_t source, uint16_t messageId, uint16_t total,
+                                                     uint8_t type, uint32_t nowMs) {
+    size_t blocks = MeshFragmenter::fragmentCount(total);
+
+    // Evict the least recently active messages until both a slot and a run of blocks are free
+    for (;;) {
+        Slot* freeSlot = nullptr;
+        Slot* oldest = nullptr;
+        for (size_t i = 0; i < MESH_REASSEMBLY_SLOTS; i++) {
+            Slot& slot = slots[i];
+            if (slot.source == 0) {
+                if (!freeSlot) freeSlot = &slot;
+            } else if (!oldest || (int32_t)(slot.lastMs - oldest->lastMs) < 0) {
+                oldest = &slot;
+            }
+        }
+
+        int first = freeSlot ? reserveBlocks(blocks) : -1;
+        if (first >= 0) {
+            freeSlot->source = source;
+            freeSlot->messageId = messageId;
+            freeSlot->total = total;
+            freeSlot->type = type;
+            freeSlot->firstBlock = (uint8_t)first;
+            freeSlot->blockCount = (uint8_t)blocks;
+            freeSlot->received = 0;
+            freeSlot->lastMs = nowMs;
+            freeSlot->complete = false;
+
+            stats.started++;
+            stats.blocksInUse += blocks;
+            if (stats.blocksInUse > stats.blocksHighWater) {
+                stats.blocksHighWater = stats.blocksInUse;
+            }
+            return freeSlot;
+        }
+
+        if (!oldest) {
+            return nullptr;
+        }
+        releaseSlot(*oldest);
+        stats.evicted++;
+    }
+}
+
+MeshReassemblyResult MeshReassembler::onFragment(uint32_t source, const uint8_t* fragment, size_t len,
+                                                 uint32_t nowMs, uint8_t* type,
+                                                 const uint8_t** message, size_t* messageLen) {
+    releaseCompleted();
+
+    if (source == 0 || !fragment || !type || !message || !messageLen ||
+        len <= MeshFragmenter::HEADER_SIZE) {
+        stats.rejected++;
+        return MESH_REASSEMBLY_DROPPED;
+    }
+
+    uint16_t messageId = getU16(fragment);
+    size_t offset = getU16(fragment + 2);
+    size_t total = getU16(fragment + 4);
+    uint8_t innerType = fragment[6];
+    const uint8_t* data = fragment + MeshFragmenter::HEADER_SIZE;
+    size_t dataLen = len - MeshFragmenter::HEADER_SIZE;
+
+    // Offsets must land on fragment boundaries and sizes must match the sender's split
+    size_t expected = total > offset && total - offset < MESH_FRAGMENT_SIZE ? total - offset : MESH_FRAGMENT_SIZE;
+    if (total == 0 || total > MeshFragmenter::MAX_MESSAGE || offset >= total ||
+        offset % MESH_FRAGMENT_SIZE != 0 || dataLen != expected) {
+        stats.rejected++;
+        return MESH_REASSEMBLY_DROPPED;
+    }
+
+    Slot* slot = nullptr;
+    for (size_t i = 0; i < MESH_REASSEMBLY_SLOTS; i++) {
+        if (slots[i].source == source && slots[i].messageId == messageId) {
+            slot = &slots[i];
+            break;
+        }
+    }
+
+    if (slot && (slot->total != total || slot->type != innerType)) {
+        // Same id reused for a different message (sender restart); start over
+        releaseSlot(*slot);
+        slot = nullptr;
+    }
+
+    if (!slot) {
+        slot = startMessage(source, messageId, (uint16_t)total, innerType, nowMs);
+        if (!slot) {
+            stats.rejected++;
+            return MESH_REASSEMBLY_DROPPED;
+        }
+    }
+
+    uint32_t bit = 1u << (offset / MESH_FRAGMENT_SIZE);
+    slot->lastMs = nowMs;
+    if (slot->received & bit) {
+        stats.duplicates++;
+        return MESH_REASSEMBLY_PENDING;
+    }
+
+    memcpy(pool + slot->firstBlock * MESH_FRAGMENT_SIZE + offset, data, dataLen);
+    slot->received |= bit;
+
+    if (slot->received != runMask(slot->blockCount)) {
+        return MESH_REASSEMBLY_PENDING;
+    }
+
+    // Blocks are contiguous, so the message is handed out in place
+    slot->complete = true;
+    stats.completed++;
+    *type = slot->type;
+    *message = pool + slot->firstBlock * MESH_FRAGMENT_SIZE;
+    *messageLen = slot->total;
+    return MESH_REASSEMBLY_COMPLETE;
+}
+
+void MeshReassembler::expire(uint32_t nowMs) {
+    releaseCompleted();
+
+    for (size_t i = 0; i < MESH_REASSEMBLY_SLOTS; i++) {
+        Slot& slot = slots[i];
+        if (slot.source != 0 && (uint32_t)(nowMs - slot.lastMs) >= MESH_REASSEMBLY_TIMEOUT_MS) {
+            releaseSlot(slot);
+            stats.timedOut++;
+        }
+    }
+}
+
+MeshReassemblyStats MeshReassembler::getStats() {
+    return stats;
+}
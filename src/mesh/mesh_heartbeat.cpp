@@ -0,0 +1,224 @@
+// Mesh Heartbeat - Delta-encoded heartbeats and adaptive interval
+#include <string.h>
+#include "mesh_heartbeat.h"
+#include "mesh_bytes.h"
+
+namespace {
+
+const uint8_t FLAG_KEYFRAME = 0x01;
+
+const uint8_t FIELD_HEAP = 0x01;
+const uint8_t FIELD_NODE_COUNT = 0x02;
+const uint8_t FIELD_SIM_MASK = 0x04;
+const uint8_t FIELD_SMS_QUEUE = 0x08;
+const uint8_t FIELD_SMS_SEND_TIME = 0x10;
+const uint8_t FIELD_ALL = FIELD_HEAP | FIELD_NODE_COUNT | FIELD_SIM_MASK | FIELD_SMS_QUEUE | FIELD_SMS_SEND_TIME;
+
+uint8_t changedFields(const MeshHeartbeatSnapshot& a, const MeshHeartbeatSnapshot& b) {
+    uint8_t mask = 0;
+    if (a.freeHeapBucket != b.freeHeapBucket) mask |= FIELD_HEAP;
+    if (a.nodeCount != b.nodeCount) mask |= FIELD_NODE_COUNT;
+    if (a.simActiveMask != b.simActiveMask) mask |= FIELD_SIM_MASK;
+    if (a.smsQueueDepth != b.smsQueueDepth) mask |= FIELD_SMS_QUEUE;
+    if (a.smsSendTime != b.smsSendTime) mask |= FIELD_SMS_SEND_TIME;
+    return mask;
+}
+
+size_t fieldsSize(uint8_t mask) {
+    return ((mask & FIELD_HEAP) ? 1 : 0) + ((mask & FIELD_NODE_COUNT) ? 2 : 0) +
+           ((mask & FIELD_SIM_MASK) ? 4 : 0) + ((mask & FIELD_SMS_QUEUE) ? 1 : 0) +
+           ((mask & FIELD_SMS_SEND_TIME) ? 1 : 0);
+}
+
+} // namespace
+
+MeshHeartbeatEncoder::MeshHeartbeatEncoder() :
+    keyframeId(0),
+    beatsSinceKeyframe(0),
+    forceKeyframe(true),
+    topologyChanged(false),
+    intervalMs(HEARTBEAT_INTERVAL) {
+    memset(&keyframe, 0, sizeof(keyframe));
+}
+
+bool MeshHeartbeatEncoder::encode(const MeshHeartbeatSnapshot& snapshot, uint8_t* output,
+                                  size_t outputCap, size_t* outputLen) {
+    if (!output || !outputLen || outputCap < MAX_SIZE) {
+        return false;
+    }
+
+    uint8_t changed = changedFields(snapshot, keyframe);
+    bool isKeyframe = forceKeyframe || beatsSinceKeyframe + 1 >= HEARTBEAT_KEYFRAME_EVERY;
+    uint8_t mask = isKeyframe ? FIELD_ALL : changed;
+
+    if (isKeyframe) {
+        keyframe = snapshot;
+        keyframeId++;
+        beatsSinceKeyframe = 0;
+        forceKeyframe = false;
+    } else {
+        beatsSinceKeyframe++;
+    }
+
+    output[0] = isKeyframe ? FLAG_KEYFRAME : 0;
+    output[1] = keyframeId;
+    output[2] = mask;
+
+    uint8_t* p = output + 3;
+    if (mask & FIELD_HEAP) {
+        *p++ = snapshot.freeHeapBucket;
+    }
+    if (mask & FIELD_NODE_COUNT) {
+        putU16(p, snapshot.nodeCount);
+        p += 2;
+    }
+    if (mask & FIELD_SIM_MASK) {
+        putU32(p, snapshot.simActiveMask);
+        p += 4;
+    }
+    if (mask & FIELD_SMS_QUEUE) {
+        *p++ = snapshot.smsQueueDepth;
+    }
+    if (mask & FIELD_SMS_SEND_TIME) {
+        *p++ = snapshot.smsSendTime;
+    }
+    *outputLen = p - output;
+
+    // Stretch while nothing moves; hold the interval while state is changing
+    if (topologyChanged) {
+        topologyChanged = false;
+    } else if (changed == 0) {
+        intervalMs += intervalMs / 2;
+        if (intervalMs > HEARTBEAT_MAX_INTERVAL) {
+            intervalMs = HEARTBEAT_MAX_INTERVAL;
+        }
+    }
+
+    return true;
+}
+
+void MeshHeartbeatEncoder::onTopologyChange() {
+    // New neighbours need a full snapshot, and everyone needs fresh liveness soon
+    forceKeyframe = true;
+    topologyChanged = true;
+    intervalMs = HEARTBEAT_MIN_INTERVAL;
+}
+
+uint32_t MeshHeartbeatEncoder::getIntervalMs() {
+    return intervalMs;
+}
+
+MeshHeartbeatTable::MeshHeartbeatTable() : peerCount(0) {
+    memset(peers, 0, sizeof(peers));
+}
+
+MeshPeerState* MeshHeartbeatTable::slotFor(uint32_t nodeId, uint32_t nowMs) {
+    MeshPeerState* oldest = nullptr;
+
+    for (size_t i = 0; i < peerCount; i++) {
+        if (peers[i].nodeId == nodeId) {
+            return &peers[i];
+        }
+        if (!oldest || (uint32_t)(nowMs - peers[i].lastSeenMs) > (uint32_t)(nowMs - oldest->lastSeenMs)) {
+            oldest = &peers[i];
+        }
+    }
+
+    MeshPeerState* slot = (peerCount < MESH_MAX_PEERS) ? &peers[peerCount++] : oldest;
+    memset(slot, 0, sizeof(*slot));
+    slot->nodeId = nodeId;
+    return slot;
+}
+
+bool MeshHeartbeatTable::apply(uint32_t nodeId, const uint8_t* data, size_t len, uint32_t nowMs) {
+    if (!data || len < 3) {
+        return false;
+    }
+
+    bool isKeyframe = (data[0] & FLAG_KEYFRAME) != 0;
+    uint8_t keyframeId = data[1];
+    uint8_t mask = data[2];
+    if ((mask & ~FIELD_ALL) || (isKeyframe && mask != FIELD_ALL) || len != 3 + fieldsSize(mask)) {
+        return false;
+    }
+
+    MeshHeartbeatSnapshot values;
+    memset(&values, 0, sizeof(values));
+    const uint8_t* p = data + 3;
+    if (mask & FIELD_HEAP) {
+        values.freeHeapBucket = *p++;
+    }
+    if (mask & FIELD_NODE_COUNT) {
+        values.nodeCount = getU16(p);
+        p += 2;
+    }
+    if (mask & FIELD_SIM_MASK) {
+        values.simActiveMask = getU32(p);
+        p += 4;
+    }
+    if (mask & FIELD_SMS_QUEUE) {
+        values.smsQueueDepth = *p++;
+    }
+    if (mask & FIELD_SMS_SEND_TIME) {
+        values.smsSendTime = *p++;
+    }
+
+    MeshPeerState* peer = slotFor(nodeId, nowMs);
+    peer->lastSeenMs = nowMs;
+
+    if (isKeyframe) {
+        peer->keyframe = values;
+        peer->snapshot = values;
+        peer->keyframeId = keyframeId;
+        peer->synced = true;
+        return true;
+    }
+
+    // Deltas carry absolute values, so present fields are always usable;
+    // absent fields are only trustworthy if we hold the matching keyframe
+    if (keyframeId == peer->keyframeId && peer->synced) {
+        peer->snapshot = peer->keyframe;
+    } else {
+        peer->synced = false;
+    }
+
+    if (mask & FIELD_HEAP) peer->snapshot.freeHeapBucket = values.freeHeapBucket;
+    if (mask & FIELD_NODE_COUNT) peer->snapshot.nodeCount = values.nodeCount;
+    if (mask & FIELD_SIM_MASK) peer->snapshot.simActiveMask = values.simActiveMask;
+    if (mask & FIELD_SMS_QUEUE) peer->snapshot.smsQueueDepth = values.smsQueueDepth;
+    if (mask & FIELD_SMS_SEND_TIME) peer->snapshot.smsSendTime = values.smsSendTime;
+    return true;
+}
+
+const MeshPeerState* MeshHeartbeatTable::find(uint32_t nodeId) {
+    for (size_t i = 0; i < peerCount; i++) {
+        if (peers[i].nodeId == nodeId) {
+            return &peers[i];
+        }
+    }
+    return nullptr;
+}
+
+bool MeshHeartbeatTable::isAlive(uint32_t nodeId, uint32_t nowMs) {
+    // Three maximum-length intervals without a beat means the peer is gone
+    const MeshPeerState* peer = find(nodeId);
+    return peer && (uint32_t)(nowMs - peer->lastSeenMs) < 3 * HEARTBEAT_MAX_INTERVAL;
+}
+
+size_t MeshHeartbeatTable::getPeerCount() {
+    return peerCount;
+}
+
+const MeshPeerState* MeshHeartbeatTable::getPeer(size_t index) {
+    return index < peerCount ? &peers[index] : nullptr;
+}
+
+bool MeshHeartbeatTable::remove(uint32_t nodeId) {
+    for (size_t i = 0; i < peerCount; i++) {
+        if (peers[i].nodeId == nodeId) {
+            peers[i] = peers[--peerCount];
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,692 @@
+// Mesh SMS Job Balancer - Coordinator placement, work pulling and fleet SMS statistics
+#include <string.h>
+#include "mesh_job_balancer.h"
+#include "mesh_bytes.h"
+#include "mesh_reliable.h"
+
+static const uint8_t OP_REQUEST = 1;   // Job holder to coordinator: where should this run?
+static const uint8_t OP_PLACE = 2;     // Coordinator's answer
+static const uint8_t OP_ASSIGN = 3;    // Job holder to the chosen worker
+static const uint8_t OP_HANDOVER = 4;  // Overloaded node to the idle node that pulled
+static const uint8_t OP_RESULT = 5;    // Worker to coordinator
+static const uint8_t OP_PULL = 6;      // Idle node to overloaded node
+
+static const size_t REQUEST_SIZE = 9;
+static const size_t PLACE_SIZE = 17;
+static const size_t RESULT_SIZE = 19;
+static const size_t PULL_SIZE = 3;
+static const uint32_t WORKER_TIMEOUT_MS = 3 * HEARTBEAT_MAX_INTERVAL;
+
+static_assert(MeshJobBalancer::MAX_MESSAGE <= MeshReliable::MAX_PAYLOAD,
+              "MESH_JOB_MAX_BODY must fit one reliable message");
+
+static uint8_t countSims(uint32_t mask) {
+    uint8_t count = 0;
+    for (; mask; mask &= mask - 1) count++;
+    return count;
+}
+
+MeshJobBalancer::MeshJobBalancer() :
+    self(0), coordinator(0), selfHeap(0), selfSims(0), selfSendTimeMs(0), nextJobId(1),
+    lastPullMs(0), pulledBefore(false), pullTarget(0), pullCount(0), inFlight(OUT_NONE), inFlightSlot(0),
+    replyHead(0), replyCount(0), resultHead(0), resultCount(0), decisionNext(0), decisionCount(0),
+    rateEpoch(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(workers, 0, sizeof(workers));
+    memset(replies, 0, sizeof(replies));
+    memset(results, 0, sizeof(results));
+    memset(decisions, 0, sizeof(decisions));
+    memset(rateCounts, 0, sizeof(rateCounts));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MeshJobBalancer::setSelf(uint32_t nodeId) {
+    self = nodeId;
+}
+
+void MeshJobBalancer::setLocalCapacity(uint8_t heapBucket, uint32_t simActiveMask) {
+    selfHeap = heapBucket;
+    selfSims = countSims(simActiveMask);
+}
+
+MeshJobBalancer::Worker* MeshJobBalancer::findWorker(uint32_t nodeId) {
+    for (size_t i = 0; i < MESH_MAX_PEERS; i++) {
+        if (workers[i].nodeId == nodeId) return &workers[i];
+    }
+    return nullptr;
+}
+
+bool MeshJobBalancer::usable(const Worker& worker, uint32_t nowMs) {
+    return worker.nodeId != 0 && worker.reachable && (uint32_t)(nowMs - worker.lastSeenMs) < WORKER_TIMEOUT_MS;
+}
+
+void MeshJobBalancer::onHeartbeat(const MeshPeerState& peer, bool reachable, uint32_t nowMs,
+                                  uint32_t transferPenaltyMs) {
+    if (peer.nodeId == 0 || peer.nodeId == self) {
+        return;
+    }
+
+    Worker* worker = findWorker(peer.nodeId);
+    if (!worker) {
+        worker = meshOldestSlot(workers, MESH_MAX_PEERS, &Worker::lastSeenMs);
+        memset(worker, 0, sizeof(Worker));
+        worker->nodeId = peer.nodeId;
+    }
+
+    worker->lastSeenMs = nowMs;
+    worker->synced = peer.synced;
+    worker->reachable = reachable;
+    worker->transferMs = transferPenaltyMs;
+    worker->heapBucket = peer.snapshot.freeHeapBucket;
+    worker->sims = countSims(peer.snapshot.simActiveMask);
+    worker->queueDepth = peer.snapshot.smsQueueDepth;
+    worker->sendTimeMs = (uint32_t)peer.snapshot.smsSendTime * 100;
+}
+
+void MeshJobBalancer::elect(uint32_t nowMs) {
+    // Lowest ID among nodes with the heap to coordinate; self when nobody qualifies
+    uint32_t best = selfHeap >= MESH_JOB_COORDINATOR_MIN_HEAP ? self : 0;
+    for (size_t i = 0; i < MESH_MAX_PEERS; i++) {
+        const Worker& worker = workers[i];
+        if (usable(worker, nowMs) && worker.synced && worker.heapBucket >= MESH_JOB_COORDINATOR_MIN_HEAP &&
+            (best == 0 || worker.nodeId < best)) {
+            best = worker.nodeId;
+        }
+    }
+    if (best == 0) {
+        best = self;
+    }
+
+    if (best != coordinator) {
+        coordinator = best;
+        stats.elections++;
+    }
+}
+
+uint32_t MeshJobBalancer::getCoordinator(uint32_t nowMs) {
+    elect(nowMs);
+    return coordinator;
+}
+
+MeshJobBalancer::Slot* MeshJobBalancer::freeSlot() {
+    for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+        if (slots[i].state == SLOT_FREE) return &slots[i];
+    }
+    return nullptr;
+}
+
+MeshJobBalancer::Slot* MeshJobBalancer::findSlot(uint32_t submitter, uint32_t jobId, uint8_t state) {
+    for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+        if (slots[i].state == state && slots[i].job.submitter == submitter && slots[i].job.jobId == jobId) {
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+size_t MeshJobBalancer::countState(uint8_t state) {
+    size_t count = 0;
+    for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+        if (slots[i].state == state) count++;
+    }
+    return count;
+}
+
+uint8_t MeshJobBalancer::localDepth() {
+    return (uint8_t)(countState(SLOT_QUEUED) + countState(SLOT_RUNNING));
+}
+
+void MeshJobBalancer::noteDepth() {
+    uint32_t depth = localDepth();
+    if (depth > stats.queueHighWater) {
+        stats.queueHighWater = depth;
+    }
+}
+
+bool MeshJobBalancer::submit(const uint8_t* body, size_t len, uint32_t nowMs, uint32_t* jobId) {
+    if (!body || len == 0 || len > MESH_JOB_MAX_BODY) {
+        return false;
+    }
+    Slot* slot = freeSlot();
+    if (!slot) {
+        return false;
+    }
+
+    memset(slot, 0, sizeof(Slot));
+    slot->state = SLOT_UNPLACED;
+    slot->arrivedMs = nowMs;
+    slot->job.jobId = nextJobId++;
+    slot->job.submitter = self;
+    slot->job.length = (uint16_t)len;
+    memcpy(slot->job.body, body, len);
+    stats.submitted++;
+
+    if (jobId) *jobId = slot->job.jobId;
+    return true;
+}
+
+uint32_t MeshJobBalancer::expectedWait(uint8_t depth, uint8_t pending, uint32_t sendTimeMs, uint8_t sims) {
+    uint32_t perJob = sendTimeMs != 0 ? sendTimeMs : MESH_JOB_DEFAULT_SEND_MS;
+    return ((uint32_t)depth + pending + 1) * perJob / sims;
+}
+
+bool MeshJobBalancer::decide(uint32_t submitter, uint32_t jobId, uint32_t nowMs, MeshJobDecision* decision) {
+    uint32_t bestNode = 0;
+    uint32_t bestWait = 0;
+    uint32_t bestDepth = 0;
+    uint8_t candidates = 0;
+
+    if (selfSims > 0 && localDepth() < MESH_JOB_QUEUE_SLOTS) {
+        bestNode = self;
+        bestDepth = localDepth();
+        bestWait = expectedWait(localDepth(), 0, selfSendTimeMs, selfSims);
+        candidates++;
+    }
+    for (size_t i = 0; i < MESH_MAX_PEERS; i++) {
+        const Worker& worker = workers[i];
+        uint32_t depth = (uint32_t)worker.queueDepth + worker.pending;
+        if (!usable(worker, nowMs) || !worker.synced || worker.sims == 0 || depth >= MESH_JOB_QUEUE_SLOTS) {
+            continue;
+        }
+        candidates++;
+
+        uint32_t wait = expectedWait(worker.queueDepth, worker.pending, worker.sendTimeMs, worker.sims) +
+                        worker.transferMs;
+        if (bestNode == 0 || wait < bestWait ||
+            (wait == bestWait && (depth < bestDepth || (depth == bestDepth && worker.nodeId < bestNode)))) {
+            bestNode = worker.nodeId;
+            bestWait = wait;
+            bestDepth = depth;
+        }
+    }
+    if (bestNode == 0) {
+        return false;
+    }
+
+    // Counted against the worker until it next reports, so a burst spreads out
+    if (bestNode != self) {
+        Worker* worker = findWorker(bestNode);
+        if (worker->pending < 255) worker->pending++;
+    }
+
+    decision->submitter = submitter;
+    decision->jobId = jobId;
+    decision->worker = bestNode;
+    decision->expectedWaitMs = bestWait;
+    decision->atMs = nowMs;
+    decision->candidates = candidates;
+    stats.placements++;
+    logDecision(*decision);
+    return true;
+}
+
+void MeshJobBalancer::applyPlacement(Slot& slot, uint32_t worker) {
+    if (worker == self) {
+        slot.state = SLOT_QUEUED;
+        noteDepth();
+        return;
+    }
+    slot.state = SLOT_HANDOFF;
+    slot.op = OP_ASSIGN;
+    slot.fallback = SLOT_UNPLACED;
+    slot.destId = worker;
+}
+
+bool MeshJobBalancer::choosePull(uint32_t nowMs) {
+    if (selfSims == 0 || localDepth() != 0 ||
+        (pulledBefore && (uint32_t)(nowMs - lastPullMs) < MESH_JOB_PULL_INTERVAL_MS)) {
+        return false;
+    }
+
+    Worker* deepest = nullptr;
+    for (size_t i = 0; i < MESH_MAX_PEERS; i++) {
+        Worker& worker = workers[i];
+        if (usable(worker, nowMs) && worker.queueDepth >= MESH_JOB_PULL_THRESHOLD &&
+            (!deepest || worker.queueDepth > deepest->queueDepth)) {
+            deepest = &worker;
+        }
+    }
+    if (!deepest) {
+        return false;
+    }
+
+    pullTarget = deepest->nodeId;
+    pullCount = deepest->queueDepth / 2;
+    lastPullMs = nowMs;
+    pulledBefore = true;
+    return true;
+}
+
+void MeshJobBalancer::handOver(uint32_t puller, uint8_t wanted) {
+    if (localDepth() < MESH_JOB_PULL_THRESHOLD) {
+        return;
+    }
+
+    // Newest first: the oldest jobs are next in line here anyway
+    size_t queued = countState(SLOT_QUEUED);
+    size_t give = queued - queued / 2;
+    if (give > wanted) give = wanted;
+    for (; give > 0; give--) {
+        Slot* newest = nullptr;
+        for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+            if (slots[i].state == SLOT_QUEUED &&
+                (!newest || (int32_t)(slots[i].arrivedMs - newest->arrivedMs) >= 0)) {
+                newest = &slots[i];
+            }
+        }
+        newest->state = SLOT_HANDOFF;
+        newest->op = OP_HANDOVER;
+        newest->fallback = SLOT_QUEUED;
+        newest->destId = puller;
+    }
+}
+
+bool MeshJobBalancer::acceptJob(uint8_t op, const uint8_t* data, size_t len, uint32_t nowMs) {
+    if (len < JOB_HEADER_SIZE || len - JOB_HEADER_SIZE > MESH_JOB_MAX_BODY) {
+        return false;
+    }
+    uint32_t submitter = getU32(data + 1);
+    uint32_t jobId = getU32(data + 5);
+    if (findSlot(submitter, jobId, SLOT_QUEUED)) {
+        return true;
+    }
+
+    Slot* slot = freeSlot();
+    if (!slot) {
+        stats.dropped++;
+        return false;
+    }
+
+    memset(slot, 0, sizeof(Slot));
+    slot->state = SLOT_QUEUED;
+    slot->arrivedMs = nowMs;
+    slot->job.submitter = submitter;
+    slot->job.jobId = jobId;
+    slot->job.waitMs = getU32(data + 9);
+    slot->job.attempts = data[13];
+    slot->job.length = (uint16_t)(len - JOB_HEADER_SIZE);
+    memcpy(slot->job.body, data + JOB_HEADER_SIZE, slot->job.length);
+
+    if (op == OP_HANDOVER) {
+        stats.pulledIn++;
+    } else {
+        stats.assigned++;
+    }
+    noteDepth();
+    return true;
+}
+
+bool MeshJobBalancer::receive(uint32_t from, const uint8_t* data, size_t len, uint32_t nowMs) {
+    if (!data || len == 0) {
+        return false;
+    }
+
+    switch (data[0]) {
+        case OP_REQUEST: {
+            if (len != REQUEST_SIZE) {
+                return false;
+            }
+            // Answered even if our own view of the election differs; whoever asked trusts us
+            MeshJobDecision decision;
+            if (decide(getU32(data + 1), getU32(data + 5), nowMs, &decision)) {
+                queueReply(from, decision);
+            } else {
+                stats.unplaceable++;
+            }
+            return true;
+        }
+
+        case OP_PLACE: {
+            if (len != PLACE_SIZE) {
+                return false;
+            }
+            // Late answers to a request already repeated find nothing to place
+            Slot* slot = findSlot(getU32(data + 1), getU32(data + 5), SLOT_REQUESTED);
+            if (slot) {
+                applyPlacement(*slot, getU32(data + 9));
+            }
+            return true;
+        }
+
+        case OP_ASSIGN:
+        case OP_HANDOVER:
+            return acceptJob(data[0], data, len, nowMs);
+
+        case OP_RESULT: {
+            if (len != RESULT_SIZE) {
+                return false;
+            }
+            Result result;
+            result.submitter = getU32(data + 1);
+            result.jobId = getU32(data + 5);
+            result.sent = data[9] != 0;
+            result.waitMs = getU32(data + 10);
+            result.sendMs = getU32(data + 14);
+            recordResult(result, nowMs);
+
+            // A report is the freshest depth we have; what we placed there is now counted in it
+            Worker* worker = findWorker(from);
+            if (worker) {
+                worker->queueDepth = data[18];
+                worker->pending = 0;
+            }
+            return true;
+        }
+
+        case OP_PULL: {
+            if (len != PULL_SIZE) {
+                return false;
+            }
+            Worker* worker = findWorker(from);
+            if (worker) worker->queueDepth = data[2];
+            handOver(from, data[1]);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool MeshJobBalancer::nextOutgoing(uint32_t nowMs, uint32_t* destId, uint8_t* output, size_t outputCap,
+                                   size_t* outputLen) {
+    if (!destId || !output || !outputLen || outputCap < MAX_MESSAGE) {
+        return false;
+    }
+    elect(nowMs);
+    inFlight = OUT_NONE;
+
+    // Reports queued for a coordinator we have since replaced are ours to record
+    while (resultCount > 0 && coordinator == self) {
+        recordResult(results[resultHead], nowMs);
+        resultHead = (resultHead + 1) % MESH_JOB_RESULT_SLOTS;
+        resultCount--;
+    }
+
+    for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+        Slot& slot = slots[i];
+        if (slot.state == SLOT_REQUESTED && (uint32_t)(nowMs - slot.requestedMs) >= MESH_JOB_PLACE_TIMEOUT_MS) {
+            slot.state = SLOT_UNPLACED;
+        }
+
+        // The coordinator places its own jobs without a round trip
+        MeshJobDecision decision;
+        if (slot.state == SLOT_UNPLACED && coordinator == self) {
+            if (decide(slot.job.submitter, slot.job.jobId, nowMs, &decision)) {
+                applyPlacement(slot, decision.worker);
+            } else if (!slot.noted) {
+                stats.unplaceable++;
+                slot.noted = true;
+            }
+        }
+    }
+
+    // Results first: they refresh the coordinator's view of the sender's queue
+    if (resultCount > 0) {
+        const Result& result = results[resultHead];
+        output[0] = OP_RESULT;
+        putU32(output + 1, result.submitter);
+        putU32(output + 5, result.jobId);
+        output[9] = result.sent ? 1 : 0;
+        putU32(output + 10, result.waitMs);
+        putU32(output + 14, result.sendMs);
+        output[18] = localDepth();
+        *destId = coordinator;
+        *outputLen = RESULT_SIZE;
+        inFlight = OUT_RESULT;
+        return true;
+    }
+
+    if (replyCount > 0) {
+        const Reply& reply = replies[replyHead];
+        output[0] = OP_PLACE;
+        putU32(output + 1, reply.decision.submitter);
+        putU32(output + 5, reply.decision.jobId);
+        putU32(output + 9, reply.decision.worker);
+        putU32(output + 13, reply.decision.expectedWaitMs);
+        *destId = reply.destId;
+        *outputLen = PLACE_SIZE;
+        inFlight = OUT_REPLY;
+        return true;
+    }
+
+    if (choosePull(nowMs)) {
+        output[0] = OP_PULL;
+        output[1] = pullCount;
+        output[2] = localDepth();
+        *destId = pullTarget;
+        *outputLen = PULL_SIZE;
+        inFlight = OUT_PULL;
+        return true;
+    }
+
+    for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+        const Slot& slot = slots[i];
+        if (slot.state == SLOT_UNPLACED && coordinator != self) {
+            output[0] = OP_REQUEST;
+            putU32(output + 1, slot.job.submitter);
+            putU32(output + 5, slot.job.jobId);
+            *destId = coordinator;
+            *outputLen = REQUEST_SIZE;
+        } else if (slot.state == SLOT_HANDOFF) {
+            // Wait here so far travels with the job; the clock restarts on the next node
+            output[0] = slot.op;
+            putU32(output + 1, slot.job.submitter);
+            putU32(output + 5, slot.job.jobId);
+            putU32(output + 9, slot.job.waitMs + (nowMs - slot.arrivedMs));
+            output[13] = slot.job.attempts;
+            memcpy(output + JOB_HEADER_SIZE, slot.job.body, slot.job.length);
+            *destId = slot.destId;
+            *outputLen = JOB_HEADER_SIZE + slot.job.length;
+        } else {
+            continue;
+        }
+        inFlight = OUT_JOB;
+        inFlightSlot = i;
+        return true;
+    }
+    return false;
+}
+
+void MeshJobBalancer::outgoingDone(bool sent, uint32_t nowMs) {
+    switch (inFlight) {
+        case OUT_RESULT:
+            if (sent) {
+                resultHead = (resultHead + 1) % MESH_JOB_RESULT_SLOTS;
+                resultCount--;
+            }
+            break;
+
+        case OUT_REPLY:
+            if (sent) {
+                replyHead = (replyHead + 1) % MESH_JOB_REPLY_SLOTS;
+                replyCount--;
+            }
+            break;
+
+        case OUT_PULL:
+            if (sent) {
+                // Assume the request is honored until the next heartbeat says otherwise
+                Worker* worker = findWorker(pullTarget);
+                if (worker) worker->queueDepth -= pullCount < worker->queueDepth ? pullCount : worker->queueDepth;
+            }
+            break;
+
+        case OUT_JOB: {
+            Slot& slot = slots[inFlightSlot];
+            if (slot.state == SLOT_UNPLACED) {
+                if (sent) {
+                    slot.state = SLOT_REQUESTED;
+                    slot.requestedMs = nowMs;
+                }
+            } else if (!sent) {
+                // Refused (window full): placements are asked for again, pulled jobs stay here
+                slot.state = slot.fallback;
+            } else {
+                if (slot.op == OP_HANDOVER) stats.pulledOut++;
+                slot.state = SLOT_FREE;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+    inFlight = OUT_NONE;
+}
+
+bool MeshJobBalancer::takeJob(uint32_t nowMs, MeshSmsJob* job) {
+    if (!job) {
+        return false;
+    }
+
+    // Longest total wait first, counting time spent on earlier nodes
+    Slot* oldest = nullptr;
+    uint32_t oldestWait = 0;
+    for (size_t i = 0; i < MESH_JOB_QUEUE_SLOTS; i++) {
+        uint32_t wait = slots[i].job.waitMs + (nowMs - slots[i].arrivedMs);
+        if (slots[i].state == SLOT_QUEUED && (!oldest || wait > oldestWait)) {
+            oldest = &slots[i];
+            oldestWait = wait;
+        }
+    }
+    if (!oldest) {
+        return false;
+    }
+
+    oldest->state = SLOT_RUNNING;
+    oldest->job.waitMs = oldestWait;
+    *job = oldest->job;
+    return true;
+}
+
+bool MeshJobBalancer::completeJob(uint32_t jobId, uint32_t submitter, bool sent, uint32_t sendMs, uint32_t nowMs) {
+    Slot* slot = findSlot(submitter, jobId, SLOT_RUNNING);
+    if (!slot) {
+        return false;
+    }
+    slot->job.attempts++;
+
+    if (sent) {
+        selfSendTimeMs = selfSendTimeMs == 0 ? sendMs : (selfSendTimeMs * 7 + sendMs) / 8;
+        stats.completed++;
+    } else if (slot->job.attempts < MESH_JOB_MAX_ATTEMPTS) {
+        // Another node (or another SIM here) may do better; the wait keeps accumulating
+        slot->state = SLOT_UNPLACED;
+        slot->noted = false;
+        slot->arrivedMs = nowMs;
+        stats.retried++;
+        return true;
+    } else {
+        stats.failed++;
+    }
+
+    Result result;
+    result.submitter = submitter;
+    result.jobId = jobId;
+    result.sent = sent;
+    result.waitMs = slot->job.waitMs;
+    result.sendMs = sendMs;
+    slot->state = SLOT_FREE;
+
+    if (coordinator == self) {
+        recordResult(result, nowMs);
+    } else {
+        queueResult(result);
+    }
+    return true;
+}
+
+void MeshJobBalancer::queueReply(uint32_t destId, const MeshJobDecision& decision) {
+    // A full backlog loses its oldest answer; that holder asks again after its timeout
+    if (replyCount == MESH_JOB_REPLY_SLOTS) {
+        replyHead = (replyHead + 1) % MESH_JOB_REPLY_SLOTS;
+        replyCount--;
+    }
+    Reply& reply = replies[(replyHead + replyCount) % MESH_JOB_REPLY_SLOTS];
+    reply.destId = destId;
+    reply.decision = decision;
+    replyCount++;
+}
+
+void MeshJobBalancer::queueResult(const Result& result) {
+    // A full backlog loses its oldest report; results only feed statistics
+    if (resultCount == MESH_JOB_RESULT_SLOTS) {
+        resultHead = (resultHead + 1) % MESH_JOB_RESULT_SLOTS;
+        resultCount--;
+    }
+    results[(resultHead + resultCount) % MESH_JOB_RESULT_SLOTS] = result;
+    resultCount++;
+}
+
+size_t MeshJobBalancer::waitBucket(uint32_t waitMs) {
+    size_t bucket = 0;
+    while (waitMs > 0 && bucket < MESH_JOB_WAIT_BUCKETS - 1) {
+        waitMs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void MeshJobBalancer::advanceRate(uint32_t nowMs) {
+    uint32_t epoch = nowMs / RATE_BUCKET_MS;
+    if (epoch - rateEpoch >= RATE_BUCKETS) {
+        memset(rateCounts, 0, sizeof(rateCounts));
+        rateEpoch = epoch;
+    }
+    while (rateEpoch != epoch) {
+        rateEpoch++;
+        rateCounts[rateEpoch % RATE_BUCKETS] = 0;
+    }
+}
+
+void MeshJobBalancer::recordResult(const Result& result, uint32_t nowMs) {
+    stats.reported++;
+    stats.waitHistogram[waitBucket(result.waitMs)]++;
+    if (result.waitMs > stats.maxWaitMs) {
+        stats.maxWaitMs = result.waitMs;
+    }
+    if (result.sent) {
+        advanceRate(nowMs);
+        rateCounts[rateEpoch % RATE_BUCKETS]++;
+    }
+}
+
+void MeshJobBalancer::logDecision(const MeshJobDecision& decision) {
+    decisions[decisionNext] = decision;
+    decisionNext = (decisionNext + 1) % MESH_JOB_DECISION_LOG;
+    if (decisionCount < MESH_JOB_DECISION_LOG) decisionCount++;
+}
+
+uint8_t MeshJobBalancer::getQueueDepth() {
+    return localDepth();
+}
+
+uint8_t MeshJobBalancer::getSendTimeUnits() {
+    uint32_t units = (selfSendTimeMs + 50) / 100;
+    return units > 255 ? 255 : (uint8_t)units;
+}
+
+MeshJobStats MeshJobBalancer::getStats(uint32_t nowMs) {
+    elect(nowMs);
+    advanceRate(nowMs);
+
+    MeshJobStats result = stats;
+    result.coordinator = coordinator;
+    result.queueDepth = localDepth();
+    result.fleetSmsPerMinute = 0;
+    for (size_t i = 0; i < RATE_BUCKETS; i++) {
+        result.fleetSmsPerMinute += rateCounts[i];
+    }
+    return result;
+}
+
+size_t MeshJobBalancer::getDecisions(MeshJobDecision* output, size_t outputCap) {
+    // Newest first
+    size_t count = 0;
+    for (; output && count < decisionCount && count < outputCap; count++) {
+        size_t index = (decisionNext + MESH_JOB_DECISION_LOG - 1 - count) % MESH_JOB_DECISION_LOG;
+        output[count] = decisions[index];
+    }
+    return count;
+}
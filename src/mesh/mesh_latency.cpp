@@ -0,0 +1,315 @@
+// Mesh Latency - fixed-memory log-linear histograms per stage, message type and hop count
+#include <string.h>
+#include "mesh_latency.h"
+
+namespace {
+
+inline bool putVarint(uint8_t* output, size_t outputCap, size_t* offset, uint32_t value) {
+    do {
+        if (*offset >= outputCap) {
+            return false;
+        }
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        output[(*offset)++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return true;
+}
+
+inline bool getVarint(const uint8_t* data, size_t len, size_t* offset, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*offset >= len) {
+            return false;
+        }
+        uint8_t byte = data[(*offset)++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+MeshLatencyHistogram::MeshLatencyHistogram() {
+    clear();
+}
+
+void MeshLatencyHistogram::clear() {
+    memset(counts, 0, sizeof(counts));
+    total = 0;
+    samples = 0;
+    minValue = UINT32_MAX;
+    maxValue = 0;
+}
+
+void MeshLatencyHistogram::halve() {
+    total = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        counts[i] >>= 1;
+        total += counts[i];
+    }
+}
+
+void MeshLatencyHistogram::merge(const MeshLatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        while ((uint32_t)counts[i] + other.counts[i] > UINT16_MAX) {
+            halve();
+        }
+    }
+    for (size_t i = 0; i < BUCKETS; i++) {
+        counts[i] += other.counts[i];
+        total += other.counts[i];
+    }
+    samples += other.samples;
+    if (other.samples > 0 && other.minValue < minValue) minValue = other.minValue;
+    if (other.maxValue > maxValue) maxValue = other.maxValue;
+}
+
+uint32_t MeshLatencyHistogram::bucketLow(size_t bucket) {
+    size_t group = bucket / SUB_BUCKETS;
+    if (group == 0) {
+        return (uint32_t)bucket;
+    }
+    return (uint32_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (group - 1);
+}
+
+uint32_t MeshLatencyHistogram::bucketHigh(size_t bucket) {
+    size_t group = bucket / SUB_BUCKETS;
+    uint32_t width = group == 0 ? 1 : 1u << (group - 1);
+    return bucketLow(bucket) + width - 1;
+}
+
+uint32_t MeshLatencyHistogram::getMean() const {
+    if (total == 0) {
+        return 0;
+    }
+    // Bucket midpoints; exact below 2 x SUB_BUCKETS
+    uint64_t sum = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (counts[i]) {
+            sum += (uint64_t)counts[i] * ((bucketLow(i) + (uint64_t)bucketHigh(i)) / 2);
+        }
+    }
+    return (uint32_t)(sum / total);
+}
+
+uint32_t MeshLatencyHistogram::getPercentile(double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+    if (percentile < 0) percentile = 0;
+    if (percentile > 100) percentile = 100;
+
+    // Rank of the sample we are after, counting from 1
+    uint32_t rank = (uint32_t)(percentile / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint32_t high = bucketHigh(i);
+            uint32_t low = bucketLow(i);
+            // The recorded extremes are exact, so never report past them
+            if (high > maxValue) high = maxValue;
+            return high < low ? low : high;
+        }
+    }
+    return maxValue;
+}
+
+bool MeshLatencyHistogram::encode(uint8_t* output, size_t outputCap, size_t* outputLen) const {
+    if (!output || !outputLen) {
+        return false;
+    }
+
+    uint32_t used = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (counts[i]) used++;
+    }
+
+    size_t offset = 0;
+    if (!putVarint(output, outputCap, &offset, samples) ||
+        !putVarint(output, outputCap, &offset, getMin()) ||
+        !putVarint(output, outputCap, &offset, maxValue) ||
+        !putVarint(output, outputCap, &offset, used)) {
+        return false;
+    }
+    size_t previous = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (!counts[i]) {
+            continue;
+        }
+        if (!putVarint(output, outputCap, &offset, (uint32_t)(i - previous)) ||
+            !putVarint(output, outputCap, &offset, counts[i])) {
+            return false;
+        }
+        previous = i;
+    }
+    *outputLen = offset;
+    return true;
+}
+
+bool MeshLatencyHistogram::decode(const uint8_t* data, size_t len, size_t* consumed) {
+    if (!data || !consumed) {
+        return false;
+    }
+
+    size_t offset = 0;
+    uint32_t count, low, high, used;
+    if (!getVarint(data, len, &offset, &count) || !getVarint(data, len, &offset, &low) ||
+        !getVarint(data, len, &offset, &high) || !getVarint(data, len, &offset, &used) ||
+        used > BUCKETS) {
+        return false;
+    }
+
+    clear();
+    size_t bucket = 0;
+    for (uint32_t i = 0; i < used; i++) {
+        uint32_t gap, bucketCount;
+        if (!getVarint(data, len, &offset, &gap) || !getVarint(data, len, &offset, &bucketCount)) {
+            return false;
+        }
+        bucket += gap;
+        if (bucket >= BUCKETS || (i > 0 && gap == 0) || bucketCount == 0 || bucketCount > UINT16_MAX) {
+            return false;
+        }
+        counts[bucket] = (uint16_t)bucketCount;
+        total += bucketCount;
+    }
+    samples = count;
+    minValue = count > 0 ? low : UINT32_MAX;
+    maxValue = high;
+    *consumed = offset;
+    return true;
+}
+
+MeshLatencyRecorder::MeshLatencyRecorder() {
+    reset();
+}
+
+void MeshLatencyRecorder::reset() {
+    for (size_t i = 0; i < MESH_LATENCY_MAX_SERIES; i++) {
+        series[i].key = 0;
+        series[i].histogram.clear();
+    }
+    memset(index, 0, sizeof(index));
+    seriesCount = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+const MeshLatencyRecorder::Series* MeshLatencyRecorder::find(uint32_t key) const {
+    for (size_t probe = 0, slot = slotOf(key); probe < INDEX_SIZE; probe++, slot = (slot + 1) & (INDEX_SIZE - 1)) {
+        if (index[slot] == 0) {
+            return nullptr;
+        }
+        if (series[index[slot] - 1].key == key) {
+            return &series[index[slot] - 1];
+        }
+    }
+    return nullptr;
+}
+
+void MeshLatencyRecorder::record(MeshLatencyStage stage, uint8_t type, uint8_t hops, uint32_t valueUs) {
+    uint32_t key = packKey(stage, type, hops);
+    if (valueUs >= MeshLatencyHistogram::MAX_VALUE) {
+        stats.clamped++;
+    }
+
+    // The index is at most half full, so a free slot always ends the probe
+    size_t slot = slotOf(key);
+    while (index[slot] != 0 && series[index[slot] - 1].key != key) {
+        slot = (slot + 1) & (INDEX_SIZE - 1);
+    }
+    if (index[slot] == 0) {
+        if (seriesCount >= MESH_LATENCY_MAX_SERIES) {
+            stats.dropped++;
+            return;
+        }
+        series[seriesCount].key = key;
+        series[seriesCount].histogram.clear();
+        index[slot] = (uint8_t)(++seriesCount);
+    }
+
+    series[index[slot] - 1].histogram.record(valueUs);
+    stats.recorded++;
+}
+
+bool MeshLatencyRecorder::get(MeshLatencyStage stage, uint8_t type, uint8_t hops,
+                              MeshLatencyHistogram* output) const {
+    const Series* found = find(packKey(stage, type, hops));
+    if (!found || !output) {
+        return false;
+    }
+    *output = found->histogram;
+    return true;
+}
+
+size_t MeshLatencyRecorder::getKeys(MeshLatencyKey* output, size_t outputCap) const {
+    size_t count = 0;
+    for (size_t i = 0; i < seriesCount && count < outputCap; i++) {
+        output[count].stage = (uint8_t)(series[i].key >> 16);
+        output[count].type = (uint8_t)(series[i].key >> 8);
+        output[count].hops = (uint8_t)series[i].key;
+        count++;
+    }
+    return count;
+}
+
+MeshLatencyStats MeshLatencyRecorder::getStats() const {
+    MeshLatencyStats result = stats;
+    result.series = (uint32_t)seriesCount;
+    return result;
+}
+
+bool MeshLatencyRecorder::encodeReport(uint8_t* output, size_t outputCap, size_t* outputLen) const {
+    if (!output || !outputLen || outputCap < 1) {
+        return false;
+    }
+
+    output[0] = REPORT_VERSION;
+    size_t offset = 1;
+    for (size_t i = 0; i < seriesCount; i++) {
+        size_t histogramLen;
+        if (outputCap - offset < 3 ||
+            !series[i].histogram.encode(output + offset + 3, outputCap - offset - 3, &histogramLen)) {
+            continue;
+        }
+        output[offset] = (uint8_t)(series[i].key >> 16);
+        output[offset + 1] = (uint8_t)(series[i].key >> 8);
+        output[offset + 2] = (uint8_t)series[i].key;
+        offset += 3 + histogramLen;
+    }
+    *outputLen = offset;
+    return true;
+}
+
+bool MeshLatencyRecorder::nextSeries(const uint8_t* data, size_t len, size_t* offset,
+                                     MeshLatencyKey* key, MeshLatencyHistogram* histogram) {
+    if (!data || !offset || !key || !histogram) {
+        return false;
+    }
+    if (*offset == 0) {
+        if (len < 1 || data[0] != REPORT_VERSION) {
+            return false;
+        }
+        *offset = 1;
+    }
+    if (*offset + 3 > len || data[*offset] >= MESH_LATENCY_STAGE_COUNT) {
+        return false;
+    }
+
+    size_t consumed;
+    if (!histogram->decode(data + *offset + 3, len - *offset - 3, &consumed)) {
+        return false;
+    }
+    key->stage = data[*offset];
+    key->type = data[*offset + 1];
+    key->hops = data[*offset + 2];
+    *offset += 3 + consumed;
+    return true;
+}
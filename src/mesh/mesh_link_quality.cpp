@@ -0,0 +1,302 @@
+// Mesh Link Quality - probe-based delivery ratios, round trips and ETX costs per neighbor
+#include <string.h>
+#include "mesh_link_quality.h"
+#include "mesh_bytes.h"
+
+namespace {
+
+inline uint16_t addSaturating(uint16_t value, uint32_t add) {
+    uint32_t sum = value + add;
+    return sum > UINT16_MAX ? UINT16_MAX : (uint16_t)sum;
+}
+
+// Probes sent this recently may still be in flight or crossed the neighbor's own probe
+const uint32_t IN_FLIGHT = 2;
+
+} // namespace
+
+static_assert(MESH_LINK_WINDOW <= 32, "Delivery is measured over the 32-bit heard bitmap");
+
+MeshLinkQuality::MeshLinkQuality() {
+    memset(links, 0, sizeof(links));
+}
+
+MeshLinkQuality::Link* MeshLinkQuality::find(uint32_t nodeId) {
+    if (nodeId == 0) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_LINKS; i++) {
+        if (links[i].nodeId == nodeId) return &links[i];
+    }
+    return nullptr;
+}
+
+bool MeshLinkQuality::addNeighbor(uint32_t nodeId, uint32_t nowMs) {
+    if (nodeId == 0 || find(nodeId)) {
+        return false;
+    }
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_LINKS; i++) {
+        if (links[i].nodeId == 0) {
+            memset(&links[i], 0, sizeof(Link));
+            links[i].nodeId = nodeId;
+            links[i].addedMs = nowMs;
+            links[i].cost = MESH_LINK_COST_UNIT;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MeshLinkQuality::removeNeighbor(uint32_t nodeId) {
+    Link* link = find(nodeId);
+    if (!link) {
+        return false;
+    }
+    memset(link, 0, sizeof(Link));
+    return true;
+}
+
+bool MeshLinkQuality::nextProbe(uint32_t nowMs, uint32_t* destId, uint8_t* output, size_t outputCap,
+                                size_t* outputLen) {
+    if (!destId || !output || !outputLen || outputCap < PROBE_SIZE) {
+        return false;
+    }
+
+    // The neighbor waiting longest goes first
+    Link* due = nullptr;
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_LINKS; i++) {
+        Link& link = links[i];
+        if (link.nodeId == 0 || (link.txCount > 0 && (uint32_t)(nowMs - link.lastProbeMs) < MESH_LINK_PROBE_MS)) {
+            continue;
+        }
+        if (!due || link.txCount == 0 || (int32_t)(link.lastProbeMs - due->lastProbeMs) < 0) {
+            due = &link;
+        }
+    }
+    if (!due) {
+        return false;
+    }
+
+    due->txSeq++;
+    due->txCount = addSaturating(due->txCount, 1);
+    due->lastProbeMs = nowMs;
+
+    uint32_t held = due->hasRx ? nowMs - due->rxAtMs : 0;
+    putU16(output, due->txSeq);
+    putU32(output + 2, nowMs);
+    putU16(output + 6, due->hasRx ? due->rxSeq : 0);
+    putU32(output + 8, due->hasRx ? due->rxBitmap : 0);
+    putU32(output + 12, due->hasRx ? due->rxSentMs : 0);
+    putU16(output + 16, held > UINT16_MAX ? UINT16_MAX : (uint16_t)held);
+
+    *destId = due->nodeId;
+    *outputLen = PROBE_SIZE;
+    return true;
+}
+
+bool MeshLinkQuality::onProbe(uint32_t from, const uint8_t* data, size_t len, uint32_t nowMs) {
+    Link* link = find(from);
+    if (!link || !data || len != PROBE_SIZE) {
+        return false;
+    }
+
+    uint16_t seq = getU16(data);
+    uint32_t sentMs = getU32(data + 2);
+    uint16_t echoSeq = getU16(data + 6);
+    uint32_t echoBitmap = getU32(data + 8);
+    uint32_t echoMs = getU32(data + 12);
+    uint16_t held = getU16(data + 16);
+
+    // Its sequence: new highest, a late one inside the bitmap, or a restart
+    int16_t ahead = (int16_t)(seq - link->rxSeq);
+    if (!link->hasRx || ahead <= -32) {
+        link->rxSeq = seq;
+        link->rxBitmap = 1;
+        link->rxCount = 1;
+        link->hasRx = true;
+        link->rxSentMs = sentMs;
+        link->rxAtMs = nowMs;
+    } else if (ahead > 0) {
+        link->rxBitmap = ahead >= 32 ? 1 : (link->rxBitmap << ahead) | 1;
+        link->rxSeq = seq;
+        link->rxCount = addSaturating(link->rxCount, ahead);
+        link->rxSentMs = sentMs;
+        link->rxAtMs = nowMs;
+    } else {
+        link->rxBitmap |= 1u << -ahead;
+    }
+
+    // Its view of ours; an echo of a sequence we have not sent is from before a restart
+    if (echoBitmap != 0 && link->txCount > 0 && (int16_t)(link->txSeq - echoSeq) >= 0) {
+        link->echoSeq = echoSeq;
+        link->echoBitmap = echoBitmap;
+        link->hasEcho = true;
+
+        uint32_t rtt = nowMs - echoMs - held;
+        if (held != UINT16_MAX && rtt < MESH_LINK_PROBE_MS) {
+            link->srttMs = link->srttMs == 0 ? (rtt > 0 ? rtt : 1)
+                                             : (uint32_t)((int32_t)link->srttMs + ((int32_t)rtt - (int32_t)link->srttMs) / 8);
+        }
+    }
+
+    updateCost(*link, nowMs);
+    return true;
+}
+
+void MeshLinkQuality::noteTransmission(Link& link, bool retransmit) {
+    int32_t target = retransmit ? UINT16_MAX : 0;
+    link.retransmitShare = (uint16_t)(link.retransmitShare + (target - (int32_t)link.retransmitShare) / 16);
+}
+
+void MeshLinkQuality::onReliableSent(uint32_t nodeId) {
+    Link* link = find(nodeId);
+    if (link) {
+        link->reliableSent++;
+        noteTransmission(*link, false);
+    }
+}
+
+void MeshLinkQuality::onRetransmit(uint32_t nodeId) {
+    Link* link = find(nodeId);
+    if (link) {
+        link->retransmits++;
+        noteTransmission(*link, true);
+    }
+}
+
+void MeshLinkQuality::forwardRatio(const Link& link, uint8_t* heard, uint8_t* sent) {
+    *heard = 0;
+    *sent = 0;
+    if (!link.hasEcho) {
+        return;
+    }
+
+    // Ours after the highest it heard count as lost once they are too old to be in flight
+    uint16_t after = (uint16_t)(link.txSeq - link.echoSeq);
+    uint16_t end = after > IN_FLIGHT ? link.txSeq - IN_FLIGHT : link.echoSeq;
+    uint16_t span = (uint16_t)(end - (uint16_t)(link.txSeq - link.txCount));
+    uint8_t window = span < MESH_LINK_WINDOW ? (uint8_t)span : MESH_LINK_WINDOW;
+
+    for (uint8_t k = 0; k < window; k++) {
+        int16_t back = (int16_t)(link.echoSeq - (uint16_t)(end - k));
+        if (back >= 0 && back < 32 && (link.echoBitmap >> back) & 1) {
+            (*heard)++;
+        }
+    }
+    *sent = window;
+}
+
+void MeshLinkQuality::reverseRatio(const Link& link, uint32_t nowMs, uint8_t* heard, uint8_t* sent) {
+    *heard = 0;
+    *sent = 0;
+    if (!link.hasRx) {
+        return;
+    }
+
+    // Probe intervals gone by since its last one, beyond the one still to come, were lost
+    uint32_t silent = (nowMs - link.rxAtMs) / MESH_LINK_PROBE_MS;
+    uint32_t missed = silent > 1 ? silent - 1 : 0;
+    uint32_t span = link.rxCount + missed;
+    uint8_t window = span < MESH_LINK_WINDOW ? (uint8_t)span : MESH_LINK_WINDOW;
+
+    for (uint32_t k = missed; k < window; k++) {
+        if ((link.rxBitmap >> (k - missed)) & 1) {
+            (*heard)++;
+        }
+    }
+    *sent = window;
+}
+
+uint8_t MeshLinkQuality::measure(const Link& link, uint32_t nowMs, bool* measured) {
+    uint8_t forwardHeard, forwardSent, reverseHeard, reverseSent;
+    forwardRatio(link, &forwardHeard, &forwardSent);
+    reverseRatio(link, nowMs, &reverseHeard, &reverseSent);
+
+    *measured = forwardSent >= MIN_PROBES && reverseSent >= MIN_PROBES;
+    if (!*measured) {
+        return MESH_LINK_COST_UNIT;
+    }
+    if (forwardHeard == 0 || reverseHeard == 0) {
+        return UINT8_MAX;
+    }
+
+    uint32_t product = (uint32_t)forwardHeard * reverseHeard;
+    uint32_t cost = ((uint32_t)MESH_LINK_COST_UNIT * forwardSent * reverseSent + product / 2) / product;
+    cost += (uint32_t)MESH_LINK_COST_UNIT * link.retransmitShare / (65536 - link.retransmitShare);
+    cost += link.srttMs / MESH_LINK_RTT_UNIT_MS;
+    return cost > UINT8_MAX ? UINT8_MAX : (uint8_t)cost;
+}
+
+void MeshLinkQuality::updateCost(Link& link, uint32_t nowMs) {
+    bool measured;
+    uint8_t cost = measure(link, nowMs, &measured);
+    if (!measured) {
+        return;
+    }
+
+    uint32_t diff = cost > link.cost ? cost - link.cost : link.cost - cost;
+    if (diff * 100 > (uint32_t)link.cost * MESH_LINK_COST_HYSTERESIS) {
+        link.cost = cost;
+        link.costChanged = true;
+    }
+}
+
+bool MeshLinkQuality::nextCostChange(uint32_t nowMs, uint32_t* nodeId, uint8_t* cost) {
+    if (!nodeId || !cost) {
+        return false;
+    }
+
+    // Silence worsens the reverse ratio, so costs are re-evaluated here too
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_LINKS; i++) {
+        Link& link = links[i];
+        if (link.nodeId == 0) {
+            continue;
+        }
+        updateCost(link, nowMs);
+        if (link.costChanged) {
+            link.costChanged = false;
+            *nodeId = link.nodeId;
+            *cost = link.cost;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t MeshLinkQuality::getCost(uint32_t nodeId) {
+    Link* link = find(nodeId);
+    return link ? link->cost : MESH_LINK_COST_UNIT;
+}
+
+MeshLinkStats MeshLinkQuality::statsFor(const Link& link, uint32_t nowMs) {
+    MeshLinkStats stats;
+    stats.nodeId = link.nodeId;
+    forwardRatio(link, &stats.forwardHeard, &stats.forwardSent);
+    reverseRatio(link, nowMs, &stats.reverseHeard, &stats.reverseSent);
+    stats.srttMs = link.srttMs;
+    stats.reliableSent = link.reliableSent;
+    stats.retransmits = link.retransmits;
+    stats.measuredCost = measure(link, nowMs, &stats.measured);
+    stats.cost = link.cost;
+    return stats;
+}
+
+MeshLinkStats MeshLinkQuality::getStats(uint32_t nodeId, uint32_t nowMs) {
+    Link* link = find(nodeId);
+    if (!link) {
+        MeshLinkStats empty;
+        memset(&empty, 0, sizeof(empty));
+        return empty;
+    }
+    return statsFor(*link, nowMs);
+}
+
+size_t MeshLinkQuality::getLinks(MeshLinkStats* output, size_t outputCap, uint32_t nowMs) {
+    size_t count = 0;
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_LINKS && count < outputCap; i++) {
+        if (links[i].nodeId != 0) {
+            output[count++] = statsFor(links[i], nowMs);
+        }
+    }
+    return count;
+}
@@ -1,27 +1,124 @@
-// Mesh Network Manager - Handles painlessMesh networking with AES-256 encryption
+// Mesh Network Manager - Handles painlessMesh networking with AES-256-GCM encryption
 #include <Arduino.h>
 #include <painlessMesh.h>
-#include <AES256.h>
+#include <utility>
 #include "mesh_network_manager.h"
+#include "mesh_wire_frame.h"
+#include "mesh_aead.h"
+#include "mesh_seen_cache.h"
+#include "mesh_outbound_queue.h"
+#include "mesh_heartbeat.h"
+#include "mesh_dispatcher.h"
+#include "mesh_topology.h"
+#include "mesh_reliable.h"
+#include "mesh_fragment.h"
+#include "mesh_flow_control.h"
+#include "mesh_compressor.h"
+#include "mesh_buffer_pool.h"
+#include "mesh_receive_ring.h"
+#include "mesh_pubsub.h"
+#include "mesh_job_balancer.h"
+#include "mesh_time_sync.h"
+#include "mesh_latency.h"
+#include "mesh_platform.h"
 #include "../config/mesh_config.h"
-#include "../config/security_config.h"
+#ifdef ARDUINO
+#include "secure_key_manager.h"
+#endif
 
 MeshNetworkManager::MeshNetworkManager() :
     mesh(),
-    aes(),
+    aead(),
+    rxAead(),
+    seenCache(),
+    outbound(),
+    heartbeat(),
+    peers(),
+    dispatcher(),
+    topology(),
+    reliable(),
+    reassembler(),
+    flow(),
+    compressor(),
+    buffers(),
+    rxRing(),
+    subscriptions(),
+    jobs(),
+    timeSync(),
+    latency(),
+    latencyPublished(),
+    rxPublished(),
+    stateLock(),
+    rxTask(nullptr),
     lastHeartbeat(0),
-    nodeCount(0),
-    isConnected(false) {}
+    lastLinkState(0),
+    linkStateChanged(false),
+    linkStateStale(false),
+    lastSubscriptionAdvert(0),
+    advertisedReach(0),
+    txSequence(0),
+    fragmentMessageId(0),
+    simActiveMask(0),
+    latencyCollector(0),
+    lastLatencyReport(0),
+    lastStatsPublish(0),
+    topicRelayCount(0),
+    topicRelayBytes(0),
+    deferredCount(0),
+    deferredBytes(0) {
+    // Built-in handlers; other modules may replace them or add their own
+    dispatcher.registerHandler(MESH_MSG_HEARTBEAT, handleHeartbeat, this);
+    dispatcher.registerHandler(MESH_MSG_LINK_STATE, handleLinkState, this);
+    dispatcher.registerHandler(MESH_MSG_SUBSCRIPTION, handleSubscription, this);
+    dispatcher.registerHandler(MESH_MSG_JOB, handleJob, this);
+    dispatcher.registerHandler(MESH_MSG_TIME, handleTime, this);
+    dispatcher.registerHandler(MESH_MSG_LINK_PROBE, handleLinkProbe, this);
+    dispatcher.registerHandler(MESH_MSG_ACK, handleAck, this);
+    dispatcher.registerHandler(MESH_MSG_CREDIT, handleCredit, this);
+    dispatcher.registerHandler(MESH_MSG_DATA, handleDataMessage, this);
+    dispatcher.registerHandler(MESH_MSG_COMMAND, handleCommand, this);
+}
 
+#ifdef ARDUINO
 bool MeshNetworkManager::begin() {
-    // Initialize AES encryption
-    aes.setKey(AES_KEY, 32);
+    SecureKeyManager keyManager;
+    uint8_t meshKey[MeshAEAD::KEY_SIZE];
+    if (!keyManager.begin() || !keyManager.getAESKey(meshKey, sizeof(meshKey))) {
+        Serial.println("Failed to load mesh key");
+        return false;
+    }
+    bool ready = begin(meshKey, sizeof(meshKey));
+    memset(meshKey, 0, sizeof(meshKey)); // AEAD keeps only the expanded key
+    return ready;
+}
+#endif
+
+bool MeshNetworkManager::begin(const uint8_t* meshKey, size_t keyLen, uint16_t keyEpoch) {
+    // Initialize AES-256-GCM payload encryption (key is shared mesh-wide)
+    if (!aead.begin(meshKey, keyLen, keyEpoch)) {
+        Serial.println("Failed to initialize mesh encryption");
+        return false;
+    }
+    rxAead.setKey(meshKey, keyLen, keyEpoch);
+
+    // Random starting sequence so a quick reboot is not mistaken for duplicates
+    txSequence = esp_random();
+    fragmentMessageId = (uint16_t)esp_random();
+    reliable.begin((uint16_t)esp_random());
+
+    // Must-deliver messages left from before a reboot go out again once peers are reachable
+    if (!storeFlash.begin(MESH_STORE_PARTITION) || !store.begin(&storeFlash, millis())) {
+        Serial.println("No store-and-forward partition; stored sends will be refused");
+    }
 
     // Initialize mesh network
     mesh.setDebugMsgTypes(ERROR | STARTUP | CONNECTION);
 
     mesh.init(MESH_PREFIX, MESH_PASSWORD, MESH_PORT);
     mesh.setContainsRoot(true);
+    topology.setSelf(mesh.getNodeId());
+    jobs.setSelf(mesh.getNodeId());
+    timeSync.setSelf(mesh.getNodeId());
 
     // Set up callbacks
     mesh.onReceive([this](uint32_t from, String &msg) {
@@ -40,172 +137,1036 @@ bool MeshNetworkManager::begin() {
         this->onChangedConnections();
     });
 
+    // Decryption and dispatch get their own task; without one, frames are handled as they arrive
+    if (!meshStartTask(receiveTask, this, "mesh_rx", MESH_RX_TASK_STACK, MESH_RX_TASK_PRIORITY,
+                       MESH_RX_TASK_CORE, &rxTask)) {
+        rxTask = nullptr;
+    }
+
     Serial.println("Mesh network initialized");
     return true;
 }
 
 void MeshNetworkManager::update() {
+    // Receive callbacks only queue frames, so this stays quick however slow the handlers are
     mesh.update();
 
-    // Send heartbeat every HEARTBEAT_INTERVAL
-    if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL) {
+    MeshLockGuard guard(stateLock);
+    if (!rxTask) {
+        reassembler.expire(millis());
+    }
+    flushTopicRelays();
+
+    // Heartbeat interval adapts to topology stability
+    if (millis() - lastHeartbeat >= heartbeat.getIntervalMs()) {
         sendHeartbeat();
         lastHeartbeat = millis();
     }
+
+    flushLinks();
+
+    // Link changes since the last pass go out as one advert; unchanged ones are refreshed
+    if (linkStateChanged || millis() - lastLinkState >= MESH_LINK_STATE_REFRESH_MS) {
+        topology.expire(millis());
+        subscriptions.expire(millis());
+        sendLinkState();
+        sendSubscriptions();
+        lastLinkState = millis();
+        linkStateChanged = false;
+        linkStateStale = false;
+    } else if (linkStateStale && millis() - lastLinkState >= MESH_LINK_STATE_READVERTISE_MS) {
+        // Nodes that joined elsewhere have not heard our last advert yet
+        sendLinkState();
+        lastLinkState = millis();
+        linkStateStale = false;
+    }
+
+    // Nodes that joined since our last digest advert have not heard it yet
+    size_t reachable = topology.getReachableCount();
+    if (reachable < advertisedReach) {
+        advertisedReach = reachable;
+    } else if (reachable > advertisedReach && millis() - lastSubscriptionAdvert >= MESH_TOPIC_READVERTISE_MS) {
+        sendSubscriptions();
+    }
+
+    flushTime();
+    flushLatency();
+    flushJobs();
+    flushCredits();
+    flushReliable();
+    flushStored();
+    flushDeferred();
+    flushOutbound();
 }
 
-bool MeshNetworkManager::sendMessage(uint32_t destId, const String& message, uint8_t hops) {
+bool MeshNetworkManager::sendMessage(uint32_t destId, const String& message, uint8_t hops,
+                                     MeshPriority priority) {
+    MeshLockGuard guard(stateLock);
     if (hops > MAX_NETWORK_HOPS) {
         Serial.println("Message exceeds maximum hop count");
         return false;
     }
 
-    // Encrypt message
-    String encryptedMsg = encryptMessage(message);
-
-    // Add hop count and timestamp
-    DynamicJsonDocument doc(1024);
-    doc["type"] = "data";
-    doc["payload"] = encryptedMsg;
-    doc["hops"] = hops;
-    doc["timestamp"] = millis();
-    doc["source"] = mesh.getNodeId();
-
-    String jsonString;
-    serializeJson(doc, jsonString);
+    // Unknown destinations are left to painlessMesh routing
+    uint8_t distance = topology.getHopDistance(destId);
+    if (distance != MeshTopology::UNREACHABLE && hops + distance > MAX_NETWORK_HOPS) {
+        Serial.printf("Destination %u is %u hops away, beyond the hop limit\n", destId, distance);
+        return false;
+    }
 
-    return mesh.sendSingle(destId, jsonString);
+    return queueMessage(destId, MESH_MSG_DATA, (const uint8_t*)message.c_str(), message.length(),
+                        hops, priority);
 }
 
-bool MeshNetworkManager::broadcastMessage(const String& message, uint8_t hops) {
+bool MeshNetworkManager::broadcastMessage(const String& message, uint8_t hops, MeshPriority priority) {
+    MeshLockGuard guard(stateLock);
     if (hops > MAX_NETWORK_HOPS) {
         Serial.println("Broadcast exceeds maximum hop count");
         return false;
     }
 
-    // Encrypt message
-    String encryptedMsg = encryptMessage(message);
+    return queueMessage(MeshWireFrame::BROADCAST_DEST, MESH_MSG_DATA,
+                        (const uint8_t*)message.c_str(), message.length(), hops, priority);
+}
+
+bool MeshNetworkManager::sendReliable(uint32_t destId, const String& message, MeshPriority priority) {
+    return sendReliable(destId, MESH_MSG_DATA, (const uint8_t*)message.c_str(), message.length(), priority);
+}
+
+bool MeshNetworkManager::sendReliable(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                                      MeshPriority priority) {
+    if (destId == MeshWireFrame::BROADCAST_DEST || len > MeshReliable::MAX_PAYLOAD) {
+        Serial.println("Reliable send needs a single destination and a payload within one record");
+        return false;
+    }
+
+    MeshLockGuard guard(stateLock);
+
+    uint8_t distance = topology.getHopDistance(destId);
+    if (distance != MeshTopology::UNREACHABLE && distance > MAX_NETWORK_HOPS) {
+        Serial.printf("Destination %u is %u hops away, beyond the hop limit\n", destId, distance);
+        return false;
+    }
+
+    MeshBuffer packet = buffers.acquire(MESH_OUTBOUND_MAX_RECORD);
+    if (!packet) {
+        Serial.println("No buffer for reliable send");
+        return false;
+    }
+
+    // Refused when the window to this destination is full; the caller retries later
+    size_t packetLen;
+    if (!reliable.send(destId, type, data, len, millis(), packet.data(), packet.capacity(), &packetLen)) {
+        return false;
+    }
+
+    // A full queue only delays the first copy; the window retransmits it
+    links.onReliableSent(nextHopFor(destId));
+    queueMessage(destId, MESH_MSG_RELIABLE, packet.data(), packetLen, 0, priority);
+    return true;
+}
+
+bool MeshNetworkManager::sendStored(uint32_t destId, const String& message, MeshPriority priority) {
+    return sendStored(destId, MESH_MSG_DATA, (const uint8_t*)message.c_str(), message.length(), priority);
+}
+
+bool MeshNetworkManager::sendStored(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                                    MeshPriority priority) {
+    if (destId == MeshWireFrame::BROADCAST_DEST || len > MeshStoreForward::MAX_PAYLOAD) {
+        Serial.println("Stored send needs a single destination and a payload within one record");
+        return false;
+    }
+
+    MeshLockGuard guard(stateLock);
 
-    // Add hop count and timestamp
-    DynamicJsonDocument doc(1024);
-    doc["type"] = "broadcast";
-    doc["payload"] = encryptedMsg;
-    doc["hops"] = hops;
-    doc["timestamp"] = millis();
-    doc["source"] = mesh.getNodeId();
+    uint8_t distance = topology.getHopDistance(destId);
+    if (distance != MeshTopology::UNREACHABLE && distance > MAX_NETWORK_HOPS) {
+        Serial.printf("Destination %u is %u hops away, beyond the hop limit\n", destId, distance);
+        return false;
+    }
+
+    // On flash before anything is sent; flushStored() takes it from there
+    if (!store.append(destId, type, data, len, priority, millis())) {
+        Serial.println("Store-and-forward log full or unavailable, message refused");
+        return false;
+    }
+    return true;
+}
 
-    String jsonString;
-    serializeJson(doc, jsonString);
+bool MeshNetworkManager::queueMessage(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                                      uint8_t hops, MeshPriority priority, uint8_t flags) {
+    // Payloads beyond one frame are split; oversized records go out directly,
+    // except from handlers: only loop() talks to painlessMesh
+    if (len > MESH_OUTBOUND_MAX_RECORD && rxTask && meshCurrentTask() == rxTask) {
+        return deferSend(destId, type, data, len, hops, flags);
+    }
+    if (len > MAX_FRAME_PAYLOAD) {
+        return sendFragmented(destId, type, data, len, hops, flags);
+    }
+    if (len > MESH_OUTBOUND_MAX_RECORD) {
+        return sendFrame(destId, type, data, len, hops, flags);
+    }
+
+    if (!outbound.enqueue(destId, type, data, len, hops, priority, millis(), flags)) {
+        Serial.printf("Outbound queue full (priority %d), message dropped\n", priority);
+        return false;
+    }
 
-    mesh.sendBroadcast(jsonString);
+    // Control traffic should not wait for the next update() pass; only loop() talks to painlessMesh
+    if (priority == MESH_PRIORITY_CONTROL && (!rxTask || meshCurrentTask() != rxTask)) {
+        flushOutbound();
+    }
     return true;
 }
 
-String MeshNetworkManager::encryptMessage(const String& message) {
-    // Simple AES encryption (in production, use proper padding and IV)
-    uint8_t block[16];
-    message.getBytes(block, 16);
+bool MeshNetworkManager::deferSend(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                                   uint8_t hops, uint8_t flags) {
+    if (deferredCount >= MESH_RX_DEFERRED_SENDS || len > MESH_RX_DEFERRED_BYTES - deferredBytes) {
+        Serial.printf("No room to defer a %u byte send from a handler, message dropped\n", (unsigned)len);
+        return false;
+    }
+
+    DeferredSend& entry = deferred[deferredCount++];
+    entry.destId = destId;
+    entry.type = type;
+    entry.hops = hops;
+    entry.flags = flags;
+    entry.offset = deferredBytes;
+    entry.len = len;
+    memcpy(deferredData + deferredBytes, data, len);
+    deferredBytes += len;
+    return true;
+}
 
-    aes.encryptBlock(block, block);
+void MeshNetworkManager::flushDeferred() {
+    // Called from update() under stateLock, so the worker cannot add to the batch meanwhile
+    for (size_t i = 0; i < deferredCount; i++) {
+        const DeferredSend& entry = deferred[i];
+        queueMessage(entry.destId, entry.type, deferredData + entry.offset, entry.len, entry.hops,
+                     MESH_PRIORITY_TELEMETRY, entry.flags);
+    }
+    deferredCount = 0;
+    deferredBytes = 0;
+}
 
-    // Convert to hex string for transmission
-    String encrypted;
-    for (int i = 0; i < 16; i++) {
-        if (block[i] < 16) encrypted += "0";
-        encrypted += String(block[i], HEX);
+void MeshNetworkManager::queueTopicRelay(const uint8_t* frame, size_t frameLen, uint32_t from) {
+    if (topicRelayCount >= MESH_TOPIC_RELAY_FRAMES || frameLen > MESH_TOPIC_RELAY_BYTES - topicRelayBytes) {
+        Serial.println("Topic relay queue full, frame not forwarded");
+        return;
     }
 
-    return encrypted;
+    TopicRelay& entry = topicRelays[topicRelayCount++];
+    entry.from = from;
+    entry.offset = topicRelayBytes;
+    entry.len = frameLen;
+    memcpy(topicRelayData + topicRelayBytes, frame, frameLen);
+    topicRelayBytes += frameLen;
+
+    // Only loop() talks to painlessMesh; without a worker we are already on it
+    if (!rxTask || meshCurrentTask() != rxTask) {
+        flushTopicRelays();
+    }
 }
 
-String MeshNetworkManager::decryptMessage(const String& encryptedMessage) {
-    // Convert hex string back to bytes
-    uint8_t block[16];
-    for (int i = 0; i < 16; i++) {
-        String byteStr = encryptedMessage.substring(i * 2, i * 2 + 2);
-        block[i] = strtol(byteStr.c_str(), NULL, 16);
+void MeshNetworkManager::flushTopicRelays() {
+    for (size_t i = 0; i < topicRelayCount; i++) {
+        const TopicRelay& entry = topicRelays[i];
+        uint8_t* frame = topicRelayData + entry.offset;
+        MeshFrameHeader header;
+        if (!MeshWireFrame::readHeader(frame, entry.len, &header)) {
+            continue;
+        }
+
+        // Hops is outside the AEAD associated data, so it is bumped without re-sealing
+        header.hops++;
+        MeshWireFrame::writeHeader(header, frame, entry.len);
+        forwardTopic(header.dest, frame, entry.len, header.hops, entry.from);
     }
+    topicRelayCount = 0;
+    topicRelayBytes = 0;
+}
+
+bool MeshNetworkManager::sendFragmented(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                                        uint8_t hops, uint8_t flags) {
+    if (len > MeshFragmenter::MAX_MESSAGE) {
+        Serial.printf("Message of %u bytes exceeds the reassembly limit\n", (unsigned)len);
+        return false;
+    }
+
+    MeshBuffer fragment = buffers.acquire(MeshFragmenter::HEADER_SIZE + MESH_FRAGMENT_SIZE);
+    if (!fragment) {
+        Serial.println("No buffer for fragmentation");
+        return false;
+    }
+
+    uint16_t messageId = ++fragmentMessageId;
+    size_t count = MeshFragmenter::fragmentCount(len);
+    for (size_t i = 0; i < count; i++) {
+        size_t fragmentLen;
+        if (!MeshFragmenter::writeFragment(messageId, type, data, len, i,
+                                           fragment.data(), fragment.capacity(), &fragmentLen) ||
+            !sendFrame(destId, MESH_MSG_FRAGMENT, fragment.data(), fragmentLen, hops, flags)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshNetworkManager::flushOutbound() {
+    if (outbound.isEmpty()) {
+        return;
+    }
+
+    // Nothing is taken off the queue unless there is a buffer to build it in
+    MeshBuffer batch = buffers.acquire(MESH_COALESCE_MAX_BYTES);
+    if (!batch) {
+        return;
+    }
+
+    // Bounded burst so a deep backlog cannot starve mesh.update()
+    MeshOutboundFrame frame;
+    for (int i = 0; i < MESH_OUTBOUND_BURST; i++) {
+        if (!outbound.nextFrame(millis(), &frame, batch.data(), batch.capacity(), canSendTo, this)) {
+            break;
+        }
+        // Topic frames fan out to several neighbors and are not charged against any one window
+        uint8_t flags = frame.flags;
+        if (frame.lowestPriority != MESH_PRIORITY_CONTROL && frame.dest != MeshWireFrame::BROADCAST_DEST &&
+            !(flags & MeshWireFrame::FLAG_TOPIC)) {
+            flags |= MeshWireFrame::FLAG_CREDITED;
+        }
+        sendFrame(frame.dest, frame.type, batch.data(), frame.length, frame.hops, flags);
+    }
+}
+
+void MeshNetworkManager::flushCredits() {
+    // Credits are withheld as heap runs low so upstream senders back off before we run out
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint16_t window = MESH_FLOW_WINDOW;
+    if (freeHeap < MESH_FLOW_LOW_HEAP) {
+        window = 0;
+    } else if (freeHeap < 2 * MESH_FLOW_LOW_HEAP) {
+        window = MESH_FLOW_WINDOW / 2;
+    }
+    flow.setWindow(window);
 
-    aes.decryptBlock(block, block);
+    uint32_t destId;
+    uint8_t grant[MeshFlowControl::GRANT_SIZE];
+    size_t len;
+    while (flow.nextGrant(millis(), &destId, grant, sizeof(grant), &len)) {
+        queueMessage(destId, MESH_MSG_CREDIT, grant, len, 0, MESH_PRIORITY_CONTROL);
+    }
+}
 
-    return String((char*)block);
+uint32_t MeshNetworkManager::nextHopFor(uint32_t destId) {
+    uint32_t via = topology.getNextHop(destId);
+    return via != 0 ? via : destId;
+}
+
+bool MeshNetworkManager::canSendTo(void* context, uint32_t destId) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    if (destId == MeshWireFrame::BROADCAST_DEST) {
+        return true;
+    }
+    // Topic IDs are not nodes, so they look like an unknown peer and are never held back
+    return self->flow.canSend(self->nextHopFor(destId), millis());
+}
+
+void MeshNetworkManager::flushReliable() {
+    MeshBuffer packet = buffers.acquire(MESH_OUTBOUND_MAX_RECORD);
+    if (!packet) {
+        return;
+    }
+
+    uint32_t destId;
+    size_t len;
+
+    // One cumulative ACK per peer per pass, coalesced with any outbound data
+    while (reliable.nextAck(&destId, packet.data(), packet.capacity(), &len)) {
+        queueMessage(destId, MESH_MSG_ACK, packet.data(), len, 0, MESH_PRIORITY_SMS);
+    }
+
+    while (reliable.nextRetransmit(millis(), &destId, packet.data(), packet.capacity(), &len)) {
+        links.onRetransmit(nextHopFor(destId));
+        queueMessage(destId, MESH_MSG_RELIABLE, packet.data(), len, 0, MESH_PRIORITY_SMS);
+    }
+}
+
+void MeshNetworkManager::flushStored() {
+    MeshBuffer packet = buffers.acquire(MESH_OUTBOUND_MAX_RECORD);
+    if (!packet) {
+        return;
+    }
+
+    // The store paces replays; records for destinations outside our partition stay on flash
+    uint32_t destId;
+    MeshPriority priority;
+    size_t len;
+    while (store.nextReplay(millis(), canReach, this, &destId, &priority, packet.data(), packet.capacity(), &len)) {
+        queueMessage(destId, MESH_MSG_STORED, packet.data(), len, 0, priority);
+    }
+}
+
+bool MeshNetworkManager::canReach(void* context, uint32_t destId) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    uint8_t distance = self->topology.getHopDistance(destId);
+    if (distance != MeshTopology::UNREACHABLE) {
+        return distance <= MAX_NETWORK_HOPS;
+    }
+    // Unknown destinations are left to painlessMesh routing, as long as we are connected at all
+    return self->topology.getNeighborCount() > 0;
+}
+
+bool MeshNetworkManager::sendFrame(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, uint8_t hops,
+                                   uint8_t flags) {
+    MeshFrameHeader header;
+    header.version = MeshWireFrame::VERSION;
+    header.type = type;
+    header.flags = flags;
+    header.hops = hops;
+    header.seq = ++txSequence;
+    header.source = mesh.getNodeId();
+    header.dest = destId;
+    header.sentMs = timeSync.toMesh(millis());
+    if (timeSync.getErrorMs(millis()) != UINT32_MAX) {
+        header.flags |= MeshWireFrame::FLAG_MESH_TIME;
+    }
+    header.keyEpoch = aead.getKeyEpoch();
+
+    // A wrapped sequence counter would repeat nonces under the same salt
+    if (header.seq == 0) {
+        aead.refreshSalt();
+    }
+
+    MeshBuffer frame = buffers.acquire(MeshWireFrame::HEADER_SIZE + len + MeshAEAD::OVERHEAD);
+    if (!frame) {
+        Serial.println("No buffer for outgoing frame");
+        return false;
+    }
+
+    // Compress ahead of encryption when it pays off; ciphertext would not shrink.
+    // Without a spare buffer the frame simply goes out uncompressed.
+    MeshBuffer compressed = buffers.acquire(len);
+    size_t compressedLen;
+    if (compressed && compressor.compress(type, data, len, compressed.data(), compressed.capacity(), &compressedLen)) {
+        header.flags |= MeshWireFrame::FLAG_COMPRESSED;
+        data = compressed.data();
+        len = compressedLen;
+    }
+
+    // Seal straight into the payload area of the outgoing frame
+    uint8_t* payload = frame.data() + MeshWireFrame::HEADER_SIZE;
+    size_t payloadLen;
+    if (!aead.seal(header, data, len, payload, frame.capacity() - MeshWireFrame::HEADER_SIZE, &payloadLen)) {
+        Serial.println("Failed to encrypt message");
+        return false;
+    }
+    header.length = payloadLen;
+    compressed.release();
+
+    size_t frameLen;
+    if (!MeshWireFrame::encode(header, payload, frame.data(), frame.capacity(), &frameLen)) {
+        Serial.println("Failed to encode frame");
+        return false;
+    }
+
+    if (flags & MeshWireFrame::FLAG_TOPIC) {
+        forwardTopic(destId, frame.data(), frameLen, hops, 0);
+        return true;
+    }
+    return transmitFrame(destId, frame.data(), frameLen, (flags & MeshWireFrame::FLAG_CREDITED) != 0);
+}
+
+bool MeshNetworkManager::transmitFrame(uint32_t destId, const uint8_t* frame, size_t frameLen, bool credited) {
+    MeshBuffer armor = buffers.acquire(MeshWireFrame::armoredSize(frameLen) + 1);
+    size_t armorLen;
+    if (!armor || !MeshWireFrame::armor(frame, frameLen, (char*)armor.data(), armor.capacity(), &armorLen)) {
+        Serial.println("Failed to armor frame");
+        return false;
+    }
+
+    // painlessMesh only accepts String payloads; this copy is the one allocation left per send
+    if (destId == MeshWireFrame::BROADCAST_DEST) {
+        mesh.sendBroadcast(String((const char*)armor.data()));
+        return true;
+    }
+
+    // Hand the frame to the cached next hop; relays forward it on from there
+    uint32_t via = nextHopFor(destId);
+    if (credited) {
+        flow.onSent(via, millis());
+    }
+    return mesh.sendSingle(via, String((const char*)armor.data()));
+}
+
+size_t MeshNetworkManager::forwardTopic(uint32_t topicId, const uint8_t* frame, size_t frameLen, uint8_t hops,
+                                        uint32_t exclude) {
+    // A copy sent out with this hop count may still travel MAX_NETWORK_HOPS - hops links
+    size_t routeCount = topology.getNodesWithin(MeshTopology::UNREACHABLE - 1, topicRoutes, MESH_TOPOLOGY_MAX_NODES);
+    uint32_t branches[MESH_TOPOLOGY_MAX_NODES];
+    size_t count = subscriptions.selectBranches(topicId, exclude, topicRoutes, routeCount, MAX_NETWORK_HOPS - hops,
+                                                branches, MESH_TOPOLOGY_MAX_NODES);
+    if (count == 0) {
+        return 0;
+    }
+
+    // Armored once, then handed to each neighbor with subscribers behind it
+    MeshBuffer armor = buffers.acquire(MeshWireFrame::armoredSize(frameLen) + 1);
+    size_t armorLen;
+    if (!armor || !MeshWireFrame::armor(frame, frameLen, (char*)armor.data(), armor.capacity(), &armorLen)) {
+        Serial.println("Failed to armor frame");
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        mesh.sendSingle(branches[i], String((const char*)armor.data()));
+    }
+    return count;
+}
+
+void MeshNetworkManager::relayFrame(MeshFrameHeader& header, uint8_t* frame, size_t frameLen) {
+    if (header.hops + 1 >= MAX_NETWORK_HOPS) {
+        Serial.println("Relay discarded: exceeded max hops");
+        return;
+    }
+
+    // Hops is outside the AEAD associated data, so relays update it without re-sealing
+    header.hops++;
+    // Relays cannot hold frames, so credited ones go out even past the next hop's window;
+    // our own traffic to that hop then waits until it catches up
+    MeshWireFrame::writeHeader(header, frame, frameLen);
+    transmitFrame(header.dest, frame, frameLen, (header.flags & MeshWireFrame::FLAG_CREDITED) != 0);
 }
 
 void MeshNetworkManager::onReceive(uint32_t from, String &msg) {
-    DynamicJsonDocument doc(1024);
-    DeserializationError error = deserializeJson(doc, msg);
+    // Runs inside mesh.update(): relays and credit accounting happen here, everything else
+    // is left to the worker. Only frames for this node take a ring slot, so a worker held
+    // up by a slow handler never stops us forwarding or crediting neighbors.
+    size_t frameLen;
+    MeshFrameHeader header;
+    if (!MeshWireFrame::unarmor(msg.c_str(), msg.length(), rxFrame, sizeof(rxFrame), &frameLen) ||
+        !MeshWireFrame::readHeader(rxFrame, frameLen, &header)) {
+        Serial.println("Failed to decode received frame");
+        return;
+    }
+
+    bool local = true;
+    {
+        MeshLockGuard guard(stateLock);
+
+        // The sending neighbor is owed credit back for anything charged against us
+        if (header.flags & MeshWireFrame::FLAG_CREDITED) {
+            flow.onReceived(from, millis());
+        }
+
+        if (header.flags & MeshWireFrame::FLAG_TOPIC) {
+            // Authenticated by the worker before it is forwarded or remembered as seen
+            local = header.source != mesh.getNodeId();
+        } else if (header.dest != MeshWireFrame::BROADCAST_DEST && header.dest != mesh.getNodeId()) {
+            // Unicast for another node: pass it along without decrypting
+            relayFrame(header, rxFrame, frameLen);
+            local = false;
+        }
+    }
+    if (!local) {
+        return;
+    }
+
+    MeshReceiveSlot* slot = rxRing.beginPush();
+    if (!slot) {
+        return;
+    }
+    slot->from = from;
+    slot->length = frameLen;
+    memcpy(slot->frame, rxFrame, frameLen);
+    rxRing.commitPush(slot, micros());
+
+    // Without a worker (host builds) the frame is handled at once, as a woken worker would
+    if (rxTask) {
+        meshNotifyTask(rxTask);
+    } else {
+        drainReceived();
+    }
+}
+
+void MeshNetworkManager::receiveTask(void* context) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    for (;;) {
+        // Wakes at least every 100 ms so reassembly timeouts still fire on a quiet mesh
+        meshWaitForNotify(100);
+        self->drainReceived();
+    }
+}
+
+void MeshNetworkManager::drainReceived() {
+    MeshReceiveSlot* slot;
+    while ((slot = rxRing.front()) != nullptr) {
+        if (slot->length > 0) {
+            processFrame(*slot);
+        }
+        rxRing.pop(micros());
+    }
+
+    reassembler.expire(millis());
+    if (rxTask && millis() - lastStatsPublish >= MESH_RX_STATS_PUBLISH_MS) {
+        publishReceiveStats();
+    }
+}
+
+void MeshNetworkManager::publishReceiveStats() {
+    // One copy per interval under the lock keeps recording itself lock-free
+    MeshLockGuard guard(stateLock);
+    latencyPublished = latency;
+    rxPublished.seenCache = seenCache.getStats();
+    rxPublished.reassembly = reassembler.getStats();
+    rxPublished.decompression = compressor.getDecodeStats();
+    for (size_t type = 0; type < MESH_DISPATCH_TABLE_SIZE; type++) {
+        rxPublished.handlers[type] = dispatcher.getStats((uint8_t)type);
+    }
+    lastStatsPublish = millis();
+}
+
+const MeshLatencyRecorder& MeshNetworkManager::receiveLatency() {
+    // Without a worker everything runs on loop(), so the live recorder is safe to read
+    return rxTask ? latencyPublished : latency;
+}
 
-    if (error) {
+void MeshNetworkManager::processFrame(MeshReceiveSlot& slot) {
+    MeshFrameHeader header;
+    const uint8_t* payload;
+    if (!MeshWireFrame::decode(slot.frame, slot.length, &header, &payload)) {
         Serial.println("Failed to parse received message");
         return;
     }
 
-    String type = doc["type"];
-    uint8_t hops = doc["hops"] | 0;
-    String payload = doc["payload"];
+    // Drop relayed duplicates before spending any time on decryption
+    uint32_t now = millis();
+    if (seenCache.contains(header.source, header.seq, now)) {
+        return;
+    }
 
     // Check hop count
-    if (hops >= MAX_NETWORK_HOPS) {
+    if (header.hops >= MAX_NETWORK_HOPS) {
         Serial.println("Message discarded: exceeded max hops");
         return;
     }
 
-    // Decrypt payload
-    String decryptedPayload = decryptMessage(payload);
+    // Authenticate and decrypt in place; the slot is ours until pop(). Topic frames are
+    // opened into scratch instead, since the sealed frame may still be forwarded.
+    bool topic = (header.flags & MeshWireFrame::FLAG_TOPIC) != 0;
+    size_t plainOffset = MeshWireFrame::HEADER_SIZE + MeshAEAD::SALT_SIZE;
+    uint8_t* plain = topic ? rxTopicPlain : slot.frame + plainOffset;
+    size_t plainCap = topic ? sizeof(rxTopicPlain) : sizeof(slot.frame) - plainOffset;
+    size_t plainLen;
+    if (!rxAead.open(header, payload, header.length, plain, plainCap, &plainLen)) {
+        Serial.println("Failed to decrypt received message");
+        return;
+    }
+
+    // Only authenticated frames are recorded, so forgeries cannot mask real traffic
+    seenCache.insert(header.source, header.seq, now);
+
+    if (topic) {
+        // Forwarded once along every other branch with subscribers, and kept only if we are one
+        MeshLockGuard guard(stateLock);
+        if (!subscriptions.firstCopy(header.source, header.seq)) {
+            return;
+        }
+        if (header.hops + 1 < MAX_NETWORK_HOPS) {
+            queueTopicRelay(slot.frame, slot.length, slot.from);
+        }
+        if (!subscriptions.deliverLocally(header.dest)) {
+            return;
+        }
+    }
+
+    if (header.flags & MeshWireFrame::FLAG_COMPRESSED) {
+        if (!compressor.decompress(header.type, plain, plainLen, rxInflated, sizeof(rxInflated), &plainLen)) {
+            Serial.println("Failed to decompress received message");
+            return;
+        }
+        plain = rxInflated;
+    }
+
+    MeshMessageInfo info;
+    info.from = slot.from;
+    info.source = header.source;
+    info.seq = header.seq;
+    info.sentMs = header.sentMs;
+    info.receivedMs = now - (micros() - slot.enqueuedUs) / 1000;
+    info.topic = (header.flags & MeshWireFrame::FLAG_TOPIC) ? header.dest : 0;
+    info.hops = header.hops + 1;
 
-    // Handle different message types
-    if (type == "heartbeat") {
-        handleHeartbeat(from, decryptedPayload);
-    } else if (type == "data") {
-        handleDataMessage(from, decryptedPayload, hops + 1);
-    } else if (type == "command") {
-        handleCommand(from, decryptedPayload, hops + 1);
+    // Transit only means something when both ends were on mesh time; the clocks
+    // agree to within their error bounds, so a slightly negative result reads as 0
+    uint32_t transitUs = UINT32_MAX;
+    if (header.flags & MeshWireFrame::FLAG_MESH_TIME) {
+        MeshLockGuard guard(stateLock);
+        if (timeSync.getErrorMs(info.receivedMs) != UINT32_MAX) {
+            int32_t transitMs = (int32_t)(timeSync.toMesh(info.receivedMs) - header.sentMs);
+            if (transitMs <= 0) {
+                transitUs = 0;
+            } else if ((uint32_t)transitMs > MeshLatencyHistogram::MAX_VALUE / 1000) {
+                transitUs = MeshLatencyHistogram::MAX_VALUE;
+            } else {
+                transitUs = (uint32_t)transitMs * 1000;
+            }
+        }
     }
+
+    // Coalesced frames carry several records for this destination
+    if (header.type == MESH_MSG_BATCH) {
+        size_t offset = 0;
+        uint8_t type;
+        const uint8_t* data;
+        size_t len;
+        while (MeshOutboundQueue::nextRecord(plain, plainLen, &offset, &type, &data, &len)) {
+            dispatchMessage(info, type, data, len, slot.enqueuedUs, transitUs);
+        }
+        return;
+    }
+
+    dispatchMessage(info, header.type, plain, plainLen, slot.enqueuedUs, transitUs);
+}
+
+void MeshNetworkManager::dispatchMessage(MeshMessageInfo& info, uint8_t type, const uint8_t* data, size_t len,
+                                         uint32_t enqueuedUs, uint32_t transitUs) {
+    // Fragments are held until the whole message is in the pool, then dispatched from there
+    if (type == MESH_MSG_FRAGMENT) {
+        MeshReassemblyResult result = reassembler.onFragment(info.source, data, len, millis(),
+                                                             &type, &data, &len);
+        if (result != MESH_REASSEMBLY_COMPLETE) {
+            return;
+        }
+    }
+
+    // Sequenced wrapper: suppress duplicates, then dispatch the inner message
+    if (type == MESH_MSG_RELIABLE) {
+        MeshLockGuard guard(stateLock);
+        MeshReliableVerdict verdict = reliable.onData(info.source, data, len, millis(), &type, &data, &len);
+        if (verdict != MESH_RELIABLE_DELIVER) {
+            return;
+        }
+    }
+
+    // Persisted wrapper: an ACK settles one of our records; data is acknowledged, even when a
+    // duplicate, and handed up once
+    if (type == MESH_MSG_STORED) {
+        MeshLockGuard guard(stateLock);
+        if (store.onAck(info.source, data, len)) {
+            return;
+        }
+        uint8_t ack[MeshStoreForward::ACK_SIZE];
+        size_t ackLen;
+        bool fresh = store.receive(info.source, data, len, millis(), &type, &data, &len, ack, sizeof(ack), &ackLen);
+        if (ackLen > 0) {
+            queueMessage(info.source, MESH_MSG_STORED, ack, ackLen, 0, MESH_PRIORITY_CONTROL);
+        }
+        if (!fresh) {
+            return;
+        }
+    }
+
+    // Handlers run unlocked; the built-in ones and the send API take the lock themselves.
+    // Samples go into the worker's own recorder; other tasks read the copy it publishes.
+    info.type = type;
+    if (transitUs != UINT32_MAX) {
+        latency.record(MESH_LATENCY_TRANSIT, type, info.hops, transitUs);
+    }
+    latency.record(MESH_LATENCY_QUEUED, type, 0, micros() - enqueuedUs);
+    uint32_t handlerUs;
+    if (!dispatcher.dispatch(info, data, len, &handlerUs)) {
+        Serial.printf("No handler for message type %u from %u\n", type, info.source);
+        return;
+    }
+    latency.record(MESH_LATENCY_HANDLER, type, 0, handlerUs);
 }
 
 void MeshNetworkManager::onNewConnection(uint32_t nodeId) {
     Serial.printf("New connection: %u\n", nodeId);
-    nodeCount = mesh.getNodeList().size();
-    isConnected = true;
+    MeshLockGuard guard(stateLock);
+    if (topology.addLink(nodeId, millis())) {
+        linkStateChanged = true;
+    }
+    links.addNeighbor(nodeId, millis());
+    store.onConnectivity(millis());
+    heartbeat.onTopologyChange();
 }
 
 void MeshNetworkManager::onDroppedConnection(uint32_t nodeId) {
     Serial.printf("Dropped connection: %u\n", nodeId);
-    nodeCount = mesh.getNodeList().size();
-    isConnected = (nodeCount > 0);
+    MeshLockGuard guard(stateLock);
+    if (topology.removeLink(nodeId)) {
+        linkStateChanged = true;
+    }
+    flow.removePeer(nodeId);
+    links.removeNeighbor(nodeId);
+    heartbeat.onTopologyChange();
 }
 
 void MeshNetworkManager::onChangedConnections() {
-    nodeCount = mesh.getNodeList().size();
-    Serial.printf("Connections changed. Total nodes: %d\n", nodeCount);
+    MeshLockGuard guard(stateLock);
+
+    // Remote changes arrive as link-state adverts; any newcomer still needs ours
+    Serial.printf("Connections changed. Known nodes: %u\n", (unsigned)topology.getReachableCount());
+    linkStateStale = true;
+    heartbeat.onTopologyChange();
 }
 
 void MeshNetworkManager::sendHeartbeat() {
-    DynamicJsonDocument doc(512);
-    doc["nodeId"] = mesh.getNodeId();
-    doc["uptime"] = millis();
-    doc["freeHeap"] = ESP.getFreeHeap();
-    doc["nodeCount"] = nodeCount;
+    MeshHeartbeatSnapshot snapshot;
+    uint32_t heapBucket = ESP.getFreeHeap() / 4096;
+    snapshot.freeHeapBucket = heapBucket > 255 ? 255 : heapBucket;
+    snapshot.nodeCount = topology.getReachableCount();
+    snapshot.simActiveMask = simActiveMask;
+    snapshot.smsQueueDepth = jobs.getQueueDepth();
+    snapshot.smsSendTime = jobs.getSendTimeUnits();
 
-    String heartbeatData;
-    serializeJson(doc, heartbeatData);
+    // Our own entry in the coordinator election and placement
+    jobs.setLocalCapacity(snapshot.freeHeapBucket, simActiveMask);
+
+    // Only fields changed since the last keyframe are sent
+    uint8_t heartbeatData[MeshHeartbeatEncoder::MAX_SIZE];
+    size_t heartbeatLen;
+    if (!heartbeat.encode(snapshot, heartbeatData, sizeof(heartbeatData), &heartbeatLen)) {
+        return;
+    }
 
-    broadcastMessage(heartbeatData, 0);
+    queueMessage(MeshWireFrame::BROADCAST_DEST, MESH_MSG_HEARTBEAT, heartbeatData,
+                 heartbeatLen, 0, MESH_PRIORITY_TELEMETRY);
 }
 
-void MeshNetworkManager::handleHeartbeat(uint32_t from, const String& data) {
-    // Process heartbeat data
-    Serial.printf("Heartbeat from %u: %s\n", from, data.c_str());
+void MeshNetworkManager::handleHeartbeat(void* context, const MeshMessageInfo& info,
+                                         const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+
+    uint8_t distance = self->topology.getHopDistance(info.source);
+    bool reachable = distance == MeshTopology::UNREACHABLE || distance <= MAX_NETWORK_HOPS;
+    if (!self->peers.find(info.source) && !self->admitPeer(distance)) {
+        return;
+    }
+
+    // Rebuild the peer's snapshot from keyframe + delta
+    if (!self->peers.apply(info.source, data, len, millis())) {
+        Serial.printf("Malformed heartbeat from %u\n", info.source);
+        return;
+    }
+
+    // Each cost unit above a clean path is roughly one more transmission, so one more timeout
+    uint32_t penaltyMs = 0;
+    if (distance != MeshTopology::UNREACHABLE) {
+        uint32_t excess = self->topology.getPathCost(info.source) - (uint32_t)distance * MESH_LINK_COST_UNIT;
+        if ((int32_t)excess > 0) {
+            penaltyMs = excess * MESH_RELIABLE_RTO_INITIAL_MS / MESH_LINK_COST_UNIT;
+        }
+    }
+    self->jobs.onHeartbeat(*self->peers.find(info.source), reachable, millis(), penaltyMs);
+}
+
+bool MeshNetworkManager::admitPeer(uint8_t distance) {
+    // Jobs are placed over reliable unicast, which stops at the hop limit
+    if (distance != MeshTopology::UNREACHABLE && distance > MAX_NETWORK_HOPS) {
+        return false;
+    }
+    if (peers.getPeerCount() < MESH_MAX_PEERS) {
+        return true;
+    }
+
+    // Replacing the longest-silent peer would cycle a mesh larger than the table through
+    // it, each newcomer unsynced until its next keyframe. A full table takes a node only
+    // in place of one that stopped beating, or, for a node within reach, one that is not.
+    const MeshPeerState* outOfReach = nullptr;
+    for (size_t i = 0; i < peers.getPeerCount(); i++) {
+        const MeshPeerState* peer = peers.getPeer(i);
+        if ((uint32_t)(millis() - peer->lastSeenMs) >= 3 * HEARTBEAT_MAX_INTERVAL) {
+            return true;
+        }
+        uint8_t held = topology.getHopDistance(peer->nodeId);
+        if (!outOfReach && (held == MeshTopology::UNREACHABLE || held > MAX_NETWORK_HOPS)) {
+            outOfReach = peer;
+        }
+    }
+    if (distance == MeshTopology::UNREACHABLE || !outOfReach) {
+        return false;
+    }
+    peers.remove(outOfReach->nodeId);
+    return true;
+}
+
+void MeshNetworkManager::handleJob(void* context, const MeshMessageInfo& info,
+                                   const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+
+    if (!self->jobs.receive(info.source, data, len, millis())) {
+        Serial.printf("Job message from %u rejected\n", info.source);
+    }
+}
+
+void MeshNetworkManager::flushJobs() {
+    // Placements, results and pull requests; a refused send is retried on the next pass
+    uint8_t message[MeshJobBalancer::MAX_MESSAGE];
+    size_t messageLen;
+    uint32_t destId;
+    while (jobs.nextOutgoing(millis(), &destId, message, sizeof(message), &messageLen)) {
+        bool sent = sendReliable(destId, MESH_MSG_JOB, message, messageLen, MESH_PRIORITY_SMS);
+        jobs.outgoingDone(sent, millis());
+        if (!sent) {
+            break;
+        }
+    }
+}
+
+void MeshNetworkManager::flushTime() {
+    // The master is the lowest node ID with a live heartbeat; we sync to our next hop toward it
+    uint32_t now = millis();
+    uint32_t self = mesh.getNodeId();
+    uint32_t master = self;
+    for (size_t i = 0; i < peers.getPeerCount(); i++) {
+        const MeshPeerState* peer = peers.getPeer(i);
+        if (peer->nodeId < master && peers.isAlive(peer->nodeId, now)) {
+            master = peer->nodeId;
+        }
+    }
+    timeSync.setUpstream(master, master == self ? 0 : nextHopFor(master), now);
+
+    uint8_t request[MeshTimeSync::MAX_MESSAGE];
+    size_t requestLen;
+    uint32_t destId;
+    if (timeSync.nextRequest(now, &destId, request, sizeof(request), &requestLen)) {
+        queueMessage(destId, MESH_MSG_TIME, request, requestLen, 0, MESH_PRIORITY_CONTROL);
+    }
 }
 
-void MeshNetworkManager::handleDataMessage(uint32_t from, const String& data, uint8_t hops) {
+void MeshNetworkManager::handleTime(void* context, const MeshMessageInfo& info,
+                                    const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+
+    // Requests are answered at once; the reply's frame header carries our transmit time
+    uint8_t reply[MeshTimeSync::MAX_MESSAGE];
+    size_t replyLen;
+    if (self->timeSync.receive(info.source, info.sentMs, info.receivedMs, data, len,
+                               reply, sizeof(reply), &replyLen) && replyLen > 0) {
+        self->queueMessage(info.source, MESH_MSG_TIME, reply, replyLen, 0, MESH_PRIORITY_CONTROL);
+    }
+}
+
+void MeshNetworkManager::flushLatency() {
+    if (latencyCollector == 0 || latencyCollector == mesh.getNodeId() ||
+        millis() - lastLatencyReport < MESH_LATENCY_REPORT_MS) {
+        return;
+    }
+
+    // A report too big for one buffer carries the series that fit; the rest wait for a reset
+    MeshBuffer report = buffers.acquire(MESH_BUFFER_LARGE_SIZE);
+    if (!report) {
+        return;
+    }
+    lastLatencyReport = millis();
+    size_t reportLen;
+    if (receiveLatency().encodeReport(report.data(), report.capacity(), &reportLen)) {
+        queueMessage(latencyCollector, MESH_MSG_LATENCY, report.data(), reportLen, 0, MESH_PRIORITY_TELEMETRY);
+    }
+}
+
+void MeshNetworkManager::flushLinks() {
+    uint32_t now = millis();
+    uint8_t probe[MeshLinkQuality::PROBE_SIZE];
+    size_t probeLen;
+    uint32_t destId;
+    while (links.nextProbe(now, &destId, probe, sizeof(probe), &probeLen)) {
+        queueMessage(destId, MESH_MSG_LINK_PROBE, probe, probeLen, 0, MESH_PRIORITY_CONTROL);
+    }
+
+    // Costs that left the hysteresis band go out with the next link-state advert
+    uint8_t cost;
+    while (links.nextCostChange(now, &destId, &cost)) {
+        if (topology.setLinkCost(destId, cost)) {
+            linkStateChanged = true;
+        }
+    }
+}
+
+void MeshNetworkManager::handleLinkProbe(void* context, const MeshMessageInfo& info,
+                                         const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+
+    // Only probes straight from the neighbor say anything about our link to it
+    if (info.from != info.source || !self->links.onProbe(info.source, data, len, info.receivedMs)) {
+        Serial.printf("Link probe from %u via %u ignored\n", info.source, info.from);
+    }
+}
+
+void MeshNetworkManager::sendLinkState() {
+    uint8_t advert[MeshTopology::MAX_ADVERT_SIZE];
+    size_t advertLen;
+    if (!topology.encodeLinkState(advert, sizeof(advert), &advertLen)) {
+        return;
+    }
+
+    queueMessage(MeshWireFrame::BROADCAST_DEST, MESH_MSG_LINK_STATE, advert, advertLen,
+                 0, MESH_PRIORITY_CONTROL);
+}
+
+void MeshNetworkManager::sendSubscriptions() {
+    uint8_t advert[MeshSubscriptions::ADVERT_SIZE];
+    size_t advertLen;
+    if (!subscriptions.encodeAdvert(advert, sizeof(advert), &advertLen)) {
+        return;
+    }
+
+    queueMessage(MeshWireFrame::BROADCAST_DEST, MESH_MSG_SUBSCRIPTION, advert, advertLen,
+                 0, MESH_PRIORITY_CONTROL);
+    lastSubscriptionAdvert = millis();
+    advertisedReach = topology.getReachableCount();
+}
+
+void MeshNetworkManager::handleSubscription(void* context, const MeshMessageInfo& info,
+                                            const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+    if (!self->subscriptions.applyAdvert(info.source, data, len, millis())) {
+        Serial.printf("Malformed subscription advert from %u\n", info.source);
+    }
+}
+
+void MeshNetworkManager::handleLinkState(void* context, const MeshMessageInfo& info,
+                                         const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+
+    // Graph is only marked dirty; routes are rebuilt on the next query
+    if (!self->topology.applyLinkState(info.source, data, len, millis())) {
+        Serial.printf("Malformed link-state advert from %u\n", info.source);
+    }
+}
+
+void MeshNetworkManager::handleAck(void* context, const MeshMessageInfo& info,
+                                   const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+    self->reliable.onAck(info.source, data, len, millis());
+}
+
+void MeshNetworkManager::handleCredit(void* context, const MeshMessageInfo& info,
+                                      const uint8_t* data, size_t len) {
+    MeshNetworkManager* self = (MeshNetworkManager*)context;
+    MeshLockGuard guard(self->stateLock);
+    self->flow.onGrant(info.source, data, len, millis());
+}
+
+void MeshNetworkManager::handleDataMessage(void* context, const MeshMessageInfo& info,
+                                           const uint8_t* data, size_t len) {
     // Process data message
-    Serial.printf("Data from %u (hops: %d): %s\n", from, hops, data.c_str());
+    Serial.printf("Data from %u (hops: %d): %.*s\n", info.source, info.hops, (int)len, (const char*)data);
 }
 
-void MeshNetworkManager::handleCommand(uint32_t from, const String& command, uint8_t hops) {
+void MeshNetworkManager::handleCommand(void* context, const MeshMessageInfo& info,
+                                       const uint8_t* data, size_t len) {
     // Process command
-    Serial.printf("Command from %u (hops: %d): %s\n", from, hops, command.c_str());
+    Serial.printf("Command from %u (hops: %d): %.*s\n", info.source, info.hops, (int)len, (const char*)data);
 }
 
 uint32_t MeshNetworkManager::getNodeId() {
@@ -213,9 +1174,270 @@ uint32_t MeshNetworkManager::getNodeId() {
 }
 
 size_t MeshNetworkManager::getNodeCount() {
-    return nodeCount;
+    MeshLockGuard guard(stateLock);
+    return topology.getReachableCount();
 }
 
 bool MeshNetworkManager::isNetworkConnected() {
-    return isConnected;
+    MeshLockGuard guard(stateLock);
+    return topology.getNeighborCount() > 0;
+}
+
+MeshSeenCacheStats MeshNetworkManager::getSeenCacheStats() {
+    MeshLockGuard guard(stateLock);
+    return rxTask ? rxPublished.seenCache : seenCache.getStats();
+}
+
+MeshQueueStats MeshNetworkManager::getQueueStats(MeshPriority priority) {
+    MeshLockGuard guard(stateLock);
+    return outbound.getStats(priority);
+}
+
+bool MeshNetworkManager::registerHandler(uint8_t type, MeshMessageHandler handler, void* context) {
+    // Batch, reliable, fragment and stored framing are unpacked before dispatch and cannot be overridden
+    if (type == MESH_MSG_INVALID || type == MESH_MSG_BATCH || type == MESH_MSG_RELIABLE ||
+        type == MESH_MSG_FRAGMENT || type == MESH_MSG_STORED) {
+        return false;
+    }
+    return dispatcher.registerHandler(type, handler, context);
+}
+
+MeshHandlerStats MeshNetworkManager::getHandlerStats(uint8_t type) {
+    MeshLockGuard guard(stateLock);
+    if (!rxTask || type >= MESH_DISPATCH_TABLE_SIZE) {
+        return dispatcher.getStats(type);
+    }
+    return rxPublished.handlers[type];
+}
+
+bool MeshNetworkManager::subscribe(const char* topic) {
+    MeshLockGuard guard(stateLock);
+    if (!subscriptions.subscribe(MeshSubscriptions::topicId(topic))) {
+        return false;
+    }
+    sendSubscriptions();
+    return true;
+}
+
+bool MeshNetworkManager::unsubscribe(const char* topic) {
+    MeshLockGuard guard(stateLock);
+    if (!subscriptions.unsubscribe(MeshSubscriptions::topicId(topic))) {
+        return false;
+    }
+    sendSubscriptions();
+    return true;
+}
+
+bool MeshNetworkManager::publish(const char* topic, const String& message, MeshPriority priority) {
+    return publish(topic, MESH_MSG_DATA, (const uint8_t*)message.c_str(), message.length(), priority);
+}
+
+bool MeshNetworkManager::publish(const char* topic, uint8_t type, const uint8_t* data, size_t len,
+                                 MeshPriority priority) {
+    uint32_t topicId = MeshSubscriptions::topicId(topic);
+    MeshLockGuard guard(stateLock);
+
+    // With no subscriber anywhere there is nothing to send; that is not a failure.
+    // Our own subscription is not looped back.
+    size_t routeCount = topology.getNodesWithin(MeshTopology::UNREACHABLE - 1, topicRoutes, MESH_TOPOLOGY_MAX_NODES);
+    if (!subscriptions.hasSubscribers(topicId, topicRoutes, routeCount, MAX_NETWORK_HOPS)) {
+        return true;
+    }
+
+    return queueMessage(topicId, type, data, len, 0, priority, MeshWireFrame::FLAG_TOPIC);
+}
+
+MeshPubSubStats MeshNetworkManager::getPubSubStats() {
+    MeshLockGuard guard(stateLock);
+    return subscriptions.getStats();
+}
+
+bool MeshNetworkManager::getLatency(MeshLatencyStage stage, uint8_t type, uint8_t hops,
+                                    MeshLatencyHistogram* output) {
+    MeshLockGuard guard(stateLock);
+    return receiveLatency().get(stage, type, hops, output);
+}
+
+size_t MeshNetworkManager::getLatencySeries(MeshLatencyKey* output, size_t outputCap) {
+    MeshLockGuard guard(stateLock);
+    return receiveLatency().getKeys(output, outputCap);
+}
+
+MeshLatencyStats MeshNetworkManager::getLatencyStats() {
+    MeshLockGuard guard(stateLock);
+    return receiveLatency().getStats();
+}
+
+void MeshNetworkManager::setLatencyCollector(uint32_t nodeId) {
+    MeshLockGuard guard(stateLock);
+    latencyCollector = nodeId;
+}
+
+uint8_t MeshNetworkManager::getHopDistance(uint32_t nodeId) {
+    MeshLockGuard guard(stateLock);
+    return topology.getHopDistance(nodeId);
+}
+
+uint16_t MeshNetworkManager::getPathCost(uint32_t nodeId) {
+    MeshLockGuard guard(stateLock);
+    return topology.getPathCost(nodeId);
+}
+
+MeshLinkStats MeshNetworkManager::getLinkStats(uint32_t nodeId) {
+    MeshLockGuard guard(stateLock);
+    return links.getStats(nodeId, millis());
+}
+
+size_t MeshNetworkManager::getLinks(MeshLinkStats* output, size_t outputCap) {
+    MeshLockGuard guard(stateLock);
+    return links.getLinks(output, outputCap, millis());
+}
+
+size_t MeshNetworkManager::getNodesWithin(uint8_t maxHops, MeshRouteEntry* output, size_t outputCap) {
+    MeshLockGuard guard(stateLock);
+    return topology.getNodesWithin(maxHops, output, outputCap);
+}
+
+bool MeshNetworkManager::setNodeLoad(uint32_t nodeId, uint8_t load) {
+    MeshLockGuard guard(stateLock);
+    return topology.setLoad(nodeId, load);
+}
+
+uint32_t MeshNetworkManager::findLeastLoadedNode(uint8_t maxHops, bool includeSelf) {
+    MeshLockGuard guard(stateLock);
+    return topology.findLeastLoaded(maxHops, includeSelf);
+}
+
+MeshTopologyStats MeshNetworkManager::getTopologyStats() {
+    MeshLockGuard guard(stateLock);
+    return topology.getStats();
+}
+
+MeshReliableStats MeshNetworkManager::getReliableStats() {
+    MeshLockGuard guard(stateLock);
+    return reliable.getStats();
+}
+
+MeshStoreStats MeshNetworkManager::getStoreStats() {
+    MeshLockGuard guard(stateLock);
+    return store.getStats(millis());
+}
+
+size_t MeshNetworkManager::getStoreDepth(MeshPriority priority) {
+    MeshLockGuard guard(stateLock);
+    return store.getDepth(priority);
+}
+
+MeshReassemblyStats MeshNetworkManager::getReassemblyStats() {
+    MeshLockGuard guard(stateLock);
+    return rxTask ? rxPublished.reassembly : reassembler.getStats();
+}
+
+bool MeshNetworkManager::setCompressionDictionary(uint8_t type, const uint8_t* dictionary, size_t len) {
+    return compressor.setDictionary(type, dictionary, len);
+}
+
+MeshCompressionStats MeshNetworkManager::getCompressionStats() {
+    // loop() compresses and the worker decompresses, each into its own counters
+    MeshLockGuard guard(stateLock);
+    if (!rxTask) {
+        return compressor.getStats();
+    }
+    MeshCompressionStats result = compressor.getEncodeStats();
+    result.decompressed = rxPublished.decompression.decompressed;
+    result.decompressFailures = rxPublished.decompression.decompressFailures;
+    return result;
+}
+
+MeshBufferPoolStats MeshNetworkManager::getBufferStats(MeshBufferClass bufferClass) {
+    MeshLockGuard guard(stateLock);
+    return buffers.getStats(bufferClass);
+}
+
+MeshReceiveRingStats MeshNetworkManager::getReceiveStats() {
+    return rxRing.getStats();
+}
+
+MeshFlowStats MeshNetworkManager::getFlowStats(uint32_t nodeId) {
+    MeshLockGuard guard(stateLock);
+    return flow.getStats(nodeId);
+}
+
+size_t MeshNetworkManager::getFlowPeers(MeshFlowStats* output, size_t outputCap) {
+    MeshLockGuard guard(stateLock);
+    return flow.getPeers(output, outputCap);
+}
+
+void MeshNetworkManager::setSimStatus(uint32_t activeMask) {
+    MeshLockGuard guard(stateLock);
+    simActiveMask = activeMask;
+
+    // Placement sees SIM changes at once; the heap figure is refreshed with each heartbeat
+    uint32_t heapBucket = ESP.getFreeHeap() / 4096;
+    jobs.setLocalCapacity(heapBucket > 255 ? 255 : heapBucket, activeMask);
+}
+
+bool MeshNetworkManager::submitSmsJob(const uint8_t* body, size_t len, uint32_t* jobId) {
+    MeshLockGuard guard(stateLock);
+    return jobs.submit(body, len, millis(), jobId);
+}
+
+bool MeshNetworkManager::takeSmsJob(MeshSmsJob* job) {
+    MeshLockGuard guard(stateLock);
+    return jobs.takeJob(millis(), job);
+}
+
+bool MeshNetworkManager::completeSmsJob(const MeshSmsJob& job, bool sent, uint32_t sendMs) {
+    MeshLockGuard guard(stateLock);
+    return jobs.completeJob(job.jobId, job.submitter, sent, sendMs, millis());
+}
+
+uint32_t MeshNetworkManager::getJobCoordinator() {
+    MeshLockGuard guard(stateLock);
+    return jobs.getCoordinator(millis());
+}
+
+MeshJobStats MeshNetworkManager::getJobStats() {
+    MeshLockGuard guard(stateLock);
+    return jobs.getStats(millis());
+}
+
+size_t MeshNetworkManager::getJobDecisions(MeshJobDecision* output, size_t outputCap) {
+    MeshLockGuard guard(stateLock);
+    return jobs.getDecisions(output, outputCap);
+}
+
+bool MeshNetworkManager::getMeshTime(uint32_t* meshMs, uint32_t* errorMs) {
+    MeshLockGuard guard(stateLock);
+    return timeSync.now(millis(), meshMs, errorMs);
+}
+
+uint32_t MeshNetworkManager::toMeshTime(uint32_t localMs) {
+    MeshLockGuard guard(stateLock);
+    return timeSync.toMesh(localMs);
+}
+
+MeshTimeStats MeshNetworkManager::getTimeStats() {
+    MeshLockGuard guard(stateLock);
+    return timeSync.getStats(millis());
+}
+
+uint32_t MeshNetworkManager::meshClock(void* context) {
+    uint32_t meshMs;
+    ((MeshNetworkManager*)context)->getMeshTime(&meshMs);
+    return meshMs;
+}
+
+const MeshPeerState* MeshNetworkManager::getPeerState(uint32_t nodeId) {
+    MeshLockGuard guard(stateLock);
+    return peers.find(nodeId);
+}
+
+size_t MeshNetworkManager::getSyncedPeerCount() {
+    MeshLockGuard guard(stateLock);
+    size_t synced = 0;
+    for (size_t i = 0; i < peers.getPeerCount(); i++) {
+        if (peers.getPeer(i)->synced) synced++;
+    }
+    return synced;
 }
\ No newline at end of file
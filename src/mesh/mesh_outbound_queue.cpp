@@ -0,0 +1,258 @@
+// Mesh Outbound Queue - Priority scheduling and frame coalescing
+#include <string.h>
+#include "mesh_outbound_queue.h"
+#include "mesh_wire_frame.h"
+
+MeshOutboundQueue::MeshOutboundQueue() {
+    memset(queues, 0, sizeof(queues));
+}
+
+bool MeshOutboundQueue::enqueue(uint32_t dest, uint8_t type, const uint8_t* data, size_t len,
+                                uint8_t hops, MeshPriority priority, uint32_t nowMs, uint8_t flags) {
+    if (priority >= MESH_PRIORITY_COUNT || len > MESH_OUTBOUND_MAX_RECORD || (len > 0 && !data)) {
+        return false;
+    }
+
+    ClassQueue& queue = queues[priority];
+
+    // Slots freed by out-of-order coalescing are reclaimed only when needed
+    if (queue.count == MESH_OUTBOUND_QUEUE_DEPTH && queue.stats.depth < queue.count) {
+        uint8_t write = 0;
+        for (uint8_t i = 0; i < queue.count; i++) {
+            Entry& entry = queue.entries[(queue.head + i) % MESH_OUTBOUND_QUEUE_DEPTH];
+            if (!entry.live) continue;
+            uint8_t slot = (queue.head + write) % MESH_OUTBOUND_QUEUE_DEPTH;
+            if (&queue.entries[slot] != &entry) {
+                queue.entries[slot] = entry;
+                entry.live = false;
+            }
+            write++;
+        }
+        queue.count = write;
+    }
+
+    if (queue.count == MESH_OUTBOUND_QUEUE_DEPTH) {
+        queue.stats.dropped++;
+        return false;
+    }
+
+    Entry& entry = queue.entries[(queue.head + queue.count) % MESH_OUTBOUND_QUEUE_DEPTH];
+    entry.dest = dest;
+    entry.enqueuedMs = nowMs;
+    entry.length = len;
+    entry.type = type;
+    entry.hops = hops;
+    entry.flags = flags;
+    entry.live = true;
+    if (len > 0) {
+        memcpy(entry.data, data, len);
+    }
+
+    queue.count++;
+    queue.stats.depth++;
+    queue.stats.enqueued++;
+    if (queue.stats.depth > queue.stats.highWater) {
+        queue.stats.highWater = queue.stats.depth;
+    }
+    return true;
+}
+
+MeshOutboundQueue::Entry* MeshOutboundQueue::headEntry(ClassQueue& queue) {
+    // take() keeps the head pointed at a live entry
+    return queue.count > 0 ? &queue.entries[queue.head] : nullptr;
+}
+
+MeshOutboundQueue::Entry* MeshOutboundQueue::firstSendable(ClassQueue& queue, MeshSendFilter filter,
+                                                            void* filterContext) {
+    // Oldest message whose destination is open; order per destination is kept
+    for (uint8_t i = 0; i < queue.count; i++) {
+        Entry& entry = queue.entries[(queue.head + i) % MESH_OUTBOUND_QUEUE_DEPTH];
+        if (entry.live && filter(filterContext, entry.dest)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+size_t MeshOutboundQueue::pendingBytesFor(const Entry& lead) {
+    size_t total = 0;
+    for (size_t p = 0; p < MESH_PRIORITY_COUNT; p++) {
+        ClassQueue& queue = queues[p];
+        for (uint8_t i = 0; i < queue.count; i++) {
+            const Entry& entry = queue.entries[(queue.head + i) % MESH_OUTBOUND_QUEUE_DEPTH];
+            if (entry.live && entry.dest == lead.dest && entry.hops == lead.hops && entry.flags == lead.flags) {
+                total += RECORD_OVERHEAD + entry.length;
+            }
+        }
+    }
+    return total;
+}
+
+bool MeshOutboundQueue::isDue(MeshPriority priority, const Entry& entry, uint32_t nowMs) {
+    // Control and SMS jobs never wait; bulk traffic waits for company or its deadline
+    if (priority <= MESH_PRIORITY_SMS) {
+        return true;
+    }
+    if ((uint32_t)(nowMs - entry.enqueuedMs) >= MESH_COALESCE_DELAY_MS) {
+        return true;
+    }
+    return pendingBytesFor(entry) >= MESH_COALESCE_MAX_BYTES;
+}
+
+size_t MeshOutboundQueue::waitBucket(uint32_t waitMs) {
+    size_t bucket = 0;
+    while (waitMs > 0 && bucket < MESH_WAIT_HISTOGRAM_BUCKETS - 1) {
+        waitMs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void MeshOutboundQueue::take(ClassQueue& queue, Entry& entry, uint32_t nowMs) {
+    entry.live = false;
+    queue.stats.depth--;
+    queue.stats.sent++;
+    queue.stats.waitHistogram[waitBucket(nowMs - entry.enqueuedMs)]++;
+
+    // Advance past anything already consumed
+    while (queue.count > 0 && !queue.entries[queue.head].live) {
+        queue.head = (queue.head + 1) % MESH_OUTBOUND_QUEUE_DEPTH;
+        queue.count--;
+    }
+}
+
+MeshOutboundQueue::Entry* MeshOutboundQueue::findCoalescable(const MeshOutboundFrame& frame, size_t room,
+                                                             bool controlOnly, ClassQueue** owner) {
+    size_t classes = controlOnly ? MESH_PRIORITY_CONTROL + 1 : MESH_PRIORITY_COUNT;
+    for (size_t p = 0; p < classes; p++) {
+        ClassQueue& queue = queues[p];
+        for (uint8_t i = 0; i < queue.count; i++) {
+            Entry& entry = queue.entries[(queue.head + i) % MESH_OUTBOUND_QUEUE_DEPTH];
+            if (entry.live && entry.dest == frame.dest && entry.hops == frame.hops && entry.flags == frame.flags &&
+                RECORD_OVERHEAD + entry.length <= room) {
+                *owner = &queue;
+                return &entry;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool MeshOutboundQueue::nextFrame(uint32_t nowMs, MeshOutboundFrame* frame, uint8_t* buffer, size_t bufferCap,
+                                  MeshSendFilter filter, void* filterContext) {
+    if (!frame || !buffer || bufferCap < RECORD_OVERHEAD + MESH_OUTBOUND_MAX_RECORD) {
+        return false;
+    }
+
+    // Highest-priority class with a due head entry leads the frame
+    ClassQueue* leadQueue = nullptr;
+    Entry* lead = nullptr;
+    for (size_t p = 0; p < MESH_PRIORITY_COUNT && !lead; p++) {
+        // Control traffic is never held back
+        Entry* head = (filter && p != MESH_PRIORITY_CONTROL) ?
+            firstSendable(queues[p], filter, filterContext) : headEntry(queues[p]);
+        if (head && isDue((MeshPriority)p, *head, nowMs)) {
+            leadQueue = &queues[p];
+            lead = head;
+        }
+    }
+
+    if (!lead) {
+        return false;
+    }
+
+    frame->dest = lead->dest;
+    frame->lowestPriority = MESH_PRIORITY_CONTROL;
+    frame->hops = lead->hops;
+    frame->flags = lead->flags;
+    frame->type = lead->type;
+    frame->records = 0;
+    frame->length = 0;
+
+    size_t budget = bufferCap < MESH_COALESCE_MAX_BYTES ? bufferCap : MESH_COALESCE_MAX_BYTES;
+    if (budget < RECORD_OVERHEAD + lead->length) {
+        budget = RECORD_OVERHEAD + lead->length;
+    }
+
+    // A control message to a blocked destination must not carry held traffic along
+    bool blocked = filter && !filter(filterContext, lead->dest);
+
+    // Lead record first, then other messages to the same destination in priority order
+    Entry* record = lead;
+    ClassQueue* owner = leadQueue;
+    while (record) {
+        uint8_t* out = buffer + frame->length;
+        out[0] = record->type;
+        out[1] = (uint8_t)record->length;
+        out[2] = (uint8_t)(record->length >> 8);
+        memcpy(out + RECORD_OVERHEAD, record->data, record->length);
+        frame->length += RECORD_OVERHEAD + record->length;
+        frame->records++;
+        MeshPriority priority = (MeshPriority)(owner - queues);
+        if (priority > frame->lowestPriority) {
+            frame->lowestPriority = priority;
+        }
+        take(*owner, *record, nowMs);
+
+        record = findCoalescable(*frame, budget - frame->length, blocked, &owner);
+    }
+
+    // A lone message goes out as itself, without batch framing
+    if (frame->records == 1) {
+        frame->length -= RECORD_OVERHEAD;
+        memmove(buffer, buffer + RECORD_OVERHEAD, frame->length);
+    } else {
+        frame->type = MESH_MSG_BATCH;
+    }
+
+    return true;
+}
+
+bool MeshOutboundQueue::nextRecord(const uint8_t* batch, size_t batchLen, size_t* offset,
+                                   uint8_t* type, const uint8_t** data, size_t* dataLen) {
+    if (!batch || !offset || !type || !data || !dataLen) {
+        return false;
+    }
+
+    if (*offset + RECORD_OVERHEAD > batchLen) {
+        return false;
+    }
+
+    const uint8_t* record = batch + *offset;
+    size_t len = record[1] | (record[2] << 8);
+    if (*offset + RECORD_OVERHEAD + len > batchLen) {
+        return false;
+    }
+
+    *type = record[0];
+    *data = record + RECORD_OVERHEAD;
+    *dataLen = len;
+    *offset += RECORD_OVERHEAD + len;
+    return true;
+}
+
+bool MeshOutboundQueue::isEmpty() {
+    for (size_t p = 0; p < MESH_PRIORITY_COUNT; p++) {
+        if (queues[p].stats.depth > 0) return false;
+    }
+    return true;
+}
+
+size_t MeshOutboundQueue::getDepth(MeshPriority priority) {
+    return priority < MESH_PRIORITY_COUNT ? queues[priority].stats.depth : 0;
+}
+
+MeshQueueStats MeshOutboundQueue::getStats(MeshPriority priority) {
+    MeshQueueStats empty;
+    memset(&empty, 0, sizeof(empty));
+    return priority < MESH_PRIORITY_COUNT ? queues[priority].stats : empty;
+}
+
+void MeshOutboundQueue::resetStats() {
+    for (size_t p = 0; p < MESH_PRIORITY_COUNT; p++) {
+        uint32_t depth = queues[p].stats.depth;
+        memset(&queues[p].stats, 0, sizeof(queues[p].stats));
+        queues[p].stats.depth = depth;
+        queues[p].stats.highWater = depth;
+    }
+}
@@ -0,0 +1,237 @@
+// Mesh Publish/Subscribe - Topic digests and subscriber-aware forwarding
+#include <string.h>
+#include "mesh_pubsub.h"
+#include "mesh_bytes.h"
+
+static const uint32_t DIGEST_BITS = MESH_TOPIC_DIGEST_BYTES * 8;
+
+MeshSubscriptions::MeshSubscriptions() : localCount(0), version(0), forwardedNext(0) {
+    memset(local, 0, sizeof(local));
+    memset(digest, 0, sizeof(digest));
+    memset(remotes, 0, sizeof(remotes));
+    memset(forwardedSource, 0, sizeof(forwardedSource));
+    memset(forwardedSeq, 0, sizeof(forwardedSeq));
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t MeshSubscriptions::topicId(const char* name) {
+    // FNV-1a; 0 is kept free to mean "no topic"
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; c && *c; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+void MeshSubscriptions::digestAdd(uint8_t* target, uint32_t topicId) {
+    uint32_t h1 = topicId % DIGEST_BITS;
+    uint32_t h2 = (topicId >> 16) % DIGEST_BITS;
+    target[h1 >> 3] |= 1 << (h1 & 7);
+    target[h2 >> 3] |= 1 << (h2 & 7);
+}
+
+bool MeshSubscriptions::digestHas(const uint8_t* target, uint32_t topicId) {
+    uint32_t h1 = topicId % DIGEST_BITS;
+    uint32_t h2 = (topicId >> 16) % DIGEST_BITS;
+    return (target[h1 >> 3] & (1 << (h1 & 7))) && (target[h2 >> 3] & (1 << (h2 & 7)));
+}
+
+void MeshSubscriptions::rebuildDigest() {
+    // Bloom bits cannot be cleared one topic at a time, so the digest is rebuilt on every change
+    memset(digest, 0, sizeof(digest));
+    for (size_t i = 0; i < localCount; i++) {
+        digestAdd(digest, local[i]);
+    }
+    version++;
+}
+
+bool MeshSubscriptions::subscribe(uint32_t topicId) {
+    if (topicId == 0 || isSubscribed(topicId) || localCount == MESH_TOPIC_MAX_LOCAL) {
+        return false;
+    }
+    local[localCount++] = topicId;
+    rebuildDigest();
+    return true;
+}
+
+bool MeshSubscriptions::unsubscribe(uint32_t topicId) {
+    for (size_t i = 0; i < localCount; i++) {
+        if (local[i] == topicId) {
+            local[i] = local[--localCount];
+            rebuildDigest();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MeshSubscriptions::isSubscribed(uint32_t topicId) {
+    for (size_t i = 0; i < localCount; i++) {
+        if (local[i] == topicId) return true;
+    }
+    return false;
+}
+
+bool MeshSubscriptions::encodeAdvert(uint8_t* output, size_t outputCap, size_t* outputLen) {
+    // Nodes that never subscribed stay silent; an absent digest already means "nothing here"
+    if (!output || !outputLen || outputCap < ADVERT_SIZE || version == 0) {
+        return false;
+    }
+
+    putU16(output, version);
+    memcpy(output + 2, digest, MESH_TOPIC_DIGEST_BYTES);
+    *outputLen = ADVERT_SIZE;
+    return true;
+}
+
+MeshSubscriptions::Remote* MeshSubscriptions::findRemote(uint32_t nodeId) {
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        if (remotes[i].nodeId == nodeId) return &remotes[i];
+    }
+    return nullptr;
+}
+
+bool MeshSubscriptions::applyAdvert(uint32_t origin, const uint8_t* data, size_t len, uint32_t nowMs) {
+    if (!data || len != ADVERT_SIZE || origin == 0) {
+        return false;
+    }
+
+    uint16_t advertVersion = getU16(data);
+    Remote* remote = findRemote(origin);
+    if (!remote) {
+        remote = meshOldestSlot(remotes, MESH_TOPOLOGY_MAX_NODES, &Remote::updatedMs);
+        memset(remote, 0, sizeof(Remote));
+        remote->nodeId = origin;
+        remote->version = advertVersion - 1;
+    }
+    remote->updatedMs = nowMs;
+
+    // Refreshes repeat the version; versions restart on reboot, so any difference counts as new
+    if (remote->version == advertVersion) {
+        return true;
+    }
+    remote->version = advertVersion;
+    memcpy(remote->digest, data + 2, MESH_TOPIC_DIGEST_BYTES);
+    stats.advertsApplied++;
+    return true;
+}
+
+void MeshSubscriptions::expire(uint32_t nowMs) {
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        if (remotes[i].nodeId != 0 && (uint32_t)(nowMs - remotes[i].updatedMs) >= MESH_LINK_STATE_MAX_AGE_MS) {
+            memset(&remotes[i], 0, sizeof(Remote));
+        }
+    }
+}
+
+bool MeshSubscriptions::mayReach(uint32_t nodeId, uint32_t topicId) {
+    Remote* remote = findRemote(nodeId);
+    return remote && remote->nodeId != 0 && digestHas(remote->digest, topicId);
+}
+
+uint32_t MeshSubscriptions::branchFor(uint32_t nodeId, const MeshRouteEntry* routes, size_t routeCount,
+                                      uint8_t maxHops, bool* routed) {
+    for (size_t i = 0; i < routeCount; i++) {
+        if (routes[i].nodeId == nodeId) {
+            *routed = true;
+            return routes[i].hops <= maxHops ? routes[i].nextHop : 0;
+        }
+    }
+    *routed = false;
+    return nodeId;
+}
+
+bool MeshSubscriptions::hasSubscribers(uint32_t topicId, const MeshRouteEntry* routes, size_t routeCount,
+                                       uint8_t maxHops) {
+    for (size_t i = 0; routes && i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        const Remote& remote = remotes[i];
+        bool routed;
+        if (remote.nodeId != 0 && digestHas(remote.digest, topicId) &&
+            branchFor(remote.nodeId, routes, routeCount, maxHops, &routed) != 0) {
+            return true;
+        }
+    }
+    stats.unrouted++;
+    return false;
+}
+
+size_t MeshSubscriptions::selectBranches(uint32_t topicId, uint32_t exclude, const MeshRouteEntry* routes,
+                                         size_t routeCount, uint8_t maxHops, uint32_t* branches, size_t branchCap) {
+    if (!routes || !branches) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        const Remote& remote = remotes[i];
+        if (remote.nodeId == 0 || remote.nodeId == exclude || !digestHas(remote.digest, topicId)) {
+            continue;
+        }
+
+        // Self (next hop 0) and anything routed back the way the frame came are skipped.
+        // Only the publisher names unrouted subscribers directly; relays doing the same
+        // would each send them another copy.
+        bool routed;
+        uint32_t via = branchFor(remote.nodeId, routes, routeCount, maxHops, &routed);
+        if (via == 0 || via == exclude || (!routed && exclude != 0)) {
+            continue;
+        }
+
+        bool listed = false;
+        for (size_t b = 0; b < count && !listed; b++) {
+            listed = branches[b] == via;
+        }
+        if (!listed && count < branchCap) {
+            branches[count++] = via;
+        }
+    }
+
+    // Neighbors not chosen are the broadcast copies this saved
+    size_t neighbors = 0;
+    for (size_t i = 0; i < routeCount; i++) {
+        if (routes[i].hops == 1 && routes[i].nodeId != exclude) neighbors++;
+    }
+    stats.branchesUsed += count;
+    stats.branchesPruned += neighbors > count ? neighbors - count : 0;
+    return count;
+}
+
+bool MeshSubscriptions::firstCopy(uint32_t source, uint32_t seq) {
+    for (size_t i = 0; i < MESH_TOPIC_FORWARD_MEMORY; i++) {
+        if (forwardedSource[i] == source && forwardedSeq[i] == seq) {
+            stats.duplicatesDropped++;
+            return false;
+        }
+    }
+
+    forwardedSource[forwardedNext] = source;
+    forwardedSeq[forwardedNext] = seq;
+    forwardedNext = (forwardedNext + 1) % MESH_TOPIC_FORWARD_MEMORY;
+    return true;
+}
+
+bool MeshSubscriptions::deliverLocally(uint32_t topicId) {
+    if (isSubscribed(topicId)) {
+        stats.delivered++;
+        return true;
+    }
+    stats.passedThrough++;
+    return false;
+}
+
+MeshPubSubStats MeshSubscriptions::getStats() {
+    MeshPubSubStats result = stats;
+    result.localTopics = localCount;
+    result.knownSubscribers = 0;
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        if (remotes[i].nodeId == 0) continue;
+        for (size_t b = 0; b < MESH_TOPIC_DIGEST_BYTES; b++) {
+            if (remotes[i].digest[b] != 0) {
+                result.knownSubscribers++;
+                break;
+            }
+        }
+    }
+    return result;
+}
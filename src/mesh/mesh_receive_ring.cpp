@@ -0,0 +1,109 @@
+// Mesh Receive Ring - Lock-free hand-off of received frames to the worker
+#include "mesh_receive_ring.h"
+
+MeshReceiveRing::MeshReceiveRing() : enqueuePos(0), dequeuePos(0) {
+    // A slot is free for the producer whose ticket equals its sequence
+    for (uint32_t i = 0; i < MESH_RX_RING_SLOTS; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    resetStats();
+    highWater.store(0, std::memory_order_relaxed);
+}
+
+MeshReceiveSlot* MeshReceiveRing::beginPush() {
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[pos & MASK];
+        uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(sequence - pos);
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.slot.ticket = pos;
+                return &cell.slot;
+            }
+        } else if (diff < 0) {
+            // The consumer has not released this slot from the previous lap
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void MeshReceiveRing::commitPush(MeshReceiveSlot* slot, uint32_t nowUs) {
+    slot->enqueuedUs = nowUs;
+    if (slot->length > 0) {
+        enqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t depth = slot->ticket + 1 - dequeuePos.load(std::memory_order_relaxed);
+    uint32_t peak = highWater.load(std::memory_order_relaxed);
+    while (depth > peak && !highWater.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+        // A failed exchange reloads peak; retry only while this depth is still higher
+    }
+
+    cells[slot->ticket & MASK].sequence.store(slot->ticket + 1, std::memory_order_release);
+}
+
+MeshReceiveSlot* MeshReceiveRing::front() {
+    uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell& cell = cells[pos & MASK];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return nullptr;
+    }
+    return &cell.slot;
+}
+
+size_t MeshReceiveRing::latencyBucket(uint32_t latencyUs) {
+    size_t bucket = 0;
+    while (latencyUs > 0 && bucket < MESH_RX_LATENCY_BUCKETS - 1) {
+        latencyUs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void MeshReceiveRing::pop(uint32_t nowUs) {
+    uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell& cell = cells[pos & MASK];
+
+    if (cell.slot.length > 0) {
+        uint32_t latency = nowUs - cell.slot.enqueuedUs;
+        dispatched.fetch_add(1, std::memory_order_relaxed);
+        latencyHistogram[latencyBucket(latency)].fetch_add(1, std::memory_order_relaxed);
+        if (latency > maxLatencyUs.load(std::memory_order_relaxed)) {
+            maxLatencyUs.store(latency, std::memory_order_relaxed);
+        }
+    }
+
+    // Hand the slot back to producers for the next lap
+    cell.sequence.store(pos + MESH_RX_RING_SLOTS, std::memory_order_release);
+    dequeuePos.store(pos + 1, std::memory_order_relaxed);
+}
+
+MeshReceiveRingStats MeshReceiveRing::getStats() {
+    MeshReceiveRingStats stats;
+    stats.depth = enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
+    stats.highWater = highWater.load(std::memory_order_relaxed);
+    stats.enqueued = enqueued.load(std::memory_order_relaxed);
+    stats.dispatched = dispatched.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.maxLatencyUs = maxLatencyUs.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < MESH_RX_LATENCY_BUCKETS; i++) {
+        stats.latencyHistogram[i] = latencyHistogram[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void MeshReceiveRing::resetStats() {
+    // Depth and high-water mark describe the ring itself and are kept
+    enqueued.store(0, std::memory_order_relaxed);
+    dispatched.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    maxLatencyUs.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < MESH_RX_LATENCY_BUCKETS; i++) {
+        latencyHistogram[i].store(0, std::memory_order_relaxed);
+    }
+}
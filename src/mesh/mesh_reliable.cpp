@@ -0,0 +1,318 @@
+// Mesh Reliable Unicast - Sliding window, selective ACKs and adaptive retransmission
+#include <string.h>
+#include "mesh_reliable.h"
+#include "mesh_bytes.h"
+
+MeshReliable::MeshReliable() : nextSession(0), delivered() {
+    memset(sendPeers, 0, sizeof(sendPeers));
+    memset(receivePeers, 0, sizeof(receivePeers));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MeshReliable::begin(uint16_t sessionId) {
+    nextSession = sessionId;
+}
+
+MeshReliable::SendPeer* MeshReliable::findSendPeer(uint32_t nodeId, uint32_t nowMs, bool create) {
+    SendPeer* victim = nullptr;
+    for (size_t i = 0; i < MESH_RELIABLE_PEERS; i++) {
+        SendPeer& peer = sendPeers[i];
+        if (peer.nodeId == nodeId) {
+            return &peer;
+        }
+
+        // Only idle peers (nothing in flight) may be recycled
+        if (peer.nodeId != 0 && peer.nextSeq != peer.base) continue;
+        if (!victim || peer.nodeId == 0 ||
+            (victim->nodeId != 0 && (int32_t)(peer.lastUsedMs - victim->lastUsedMs) < 0)) {
+            victim = &peer;
+        }
+    }
+
+    if (!create || !victim) {
+        return nullptr;
+    }
+
+    // Sequence numbers restart per entry; the session ID tells receivers apart
+    memset(victim, 0, sizeof(SendPeer));
+    victim->nodeId = nodeId;
+    victim->session = nextSession++;
+    victim->lastUsedMs = nowMs;
+    victim->rtoMs = MESH_RELIABLE_RTO_INITIAL_MS;
+    return victim;
+}
+
+void MeshReliable::writePacket(const SendPeer& peer, const Slot& slot, uint8_t* packet, size_t* packetLen) {
+    putU16(packet, peer.session);
+    putU16(packet + 2, slot.seq);
+    putU16(packet + 4, peer.base);
+    packet[6] = slot.type;
+    memcpy(packet + HEADER_SIZE, slot.data, slot.length);
+    *packetLen = HEADER_SIZE + slot.length;
+}
+
+bool MeshReliable::send(uint32_t destId, uint8_t type, const uint8_t* data, size_t len, uint32_t nowMs,
+                        uint8_t* packet, size_t packetCap, size_t* packetLen) {
+    if (destId == 0 || len > MAX_PAYLOAD || (len > 0 && !data) || !packet || !packetLen ||
+        packetCap < HEADER_SIZE + len) {
+        return false;
+    }
+
+    SendPeer* peer = findSendPeer(destId, nowMs, true);
+    if (!peer || (uint16_t)(peer->nextSeq - peer->base) >= MESH_RELIABLE_WINDOW) {
+        stats.windowFull++;
+        return false;
+    }
+
+    Slot& slot = peer->slots[peer->nextSeq % MESH_RELIABLE_WINDOW];
+    slot.seq = peer->nextSeq++;
+    slot.length = len;
+    slot.type = type;
+    slot.retries = 0;
+    slot.sentMs = nowMs;
+    slot.inUse = true;
+    if (len > 0) {
+        memcpy(slot.data, data, len);
+    }
+
+    peer->lastUsedMs = nowMs;
+    writePacket(*peer, slot, packet, packetLen);
+    stats.sent++;
+    return true;
+}
+
+bool MeshReliable::nextRetransmit(uint32_t nowMs, uint32_t* destId, uint8_t* packet, size_t packetCap,
+                                  size_t* packetLen) {
+    if (!destId || !packet || !packetLen) {
+        return false;
+    }
+
+    for (size_t p = 0; p < MESH_RELIABLE_PEERS; p++) {
+        SendPeer& peer = sendPeers[p];
+        if (peer.nodeId == 0) continue;
+
+        for (uint16_t seq = peer.base; seq != peer.nextSeq; seq++) {
+            Slot& slot = peer.slots[seq % MESH_RELIABLE_WINDOW];
+            if (!slot.inUse) continue;
+
+            // Exponential backoff per retry
+            uint32_t timeout = peer.rtoMs << slot.retries;
+            if (timeout > MESH_RELIABLE_RTO_MAX_MS) timeout = MESH_RELIABLE_RTO_MAX_MS;
+            if ((uint32_t)(nowMs - slot.sentMs) < timeout) continue;
+
+            if (slot.retries >= MESH_RELIABLE_MAX_RETRIES) {
+                slot.inUse = false;
+                stats.failed++;
+                while (peer.base != peer.nextSeq && !peer.slots[peer.base % MESH_RELIABLE_WINDOW].inUse) {
+                    peer.base++;
+                }
+                continue;
+            }
+
+            if (packetCap < HEADER_SIZE + slot.length) {
+                return false;
+            }
+
+            slot.retries++;
+            slot.sentMs = nowMs;
+            *destId = peer.nodeId;
+            writePacket(peer, slot, packet, packetLen);
+            stats.retransmits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MeshReliable::sampleRtt(SendPeer& peer, uint32_t rttMs) {
+    // RFC 6298 in fixed point: srtt kept x8, rttvar kept x4
+    if (peer.srttX8 == 0) {
+        peer.srttX8 = rttMs << 3;
+        peer.rttvarX4 = rttMs << 1;
+    } else {
+        int32_t delta = (int32_t)rttMs - (int32_t)(peer.srttX8 >> 3);
+        peer.srttX8 += delta;
+        if (delta < 0) delta = -delta;
+        peer.rttvarX4 += delta - (int32_t)(peer.rttvarX4 >> 2);
+    }
+
+    uint32_t rto = (peer.srttX8 >> 3) + peer.rttvarX4;
+    if (rto < MESH_RELIABLE_RTO_MIN_MS) rto = MESH_RELIABLE_RTO_MIN_MS;
+    if (rto > MESH_RELIABLE_RTO_MAX_MS) rto = MESH_RELIABLE_RTO_MAX_MS;
+    peer.rtoMs = rto;
+}
+
+bool MeshReliable::onAck(uint32_t fromId, const uint8_t* ack, size_t ackLen, uint32_t nowMs) {
+    if (!ack || ackLen != ACK_SIZE) {
+        return false;
+    }
+
+    SendPeer* peer = findSendPeer(fromId, nowMs, false);
+    if (!peer || getU16(ack) != peer->session) {
+        return false;
+    }
+
+    uint16_t cumulative = getU16(ack + 2);
+    uint32_t sack = ack[4] | (ack[5] << 8) | ((uint32_t)ack[6] << 16) | ((uint32_t)ack[7] << 24);
+
+    for (uint16_t seq = peer->base; seq != peer->nextSeq; seq++) {
+        Slot& slot = peer->slots[seq % MESH_RELIABLE_WINDOW];
+        if (!slot.inUse) continue;
+
+        int16_t ahead = (int16_t)(seq - cumulative);
+        bool acked = ahead < 0 || (ahead >= 1 && ahead <= 32 && (sack & (1UL << (ahead - 1))));
+        if (!acked) continue;
+
+        // Karn: retransmitted messages give ambiguous samples
+        if (slot.retries == 0) {
+            sampleRtt(*peer, nowMs - slot.sentMs);
+        }
+        slot.inUse = false;
+        stats.acked++;
+    }
+
+    while (peer->base != peer->nextSeq && !peer->slots[peer->base % MESH_RELIABLE_WINDOW].inUse) {
+        peer->base++;
+    }
+    peer->lastUsedMs = nowMs;
+    return true;
+}
+
+size_t MeshReliable::getInFlight(uint32_t destId) {
+    SendPeer* peer = findSendPeer(destId, 0, false);
+    return peer ? (uint16_t)(peer->nextSeq - peer->base) : 0;
+}
+
+uint32_t MeshReliable::getRtoMs(uint32_t destId) {
+    SendPeer* peer = findSendPeer(destId, 0, false);
+    return peer ? peer->rtoMs : MESH_RELIABLE_RTO_INITIAL_MS;
+}
+
+MeshReliable::ReceivePeer* MeshReliable::findReceivePeer(uint32_t nodeId, uint32_t nowMs, bool* fresh) {
+    ReceivePeer* victim = &receivePeers[0];
+    for (size_t i = 0; i < MESH_RELIABLE_PEERS; i++) {
+        ReceivePeer& peer = receivePeers[i];
+        if (peer.nodeId == nodeId) {
+            *fresh = false;
+            return &peer;
+        }
+        if (victim->nodeId != 0 &&
+            (peer.nodeId == 0 || (int32_t)(peer.lastSeenMs - victim->lastSeenMs) < 0)) {
+            victim = &peer;
+        }
+    }
+
+    // Longest-silent peer is replaced; its window base resyncs the state
+    memset(victim, 0, sizeof(ReceivePeer));
+    victim->nodeId = nodeId;
+    victim->lastSeenMs = nowMs;
+    *fresh = true;
+    return victim;
+}
+
+void MeshReliable::advanceCumulative(ReceivePeer& peer, uint16_t to) {
+    // Bit 0 always describes the seq that becomes the new edge after a shift
+    bool held = false;
+    while ((int16_t)(to - peer.cumulative) > 0) {
+        held = peer.sack & 1;
+        peer.sack >>= 1;
+        peer.cumulative++;
+    }
+
+    // Anything already held at the new edge is contiguous now
+    while (held) {
+        held = peer.sack & 1;
+        peer.sack >>= 1;
+        peer.cumulative++;
+    }
+}
+
+MeshReliableVerdict MeshReliable::onData(uint32_t fromId, const uint8_t* packet, size_t packetLen, uint32_t nowMs,
+                                         uint8_t* type, const uint8_t** payload, size_t* payloadLen) {
+    if (!packet || packetLen < HEADER_SIZE || !type || !payload || !payloadLen) {
+        return MESH_RELIABLE_INVALID;
+    }
+
+    uint16_t senderSession = getU16(packet);
+    uint16_t seq = getU16(packet + 2);
+    uint16_t base = getU16(packet + 4);
+
+    bool fresh;
+    ReceivePeer* peer = findReceivePeer(fromId, nowMs, &fresh);
+
+    // New or rebooted sender: everything below its window base is settled
+    if (fresh || peer->session != senderSession) {
+        peer->session = senderSession;
+        peer->cumulative = base;
+        peer->sack = 0;
+    }
+    peer->lastSeenMs = nowMs;
+
+    // The sender has given up on or seen ACKs for everything below base
+    if ((int16_t)(base - peer->cumulative) > 0) {
+        advanceCumulative(*peer, base);
+    }
+
+    int16_t ahead = (int16_t)(seq - peer->cumulative);
+    if (ahead > 32) {
+        stats.outOfWindow++;
+        return MESH_RELIABLE_INVALID;
+    }
+
+    // Duplicates are re-acknowledged so a lost ACK does not stall the sender
+    peer->ackPending = true;
+    uint32_t key = ((uint32_t)senderSession << 16) | seq;
+    bool seen = ahead < 0 || (ahead > 0 && (peer->sack & (1UL << (ahead - 1))));
+    if (!seen) {
+        seen = delivered.contains(fromId, key, nowMs);
+        if (ahead == 0) {
+            advanceCumulative(*peer, seq + 1);
+        } else {
+            peer->sack |= 1UL << (ahead - 1);
+        }
+    }
+
+    if (seen) {
+        stats.duplicates++;
+        return MESH_RELIABLE_DUPLICATE;
+    }
+    delivered.insert(fromId, key, nowMs);
+
+    *type = packet[6];
+    *payload = packet + HEADER_SIZE;
+    *payloadLen = packetLen - HEADER_SIZE;
+    stats.delivered++;
+    return MESH_RELIABLE_DELIVER;
+}
+
+bool MeshReliable::nextAck(uint32_t* destId, uint8_t* ack, size_t ackCap, size_t* ackLen) {
+    if (!destId || !ack || !ackLen || ackCap < ACK_SIZE) {
+        return false;
+    }
+
+    for (size_t i = 0; i < MESH_RELIABLE_PEERS; i++) {
+        ReceivePeer& peer = receivePeers[i];
+        if (peer.nodeId == 0 || !peer.ackPending) continue;
+
+        putU16(ack, peer.session);
+        putU16(ack + 2, peer.cumulative);
+        ack[4] = (uint8_t)peer.sack;
+        ack[5] = (uint8_t)(peer.sack >> 8);
+        ack[6] = (uint8_t)(peer.sack >> 16);
+        ack[7] = (uint8_t)(peer.sack >> 24);
+
+        peer.ackPending = false;
+        *destId = peer.nodeId;
+        *ackLen = ACK_SIZE;
+        return true;
+    }
+    return false;
+}
+
+MeshReliableStats MeshReliable::getStats() {
+    return stats;
+}
+
+void MeshReliable::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
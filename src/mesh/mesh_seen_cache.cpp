@@ -0,0 +1,77 @@
+// Mesh Seen-Message Cache - Drops relayed duplicates before decryption
+#include <string.h>
+#include "mesh_seen_cache.h"
+
+static_assert((MESH_SEEN_CACHE_SETS & (MESH_SEEN_CACHE_SETS - 1)) == 0,
+              "MESH_SEEN_CACHE_SETS must be a power of two");
+
+MeshSeenCache::MeshSeenCache() {
+    clear();
+    resetStats();
+}
+
+size_t MeshSeenCache::setIndex(uint32_t source, uint32_t seq) {
+    // Cheap multiplicative mix; consecutive sequence numbers spread across sets
+    uint32_t h = source * 0x9E3779B1u ^ seq * 0x85EBCA6Bu;
+    h ^= h >> 15;
+    return h & (MESH_SEEN_CACHE_SETS - 1);
+}
+
+bool MeshSeenCache::isLive(const Entry& entry, uint32_t nowMs) {
+    return entry.source != 0 && (uint32_t)(nowMs - entry.seenMs) < MESH_SEEN_CACHE_TTL_MS;
+}
+
+bool MeshSeenCache::contains(uint32_t source, uint32_t seq, uint32_t nowMs) {
+    Entry* set = entries[setIndex(source, seq)];
+
+    for (size_t way = 0; way < MESH_SEEN_CACHE_WAYS; way++) {
+        if (set[way].source == source && set[way].seq == seq && isLive(set[way], nowMs)) {
+            stats.hits++;
+            return true;
+        }
+    }
+
+    stats.misses++;
+    return false;
+}
+
+void MeshSeenCache::insert(uint32_t source, uint32_t seq, uint32_t nowMs) {
+    Entry* set = entries[setIndex(source, seq)];
+    Entry* victim = nullptr;
+
+    for (size_t way = 0; way < MESH_SEEN_CACHE_WAYS; way++) {
+        Entry& entry = set[way];
+
+        if (entry.source == source && entry.seq == seq) {
+            entry.seenMs = nowMs;
+            return;
+        }
+
+        // Prefer a free/expired slot, otherwise the oldest live entry
+        if (!victim || (isLive(*victim, nowMs) &&
+                        (!isLive(entry, nowMs) ||
+                         (uint32_t)(nowMs - entry.seenMs) > (uint32_t)(nowMs - victim->seenMs)))) {
+            victim = &entry;
+        }
+    }
+
+    if (isLive(*victim, nowMs)) {
+        stats.evictions++;
+    }
+
+    victim->source = source;
+    victim->seq = seq;
+    victim->seenMs = nowMs;
+}
+
+void MeshSeenCache::clear() {
+    memset(entries, 0, sizeof(entries));
+}
+
+MeshSeenCacheStats MeshSeenCache::getStats() {
+    return stats;
+}
+
+void MeshSeenCache::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,460 @@
+// Mesh Store-and-Forward - append-only flash log of messages awaiting acknowledgement
+#include <string.h>
+#include "mesh_store_forward.h"
+#include "mesh_bytes.h"
+
+namespace {
+
+const uint32_t SECTOR_MAGIC = 0x3151534D;   // "MSQ1"
+const uint32_t SECTOR_HEADER_SIZE = 8;
+const uint32_t RECORD_HEADER_SIZE = 16;
+
+const uint8_t STATE_LIVE = 0xFE;            // Programmed with the record
+const uint8_t STATE_RETIRED = 0x00;         // Cleared in place once delivered or expired
+
+const uint8_t OP_DATA = 0;
+const uint8_t OP_ACK = 1;
+
+inline uint32_t recordSize(size_t len) {
+    return (RECORD_HEADER_SIZE + len + 3) & ~3u;
+}
+
+// CRC-16/CCITT-FALSE
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+bool isErased(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// IDs are (generation << 12) | offset within the sector
+static_assert(MESH_STORE_SECTOR_SIZE <= 4096, "Record IDs hold a 12-bit sector offset");
+static_assert(MESH_STORE_SECTORS >= 2, "One sector is always kept erased");
+
+MeshStoreForward::MeshStoreForward() :
+    flash(nullptr),
+    sectors(0),
+    current(0),
+    writeOffset(0),
+    generation(0),
+    replayTokens(MESH_STORE_REPLAY_PER_SEC * 1000),
+    lastRefillMs(0) {
+    memset(records, 0, sizeof(records));
+    memset(delivered, 0, sizeof(delivered));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool MeshStoreForward::begin(MeshFlash* segment, uint32_t nowMs) {
+    flash = nullptr;
+    memset(records, 0, sizeof(records));
+    lastRefillMs = nowMs;
+    if (!segment) {
+        return false;
+    }
+    sectors = segment->size() / MESH_STORE_SECTOR_SIZE;
+    if (sectors > MESH_STORE_SECTORS) sectors = MESH_STORE_SECTORS;
+    if (sectors < 2) {
+        return false;
+    }
+    flash = segment;
+
+    // Sector generations; anything that is neither ours nor blank is erased
+    uint32_t generations[MESH_STORE_SECTORS];
+    generation = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        uint8_t header[SECTOR_HEADER_SIZE];
+        generations[s] = 0;
+        if (!flash->read(s * MESH_STORE_SECTOR_SIZE, header, sizeof(header))) {
+            flash = nullptr;
+            return false;
+        }
+        if (getU32(header) == SECTOR_MAGIC && getU32(header + 4) != 0 && getU32(header + 4) != UINT32_MAX) {
+            generations[s] = getU32(header + 4);
+            if (generations[s] > generation) {
+                generation = generations[s];
+                current = s;
+            }
+        } else if (!isErased(header, sizeof(header))) {
+            flash->erase(s * MESH_STORE_SECTOR_SIZE, MESH_STORE_SECTOR_SIZE);
+            stats.erases++;
+        }
+    }
+
+    if (generation == 0) {
+        return openSector(0);
+    }
+
+    // Oldest first, so a record copied forward ends up indexed at its newest copy
+    uint32_t last = 0;
+    while (true) {
+        int next = -1;
+        for (uint32_t s = 0; s < sectors; s++) {
+            if (generations[s] > last && (next < 0 || generations[s] < generations[next])) next = s;
+        }
+        if (next < 0) break;
+        last = generations[next];
+
+        uint32_t end;
+        scanSector(next, nowMs, &end);
+        if ((uint32_t)next == current) {
+            writeOffset = end;
+        }
+    }
+
+    // A reboot between copying the oldest sector forward and erasing it leaves no spare
+    relocate((current + 1) % sectors);
+    return true;
+}
+
+bool MeshStoreForward::scanSector(uint32_t sector, uint32_t nowMs, uint32_t* end) {
+    uint32_t base = sector * MESH_STORE_SECTOR_SIZE;
+    uint32_t offset = SECTOR_HEADER_SIZE;
+
+    while (offset + RECORD_HEADER_SIZE <= MESH_STORE_SECTOR_SIZE) {
+        uint8_t header[RECORD_HEADER_SIZE];
+        if (!flash->read(base + offset, header, sizeof(header)) || isErased(header, sizeof(header))) {
+            break;
+        }
+
+        // A torn or corrupt record closes the sector; appends continue in the next one
+        uint16_t length = getU16(header + 2);
+        uint32_t size = recordSize(length);
+        bool valid = (header[0] == STATE_LIVE || header[0] == STATE_RETIRED) && length <= MAX_PAYLOAD &&
+                     offset + size <= MESH_STORE_SECTOR_SIZE;
+        if (valid) {
+            uint16_t crc = crc16(0xFFFF, header + 1, 13);
+            uint8_t chunk[64];
+            for (uint32_t done = 0; done < length && valid; done += sizeof(chunk)) {
+                uint32_t take = length - done < sizeof(chunk) ? length - done : sizeof(chunk);
+                valid = flash->read(base + offset + RECORD_HEADER_SIZE + done, chunk, take);
+                crc = crc16(crc, chunk, take);
+            }
+            valid = valid && crc == getU16(header + 14);
+        }
+        if (!valid) {
+            offset = MESH_STORE_SECTOR_SIZE;
+            break;
+        }
+
+        if (header[0] == STATE_LIVE) {
+            uint32_t id = getU32(header + 4);
+            Record* record = findRecord(id);
+            if (!record) {
+                record = freeRecord();
+                if (record) {
+                    memset(record, 0, sizeof(Record));
+                    record->id = id;
+                    record->destId = getU32(header + 8);
+                    record->length = length;
+                    record->type = header[12];
+                    record->priority = header[1] < MESH_PRIORITY_COUNT ? header[1] : (uint8_t)MESH_PRIORITY_LOG;
+                    record->queuedMs = nowMs;
+                    record->retryAtMs = nowMs;
+                    stats.recovered++;
+                } else {
+                    stats.dropped++;
+                }
+            }
+            if (record) {
+                record->offset = base + offset;
+            }
+        }
+        offset += size;
+    }
+
+    *end = offset;
+    return true;
+}
+
+MeshStoreForward::Record* MeshStoreForward::findRecord(uint32_t id) {
+    if (id == 0) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        if (records[i].id == id) return &records[i];
+    }
+    return nullptr;
+}
+
+MeshStoreForward::Record* MeshStoreForward::freeRecord() {
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        if (records[i].id == 0) return &records[i];
+    }
+    return nullptr;
+}
+
+bool MeshStoreForward::openSector(uint32_t sector) {
+    uint8_t header[SECTOR_HEADER_SIZE];
+    putU32(header, SECTOR_MAGIC);
+    putU32(header + 4, generation + 1);
+    if (!flash->write(sector * MESH_STORE_SECTOR_SIZE, header, sizeof(header))) {
+        return false;
+    }
+    generation++;
+    current = sector;
+    writeOffset = SECTOR_HEADER_SIZE;
+    return true;
+}
+
+bool MeshStoreForward::advance() {
+    // The spare becomes the current sector and the oldest one is emptied into it
+    if (!openSector((current + 1) % sectors)) {
+        return false;
+    }
+    relocate((current + 1) % sectors);
+    return true;
+}
+
+void MeshStoreForward::relocate(uint32_t sector) {
+    uint32_t base = sector * MESH_STORE_SECTOR_SIZE;
+    uint8_t magic[4];
+    if (sector == current || !flash->read(base, magic, sizeof(magic)) || isErased(magic, sizeof(magic))) {
+        return;
+    }
+
+    uint8_t payload[MAX_PAYLOAD];
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        Record& record = records[i];
+        if (record.id == 0 || record.offset < base || record.offset >= base + MESH_STORE_SECTOR_SIZE) {
+            continue;
+        }
+        if (!flash->read(record.offset + RECORD_HEADER_SIZE, payload, record.length) ||
+            !writeRecord(record, payload)) {
+            record.id = 0;
+            stats.dropped++;
+        }
+    }
+
+    flash->erase(base, MESH_STORE_SECTOR_SIZE);
+    stats.erases++;
+}
+
+bool MeshStoreForward::writeRecord(Record& record, const uint8_t* payload) {
+    uint32_t size = recordSize(record.length);
+    if (writeOffset + size > MESH_STORE_SECTOR_SIZE) {
+        return false;
+    }
+
+    // One program operation per record; padding stays erased
+    uint8_t buffer[RECORD_HEADER_SIZE + MAX_PAYLOAD + 3];
+    memset(buffer, 0xFF, size);
+    buffer[0] = STATE_LIVE;
+    buffer[1] = record.priority;
+    putU16(buffer + 2, record.length);
+    putU32(buffer + 4, record.id);
+    putU32(buffer + 8, record.destId);
+    buffer[12] = record.type;
+    if (record.length > 0) {
+        memcpy(buffer + RECORD_HEADER_SIZE, payload, record.length);
+    }
+    uint16_t crc = crc16(crc16(0xFFFF, buffer + 1, 13), buffer + RECORD_HEADER_SIZE, record.length);
+    putU16(buffer + 14, crc);
+
+    uint32_t at = current * MESH_STORE_SECTOR_SIZE + writeOffset;
+    if (!flash->write(at, buffer, size)) {
+        writeOffset = MESH_STORE_SECTOR_SIZE;
+        return false;
+    }
+    record.offset = at;
+    writeOffset += size;
+    return true;
+}
+
+void MeshStoreForward::retire(Record& record) {
+    uint8_t state = STATE_RETIRED;
+    flash->write(record.offset, &state, 1);
+    record.id = 0;
+}
+
+bool MeshStoreForward::append(uint32_t destId, uint8_t type, const uint8_t* data, size_t len,
+                              MeshPriority priority, uint32_t nowMs) {
+    if (!flash || destId == 0 || len > MAX_PAYLOAD || (len > 0 && !data) || priority >= MESH_PRIORITY_COUNT) {
+        return false;
+    }
+
+    if (writeOffset + recordSize(len) > MESH_STORE_SECTOR_SIZE && !advance()) {
+        stats.dropped++;
+        return false;
+    }
+    Record* record = freeRecord();
+    if (!record || writeOffset + recordSize(len) > MESH_STORE_SECTOR_SIZE) {
+        stats.dropped++;
+        return false;
+    }
+
+    memset(record, 0, sizeof(Record));
+    record->id = (generation << 12) | writeOffset;
+    record->destId = destId;
+    record->length = len;
+    record->type = type;
+    record->priority = priority;
+    record->queuedMs = nowMs;
+    record->retryAtMs = nowMs;
+    if (!writeRecord(*record, data)) {
+        record->id = 0;
+        stats.dropped++;
+        return false;
+    }
+
+    stats.appended++;
+    return true;
+}
+
+void MeshStoreForward::onConnectivity(uint32_t nowMs) {
+    // Whatever waited out the partition is due now, at the replay rate
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        records[i].retryAtMs = nowMs;
+        records[i].backoff = 0;
+    }
+}
+
+bool MeshStoreForward::nextReplay(uint32_t nowMs, MeshSendFilter reachable, void* context, uint32_t* destId,
+                                  MeshPriority* priority, uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!flash || !destId || !priority || !output || !outputLen) {
+        return false;
+    }
+
+    uint32_t elapsed = nowMs - lastRefillMs;
+    lastRefillMs = nowMs;
+    replayTokens += (elapsed < 1000 ? elapsed : 1000) * MESH_STORE_REPLAY_PER_SEC;
+    if (replayTokens > MESH_STORE_REPLAY_PER_SEC * 1000) {
+        replayTokens = MESH_STORE_REPLAY_PER_SEC * 1000;
+    }
+    if (replayTokens < 1000) {
+        return false;
+    }
+
+    // Most urgent class first, oldest first within it
+    Record* best = nullptr;
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        Record& record = records[i];
+        if (record.id == 0) continue;
+        if ((uint32_t)(nowMs - record.queuedMs) >= MESH_STORE_MAX_AGE_MS) {
+            retire(record);
+            stats.expired++;
+            continue;
+        }
+        if ((int32_t)(nowMs - record.retryAtMs) < 0) continue;
+        if (reachable && !reachable(context, record.destId)) continue;
+        if (!best || record.priority < best->priority ||
+            (record.priority == best->priority && (int32_t)(record.queuedMs - best->queuedMs) < 0)) {
+            best = &record;
+        }
+    }
+    if (!best || outputCap < DATA_HEADER_SIZE + best->length) {
+        return false;
+    }
+    if (!flash->read(best->offset + RECORD_HEADER_SIZE, output + DATA_HEADER_SIZE, best->length)) {
+        return false;
+    }
+
+    output[0] = OP_DATA;
+    putU32(output + 1, best->id);
+    output[5] = best->type;
+
+    if (best->attempts > 0) stats.retries++;
+    if (best->attempts < UINT8_MAX) best->attempts++;
+    uint32_t waitMs = MESH_STORE_RETRY_MS << (best->backoff < 16 ? best->backoff : 16);
+    best->retryAtMs = nowMs + (waitMs < MESH_STORE_RETRY_MAX_MS ? waitMs : MESH_STORE_RETRY_MAX_MS);
+    if (best->backoff < UINT8_MAX) best->backoff++;
+    replayTokens -= 1000;
+    stats.replayed++;
+
+    *destId = best->destId;
+    *priority = (MeshPriority)best->priority;
+    *outputLen = DATA_HEADER_SIZE + best->length;
+    return true;
+}
+
+bool MeshStoreForward::onAck(uint32_t from, const uint8_t* data, size_t len) {
+    if (!data || len != ACK_SIZE || data[0] != OP_ACK) {
+        return false;
+    }
+
+    // Only the destination can release a record
+    Record* record = findRecord(getU32(data + 1));
+    if (flash && record && record->destId == from) {
+        retire(*record);
+        stats.delivered++;
+    }
+    return true;
+}
+
+bool MeshStoreForward::receive(uint32_t from, const uint8_t* data, size_t len, uint32_t nowMs, uint8_t* type,
+                               const uint8_t** payload, size_t* payloadLen, uint8_t* ack, size_t ackCap,
+                               size_t* ackLen) {
+    *ackLen = 0;
+    if (!data || len < DATA_HEADER_SIZE || data[0] != OP_DATA || from == 0) {
+        return false;
+    }
+    uint32_t id = getU32(data + 1);
+    if (id == 0) {
+        return false;
+    }
+
+    // Duplicates are acknowledged again: the first acknowledgement may be what was lost
+    if (ack && ackCap >= ACK_SIZE) {
+        ack[0] = OP_ACK;
+        putU32(ack + 1, id);
+        *ackLen = ACK_SIZE;
+    }
+
+    Delivered* slot = nullptr;
+    for (size_t i = 0; i < MESH_STORE_DEDUP_ENTRIES; i++) {
+        Delivered& entry = delivered[i];
+        bool live = entry.origin != 0 && (uint32_t)(nowMs - entry.seenMs) < MESH_STORE_DEDUP_MS;
+        if (live && entry.origin == from && entry.id == id) {
+            stats.duplicates++;
+            return false;
+        }
+        if (!live) {
+            if (!slot || slot->origin != 0) slot = &entry;
+        } else if (!slot || (slot->origin != 0 && (int32_t)(entry.seenMs - slot->seenMs) < 0)) {
+            slot = &entry;
+        }
+    }
+    slot->origin = from;
+    slot->id = id;
+    slot->seenMs = nowMs;
+
+    stats.received++;
+    *type = data[5];
+    *payload = data + DATA_HEADER_SIZE;
+    *payloadLen = len - DATA_HEADER_SIZE;
+    return true;
+}
+
+size_t MeshStoreForward::getDepth(MeshPriority priority) {
+    size_t depth = 0;
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        if (records[i].id != 0 && records[i].priority == priority) depth++;
+    }
+    return depth;
+}
+
+MeshStoreStats MeshStoreForward::getStats(uint32_t nowMs) {
+    MeshStoreStats result = stats;
+    result.records = 0;
+    result.bytes = 0;
+    result.oldestAgeMs = 0;
+    for (size_t i = 0; i < MESH_STORE_MAX_RECORDS; i++) {
+        const Record& record = records[i];
+        if (record.id == 0) continue;
+        result.records++;
+        result.bytes += record.length;
+        if (nowMs - record.queuedMs > result.oldestAgeMs) result.oldestAgeMs = nowMs - record.queuedMs;
+    }
+    return result;
+}
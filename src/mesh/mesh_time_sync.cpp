@@ -0,0 +1,348 @@
+// Mesh Time Sync - NTP-style offset and skew estimation toward the mesh master
+#include <string.h>
+#include "mesh_time_sync.h"
+#include "mesh_bytes.h"
+
+namespace {
+
+const uint8_t OP_REQUEST = 1;
+const uint8_t OP_RESPONSE = 2;
+
+const size_t REQUEST_SIZE = 5;
+const size_t RESPONSE_SIZE = 16;
+
+} // namespace
+
+static_assert(RESPONSE_SIZE <= MeshTimeSync::MAX_MESSAGE, "Time response must fit MAX_MESSAGE");
+
+MeshTimeSync::MeshTimeSync() :
+    self(0),
+    master(0),
+    parent(0),
+    localMaster(0),
+    localParent(0),
+    heardMaster(0),
+    heardVia(0),
+    heardMs(0),
+    synced(false),
+    stratum(UNSYNCED),
+    refLocalMs(0),
+    refOffsetMs(0),
+    refErrorMs(0),
+    refDelayMs(0),
+    skewPpb(0),
+    sampleNext(0),
+    sampleCount(0),
+    hasAnchor(false),
+    hasSkew(false),
+    pendingDest(0),
+    pendingT1(0),
+    lastRequestMs(0),
+    requestedBefore(false),
+    lastMeshMs(0),
+    hasLast(false) {
+    memset(samples, 0, sizeof(samples));
+    memset(&skewAnchor, 0, sizeof(skewAnchor));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MeshTimeSync::setSelf(uint32_t nodeId) {
+    self = nodeId;
+}
+
+void MeshTimeSync::setUpstream(uint32_t masterId, uint32_t parentId, uint32_t nowMs) {
+    localMaster = masterId;
+    localParent = parentId;
+    select(nowMs);
+}
+
+void MeshTimeSync::select(uint32_t nowMs) {
+    uint32_t masterId = localMaster;
+    uint32_t parentId = localParent;
+    if (heardMaster != 0 && (uint32_t)(nowMs - heardMs) >= MESH_TIME_MASTER_TIMEOUT_MS) {
+        heardMaster = 0;
+    }
+    if (heardMaster != 0 && (masterId == 0 || heardMaster < masterId)) {
+        masterId = heardMaster;
+        parentId = heardVia;
+    }
+
+    if (masterId != master) {
+        if (master != 0) {
+            stats.masterChanges++;
+        }
+
+        // Samples against the old master say nothing about the new one, but the clock
+        // itself carries on: a new master continues from it, everyone else holds it
+        refOffsetMs = offsetAt(nowMs);
+        refLocalMs = nowMs;
+        master = masterId;
+        sampleCount = 0;
+        sampleNext = 0;
+        hasAnchor = false;
+        pendingDest = 0;
+        requestedBefore = false;
+        synced = false;
+        stratum = UNSYNCED;
+    }
+
+    if (master == self) {
+        synced = true;
+        stratum = 0;
+        refErrorMs = 0;
+        refDelayMs = 0;
+        parent = 0;
+        pendingDest = 0;
+        return;
+    }
+
+    if (parentId != parent) {
+        parent = parentId;
+        pendingDest = 0;
+    }
+}
+
+bool MeshTimeSync::nextRequest(uint32_t nowMs, uint32_t* destId, uint8_t* output, size_t outputCap,
+                               size_t* outputLen) {
+    if (!destId || !output || !outputLen || outputCap < REQUEST_SIZE ||
+        master == 0 || master == self || parent == 0) {
+        return false;
+    }
+
+    // Poll quickly until the filter has something to choose from
+    uint32_t interval = sampleCount < MESH_TIME_SAMPLES / 2 ? MESH_TIME_FAST_POLL_MS : MESH_TIME_POLL_MS;
+    if (requestedBefore && (uint32_t)(nowMs - lastRequestMs) < interval) {
+        return false;
+    }
+    requestedBefore = true;
+    lastRequestMs = nowMs;
+
+    // A lost response is simply superseded by the next request
+    pendingDest = parent;
+    pendingT1 = nowMs;
+    stats.requests++;
+
+    output[0] = OP_REQUEST;
+    putU32(output + 1, nowMs);
+    *destId = parent;
+    *outputLen = REQUEST_SIZE;
+    return true;
+}
+
+bool MeshTimeSync::receive(uint32_t from, uint32_t sentMs, uint32_t receivedMs, const uint8_t* data, size_t len,
+                           uint8_t* reply, size_t replyCap, size_t* replyLen) {
+    if (replyLen) {
+        *replyLen = 0;
+    }
+    if (!data || len < 1) {
+        return false;
+    }
+
+    if (data[0] == OP_REQUEST) {
+        if (len != REQUEST_SIZE || !reply || !replyLen || replyCap < RESPONSE_SIZE) {
+            return false;
+        }
+
+        // t3 is not ours to write: it is the sentMs of the frame carrying this reply
+        uint32_t errorMs = getErrorMs(receivedMs);
+        if (errorMs > 0xFFFF) {
+            errorMs = 0xFFFF;
+        }
+        reply[0] = OP_RESPONSE;
+        memcpy(reply + 1, data + 1, 4);
+        putU32(reply + 5, toMesh(receivedMs));
+        putU32(reply + 9, master);
+        reply[13] = synced ? stratum : UNSYNCED;
+        reply[14] = (uint8_t)errorMs;
+        reply[15] = (uint8_t)(errorMs >> 8);
+        *replyLen = RESPONSE_SIZE;
+        return true;
+    }
+
+    if (data[0] != OP_RESPONSE || len != RESPONSE_SIZE) {
+        return false;
+    }
+
+    // Only the answer to our outstanding request is trusted for timing
+    uint32_t t1 = getU32(data + 1);
+    if (pendingDest == 0 || from != pendingDest || t1 != pendingT1) {
+        stats.rejected++;
+        return false;
+    }
+    pendingDest = 0;
+
+    uint32_t t2 = getU32(data + 5);
+    uint32_t responderMaster = getU32(data + 9);
+    uint8_t responderStratum = data[13];
+    uint32_t responderError = data[14] | (data[15] << 8);
+    bool usable = responderStratum < MESH_TIME_MAX_STRATUM && responderMaster != 0 && responderMaster != self;
+
+    // Our parent knowing of a lower master than we do means our own view is partial
+    if (usable && (responderMaster < master || responderMaster == heardMaster)) {
+        heardMaster = responderMaster;
+        heardVia = from;
+        heardMs = receivedMs;
+        select(receivedMs);
+    }
+    if (master == self || responderMaster != master || !usable) {
+        stats.rejected++;
+        return false;
+    }
+
+    uint32_t t3 = sentMs;
+    uint32_t t4 = receivedMs;
+    int32_t delay = (int32_t)(t4 - t1) - (int32_t)(t3 - t2);
+    // The responder cannot have held the request longer than the round trip; a
+    // negative delay means t3 (or t2) was not what the responder stamped
+    if (delay < 0 || delay > MESH_TIME_MAX_DELAY_MS) {
+        stats.rejected++;
+        return false;
+    }
+
+    Sample sample;
+    sample.localMs = t1 + (t4 - t1) / 2;
+    sample.offsetMs = (int32_t)(((int64_t)(int32_t)(t2 - t1) + (int32_t)(t3 - t4)) / 2);
+    sample.delayMs = (uint32_t)delay;
+
+    // The true offset lies within half the round trip of the estimate, plus a
+    // millisecond of truncation on each clock, on top of the parent's own bound
+    sample.errorMs = responderError + (sample.delayMs + 1) / 2 + 2;
+    sample.stratum = responderStratum + 1;
+
+    stats.samples++;
+    addSample(sample);
+    choose(receivedMs);
+    return true;
+}
+
+void MeshTimeSync::addSample(const Sample& sample) {
+    samples[sampleNext] = sample;
+    sampleNext = (sampleNext + 1) % MESH_TIME_SAMPLES;
+    if (sampleCount < MESH_TIME_SAMPLES) {
+        sampleCount++;
+    }
+}
+
+void MeshTimeSync::choose(uint32_t nowMs) {
+    // Smallest bound as of now: a quick exchange wins until it has aged past a
+    // fresher one, and the fresher of two equal bounds wins
+    const Sample* best = nullptr;
+    uint32_t bestError = 0;
+    uint32_t bestAge = 0;
+    for (size_t i = 0; i < sampleCount; i++) {
+        uint32_t age = (uint32_t)(nowMs - samples[i].localMs);
+        uint32_t error = widen(samples[i].errorMs, age);
+        if (!best || error < bestError || (error == bestError && age < bestAge)) {
+            best = &samples[i];
+            bestError = error;
+            bestAge = age;
+        }
+    }
+    if (!best) {
+        return;
+    }
+
+    bool wasSynced = synced;
+    uint32_t before = toMesh(nowMs);
+
+    refLocalMs = best->localMs;
+    refOffsetMs = best->offsetMs;
+    refErrorMs = best->errorMs;
+    refDelayMs = best->delayMs;
+    stratum = best->stratum;
+    synced = true;
+    updateSkew(*best);
+
+    int32_t change = (int32_t)(toMesh(nowMs) - before);
+    if (wasSynced && (change > MESH_TIME_MAX_HOLD_MS || change < -MESH_TIME_MAX_HOLD_MS)) {
+        stats.steps++;
+    }
+}
+
+void MeshTimeSync::updateSkew(const Sample& sample) {
+    if (!hasAnchor) {
+        skewAnchor = sample;
+        hasAnchor = true;
+        return;
+    }
+
+    // Short spans are dominated by round-trip noise; wait for a long enough baseline
+    uint32_t span = sample.localMs - skewAnchor.localMs;
+    if ((int32_t)span < MESH_TIME_SKEW_SPAN_MS) {
+        return;
+    }
+
+    // Offsets were measured on the raw local clock, so their slope is the rate error
+    int64_t rate = (int64_t)(sample.offsetMs - skewAnchor.offsetMs) * 1000000000LL / span;
+    int64_t skew = hasSkew ? skewPpb + (rate - skewPpb) / 4 : rate;
+    const int64_t limit = (int64_t)MESH_TIME_MAX_SKEW_PPM * 1000;
+    if (skew > limit) skew = limit;
+    if (skew < -limit) skew = -limit;
+    skewPpb = (int32_t)skew;
+    hasSkew = true;
+    skewAnchor = sample;
+}
+
+int32_t MeshTimeSync::offsetAt(uint32_t localMs) {
+    int32_t elapsed = (int32_t)(localMs - refLocalMs);
+    return refOffsetMs + (int32_t)((int64_t)elapsed * skewPpb / 1000000000LL);
+}
+
+uint32_t MeshTimeSync::widen(uint32_t errorMs, uint32_t ageMs) {
+    return errorMs + (uint32_t)(((uint64_t)ageMs * MESH_TIME_DRIFT_PPM + 999999) / 1000000);
+}
+
+uint32_t MeshTimeSync::toMesh(uint32_t localMs) {
+    return localMs + (uint32_t)offsetAt(localMs);
+}
+
+uint32_t MeshTimeSync::getErrorMs(uint32_t localMs) {
+    if (master != 0 && master == self) {
+        return 0;
+    }
+    if (!synced) {
+        return UINT32_MAX;
+    }
+    int32_t age = (int32_t)(localMs - refLocalMs);
+    return widen(refErrorMs, (uint32_t)(age < 0 ? -age : age));
+}
+
+bool MeshTimeSync::now(uint32_t localMs, uint32_t* meshMs, uint32_t* errorMs) {
+    uint32_t mesh = toMesh(localMs);
+    uint32_t error = getErrorMs(localMs);
+
+    // Small backward corrections hold the clock until it catches up; larger
+    // ones (a new timescale) are taken as they are
+    if (hasLast) {
+        int32_t back = (int32_t)(lastMeshMs - mesh);
+        if (back > 0 && back <= MESH_TIME_MAX_HOLD_MS) {
+            mesh = lastMeshMs;
+            if (error != UINT32_MAX) {
+                error += back;
+            }
+        }
+    }
+    lastMeshMs = mesh;
+    hasLast = true;
+
+    if (meshMs) {
+        *meshMs = mesh;
+    }
+    if (errorMs) {
+        *errorMs = error;
+    }
+    return synced;
+}
+
+MeshTimeStats MeshTimeSync::getStats(uint32_t nowMs) {
+    MeshTimeStats result = stats;
+    result.master = master;
+    result.parent = parent;
+    result.stratum = synced ? stratum : UNSYNCED;
+    result.synced = synced;
+    result.offsetMs = offsetAt(nowMs);
+    result.skewPpb = skewPpb;
+    result.errorMs = getErrorMs(nowMs);
+    result.delayMs = refDelayMs;
+    return result;
+}
@@ -0,0 +1,372 @@
+// Mesh Topology - Incremental link-state graph with cached least-cost routes
+#include <string.h>
+#include "mesh_topology.h"
+#include "mesh_bytes.h"
+
+MeshTopology::MeshTopology() : dirty(true) {
+    memset(nodes, 0, sizeof(nodes));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MeshTopology::setSelf(uint32_t nodeId) {
+    nodes[0].id = nodeId;
+    dirty = true;
+}
+
+int MeshTopology::findSlot(uint32_t nodeId) {
+    if (nodeId == 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        if (nodes[i].id == nodeId) return i;
+    }
+    return -1;
+}
+
+int MeshTopology::allocateSlot(uint32_t nodeId, uint32_t nowMs, bool evict, uint8_t hops) {
+    // Free slot first, otherwise an unreachable node, then the farthest, then the stalest.
+    // Nodes nearer than the newcomer stay, so a full graph keeps the ones routes need.
+    int victim = -1;
+    for (size_t i = 1; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        if (nodes[i].id == 0) {
+            victim = i;
+            break;
+        }
+        if (!evict) continue;
+
+        bool isNeighbor = false;
+        for (uint8_t l = 0; l < nodes[0].linkCount; l++) {
+            if (nodes[0].links[l] == nodes[i].id) isNeighbor = true;
+        }
+        if (isNeighbor) continue;
+        if (nodes[i].hops < hops) continue;
+
+        if (victim < 0) {
+            victim = i;
+            continue;
+        }
+        if (nodes[i].hops != nodes[victim].hops) {
+            if (nodes[i].hops > nodes[victim].hops) victim = i;
+        } else if ((int32_t)(nodes[i].updatedMs - nodes[victim].updatedMs) < 0) {
+            victim = i;
+        }
+    }
+
+    if (victim < 0) {
+        return -1;
+    }
+    if (nodes[victim].id != 0) {
+        stats.evictions++;
+    }
+
+    memset(&nodes[victim], 0, sizeof(Node));
+    nodes[victim].id = nodeId;
+    nodes[victim].updatedMs = nowMs;
+    nodes[victim].hops = UNREACHABLE;
+    nodes[victim].pathCost = NO_PATH;
+    dirty = true;
+    return victim;
+}
+
+bool MeshTopology::addLink(uint32_t neighborId, uint32_t nowMs) {
+    Node& self = nodes[0];
+    if (neighborId == 0 || neighborId == self.id) {
+        return false;
+    }
+
+    for (uint8_t l = 0; l < self.linkCount; l++) {
+        if (self.links[l] == neighborId) return false;
+    }
+    if (self.linkCount == MESH_TOPOLOGY_MAX_LINKS) {
+        return false;
+    }
+
+    // Neighbour gets a slot now so it is routable before its own advert arrives
+    int slot = findSlot(neighborId);
+    if (slot < 0 && allocateSlot(neighborId, nowMs, true, 1) < 0) {
+        return false;
+    }
+
+    self.links[self.linkCount] = neighborId;
+    self.costs[self.linkCount++] = MESH_LINK_COST_UNIT;
+    self.version++;
+    dirty = true;
+    return true;
+}
+
+bool MeshTopology::removeLink(uint32_t neighborId) {
+    Node& self = nodes[0];
+    for (uint8_t l = 0; l < self.linkCount; l++) {
+        if (self.links[l] == neighborId) {
+            self.linkCount--;
+            self.links[l] = self.links[self.linkCount];
+            self.costs[l] = self.costs[self.linkCount];
+            self.version++;
+            dirty = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MeshTopology::setLinkCost(uint32_t neighborId, uint8_t cost) {
+    Node& self = nodes[0];
+    if (cost == 0) {
+        cost = 1;
+    }
+    for (uint8_t l = 0; l < self.linkCount; l++) {
+        if (self.links[l] != neighborId) continue;
+        if (self.costs[l] == cost) return false;
+        self.costs[l] = cost;
+        self.version++;
+        dirty = true;
+        return true;
+    }
+    return false;
+}
+
+bool MeshTopology::encodeLinkState(uint8_t* output, size_t outputCap, size_t* outputLen) {
+    const Node& self = nodes[0];
+    size_t len = 3 + self.linkCount * 5;
+    if (!output || !outputLen || outputCap < len) {
+        return false;
+    }
+
+    putU16(output, self.version);
+    output[2] = self.linkCount;
+    for (uint8_t l = 0; l < self.linkCount; l++) {
+        uint8_t* out = output + 3 + l * 5;
+        putU32(out, self.links[l]);
+        out[4] = self.costs[l];
+    }
+
+    *outputLen = len;
+    return true;
+}
+
+bool MeshTopology::applyLinkState(uint32_t origin, const uint8_t* data, size_t len, uint32_t nowMs) {
+    if (!data || len < 3 || origin == 0 || origin == nodes[0].id) {
+        return false;
+    }
+
+    uint16_t version = getU16(data);
+    uint8_t count = data[2];
+    if (count > MESH_TOPOLOGY_MAX_LINKS || len != 3 + (size_t)count * 5) {
+        return false;
+    }
+
+    int slot = findSlot(origin);
+    if (slot < 0) {
+        // One hop past the nearest listed node we already hold
+        refresh();
+        uint8_t hops = UNREACHABLE;
+        for (uint8_t l = 0; l < count; l++) {
+            int linked = findSlot(getU32(data + 3 + l * 5));
+            if (linked >= 0 && nodes[linked].hops + 1 < hops) {
+                hops = nodes[linked].hops + 1;
+            }
+        }
+        slot = allocateSlot(origin, nowMs, true, hops);
+        if (slot < 0) return false;
+    }
+
+    Node& node = nodes[slot];
+    node.updatedMs = nowMs;
+
+    // Periodic refreshes repeat the version and only keep the entry alive.
+    // Versions restart on reboot, so any difference counts as new.
+    if (node.version == version && node.linkCount == count) {
+        return true;
+    }
+
+    node.version = version;
+    node.linkCount = count;
+    for (uint8_t l = 0; l < count; l++) {
+        const uint8_t* in = data + 3 + l * 5;
+        node.links[l] = getU32(in);
+        node.costs[l] = in[4] == 0 ? 1 : in[4];
+    }
+
+    // Listed nodes that have not advertised yet are routable too, space permitting
+    for (uint8_t l = 0; l < count; l++) {
+        if (findSlot(node.links[l]) < 0 && node.links[l] != 0) {
+            allocateSlot(node.links[l], nowMs, false);
+        }
+    }
+
+    stats.advertsApplied++;
+    dirty = true;
+    return true;
+}
+
+void MeshTopology::expire(uint32_t nowMs) {
+    for (size_t i = 1; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        Node& node = nodes[i];
+        if (node.id == 0 || (uint32_t)(nowMs - node.updatedMs) < MESH_LINK_STATE_MAX_AGE_MS) {
+            continue;
+        }
+
+        // Direct neighbours live as long as the connection does
+        bool isNeighbor = false;
+        for (uint8_t l = 0; l < nodes[0].linkCount; l++) {
+            if (nodes[0].links[l] == node.id) isNeighbor = true;
+        }
+        if (isNeighbor) continue;
+
+        memset(&node, 0, sizeof(Node));
+        stats.evictions++;
+        dirty = true;
+    }
+}
+
+void MeshTopology::refresh() {
+    if (!dirty) {
+        return;
+    }
+
+    bool settled[MESH_TOPOLOGY_MAX_NODES];
+    for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        nodes[i].hops = UNREACHABLE;
+        nodes[i].pathCost = NO_PATH;
+        nodes[i].nextHop = 0;
+        settled[i] = false;
+    }
+
+    // Dijkstra from self. A remote link counts in both directions when either
+    // end advertises it, so nodes whose adverts have not arrived are still
+    // reached; when both do, the worse of their two costs is used. Our own
+    // links come only from our connection events.
+    nodes[0].hops = 0;
+    nodes[0].pathCost = 0;
+
+    while (true) {
+        int at = -1;
+        for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+            const Node& node = nodes[i];
+            if (node.id == 0 || settled[i] || node.pathCost == NO_PATH) continue;
+            if (at < 0 || node.pathCost < nodes[at].pathCost ||
+                (node.pathCost == nodes[at].pathCost && node.hops < nodes[at].hops)) {
+                at = i;
+            }
+        }
+        if (at < 0) break;
+        settled[at] = true;
+        const Node& here = nodes[at];
+        if (here.hops == UNREACHABLE - 1) continue;
+
+        for (size_t i = 1; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+            Node& next = nodes[i];
+            if (next.id == 0 || settled[i]) continue;
+
+            uint8_t cost = 0;
+            for (uint8_t l = 0; l < here.linkCount; l++) {
+                if (here.links[l] == next.id && here.costs[l] > cost) cost = here.costs[l];
+            }
+            for (uint8_t l = 0; at != 0 && l < next.linkCount; l++) {
+                if (next.links[l] == here.id && next.costs[l] > cost) cost = next.costs[l];
+            }
+            if (cost == 0) continue;
+
+            uint32_t total = (uint32_t)here.pathCost + cost;
+            if (total >= NO_PATH) total = NO_PATH - 1;
+            uint8_t hops = here.hops + 1;
+            if (total < next.pathCost || (total == next.pathCost && hops < next.hops)) {
+                next.pathCost = (uint16_t)total;
+                next.hops = hops;
+                next.nextHop = at == 0 ? i : here.nextHop;
+            }
+        }
+    }
+
+    stats.recomputes++;
+    dirty = false;
+}
+
+uint8_t MeshTopology::getHopDistance(uint32_t nodeId) {
+    refresh();
+    int slot = findSlot(nodeId);
+    return slot < 0 ? UNREACHABLE : nodes[slot].hops;
+}
+
+uint32_t MeshTopology::getNextHop(uint32_t nodeId) {
+    refresh();
+    int slot = findSlot(nodeId);
+    if (slot <= 0 || nodes[slot].hops == UNREACHABLE) {
+        return 0;
+    }
+    return nodes[nodes[slot].nextHop].id;
+}
+
+uint16_t MeshTopology::getPathCost(uint32_t nodeId) {
+    refresh();
+    int slot = findSlot(nodeId);
+    return slot < 0 ? NO_PATH : nodes[slot].pathCost;
+}
+
+size_t MeshTopology::getReachableCount() {
+    refresh();
+    size_t count = 0;
+    for (size_t i = 1; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        if (nodes[i].id != 0 && nodes[i].hops != UNREACHABLE) count++;
+    }
+    return count;
+}
+
+size_t MeshTopology::getNeighborCount() {
+    return nodes[0].linkCount;
+}
+
+bool MeshTopology::setLoad(uint32_t nodeId, uint8_t load) {
+    int slot = findSlot(nodeId);
+    if (slot < 0) {
+        return false;
+    }
+    nodes[slot].load = load;
+    return true;
+}
+
+size_t MeshTopology::getNodesWithin(uint8_t maxHops, MeshRouteEntry* output, size_t outputCap) {
+    if (!output) {
+        return 0;
+    }
+    refresh();
+
+    // Nearest first; a least-cost path's first n hops are themselves least-cost paths,
+    // so hop rings have no gaps and an empty ring means nothing further out
+    size_t count = 0;
+    for (uint8_t hops = 0; hops <= maxHops && count < outputCap; hops++) {
+        size_t ringStart = count;
+        for (size_t i = 0; i < MESH_TOPOLOGY_MAX_NODES && count < outputCap; i++) {
+            const Node& node = nodes[i];
+            if (node.id == 0 || node.hops != hops) continue;
+            output[count].nodeId = node.id;
+            output[count].nextHop = i == 0 ? 0 : nodes[node.nextHop].id;
+            output[count].hops = node.hops;
+            output[count].load = node.load;
+            output[count].cost = node.pathCost;
+            count++;
+        }
+        if (count == ringStart || hops == UNREACHABLE - 1) break;
+    }
+    return count;
+}
+
+uint32_t MeshTopology::findLeastLoaded(uint8_t maxHops, bool includeSelf) {
+    refresh();
+
+    // Lowest load wins; equal load goes to the closer node
+    int best = -1;
+    for (size_t i = includeSelf ? 0 : 1; i < MESH_TOPOLOGY_MAX_NODES; i++) {
+        const Node& node = nodes[i];
+        if (node.id == 0 || node.hops == UNREACHABLE || node.hops > maxHops) continue;
+        if (best < 0 || node.load < nodes[best].load ||
+            (node.load == nodes[best].load && node.hops < nodes[best].hops)) {
+            best = i;
+        }
+    }
+    return best < 0 ? 0 : nodes[best].id;
+}
+
+MeshTopologyStats MeshTopology::getStats() {
+    return stats;
+}
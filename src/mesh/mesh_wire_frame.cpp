@@ -0,0 +1,95 @@
+// Mesh Wire Frame - Fixed-layout binary envelope for mesh messages
+#include <string.h>
+#include "mesh_wire_frame.h"
+#include "mesh_bytes.h"
+#include "text_codec.h"
+
+bool MeshWireFrame::writeHeader(const MeshFrameHeader& header, uint8_t* output, size_t outputCap) {
+    if (!output || outputCap < HEADER_SIZE) {
+        return false;
+    }
+
+    output[0] = header.version;
+    output[1] = header.type;
+    output[2] = header.flags;
+    output[3] = header.hops;
+    putU32(output + 4, header.seq);
+    putU32(output + 8, header.source);
+    putU32(output + 12, header.dest);
+    putU32(output + 16, header.sentMs);
+    putU16(output + 20, header.keyEpoch);
+    putU16(output + 22, header.length);
+    return true;
+}
+
+bool MeshWireFrame::readHeader(const uint8_t* frame, size_t frameLen, MeshFrameHeader* header) {
+    if (!frame || !header || frameLen < HEADER_SIZE) {
+        return false;
+    }
+
+    // Reject unknown versions before trusting any other field
+    if (frame[0] != VERSION) {
+        return false;
+    }
+
+    header->version = frame[0];
+    header->type = frame[1];
+    header->flags = frame[2];
+    header->hops = frame[3];
+    header->seq = getU32(frame + 4);
+    header->source = getU32(frame + 8);
+    header->dest = getU32(frame + 12);
+    header->sentMs = getU32(frame + 16);
+    header->keyEpoch = getU16(frame + 20);
+    header->length = getU16(frame + 22);
+    return true;
+}
+
+bool MeshWireFrame::encode(const MeshFrameHeader& header, const uint8_t* payload,
+                           uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!outputLen || (header.length > 0 && !payload)) {
+        return false;
+    }
+
+    size_t total = HEADER_SIZE + header.length;
+    if (total > outputCap || !writeHeader(header, output, outputCap)) {
+        return false;
+    }
+
+    // Payload may already sit at output + HEADER_SIZE (built in place)
+    if (header.length > 0 && payload != output + HEADER_SIZE) {
+        memmove(output + HEADER_SIZE, payload, header.length);
+    }
+
+    *outputLen = total;
+    return true;
+}
+
+bool MeshWireFrame::decode(const uint8_t* frame, size_t frameLen,
+                           MeshFrameHeader* header, const uint8_t** payload) {
+    if (!payload || !readHeader(frame, frameLen, header)) {
+        return false;
+    }
+
+    // Truncated or padded frames are rejected outright
+    if (HEADER_SIZE + header->length != frameLen) {
+        return false;
+    }
+
+    *payload = frame + HEADER_SIZE;
+    return true;
+}
+
+size_t MeshWireFrame::armoredSize(size_t frameLen) {
+    return TextCodec::base64EncodedSize(frameLen);
+}
+
+bool MeshWireFrame::armor(const uint8_t* frame, size_t frameLen,
+                          char* output, size_t outputCap, size_t* outputLen) {
+    return frame && TextCodec::base64Encode(frame, frameLen, output, outputCap, outputLen);
+}
+
+bool MeshWireFrame::unarmor(const char* text, size_t textLen,
+                            uint8_t* output, size_t outputCap, size_t* outputLen) {
+    return text && TextCodec::base64Decode(text, textLen, output, outputCap, outputLen);
+}
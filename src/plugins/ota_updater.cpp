@@ -1,5 +1,6 @@
 // OTA Updater Implementation
 #include "ota_updater.h"
+#include "text_codec.h"
 #include <ArduinoJson.h>
 
 OTAUpdater::OTAUpdater() :
@@ -194,14 +195,15 @@ bool OTAUpdater::verifyFirmwareSignature(const uint8_t* firmwareData, size_t dat
     }
 
     // Decode base64 signature to get expected hash
-    String expectedHashStr = base64Decode(signature);
-    if (expectedHashStr.length() != 32) {
+    uint8_t expectedHash[48];
+    size_t expectedLen;
+    if (!base64Decode(signature, expectedHash, sizeof(expectedHash), &expectedLen) || expectedLen != 32) {
         Serial.println("Invalid signature length");
         return false;
     }
 
     // Compare hashes
-    if (memcmp(calculatedHash, expectedHashStr.c_str(), 32) != 0) {
+    if (memcmp(calculatedHash, expectedHash, 32) != 0) {
         Serial.println("Firmware signature verification failed");
         return false;
     }
@@ -220,12 +222,9 @@ bool OTAUpdater::calculateSHA256(const uint8_t* data, size_t len, uint8_t* hash)
     return true;
 }
 
-String OTAUpdater::base64Decode(const String& input) {
-    // Simple base64 decode implementation
-    // In production, use a proper base64 library
-    String output = "";
-    // TODO: Implement proper base64 decoding
-    return output;
+bool OTAUpdater::base64Decode(const String& input, uint8_t* output, size_t outputCap, size_t* outputLen) {
+    // Strict RFC 4648: padded, standard alphabet, no whitespace
+    return TextCodec::base64Decode(input.c_str(), input.length(), output, outputCap, outputLen);
 }
 
 bool OTAUpdater::downloadFirmware(const String& url, uint8_t*& buffer, size_t& bufferSize) {
@@ -1,41 +1,70 @@
 // AES-256 Encryption Implementation
 #include <Arduino.h>
-#include <AES256.h>
 #include "aes256_encryption.h"
+#include "secure_key_manager.h"
+#include "text_codec.h"
 #include "../config/security_config.h"
 
-AES256Encryption::AES256Encryption() : initialized(false) {}
+namespace {
 
-bool AES256Encryption::begin() {
-    aes.setKey(AES_KEY, 32);
-    initialized = true;
-    Serial.println("AES-256 encryption initialized");
-    return true;
+const size_t CHUNK_SIZE = 256;                  // Bytes per bulk cipher call
+// PKCS#7 pad length of the final block, or 0 when it is not valid padding
+size_t paddingOf(const uint8_t* block) {
+    uint8_t padding = block[AesCipher::BLOCK_SIZE - 1];
+    if (padding == 0 || padding > AesCipher::BLOCK_SIZE) return 0;
+    for (size_t i = AesCipher::BLOCK_SIZE - padding; i < AesCipher::BLOCK_SIZE; i++) {
+        if (block[i] != padding) return 0;
+    }
+    return padding;
 }
 
-String AES256Encryption::encrypt(const String& plaintext) {
-    if (!initialized) return plaintext;
+} // namespace
 
-    // Pad the plaintext to 16-byte boundary
-    String padded = padString(plaintext);
+AES256Encryption::AES256Encryption() : initialized(false) {}
 
-    String encrypted = "";
+bool AES256Encryption::begin() {
+    SecureKeyManager keyManager;
+    uint8_t key[AesCipher::KEY_SIZE];
+    if (!keyManager.begin() || !keyManager.getAESKey(key, sizeof(key))) {
+        Serial.println("AES-256 key unavailable");
+        return false;
+    }
+    bool ready = begin(key, sizeof(key));
+    memset(key, 0, sizeof(key));
+    return ready;
+}
 
-    // Encrypt in 16-byte blocks
-    for (size_t i = 0; i < padded.length(); i += 16) {
-        uint8_t block[16];
-        for (int j = 0; j < 16; j++) {
-            block[j] = (i + j < padded.length()) ? (uint8_t)padded.charAt(i + j) : 0;
-        }
+bool AES256Encryption::begin(const uint8_t* key, size_t keyLen) {
+    initialized = cipher.setKey(key, keyLen);
+    if (initialized) {
+        Serial.printf("AES-256 encryption initialized (%s)\n", AesCipher::backendName(cipher.getBackend()));
+    }
+    return initialized;
+}
 
-        aes.encryptBlock(block, block);
+String AES256Encryption::encrypt(const String& plaintext) {
+    if (!initialized) return plaintext;
 
-        // Convert to hex string
-        for (int j = 0; j < 16; j++) {
-            char hex[3];
-            sprintf(hex, "%02X", block[j]);
-            encrypted += hex;
-        }
+    const uint8_t* input = (const uint8_t*)plaintext.c_str();
+    size_t len = plaintext.length();
+    size_t paddedLen = (len / AesCipher::BLOCK_SIZE + 1) * AesCipher::BLOCK_SIZE;
+
+    String encrypted;
+    encrypted.reserve(paddedLen * 2);
+
+    uint8_t block[CHUNK_SIZE];
+    char hex[CHUNK_SIZE * 2 + 1];
+    size_t hexLen;
+    for (size_t offset = 0; offset < paddedLen; offset += CHUNK_SIZE) {
+        size_t chunk = paddedLen - offset < CHUNK_SIZE ? paddedLen - offset : CHUNK_SIZE;
+        size_t copy = offset < len ? (len - offset < chunk ? len - offset : chunk) : 0;
+        memcpy(block, input + offset, copy);
+        // Only the final chunk reaches the padding
+        memset(block + copy, (int)(paddedLen - len), chunk - copy);
+
+        cipher.encryptEcb(block, block, chunk);
+        TextCodec::hexEncode(block, chunk, hex, sizeof(hex), &hexLen);
+        encrypted.concat(hex, hexLen);
     }
 
     return encrypted;
@@ -45,60 +74,70 @@ String AES256Encryption::decrypt(const String& ciphertext) {
     if (!initialized) return ciphertext;
 
     // Ciphertext should be hex-encoded and multiple of 32 characters (16 bytes * 2 hex chars)
-    if (ciphertext.length() % 32 != 0) {
+    size_t hexLen = ciphertext.length();
+    if (hexLen % 32 != 0) {
         Serial.println("Invalid ciphertext length");
         return "";
     }
 
-    String decrypted = "";
-
-    // Decrypt in 16-byte blocks
-    for (size_t i = 0; i < ciphertext.length(); i += 32) {
-        uint8_t block[16];
-
-        // Convert hex string to bytes
-        for (int j = 0; j < 16; j++) {
-            String byteStr = ciphertext.substring(i + j * 2, i + j * 2 + 2);
-            block[j] = (uint8_t)strtol(byteStr.c_str(), NULL, 16);
+    const char* hex = ciphertext.c_str();
+    size_t len = hexLen / 2;
+    String decrypted;
+    decrypted.reserve(len);
+
+    uint8_t block[CHUNK_SIZE];
+    for (size_t offset = 0; offset < len; offset += CHUNK_SIZE) {
+        size_t chunk;
+        if (!TextCodec::hexDecode(hex + 2 * offset, len - offset < CHUNK_SIZE ? 2 * (len - offset) : 2 * CHUNK_SIZE,
+                                  block, sizeof(block), &chunk)) {
+            Serial.println("Invalid ciphertext encoding");
+            return "";
         }
 
-        aes.decryptBlock(block, block);
+        cipher.decryptEcb(block, block, chunk);
 
-        // Convert back to string
-        for (int j = 0; j < 16; j++) {
-            decrypted += (char)block[j];
+        // Malformed padding is left in place, as before
+        if (offset + chunk == len && len > 0) {
+            chunk -= paddingOf(block + chunk - AesCipher::BLOCK_SIZE);
         }
+        decrypted.concat((const char*)block, chunk);
     }
 
-    // Remove padding
-    return unpadString(decrypted);
+    return decrypted;
 }
 
-String AES256Encryption::padString(const String& input) {
-    size_t blockSize = 16;
-    size_t padding = blockSize - (input.length() % blockSize);
-    if (padding == 0) padding = blockSize;
-
-    String padded = input;
-    for (size_t i = 0; i < padding; i++) {
-        padded += (char)padding;
+bool AES256Encryption::encrypt(const uint8_t* input, size_t len, uint8_t* output, size_t outputCap,
+                               size_t* outputLen) {
+    size_t tail = len % AesCipher::BLOCK_SIZE;
+    size_t whole = len - tail;
+    size_t paddedLen = whole + AesCipher::BLOCK_SIZE;
+    if (!initialized || outputCap < paddedLen || (len > 0 && !input)) {
+        return false;
     }
 
-    return padded;
+    uint8_t last[AesCipher::BLOCK_SIZE];
+    memcpy(last, input + whole, tail);
+    memset(last + tail, (int)(AesCipher::BLOCK_SIZE - tail), AesCipher::BLOCK_SIZE - tail);
+    cipher.encryptEcb(input, output, whole);
+    cipher.encryptEcb(last, output + whole, AesCipher::BLOCK_SIZE);
+    *outputLen = paddedLen;
+    return true;
 }
 
-String AES256Encryption::unpadString(const String& input) {
-    if (input.length() == 0) return input;
-
-    uint8_t padding = (uint8_t)input.charAt(input.length() - 1);
-    if (padding > 16 || padding == 0) return input;
-
-    // Verify padding is correct
-    for (size_t i = input.length() - padding; i < input.length(); i++) {
-        if ((uint8_t)input.charAt(i) != padding) return input;
+bool AES256Encryption::decrypt(const uint8_t* input, size_t len, uint8_t* output, size_t outputCap,
+                               size_t* outputLen) {
+    if (!initialized || len == 0 || len % AesCipher::BLOCK_SIZE != 0 || outputCap < len) {
+        return false;
     }
 
-    return input.substring(0, input.length() - padding);
+    cipher.decryptEcb(input, output, len);
+    size_t padding = paddingOf(output + len - AesCipher::BLOCK_SIZE);
+    if (padding == 0) {
+        memset(output, 0, len);
+        return false;
+    }
+    *outputLen = len - padding;
+    return true;
 }
 
 String AES256Encryption::generateHMAC(const String& message) {
@@ -151,19 +190,24 @@ bool AES256Encryption::verifyHMAC(const String& message, const String& hmac) {
 
 bool AES256Encryption::rotateKey() {
     // Generate new random key using ESP32 hardware RNG
-    uint8_t newKey[32];
-    for (int i = 0; i < 32; i += 4) {
+    uint8_t newKey[AesCipher::KEY_SIZE];
+    for (size_t i = 0; i < sizeof(newKey); i += 4) {
         uint32_t randomValue = esp_random();
-        memcpy(&newKey[i], &randomValue, min(4, 32 - i));
+        memcpy(&newKey[i], &randomValue, 4);
     }
 
-    // Update key
-    aes.setKey(newKey, 32);
+    // Update key (the schedule is expanded once here)
+    initialized = cipher.setKey(newKey, sizeof(newKey));
+    memset(newKey, 0, sizeof(newKey));
 
     Serial.println("AES key rotated");
-    return true;
+    return initialized;
 }
 
 bool AES256Encryption::isInitialized() {
     return initialized;
-}
\ No newline at end of file
+}
+
+AesCipher& AES256Encryption::getCipher() {
+    return cipher;
+}
@@ -0,0 +1,677 @@
+// AES Cipher - AES-256 ECB/CBC/CTR/GCM over byte spans on mbedtls, AES-NI or portable tables
+#include <string.h>
+#include "aes_cipher.h"
+
+#if !defined(ARDUINO) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define AES_CIPHER_AESNI 1
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline void increment128(uint8_t* counter) {
+    for (int i = AesCipher::BLOCK_SIZE - 1; i >= 0; i--) {
+        if (++counter[i] != 0) break;
+    }
+}
+
+inline void xorBlock(uint8_t* out, const uint8_t* a, const uint8_t* b) {
+    for (size_t i = 0; i < AesCipher::BLOCK_SIZE; i++) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+} // namespace
+
+const char* AesCipher::backendName(AesBackend backend) {
+    switch (backend) {
+        case AES_BACKEND_PORTABLE: return "portable";
+        case AES_BACKEND_AESNI: return "aes-ni";
+        case AES_BACKEND_HARDWARE: return "hardware";
+    }
+    return "unknown";
+}
+
+AesBackend AesCipher::getBackend() const {
+    return backend;
+}
+
+bool AesCipher::hasKey() const {
+    return keyed;
+}
+
+#ifdef ARDUINO
+
+AesCipher::AesCipher() : keyed(false), backend(AES_BACKEND_HARDWARE) {
+    mbedtls_aes_init(&encryptContext);
+    mbedtls_aes_init(&decryptContext);
+    mbedtls_gcm_init(&gcm);
+}
+
+AesCipher::~AesCipher() {
+    clearKey();
+}
+
+bool AesCipher::setKey(const uint8_t* key, size_t keyLen) {
+    clearKey();
+    if (!key || keyLen != KEY_SIZE) {
+        return false;
+    }
+    if (mbedtls_aes_setkey_enc(&encryptContext, key, KEY_SIZE * 8) != 0 ||
+        mbedtls_aes_setkey_dec(&decryptContext, key, KEY_SIZE * 8) != 0 ||
+        mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, KEY_SIZE * 8) != 0) {
+        clearKey();
+        return false;
+    }
+    keyed = true;
+    return true;
+}
+
+void AesCipher::clearKey() {
+    mbedtls_aes_free(&encryptContext);
+    mbedtls_aes_free(&decryptContext);
+    mbedtls_gcm_free(&gcm);
+    mbedtls_aes_init(&encryptContext);
+    mbedtls_aes_init(&decryptContext);
+    mbedtls_gcm_init(&gcm);
+    keyed = false;
+}
+
+bool AesCipher::useBackend(AesBackend requested) {
+    return requested == AES_BACKEND_HARDWARE;
+}
+
+bool AesCipher::encryptEcb(const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed || len % BLOCK_SIZE != 0) {
+        return false;
+    }
+    for (size_t offset = 0; offset < len; offset += BLOCK_SIZE) {
+        mbedtls_aes_crypt_ecb(&encryptContext, MBEDTLS_AES_ENCRYPT, input + offset, output + offset);
+    }
+    return true;
+}
+
+bool AesCipher::decryptEcb(const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed || len % BLOCK_SIZE != 0) {
+        return false;
+    }
+    for (size_t offset = 0; offset < len; offset += BLOCK_SIZE) {
+        mbedtls_aes_crypt_ecb(&decryptContext, MBEDTLS_AES_DECRYPT, input + offset, output + offset);
+    }
+    return true;
+}
+
+bool AesCipher::encryptCbc(uint8_t* iv, const uint8_t* input, uint8_t* output, size_t len) {
+    return keyed && len % BLOCK_SIZE == 0 &&
+           mbedtls_aes_crypt_cbc(&encryptContext, MBEDTLS_AES_ENCRYPT, len, iv, input, output) == 0;
+}
+
+bool AesCipher::decryptCbc(uint8_t* iv, const uint8_t* input, uint8_t* output, size_t len) {
+    return keyed && len % BLOCK_SIZE == 0 &&
+           mbedtls_aes_crypt_cbc(&decryptContext, MBEDTLS_AES_DECRYPT, len, iv, input, output) == 0;
+}
+
+bool AesCipher::cryptCtr(const uint8_t* counter, const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed) {
+        return false;
+    }
+    uint8_t nonceCounter[BLOCK_SIZE];
+    uint8_t stream[BLOCK_SIZE];
+    size_t streamOffset = 0;
+    memcpy(nonceCounter, counter, BLOCK_SIZE);
+    return mbedtls_aes_crypt_ctr(&encryptContext, len, &streamOffset, nonceCounter, stream, input, output) == 0;
+}
+
+bool AesCipher::sealGcm(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* input,
+                        uint8_t* output, size_t len, uint8_t* tag) {
+    return keyed && mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, nonce, GCM_NONCE_SIZE, aad, aadLen,
+                                              input, output, GCM_TAG_SIZE, tag) == 0;
+}
+
+bool AesCipher::openGcm(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* input,
+                        uint8_t* output, size_t len, const uint8_t* tag) {
+    return keyed && mbedtls_gcm_auth_decrypt(&gcm, len, nonce, GCM_NONCE_SIZE, aad, aadLen, tag, GCM_TAG_SIZE,
+                                             input, output) == 0;
+}
+
+#else
+
+namespace {
+
+inline uint32_t getU32BE(const uint8_t* in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+inline void putU32BE(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+inline uint64_t getU64BE(const uint8_t* in) {
+    return ((uint64_t)getU32BE(in) << 32) | getU32BE(in + 4);
+}
+
+inline void putU64BE(uint8_t* out, uint64_t value) {
+    putU32BE(out, (uint32_t)(value >> 32));
+    putU32BE(out + 4, (uint32_t)value);
+}
+
+inline uint8_t xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+}
+
+uint8_t gfMultiply(uint8_t a, uint8_t b) {
+    uint8_t product = 0;
+    while (b) {
+        if (b & 1) product ^= a;
+        a = xtime(a);
+        b >>= 1;
+    }
+    return product;
+}
+
+inline uint32_t rotateRight(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+// S-boxes and round tables, derived once rather than transcribed
+struct AesTables {
+    uint8_t sbox[256];
+    uint8_t inverse[256];
+    uint32_t encrypt[4][256];
+    uint32_t decrypt[4][256];
+
+    AesTables() {
+        uint8_t p = 1;
+        uint8_t q = 1;
+        do {
+            p = p ^ xtime(p);                       // p * 3
+            q ^= q << 1;                            // q / 3
+            q ^= q << 2;
+            q ^= q << 4;
+            if (q & 0x80) q ^= 0x09;
+            uint8_t affine = q ^ (uint8_t)((q << 1) | (q >> 7)) ^ (uint8_t)((q << 2) | (q >> 6)) ^
+                             (uint8_t)((q << 3) | (q >> 5)) ^ (uint8_t)((q << 4) | (q >> 4));
+            sbox[p] = affine ^ 0x63;
+        } while (p != 1);
+        sbox[0] = 0x63;
+
+        for (int x = 0; x < 256; x++) {
+            inverse[sbox[x]] = (uint8_t)x;
+        }
+        for (int x = 0; x < 256; x++) {
+            uint8_t s = sbox[x];
+            uint8_t i = inverse[x];
+            encrypt[0][x] = ((uint32_t)xtime(s) << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) | (uint8_t)(xtime(s) ^ s);
+            decrypt[0][x] = ((uint32_t)gfMultiply(i, 0x0E) << 24) | ((uint32_t)gfMultiply(i, 0x09) << 16) |
+                            ((uint32_t)gfMultiply(i, 0x0D) << 8) | gfMultiply(i, 0x0B);
+            for (int t = 1; t < 4; t++) {
+                encrypt[t][x] = rotateRight(encrypt[0][x], 8 * t);
+                decrypt[t][x] = rotateRight(decrypt[0][x], 8 * t);
+            }
+        }
+    }
+};
+
+const AesTables& tables() {
+    static const AesTables instance;
+    return instance;
+}
+
+// Reduction of the four bits shifted out of a GHASH product
+const uint64_t GHASH_LAST4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+#ifdef AES_CIPHER_AESNI
+bool cpuHasAesni() {
+    static const bool present = __builtin_cpu_supports("aes");
+    return present;
+}
+
+__attribute__((target("aes,sse2")))
+void aesniEncrypt(const uint8_t* keys, const uint8_t* input, uint8_t* output, size_t blocks) {
+    __m128i k[15];
+    for (int r = 0; r < 15; r++) {
+        k[r] = _mm_load_si128((const __m128i*)(keys + 16 * r));
+    }
+
+    // Four blocks in flight hide the instruction latency
+    for (; blocks >= 4; blocks -= 4, input += 64, output += 64) {
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input), k[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(input + 16)), k[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(input + 32)), k[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(input + 48)), k[0]);
+        for (int r = 1; r < 14; r++) {
+            b0 = _mm_aesenc_si128(b0, k[r]);
+            b1 = _mm_aesenc_si128(b1, k[r]);
+            b2 = _mm_aesenc_si128(b2, k[r]);
+            b3 = _mm_aesenc_si128(b3, k[r]);
+        }
+        _mm_storeu_si128((__m128i*)output, _mm_aesenclast_si128(b0, k[14]));
+        _mm_storeu_si128((__m128i*)(output + 16), _mm_aesenclast_si128(b1, k[14]));
+        _mm_storeu_si128((__m128i*)(output + 32), _mm_aesenclast_si128(b2, k[14]));
+        _mm_storeu_si128((__m128i*)(output + 48), _mm_aesenclast_si128(b3, k[14]));
+    }
+    for (; blocks > 0; blocks--, input += 16, output += 16) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input), k[0]);
+        for (int r = 1; r < 14; r++) {
+            b = _mm_aesenc_si128(b, k[r]);
+        }
+        _mm_storeu_si128((__m128i*)output, _mm_aesenclast_si128(b, k[14]));
+    }
+}
+
+__attribute__((target("aes,sse2")))
+void aesniDecrypt(const uint8_t* keys, const uint8_t* input, uint8_t* output, size_t blocks) {
+    __m128i k[15];
+    for (int r = 0; r < 15; r++) {
+        k[r] = _mm_load_si128((const __m128i*)(keys + 16 * r));
+    }
+
+    for (; blocks >= 4; blocks -= 4, input += 64, output += 64) {
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input), k[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(input + 16)), k[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(input + 32)), k[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(input + 48)), k[0]);
+        for (int r = 1; r < 14; r++) {
+            b0 = _mm_aesdec_si128(b0, k[r]);
+            b1 = _mm_aesdec_si128(b1, k[r]);
+            b2 = _mm_aesdec_si128(b2, k[r]);
+            b3 = _mm_aesdec_si128(b3, k[r]);
+        }
+        _mm_storeu_si128((__m128i*)output, _mm_aesdeclast_si128(b0, k[14]));
+        _mm_storeu_si128((__m128i*)(output + 16), _mm_aesdeclast_si128(b1, k[14]));
+        _mm_storeu_si128((__m128i*)(output + 32), _mm_aesdeclast_si128(b2, k[14]));
+        _mm_storeu_si128((__m128i*)(output + 48), _mm_aesdeclast_si128(b3, k[14]));
+    }
+    for (; blocks > 0; blocks--, input += 16, output += 16) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input), k[0]);
+        for (int r = 1; r < 14; r++) {
+            b = _mm_aesdec_si128(b, k[r]);
+        }
+        _mm_storeu_si128((__m128i*)output, _mm_aesdeclast_si128(b, k[14]));
+    }
+}
+
+__attribute__((target("aes,sse2")))
+void aesniInverseMix(const uint8_t* input, uint8_t* output) {
+    _mm_store_si128((__m128i*)output, _mm_aesimc_si128(_mm_load_si128((const __m128i*)input)));
+}
+#endif
+
+} // namespace
+
+AesCipher::AesCipher() : keyed(false), backend(AES_BACKEND_PORTABLE) {
+#ifdef AES_CIPHER_AESNI
+    if (cpuHasAesni()) backend = AES_BACKEND_AESNI;
+#endif
+    clearKey();
+}
+
+AesCipher::~AesCipher() {
+    clearKey();
+}
+
+bool AesCipher::setKey(const uint8_t* newKey, size_t keyLen) {
+    clearKey();
+    if (!newKey || keyLen != KEY_SIZE) {
+        return false;
+    }
+    memcpy(key, newKey, KEY_SIZE);
+    expandKey();
+    keyed = true;
+    return true;
+}
+
+void AesCipher::clearKey() {
+    volatile uint8_t* wipe = (volatile uint8_t*)key;
+    for (size_t i = 0; i < sizeof(key); i++) wipe[i] = 0;
+    memset(encryptKeys, 0, sizeof(encryptKeys));
+    memset(decryptKeys, 0, sizeof(decryptKeys));
+    memset(niEncryptKeys, 0, sizeof(niEncryptKeys));
+    memset(niDecryptKeys, 0, sizeof(niDecryptKeys));
+    memset(ghashHigh, 0, sizeof(ghashHigh));
+    memset(ghashLow, 0, sizeof(ghashLow));
+    keyed = false;
+}
+
+bool AesCipher::useBackend(AesBackend requested) {
+    if (requested == AES_BACKEND_HARDWARE) {
+        return false;
+    }
+#ifdef AES_CIPHER_AESNI
+    if (requested == AES_BACKEND_AESNI && !cpuHasAesni()) {
+        return false;
+    }
+#else
+    if (requested == AES_BACKEND_AESNI) {
+        return false;
+    }
+#endif
+    backend = requested;
+    return true;
+}
+
+void AesCipher::expandKey() {
+    const AesTables& t = tables();
+    const uint8_t* sbox = t.sbox;
+
+    // FIPS-197 schedule for Nk = 8
+    uint32_t* w = encryptKeys;
+    for (int i = 0; i < 8; i++) {
+        w[i] = getU32BE(key + 4 * i);
+    }
+    uint8_t rcon = 0x01;
+    for (int i = 8; i < 4 * (ROUNDS + 1); i++) {
+        uint32_t temp = w[i - 1];
+        if (i % 8 == 0) {
+            temp = ((uint32_t)sbox[(temp >> 16) & 0xFF] << 24) | ((uint32_t)sbox[(temp >> 8) & 0xFF] << 16) |
+                   ((uint32_t)sbox[temp & 0xFF] << 8) | sbox[temp >> 24];
+            temp ^= (uint32_t)rcon << 24;
+            rcon = xtime(rcon);
+        } else if (i % 8 == 4) {
+            temp = ((uint32_t)sbox[temp >> 24] << 24) | ((uint32_t)sbox[(temp >> 16) & 0xFF] << 16) |
+                   ((uint32_t)sbox[(temp >> 8) & 0xFF] << 8) | sbox[temp & 0xFF];
+        }
+        w[i] = w[i - 8] ^ temp;
+    }
+
+    // Equivalent inverse cipher: reversed rounds, InvMixColumns on the inner ones
+    for (int round = 0; round <= ROUNDS; round++) {
+        for (int c = 0; c < 4; c++) {
+            uint32_t word = encryptKeys[4 * (ROUNDS - round) + c];
+            if (round > 0 && round < ROUNDS) {
+                word = t.decrypt[0][sbox[word >> 24]] ^ t.decrypt[1][sbox[(word >> 16) & 0xFF]] ^
+                       t.decrypt[2][sbox[(word >> 8) & 0xFF]] ^ t.decrypt[3][sbox[word & 0xFF]];
+            }
+            decryptKeys[4 * round + c] = word;
+        }
+    }
+
+    for (int i = 0; i < 4 * (ROUNDS + 1); i++) {
+        putU32BE(niEncryptKeys + 4 * i, encryptKeys[i]);
+    }
+#ifdef AES_CIPHER_AESNI
+    if (cpuHasAesni()) {
+        memcpy(niDecryptKeys, niEncryptKeys + 16 * ROUNDS, 16);
+        for (int round = 1; round < ROUNDS; round++) {
+            aesniInverseMix(niEncryptKeys + 16 * (ROUNDS - round), niDecryptKeys + 16 * round);
+        }
+        memcpy(niDecryptKeys + 16 * ROUNDS, niEncryptKeys, 16);
+    }
+#endif
+
+    // GHASH key H = E(0) and its 4-bit multiples
+    uint8_t h[BLOCK_SIZE] = {0};
+    encryptBlocks(h, h, 1);
+    uint64_t high = getU64BE(h);
+    uint64_t low = getU64BE(h + 8);
+    ghashHigh[8] = high;
+    ghashLow[8] = low;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint64_t carry = (low & 1) * 0xE1000000ULL;
+        low = (high << 63) | (low >> 1);
+        high = (high >> 1) ^ (carry << 32);
+        ghashHigh[i] = high;
+        ghashLow[i] = low;
+    }
+    for (int i = 2; i <= 8; i *= 2) {
+        for (int j = 1; j < i; j++) {
+            ghashHigh[i + j] = ghashHigh[i] ^ ghashHigh[j];
+            ghashLow[i + j] = ghashLow[i] ^ ghashLow[j];
+        }
+    }
+}
+
+void AesCipher::encryptBlocks(const uint8_t* input, uint8_t* output, size_t blocks) {
+#ifdef AES_CIPHER_AESNI
+    if (backend == AES_BACKEND_AESNI) {
+        aesniEncrypt(niEncryptKeys, input, output, blocks);
+        return;
+    }
+#endif
+    const AesTables& t = tables();
+    const uint32_t (*te)[256] = t.encrypt;
+    const uint8_t* sbox = t.sbox;
+    const uint32_t* rk;
+
+    for (; blocks > 0; blocks--, input += BLOCK_SIZE, output += BLOCK_SIZE) {
+        rk = encryptKeys;
+        uint32_t s0 = getU32BE(input) ^ rk[0];
+        uint32_t s1 = getU32BE(input + 4) ^ rk[1];
+        uint32_t s2 = getU32BE(input + 8) ^ rk[2];
+        uint32_t s3 = getU32BE(input + 12) ^ rk[3];
+        for (int round = 1; round < ROUNDS; round++) {
+            rk += 4;
+            uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xFF] ^ te[2][(s2 >> 8) & 0xFF] ^ te[3][s3 & 0xFF] ^ rk[0];
+            uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xFF] ^ te[2][(s3 >> 8) & 0xFF] ^ te[3][s0 & 0xFF] ^ rk[1];
+            uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xFF] ^ te[2][(s0 >> 8) & 0xFF] ^ te[3][s1 & 0xFF] ^ rk[2];
+            uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xFF] ^ te[2][(s1 >> 8) & 0xFF] ^ te[3][s2 & 0xFF] ^ rk[3];
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+        rk += 4;
+        putU32BE(output, ((uint32_t)sbox[s0 >> 24] << 24 | (uint32_t)sbox[(s1 >> 16) & 0xFF] << 16 |
+                          (uint32_t)sbox[(s2 >> 8) & 0xFF] << 8 | sbox[s3 & 0xFF]) ^ rk[0]);
+        putU32BE(output + 4, ((uint32_t)sbox[s1 >> 24] << 24 | (uint32_t)sbox[(s2 >> 16) & 0xFF] << 16 |
+                              (uint32_t)sbox[(s3 >> 8) & 0xFF] << 8 | sbox[s0 & 0xFF]) ^ rk[1]);
+        putU32BE(output + 8, ((uint32_t)sbox[s2 >> 24] << 24 | (uint32_t)sbox[(s3 >> 16) & 0xFF] << 16 |
+                              (uint32_t)sbox[(s0 >> 8) & 0xFF] << 8 | sbox[s1 & 0xFF]) ^ rk[2]);
+        putU32BE(output + 12, ((uint32_t)sbox[s3 >> 24] << 24 | (uint32_t)sbox[(s0 >> 16) & 0xFF] << 16 |
+                               (uint32_t)sbox[(s1 >> 8) & 0xFF] << 8 | sbox[s2 & 0xFF]) ^ rk[3]);
+    }
+}
+
+void AesCipher::decryptBlocks(const uint8_t* input, uint8_t* output, size_t blocks) {
+#ifdef AES_CIPHER_AESNI
+    if (backend == AES_BACKEND_AESNI) {
+        aesniDecrypt(niDecryptKeys, input, output, blocks);
+        return;
+    }
+#endif
+    const AesTables& t = tables();
+    const uint32_t (*td)[256] = t.decrypt;
+    const uint8_t* inverse = t.inverse;
+    const uint32_t* rk;
+
+    for (; blocks > 0; blocks--, input += BLOCK_SIZE, output += BLOCK_SIZE) {
+        rk = decryptKeys;
+        uint32_t s0 = getU32BE(input) ^ rk[0];
+        uint32_t s1 = getU32BE(input + 4) ^ rk[1];
+        uint32_t s2 = getU32BE(input + 8) ^ rk[2];
+        uint32_t s3 = getU32BE(input + 12) ^ rk[3];
+        for (int round = 1; round < ROUNDS; round++) {
+            rk += 4;
+            uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xFF] ^ td[2][(s2 >> 8) & 0xFF] ^ td[3][s1 & 0xFF] ^ rk[0];
+            uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xFF] ^ td[2][(s3 >> 8) & 0xFF] ^ td[3][s2 & 0xFF] ^ rk[1];
+            uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xFF] ^ td[2][(s0 >> 8) & 0xFF] ^ td[3][s3 & 0xFF] ^ rk[2];
+            uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xFF] ^ td[2][(s1 >> 8) & 0xFF] ^ td[3][s0 & 0xFF] ^ rk[3];
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+        rk += 4;
+        putU32BE(output, ((uint32_t)inverse[s0 >> 24] << 24 | (uint32_t)inverse[(s3 >> 16) & 0xFF] << 16 |
+                          (uint32_t)inverse[(s2 >> 8) & 0xFF] << 8 | inverse[s1 & 0xFF]) ^ rk[0]);
+        putU32BE(output + 4, ((uint32_t)inverse[s1 >> 24] << 24 | (uint32_t)inverse[(s0 >> 16) & 0xFF] << 16 |
+                              (uint32_t)inverse[(s3 >> 8) & 0xFF] << 8 | inverse[s2 & 0xFF]) ^ rk[1]);
+        putU32BE(output + 8, ((uint32_t)inverse[s2 >> 24] << 24 | (uint32_t)inverse[(s1 >> 16) & 0xFF] << 16 |
+                              (uint32_t)inverse[(s0 >> 8) & 0xFF] << 8 | inverse[s3 & 0xFF]) ^ rk[2]);
+        putU32BE(output + 12, ((uint32_t)inverse[s3 >> 24] << 24 | (uint32_t)inverse[(s2 >> 16) & 0xFF] << 16 |
+                               (uint32_t)inverse[(s1 >> 8) & 0xFF] << 8 | inverse[s0 & 0xFF]) ^ rk[3]);
+    }
+}
+
+bool AesCipher::encryptEcb(const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed || len % BLOCK_SIZE != 0) {
+        return false;
+    }
+    encryptBlocks(input, output, len / BLOCK_SIZE);
+    return true;
+}
+
+bool AesCipher::decryptEcb(const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed || len % BLOCK_SIZE != 0) {
+        return false;
+    }
+    decryptBlocks(input, output, len / BLOCK_SIZE);
+    return true;
+}
+
+bool AesCipher::encryptCbc(uint8_t* iv, const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed || len % BLOCK_SIZE != 0) {
+        return false;
+    }
+
+    // Each block depends on the last, so this one stays serial
+    for (size_t offset = 0; offset < len; offset += BLOCK_SIZE) {
+        xorBlock(output + offset, input + offset, iv);
+        encryptBlocks(output + offset, output + offset, 1);
+        memcpy(iv, output + offset, BLOCK_SIZE);
+    }
+    return true;
+}
+
+bool AesCipher::decryptCbc(uint8_t* iv, const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed || len % BLOCK_SIZE != 0) {
+        return false;
+    }
+
+    uint8_t plain[16 * BLOCK_SIZE];
+    uint8_t previous[BLOCK_SIZE];
+    for (size_t offset = 0; offset < len; offset += sizeof(plain)) {
+        size_t chunk = len - offset < sizeof(plain) ? len - offset : sizeof(plain);
+        decryptBlocks(input + offset, plain, chunk / BLOCK_SIZE);
+        for (size_t i = 0; i < chunk; i += BLOCK_SIZE) {
+            // Read the ciphertext before it is overwritten in place
+            memcpy(previous, input + offset + i, BLOCK_SIZE);
+            xorBlock(output + offset + i, plain + i, iv);
+            memcpy(iv, previous, BLOCK_SIZE);
+        }
+    }
+    return true;
+}
+
+bool AesCipher::cryptCtr(const uint8_t* counter, const uint8_t* input, uint8_t* output, size_t len) {
+    if (!keyed) {
+        return false;
+    }
+
+    uint8_t block[BLOCK_SIZE];
+    uint8_t stream[16 * BLOCK_SIZE];
+    memcpy(block, counter, BLOCK_SIZE);
+    for (size_t offset = 0; offset < len; offset += sizeof(stream)) {
+        size_t chunk = len - offset < sizeof(stream) ? len - offset : sizeof(stream);
+        size_t blocks = (chunk + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (size_t i = 0; i < blocks; i++) {
+            memcpy(stream + i * BLOCK_SIZE, block, BLOCK_SIZE);
+            increment128(block);
+        }
+        encryptBlocks(stream, stream, blocks);
+        for (size_t i = 0; i < chunk; i++) {
+            output[offset + i] = input[offset + i] ^ stream[i];
+        }
+    }
+    return true;
+}
+
+void AesCipher::ghashMultiply(uint8_t* x) {
+    uint8_t low = x[15] & 0x0F;
+    uint64_t zh = ghashHigh[low];
+    uint64_t zl = ghashLow[low];
+
+    for (int i = 15; i >= 0; i--) {
+        low = x[i] & 0x0F;
+        uint8_t high = x[i] >> 4;
+        if (i != 15) {
+            uint8_t rem = (uint8_t)(zl & 0x0F);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (GHASH_LAST4[rem] << 48);
+            zh ^= ghashHigh[low];
+            zl ^= ghashLow[low];
+        }
+        uint8_t rem = (uint8_t)(zl & 0x0F);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (GHASH_LAST4[rem] << 48);
+        zh ^= ghashHigh[high];
+        zl ^= ghashLow[high];
+    }
+    putU64BE(x, zh);
+    putU64BE(x + 8, zl);
+}
+
+void AesCipher::ghash(uint8_t* state, const uint8_t* data, size_t len) {
+    for (size_t offset = 0; offset < len; offset += BLOCK_SIZE) {
+        size_t chunk = len - offset < BLOCK_SIZE ? len - offset : BLOCK_SIZE;
+        for (size_t i = 0; i < chunk; i++) {
+            state[i] ^= data[offset + i];
+        }
+        ghashMultiply(state);
+    }
+}
+
+void AesCipher::gcmTag(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* ciphertext,
+                       size_t len, uint8_t* tag) {
+    uint8_t state[BLOCK_SIZE] = {0};
+    ghash(state, aad, aadLen);
+    ghash(state, ciphertext, len);
+
+    uint8_t lengths[BLOCK_SIZE];
+    putU64BE(lengths, (uint64_t)aadLen * 8);
+    putU64BE(lengths + 8, (uint64_t)len * 8);
+    ghash(state, lengths, sizeof(lengths));
+
+    uint8_t j0[BLOCK_SIZE] = {0};
+    memcpy(j0, nonce, GCM_NONCE_SIZE);
+    j0[15] = 1;
+    encryptBlocks(j0, j0, 1);
+    xorBlock(tag, state, j0);
+}
+
+bool AesCipher::sealGcm(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* input,
+                        uint8_t* output, size_t len, uint8_t* tag) {
+    if (!keyed || !nonce || !tag || (aadLen > 0 && !aad)) {
+        return false;
+    }
+
+    // Payload counter starts one past J0 = nonce || 1
+    uint8_t counter[BLOCK_SIZE] = {0};
+    memcpy(counter, nonce, GCM_NONCE_SIZE);
+    counter[15] = 2;
+    cryptCtr(counter, input, output, len);
+    gcmTag(nonce, aad, aadLen, output, len, tag);
+    return true;
+}
+
+bool AesCipher::openGcm(const uint8_t* nonce, const uint8_t* aad, size_t aadLen, const uint8_t* input,
+                        uint8_t* output, size_t len, const uint8_t* tag) {
+    if (!keyed || !nonce || !tag || (aadLen > 0 && !aad)) {
+        return false;
+    }
+
+    uint8_t expected[GCM_TAG_SIZE];
+    gcmTag(nonce, aad, aadLen, input, len, expected);
+    uint8_t diff = 0;
+    for (size_t i = 0; i < GCM_TAG_SIZE; i++) {
+        diff |= expected[i] ^ tag[i];
+    }
+    if (diff != 0) {
+        memset(output, 0, len);
+        return false;
+    }
+
+    uint8_t counter[BLOCK_SIZE] = {0};
+    memcpy(counter, nonce, GCM_NONCE_SIZE);
+    counter[15] = 2;
+    return cryptCtr(counter, input, output, len);
+}
+
+#endif
@@ -1,13 +1,15 @@
 #include "hmac_handler.h"
 
 HMACHandler::HMACHandler(SecureKeyManager* keyMgr) 
-    : keyManager(keyMgr), replayCacheIndex(0) {
+    : keyManager(keyMgr), midstatesReady(false), timeSource(nullptr), timeSourceContext(nullptr) {
     memset(hmacKey, 0, sizeof(hmacKey));
-    memset(replayCache, 0, sizeof(replayCache));
+    mbedtls_sha256_init(&innerMidstate);
+    mbedtls_sha256_init(&outerMidstate);
 }
 
 HMACHandler::~HMACHandler() {
-    mbedtls_md_free(&md_ctx);
+    mbedtls_sha256_free(&innerMidstate);
+    mbedtls_sha256_free(&outerMidstate);
     memset(hmacKey, 0, sizeof(hmacKey)); // Clear sensitive data
 }
 
@@ -17,57 +19,77 @@ bool HMACHandler::begin() {
         return false;
     }
     
+    if (!reloadKey()) {
+        return false;
+    }
+    
+    Serial.println("[HMACHandler] Initialized successfully");
+    return true;
+}
+
+bool HMACHandler::reloadKey() {
     // Load HMAC key from secure storage
-    if (!keyManager->getHMACKey(hmacKey, sizeof(hmacKey))) {
+    if (!keyManager || !keyManager->getHMACKey(hmacKey, sizeof(hmacKey))) {
         Serial.println("[HMACHandler] Failed to load HMAC key");
         return false;
     }
     
-    // Initialize mbedtls MD context
-    mbedtls_md_init(&md_ctx);
+    loadMidstates();
+    return true;
+}
+
+void HMACHandler::loadMidstates() {
+    // RFC 2104: the key (shorter than a block) is zero-padded to 64 bytes
+    uint8_t pad[64];
     
-    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-    if (md_info == NULL) {
-        Serial.println("[HMACHandler] Failed to get SHA256 MD info");
-        return false;
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] = (i < sizeof(hmacKey) ? hmacKey[i] : 0) ^ 0x36;
     }
+    mbedtls_sha256_starts(&innerMidstate, 0);
+    mbedtls_sha256_update(&innerMidstate, pad, sizeof(pad));
     
-    int ret = mbedtls_md_setup(&md_ctx, md_info, 1); // 1 = HMAC mode
-    if (ret != 0) {
-        Serial.printf("[HMACHandler] MD setup failed: -0x%04x\n", -ret);
-        return false;
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] = (i < sizeof(hmacKey) ? hmacKey[i] : 0) ^ 0x5c;
     }
+    mbedtls_sha256_starts(&outerMidstate, 0);
+    mbedtls_sha256_update(&outerMidstate, pad, sizeof(pad));
     
-    Serial.println("[HMACHandler] Initialized successfully");
-    return true;
+    memset(pad, 0, sizeof(pad));
+    midstatesReady = true;
 }
 
-bool HMACHandler::computeHMAC(const uint8_t* data, size_t dataLen,
-                             const uint8_t* key, size_t keyLen,
-                             uint8_t* hmac, size_t* hmacLen) {
-    if (!data || !key || !hmac || !hmacLen) {
+bool HMACHandler::computeHMAC(const HMACSegment* segments, size_t count,
+                             const uint8_t* stamp, uint8_t* hmac) {
+    if ((!segments && count > 0) || !hmac) {
         return false;
     }
     
-    int ret = mbedtls_md_hmac_starts(&md_ctx, key, keyLen);
-    if (ret != 0) {
-        Serial.printf("[HMACHandler] HMAC start failed: -0x%04x\n", -ret);
+    if (!midstatesReady) {
+        Serial.println("[HMACHandler] HMAC key not loaded");
         return false;
     }
     
-    ret = mbedtls_md_hmac_update(&md_ctx, data, dataLen);
-    if (ret != 0) {
-        Serial.printf("[HMACHandler] HMAC update failed: -0x%04x\n", -ret);
-        return false;
+    // Inner hash resumes after the ipad block; each segment goes straight in
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_clone(&ctx, &innerMidstate);
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].len > 0) {
+            mbedtls_sha256_update(&ctx, segments[i].data, segments[i].len);
+        }
     }
-    
-    ret = mbedtls_md_hmac_finish(&md_ctx, hmac);
-    if (ret != 0) {
-        Serial.printf("[HMACHandler] HMAC finish failed: -0x%04x\n", -ret);
-        return false;
+    if (stamp) {
+        mbedtls_sha256_update(&ctx, stamp, TIMESTAMP_SIZE + NONCE_SIZE);
     }
+    uint8_t inner[HMAC_SIZE];
+    mbedtls_sha256_finish(&ctx, inner);
+    
+    // Outer hash resumes after the opad block
+    mbedtls_sha256_clone(&ctx, &outerMidstate);
+    mbedtls_sha256_update(&ctx, inner, sizeof(inner));
+    mbedtls_sha256_finish(&ctx, hmac);
+    mbedtls_sha256_free(&ctx);
     
-    *hmacLen = HMAC_SIZE;
     return true;
 }
 
@@ -78,28 +100,19 @@ bool HMACHandler::signMessage(const uint8_t* message, size_t messageLen,
         return false;
     }
     
-    // Create buffer with message + timestamp + nonce
+    // Signed as message + timestamp + nonce
+    uint8_t stamp[TIMESTAMP_SIZE + NONCE_SIZE];
     uint32_t timestamp = getCurrentTimestamp();
     uint32_t nonce = generateNonce();
+    memcpy(stamp, &timestamp, TIMESTAMP_SIZE);
+    memcpy(stamp + TIMESTAMP_SIZE, &nonce, NONCE_SIZE);
     
-    size_t totalLen = messageLen + TIMESTAMP_SIZE + NONCE_SIZE;
-    uint8_t* buffer = (uint8_t*)malloc(totalLen);
-    if (!buffer) {
-        Serial.println("[HMACHandler] Memory allocation failed");
+    HMACSegment segment = {message, messageLen};
+    if (!computeHMAC(&segment, 1, stamp, signature)) {
         return false;
     }
-    
-    // Combine message + timestamp + nonce
-    memcpy(buffer, message, messageLen);
-    memcpy(buffer + messageLen, &timestamp, TIMESTAMP_SIZE);
-    memcpy(buffer + messageLen + TIMESTAMP_SIZE, &nonce, NONCE_SIZE);
-    
-    // Compute HMAC
-    bool result = computeHMAC(buffer, totalLen, hmacKey, sizeof(hmacKey), 
-                             signature, signatureLen);
-    
-    free(buffer);
-    return result;
+    *signatureLen = HMAC_SIZE;
+    return true;
 }
 
 bool HMACHandler::verifyMessage(const uint8_t* message, size_t messageLen,
@@ -127,10 +140,8 @@ bool HMACHandler::verifyMessage(const uint8_t* message, size_t messageLen,
     
     // Compute HMAC for verification
     uint8_t computedHMAC[HMAC_SIZE];
-    size_t computedLen;
-    
-    if (!computeHMAC(message, messageLen, hmacKey, sizeof(hmacKey),
-                    computedHMAC, &computedLen)) {
+    HMACSegment segment = {message, messageLen};
+    if (!computeHMAC(&segment, 1, nullptr, computedHMAC)) {
         Serial.println("[HMACHandler] Failed to compute verification HMAC");
         return false;
     }
@@ -152,131 +163,227 @@ bool HMACHandler::verifyMessage(const uint8_t* message, size_t messageLen,
     return true;
 }
 
-bool HMACHandler::appendHMAC(const uint8_t* message, size_t messageLen,
-                            uint8_t* output, size_t* outputLen) {
-    if (!message || !output || !outputLen) {
+bool HMACHandler::sealSegments(const HMACSegment* segments, size_t count,
+                              uint8_t* trailer, size_t trailerCap, size_t* trailerLen) {
+    if (!trailer || !trailerLen || trailerCap < OVERHEAD) {
         return false;
     }
     
     uint32_t timestamp = getCurrentTimestamp();
     uint32_t nonce = generateNonce();
+    memcpy(trailer, &timestamp, TIMESTAMP_SIZE);
+    memcpy(trailer + TIMESTAMP_SIZE, &nonce, NONCE_SIZE);
     
-    // Copy message
-    memcpy(output, message, messageLen);
-    
-    // Append timestamp and nonce
-    memcpy(output + messageLen, &timestamp, TIMESTAMP_SIZE);
-    memcpy(output + messageLen + TIMESTAMP_SIZE, &nonce, NONCE_SIZE);
-    
-    size_t dataLen = messageLen + TIMESTAMP_SIZE + NONCE_SIZE;
-    
-    // Compute and append HMAC
-    uint8_t hmac[HMAC_SIZE];
-    size_t hmacLen;
-    
-    if (!computeHMAC(output, dataLen, hmacKey, sizeof(hmacKey), hmac, &hmacLen)) {
+    // Timestamp and nonce are read back from the trailer itself
+    if (!computeHMAC(segments, count, trailer, trailer + TIMESTAMP_SIZE + NONCE_SIZE)) {
         return false;
     }
-    
-    memcpy(output + dataLen, hmac, HMAC_SIZE);
-    *outputLen = dataLen + HMAC_SIZE;
-    
+    *trailerLen = OVERHEAD;
     return true;
 }
 
-bool HMACHandler::verifyAndExtract(const uint8_t* signedMessage, size_t signedLen,
-                                  uint8_t* message, size_t* messageLen) {
-    if (!signedMessage || !message || !messageLen) {
-        return false;
-    }
-    
-    if (signedLen < OVERHEAD) {
-        Serial.println("[HMACHandler] Signed message too short");
-        return false;
-    }
-    
-    // Extract HMAC (last 32 bytes)
-    const uint8_t* receivedHMAC = signedMessage + signedLen - HMAC_SIZE;
-    
-    // Extract timestamp and nonce
-    size_t dataLen = signedLen - HMAC_SIZE;
+bool HMACHandler::authenticate(const HMACSegment* segments, size_t count, const uint8_t* trailer,
+                              uint32_t peer, const uint32_t* sequence, uint32_t now,
+                              HMACReplayVerdict* verdict) {
     uint32_t timestamp, nonce;
-    memcpy(&timestamp, signedMessage + dataLen - TIMESTAMP_SIZE - NONCE_SIZE, TIMESTAMP_SIZE);
-    memcpy(&nonce, signedMessage + dataLen - NONCE_SIZE, NONCE_SIZE);
-    
-    // Check replay attack
-    if (isReplayAttack(timestamp, nonce)) {
-        Serial.println("[HMACHandler] Replay attack detected!");
+    memcpy(&timestamp, trailer, TIMESTAMP_SIZE);
+    memcpy(&nonce, trailer + TIMESTAMP_SIZE, NONCE_SIZE);
+    
+    // Check replay attack before spending a hash on the message
+    *verdict = sequence
+        ? replayFilter.checkSequence(peer, *sequence, timestamp, now)
+        : replayFilter.checkNonce(peer, timestamp, nonce, now);
+    if (*verdict != REPLAY_ACCEPT) {
         return false;
     }
     
     // Verify HMAC
     uint8_t computedHMAC[HMAC_SIZE];
-    size_t computedLen;
-    
-    if (!computeHMAC(signedMessage, dataLen, hmacKey, sizeof(hmacKey),
-                    computedHMAC, &computedLen)) {
+    if (!computeHMAC(segments, count, trailer, computedHMAC)) {
         return false;
     }
     
     // Constant-time comparison
+    const uint8_t* receivedHMAC = trailer + TIMESTAMP_SIZE + NONCE_SIZE;
     int diff = 0;
     for (size_t i = 0; i < HMAC_SIZE; i++) {
         diff |= (receivedHMAC[i] ^ computedHMAC[i]);
     }
     
     if (diff != 0) {
+        return false;
+    }
+    
+    // Only authentic messages reach the replay filter
+    if (sequence) {
+        replayFilter.recordSequence(peer, *sequence, timestamp, now);
+    } else {
+        replayFilter.recordNonce(peer, timestamp, nonce);
+    }
+    
+    return true;
+}
+
+bool HMACHandler::checkTrailer(const HMACSegment* segments, size_t count, const uint8_t* trailer,
+                              uint32_t peer, const uint32_t* sequence) {
+    HMACReplayVerdict verdict;
+    if (authenticate(segments, count, trailer, peer, sequence, getCurrentTimestamp(), &verdict)) {
+        return true;
+    }
+    
+    if (verdict != REPLAY_ACCEPT) {
+        Serial.printf("[HMACHandler] Replay attack detected! (%s)\n", HMACReplayFilter::verdictName(verdict));
+    } else {
         Serial.println("[HMACHandler] HMAC verification failed");
+    }
+    return false;
+}
+
+size_t HMACHandler::verifyMany(HMACFrame* frames, size_t count) {
+    if (!frames) {
+        return 0;
+    }
+    
+    // One clock read and one log line for the burst; frames are checked in
+    // order, so a duplicate inside the batch is caught like any other replay
+    uint32_t now = getCurrentTimestamp();
+    size_t verified = 0;
+    size_t replayed = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        HMACFrame& frame = frames[i];
+        frame.verified = false;
+        frame.messageLen = 0;
+        if (!frame.sealed || frame.sealedLen < OVERHEAD) {
+            continue;
+        }
+        
+        HMACSegment segment = {frame.sealed, frame.sealedLen - OVERHEAD};
+        HMACReplayVerdict verdict;
+        if (authenticate(&segment, 1, frame.sealed + segment.len, frame.peer,
+                         frame.sequenced ? &frame.sequence : nullptr, now, &verdict)) {
+            frame.verified = true;
+            frame.messageLen = segment.len;
+            verified++;
+        } else if (verdict != REPLAY_ACCEPT) {
+            replayed++;
+        }
+    }
+    
+    if (verified < count) {
+        Serial.printf("[HMACHandler] %u of %u frames rejected (%u replayed)\n",
+                     (unsigned)(count - verified), (unsigned)count, (unsigned)replayed);
+    }
+    return verified;
+}
+
+bool HMACHandler::verifySegments(const HMACSegment* segments, size_t count,
+                                const uint8_t* trailer, size_t trailerLen) {
+    if (!trailer || trailerLen != OVERHEAD) {
+        return false;
+    }
+    return checkTrailer(segments, count, trailer, 0, nullptr);
+}
+
+bool HMACHandler::seal(uint8_t* buffer, size_t messageLen, size_t bufferCap, size_t* sealedLen) {
+    if (!buffer || !sealedLen || bufferCap < messageLen || bufferCap - messageLen < OVERHEAD) {
         return false;
     }
     
-    // Extract original message (without timestamp, nonce, and HMAC)
-    *messageLen = dataLen - TIMESTAMP_SIZE - NONCE_SIZE;
-    memcpy(message, signedMessage, *messageLen);
+    HMACSegment segment = {buffer, messageLen};
+    size_t trailerLen;
+    if (!sealSegments(&segment, 1, buffer + messageLen, bufferCap - messageLen, &trailerLen)) {
+        return false;
+    }
+    *sealedLen = messageLen + trailerLen;
+    return true;
+}
+
+bool HMACHandler::unseal(const uint8_t* sealed, size_t sealedLen, size_t* messageLen) {
+    return unsealWith(0, nullptr, sealed, sealedLen, messageLen);
+}
+
+bool HMACHandler::unsealFrom(uint32_t peer, const uint8_t* sealed, size_t sealedLen, size_t* messageLen) {
+    return unsealWith(peer, nullptr, sealed, sealedLen, messageLen);
+}
+
+bool HMACHandler::unsealSequenced(uint32_t peer, uint32_t sequence,
+                                 const uint8_t* sealed, size_t sealedLen, size_t* messageLen) {
+    return unsealWith(peer, &sequence, sealed, sealedLen, messageLen);
+}
+
+bool HMACHandler::unsealWith(uint32_t peer, const uint32_t* sequence,
+                            const uint8_t* sealed, size_t sealedLen, size_t* messageLen) {
+    if (!sealed || !messageLen) {
+        return false;
+    }
     
-    // Update replay cache
-    updateReplayCache(timestamp, nonce);
+    if (sealedLen < OVERHEAD) {
+        Serial.println("[HMACHandler] Signed message too short");
+        return false;
+    }
     
+    HMACSegment segment = {sealed, sealedLen - OVERHEAD};
+    if (!checkTrailer(&segment, 1, sealed + segment.len, peer, sequence)) {
+        return false;
+    }
+    *messageLen = segment.len;
     return true;
 }
 
-bool HMACHandler::isReplayAttack(uint32_t timestamp, uint32_t nonce) {
-    uint32_t currentTime = getCurrentTimestamp();
+bool HMACHandler::appendHMAC(const uint8_t* message, size_t messageLen,
+                            uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!message || !output || !outputLen || outputCap < messageLen) {
+        return false;
+    }
     
-    // Check if timestamp is too old (older than replay window)
-    if (currentTime - timestamp > REPLAY_WINDOW_MS) {
-        Serial.println("[HMACHandler] Message timestamp too old");
-        return true;
+    // Copy message (already in place when output is the message buffer)
+    if (output != message) {
+        memmove(output, message, messageLen);
     }
     
-    // Check if timestamp is in the future (clock skew tolerance: 1 minute)
-    if (timestamp > currentTime + 60000) {
-        Serial.println("[HMACHandler] Message timestamp in future");
-        return true;
+    return seal(output, messageLen, outputCap, outputLen);
+}
+
+bool HMACHandler::verifyAndExtract(const uint8_t* signedMessage, size_t signedLen,
+                                  uint8_t* message, size_t* messageLen) {
+    if (!signedMessage || !message || !messageLen) {
+        return false;
     }
     
-    // Check replay cache for duplicate timestamp+nonce
-    for (size_t i = 0; i < REPLAY_CACHE_SIZE; i++) {
-        if (replayCache[i].used &&
-            replayCache[i].timestamp == timestamp &&
-            replayCache[i].nonce == nonce) {
-            return true; // Duplicate found
-        }
+    size_t payloadLen;
+    if (!unseal(signedMessage, signedLen, &payloadLen)) {
+        return false;
     }
     
-    return false;
+    // Extract original message (without timestamp, nonce, and HMAC)
+    if (message != signedMessage) {
+        memmove(message, signedMessage, payloadLen);
+    }
+    *messageLen = payloadLen;
+    
+    return true;
+}
+
+bool HMACHandler::isReplayAttack(uint32_t timestamp, uint32_t nonce) {
+    return replayFilter.checkNonce(0, timestamp, nonce, getCurrentTimestamp()) != REPLAY_ACCEPT;
 }
 
 void HMACHandler::updateReplayCache(uint32_t timestamp, uint32_t nonce) {
-    replayCache[replayCacheIndex].timestamp = timestamp;
-    replayCache[replayCacheIndex].nonce = nonce;
-    replayCache[replayCacheIndex].used = true;
-    
-    replayCacheIndex = (replayCacheIndex + 1) % REPLAY_CACHE_SIZE;
+    replayFilter.recordNonce(0, timestamp, nonce);
+}
+
+HMACReplayStats HMACHandler::getReplayStats() const {
+    return replayFilter.getStats();
+}
+
+void HMACHandler::setTimeSource(HMACTimeSource source, void* context) {
+    timeSource = source;
+    timeSourceContext = context;
 }
 
 uint32_t HMACHandler::getCurrentTimestamp() {
-    return millis();
+    return timeSource ? timeSource(timeSourceContext) : millis();
 }
 
 uint32_t HMACHandler::generateNonce() {
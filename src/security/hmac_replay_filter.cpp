@@ -0,0 +1,286 @@
+// HMAC Replay Filter - sliding sequence windows and time-bucketed nonce sets
+#include "hmac_replay_filter.h"
+#include <string.h>
+
+namespace {
+
+uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+}
+
+bool testBit(const uint32_t* bitmap, uint32_t bit) {
+    return (bitmap[bit / 32] >> (bit % 32)) & 1U;
+}
+
+void setBit(uint32_t* bitmap, uint32_t bit) {
+    bitmap[bit / 32] |= 1U << (bit % 32);
+}
+
+} // namespace
+
+HMACReplayFilter::HMACReplayFilter() {
+    reset();
+}
+
+void HMACReplayFilter::reset() {
+    memset(peers, 0, sizeof(peers));
+    memset(buckets, 0, sizeof(buckets));
+    memset(&stats, 0, sizeof(stats));
+}
+
+HMACReplayVerdict HMACReplayFilter::checkAge(uint32_t timestamp, uint32_t now) const {
+    int32_t age = (int32_t)(now - timestamp);
+    if (age > (int32_t)HMAC_REPLAY_WINDOW_MS) {
+        return REPLAY_STALE;
+    }
+    if (age < -(int32_t)HMAC_REPLAY_FUTURE_MS) {
+        return REPLAY_FUTURE;
+    }
+    return REPLAY_ACCEPT;
+}
+
+HMACReplayVerdict HMACReplayFilter::reject(HMACReplayVerdict verdict) {
+    switch (verdict) {
+        case REPLAY_STALE: stats.stale++; break;
+        case REPLAY_FUTURE: stats.future++; break;
+        case REPLAY_DUPLICATE: stats.duplicate++; break;
+        case REPLAY_OUT_OF_WINDOW: stats.outOfWindow++; break;
+        case REPLAY_OVERFLOW: stats.overflow++; break;
+        default: break;
+    }
+    return verdict;
+}
+
+bool HMACReplayFilter::isLive(const PeerWindow& entry, uint32_t now) const {
+    // Past this, everything the entry protects is rejected as stale anyway
+    return entry.active && now - entry.lastSeen <= HMAC_REPLAY_WINDOW_MS + HMAC_REPLAY_FUTURE_MS;
+}
+
+HMACReplayFilter::PeerWindow* HMACReplayFilter::candidateSet(uint32_t peer, size_t choice) {
+    size_t first = mix32(peer) % SETS;
+    if (choice == 0) {
+        return peers[first];
+    }
+    // Always a different set, so a crowded set can overflow into its alternative
+    return peers[(first + 1 + mix32(peer ^ 0x9E3779B9U) % (SETS - 1)) % SETS];
+}
+
+HMACReplayFilter::PeerWindow* HMACReplayFilter::findPeer(uint32_t peer, uint32_t now) {
+    for (size_t choice = 0; choice < 2; choice++) {
+        PeerWindow* set = candidateSet(peer, choice);
+        for (size_t way = 0; way < WAYS; way++) {
+            if (set[way].peer == peer && isLive(set[way], now)) {
+                return &set[way];
+            }
+        }
+    }
+    return nullptr;
+}
+
+void HMACReplayFilter::shiftWindow(uint32_t* bitmap, uint32_t count) {
+    if (count >= HMAC_REPLAY_SEQ_WINDOW) {
+        memset(bitmap, 0, WINDOW_WORDS * sizeof(uint32_t));
+        return;
+    }
+    size_t words = count / 32;
+    uint32_t bits = count % 32;
+    for (size_t k = WINDOW_WORDS; k-- > 0;) {
+        uint32_t value = 0;
+        if (k >= words) {
+            value = bitmap[k - words] << bits;
+            if (bits && k > words) {
+                value |= bitmap[k - words - 1] >> (32 - bits);
+            }
+        }
+        bitmap[k] = value;
+    }
+}
+
+HMACReplayVerdict HMACReplayFilter::checkSequence(uint32_t peer, uint32_t sequence,
+                                                  uint32_t timestamp, uint32_t now) {
+    HMACReplayVerdict verdict = checkAge(timestamp, now);
+    if (verdict != REPLAY_ACCEPT) {
+        return reject(verdict);
+    }
+
+    PeerWindow* entry = findPeer(peer, now);
+    if (!entry) {
+        return REPLAY_ACCEPT;
+    }
+
+    int32_t ahead = (int32_t)(sequence - entry->top);
+    int32_t newer = (int32_t)(timestamp - entry->topTimestamp);
+    if (ahead > 0) {
+        // A newer number with a much older timestamp was captured before the sender restarted
+        return newer < -(int32_t)HMAC_REPLAY_REORDER_MS ? reject(REPLAY_OUT_OF_WINDOW) : REPLAY_ACCEPT;
+    }
+    if (newer > (int32_t)HMAC_REPLAY_REORDER_MS) {
+        return REPLAY_ACCEPT;   // Sequence numbers started over; recordSequence() resets the window
+    }
+
+    uint32_t behind = entry->top - sequence;
+    if (behind >= HMAC_REPLAY_SEQ_WINDOW) {
+        return reject(REPLAY_OUT_OF_WINDOW);
+    }
+    return testBit(entry->bitmap, behind) ? reject(REPLAY_DUPLICATE) : REPLAY_ACCEPT;
+}
+
+void HMACReplayFilter::recordSequence(uint32_t peer, uint32_t sequence, uint32_t timestamp, uint32_t now) {
+    stats.accepted++;
+
+    PeerWindow* entry = findPeer(peer, now);
+    if (entry) {
+        int32_t ahead = (int32_t)(sequence - entry->top);
+        int32_t newer = (int32_t)(timestamp - entry->topTimestamp);
+        if (ahead > 0) {
+            shiftWindow(entry->bitmap, (uint32_t)ahead);
+            setBit(entry->bitmap, 0);
+            entry->top = sequence;
+            if (newer > 0) {
+                entry->topTimestamp = timestamp;
+            }
+            entry->lastSeen = now;
+            return;
+        }
+        if (newer <= (int32_t)HMAC_REPLAY_REORDER_MS) {
+            uint32_t behind = entry->top - sequence;
+            if (behind < HMAC_REPLAY_SEQ_WINDOW) {
+                setBit(entry->bitmap, behind);
+            }
+            entry->lastSeen = now;
+            return;
+        }
+        stats.restarts++;
+    } else {
+        // Take a free or expired way in either set, else displace the one heard from least recently
+        entry = candidateSet(peer, 0);
+        for (size_t choice = 0; choice < 2 && isLive(*entry, now); choice++) {
+            PeerWindow* set = candidateSet(peer, choice);
+            for (size_t way = 0; way < WAYS; way++) {
+                if (!isLive(set[way], now)) {
+                    entry = &set[way];
+                    break;
+                }
+                if (now - set[way].lastSeen > now - entry->lastSeen) {
+                    entry = &set[way];
+                }
+            }
+        }
+        if (isLive(*entry, now)) {
+            stats.evictions++;
+        } else if (!entry->active) {
+            stats.peers++;
+        }
+    }
+
+    entry->peer = peer;
+    entry->top = sequence;
+    entry->topTimestamp = timestamp;
+    entry->lastSeen = now;
+    memset(entry->bitmap, 0, sizeof(entry->bitmap));
+    setBit(entry->bitmap, 0);
+    entry->active = true;
+}
+
+uint16_t HMACReplayFilter::fingerprint(uint32_t peer, uint32_t timestamp, uint32_t nonce, size_t* rows) {
+    // Rows and fingerprint come from independent bits, so a row match says nothing about the fingerprint
+    uint32_t h = mix32(nonce ^ mix32(timestamp ^ mix32(peer)));
+    uint32_t g = mix32(h ^ 0x9E3779B9U);
+    rows[0] = (size_t)(((uint64_t)(h >> 16) * NONCE_ROWS) >> 16);
+    rows[1] = (size_t)(((uint64_t)g * (NONCE_ROWS - 1)) >> 32);
+    if (rows[1] >= rows[0]) {
+        rows[1]++;      // Always a different row
+    }
+    uint16_t fp = (uint16_t)h;
+    return fp ? fp : 1;
+}
+
+HMACReplayVerdict HMACReplayFilter::checkNonce(uint32_t peer, uint32_t timestamp, uint32_t nonce, uint32_t now) {
+    HMACReplayVerdict verdict = checkAge(timestamp, now);
+    if (verdict != REPLAY_ACCEPT) {
+        return reject(verdict);
+    }
+
+    uint32_t epoch = timestamp / HMAC_REPLAY_BUCKET_MS;
+    const NonceBucket& bucket = buckets[epoch % BUCKETS];
+    if (bucket.epoch != epoch || bucket.count == 0) {
+        return REPLAY_ACCEPT;   // Slot still holds an expired slice; it is wiped on record
+    }
+
+    size_t rows[2];
+    uint16_t fp = fingerprint(peer, timestamp, nonce, rows);
+    bool room = false;
+    for (size_t r = 0; r < 2; r++) {
+        const uint16_t* row = bucket.slots + rows[r] * NONCE_WAYS;
+        for (size_t way = 0; way < NONCE_WAYS && row[way] != 0; way++) {
+            if (row[way] == fp) {
+                return reject(REPLAY_DUPLICATE);
+            }
+        }
+        room |= row[NONCE_WAYS - 1] == 0;
+    }
+    if (!room && !HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT) {
+        return reject(REPLAY_OVERFLOW);
+    }
+    return REPLAY_ACCEPT;
+}
+
+void HMACReplayFilter::recordNonce(uint32_t peer, uint32_t timestamp, uint32_t nonce) {
+    stats.accepted++;
+
+    uint32_t epoch = timestamp / HMAC_REPLAY_BUCKET_MS;
+    NonceBucket& bucket = buckets[epoch % BUCKETS];
+    if (bucket.epoch != epoch) {
+        memset(bucket.slots, 0, sizeof(bucket.slots));
+        bucket.count = 0;
+        bucket.epoch = epoch;
+    }
+
+    // Rows fill from the front, so the first empty way is also the row's fill level
+    size_t rows[2];
+    uint16_t fp = fingerprint(peer, timestamp, nonce, rows);
+    uint16_t* target = nullptr;
+    size_t targetFill = NONCE_WAYS;
+    for (size_t r = 0; r < 2; r++) {
+        uint16_t* row = bucket.slots + rows[r] * NONCE_WAYS;
+        size_t fill = 0;
+        for (; fill < NONCE_WAYS && row[fill] != 0; fill++) {
+            if (row[fill] == fp) {
+                return;
+            }
+        }
+        if (fill < targetFill) {
+            target = row + fill;
+            targetFill = fill;
+        }
+    }
+    if (!target) {
+        stats.overflow++;   // Only reachable with HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT
+        return;
+    }
+    *target = fp;
+    bucket.count++;
+}
+
+HMACReplayStats HMACReplayFilter::getStats() const {
+    HMACReplayStats result = stats;
+    result.memoryBytes = sizeof(*this);
+    return result;
+}
+
+const char* HMACReplayFilter::verdictName(HMACReplayVerdict verdict) {
+    switch (verdict) {
+        case REPLAY_ACCEPT: return "accept";
+        case REPLAY_STALE: return "stale";
+        case REPLAY_FUTURE: return "future";
+        case REPLAY_DUPLICATE: return "duplicate";
+        case REPLAY_OUT_OF_WINDOW: return "out-of-window";
+        case REPLAY_OVERFLOW: return "overflow";
+    }
+    return "unknown";
+}
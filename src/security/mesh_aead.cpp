@@ -0,0 +1,149 @@
+#include "mesh_aead.h"
+
+MeshAEAD::MeshAEAD() : initialized(false), epoch(0) {
+    memset(salt, 0, sizeof(salt));
+    mbedtls_gcm_init(&gcm);
+}
+
+MeshAEAD::~MeshAEAD() {
+    mbedtls_gcm_free(&gcm); // Also zeroizes the expanded key
+}
+
+bool MeshAEAD::begin(const uint8_t* key, size_t keyLen, uint16_t keyEpoch) {
+    refreshSalt();
+
+    if (!setKey(key, keyLen, keyEpoch)) {
+        return false;
+    }
+
+    Serial.println("[MeshAEAD] Initialized successfully");
+    return true;
+}
+
+bool MeshAEAD::setKey(const uint8_t* key, size_t keyLen, uint16_t keyEpoch) {
+    if (!key || keyLen != KEY_SIZE) {
+        Serial.println("[MeshAEAD] Invalid key length (expected 32 bytes)");
+        return false;
+    }
+
+    // Key schedule is expanded once here and reused for every message
+    int ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, KEY_SIZE * 8);
+    if (ret != 0) {
+        Serial.printf("[MeshAEAD] GCM setkey failed: -0x%04x\n", -ret);
+        initialized = false;
+        return false;
+    }
+
+    epoch = keyEpoch;
+    initialized = true;
+    return true;
+}
+
+uint16_t MeshAEAD::getKeyEpoch() {
+    return epoch;
+}
+
+void MeshAEAD::refreshSalt() {
+    uint32_t value = esp_random();
+    memcpy(salt, &value, SALT_SIZE);
+}
+
+void MeshAEAD::buildNonce(const uint8_t* saltBytes, const MeshFrameHeader& header, uint8_t* nonce) {
+    memcpy(nonce, saltBytes, SALT_SIZE);
+    for (int i = 0; i < 4; i++) {
+        nonce[4 + i] = (uint8_t)(header.source >> (8 * i));
+        nonce[8 + i] = (uint8_t)(header.seq >> (8 * i));
+    }
+}
+
+void MeshAEAD::buildAAD(const MeshFrameHeader& header, uint8_t* aad) {
+    aad[0] = header.type;
+    for (int i = 0; i < 4; i++) {
+        aad[1 + i] = (uint8_t)(header.source >> (8 * i));
+        aad[5 + i] = (uint8_t)(header.dest >> (8 * i));
+        aad[9 + i] = (uint8_t)(header.seq >> (8 * i));
+    }
+    aad[13] = (uint8_t)header.keyEpoch;
+    aad[14] = (uint8_t)(header.keyEpoch >> 8);
+    aad[15] = header.flags;
+    for (int i = 0; i < 4; i++) {
+        aad[16 + i] = (uint8_t)(header.sentMs >> (8 * i));
+    }
+}
+
+bool MeshAEAD::seal(const MeshFrameHeader& header, const uint8_t* plaintext, size_t len,
+                    uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!initialized || !output || !outputLen || (len > 0 && !plaintext)) {
+        return false;
+    }
+
+    if (len + OVERHEAD > outputCap) {
+        Serial.println("[MeshAEAD] Output buffer too small");
+        return false;
+    }
+
+    if (header.keyEpoch != epoch) {
+        Serial.println("[MeshAEAD] Key epoch mismatch");
+        return false;
+    }
+
+    uint8_t nonce[NONCE_SIZE];
+    uint8_t aad[AAD_SIZE];
+    buildNonce(salt, header, nonce);
+    buildAAD(header, aad);
+
+    memcpy(output, salt, SALT_SIZE);
+
+    // Single pass: encrypt and authenticate straight into the caller's buffer
+    int ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len,
+                                        nonce, NONCE_SIZE, aad, AAD_SIZE,
+                                        plaintext, output + SALT_SIZE,
+                                        TAG_SIZE, output + SALT_SIZE + len);
+    if (ret != 0) {
+        Serial.printf("[MeshAEAD] GCM encrypt failed: -0x%04x\n", -ret);
+        return false;
+    }
+
+    *outputLen = len + OVERHEAD;
+    return true;
+}
+
+bool MeshAEAD::open(const MeshFrameHeader& header, const uint8_t* sealed, size_t sealedLen,
+                    uint8_t* output, size_t outputCap, size_t* outputLen) {
+    if (!initialized || !sealed || !output || !outputLen) {
+        return false;
+    }
+
+    if (sealedLen < OVERHEAD) {
+        Serial.println("[MeshAEAD] Sealed payload too short");
+        return false;
+    }
+
+    size_t len = sealedLen - OVERHEAD;
+    if (len > outputCap) {
+        Serial.println("[MeshAEAD] Output buffer too small");
+        return false;
+    }
+
+    if (header.keyEpoch != epoch) {
+        Serial.println("[MeshAEAD] Key epoch mismatch");
+        return false;
+    }
+
+    uint8_t nonce[NONCE_SIZE];
+    uint8_t aad[AAD_SIZE];
+    buildNonce(sealed, header, nonce);
+    buildAAD(header, aad);
+
+    // Tag is checked in constant time; output is wiped on failure
+    int ret = mbedtls_gcm_auth_decrypt(&gcm, len, nonce, NONCE_SIZE, aad, AAD_SIZE,
+                                       sealed + SALT_SIZE + len, TAG_SIZE,
+                                       sealed + SALT_SIZE, output);
+    if (ret != 0) {
+        Serial.println("[MeshAEAD] Authentication failed");
+        return false;
+    }
+
+    *outputLen = len;
+    return true;
+}
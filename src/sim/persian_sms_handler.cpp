@@ -1,6 +1,7 @@
 // Persian SMS Handler - UCS2 encoding and decoding for Persian text
 #include <Arduino.h>
 #include "persian_sms_handler.h"
+#include "text_codec.h"
 
 PersianSMSHandler::PersianSMSHandler() {}
 
@@ -102,10 +103,11 @@ String PersianSMSHandler::preparePDUMessage(const String& message, const String&
 
     // Destination address (recipient)
     String phoneNumber = formatPhoneNumber(recipient);
-    int addressLength = phoneNumber.length() / 2;
-    char addrLenHex[3];
-    sprintf(addrLenHex, "%02X", addressLength);
-    pdu += addrLenHex;
+    uint8_t addressLength = phoneNumber.length() / 2;
+    char octet[3];
+    size_t octetLen;
+    TextCodec::hexEncode(&addressLength, 1, octet, sizeof(octet), &octetLen);
+    pdu += octet;
     pdu += "91"; // Type-of-address: international
     pdu += phoneNumber;
 
@@ -119,16 +121,20 @@ String PersianSMSHandler::preparePDUMessage(const String& message, const String&
     pdu += "FF";
 
     // User data length (number of UCS2 characters)
-    int userDataLength = ucs2Message.length() / 2;
-    char udLenHex[3];
-    sprintf(udLenHex, "%02X", userDataLength);
-    pdu += udLenHex;
-
-    // User data: UCS2 encoded message
-    for (size_t i = 0; i < ucs2Message.length(); i++) {
-        char hex[3];
-        sprintf(hex, "%02X", (uint8_t)ucs2Message.charAt(i));
-        pdu += hex;
+    uint8_t userDataLength = ucs2Message.length() / 2;
+    TextCodec::hexEncode(&userDataLength, 1, octet, sizeof(octet), &octetLen);
+    pdu += octet;
+
+    // User data: UCS2 encoded message, hex-encoded a chunk at a time
+    const uint8_t* userData = (const uint8_t*)ucs2Message.c_str();
+    size_t userDataBytes = ucs2Message.length();
+    pdu.reserve(pdu.length() + userDataBytes * 2);
+    char hex[129];
+    for (size_t offset = 0; offset < userDataBytes; offset += 64) {
+        size_t chunk = userDataBytes - offset < 64 ? userDataBytes - offset : 64;
+        size_t hexLen;
+        TextCodec::hexEncode(userData + offset, chunk, hex, sizeof(hex), &hexLen);
+        pdu.concat(hex, hexLen);
     }
 
     return pdu;
@@ -1,11 +1,13 @@
 // Health Monitor - System health monitoring and reporting
 #include <Arduino.h>
 #include "health_monitor.h"
+#include "mesh_network_manager.h"
 
 HealthMonitor::HealthMonitor() :
     lastHealthCheck(0),
     consecutiveFailures(0),
-    systemHealthy(true) {}
+    systemHealthy(true),
+    lastBufferFailures(0) {}
 
 bool HealthMonitor::begin() {
     Serial.println("Health monitor initialized");
@@ -33,9 +35,21 @@ SystemHealth HealthMonitor::getSystemHealth() {
     if (meshManager) {
         health.meshConnections = meshManager->getNodeCount();
         health.networkHealth = meshManager->isNetworkConnected() ? 1.0 : 0.0;
+
+        // Pool sizing check: how close each class came to running out
+        health.meshBufferPeak = 0.0;
+        health.meshBufferFailures = 0;
+        for (int c = 0; c < MESH_BUFFER_CLASS_COUNT; c++) {
+            MeshBufferPoolStats pool = meshManager->getBufferStats((MeshBufferClass)c);
+            float peak = (float)pool.highWater / pool.blockCount;
+            health.meshBufferPeak = max(health.meshBufferPeak, peak);
+            health.meshBufferFailures += pool.failures;
+        }
     } else {
         health.meshConnections = 0;
         health.networkHealth = 0.0;
+        health.meshBufferPeak = 0.0;
+        health.meshBufferFailures = 0;
     }
 
     // SIM metrics - integrate with SIM manager
@@ -79,6 +93,13 @@ void HealthMonitor::performHealthCheck() {
         currentHealth = false;
     }
 
+    // Exhausted buffer pools drop frames without the heap ever looking low
+    if (health.meshBufferFailures > lastBufferFailures) {
+        Serial.printf("WARNING: Mesh buffer pool exhausted %u times (peak use %.0f%%)\n",
+                      health.meshBufferFailures - lastBufferFailures, health.meshBufferPeak * 100);
+    }
+    lastBufferFailures = health.meshBufferFailures;
+
     // Update health status
     if (!currentHealth) {
         consecutiveFailures++;
@@ -144,13 +165,15 @@ String HealthMonitor::getHealthReport() {
             "  Voltage: %.2fV\n"
             "  CPU Frequency: %d MHz\n"
             "  Network Connections: %d\n"
+            "  Mesh Buffers: %.0f%% peak, %u failures\n"
             "  Active SIMs: %d\n"
             "  Overall Health: %.1f%%\n"
             "  Status: %s",
             health.freeHeap, health.heapSize,
             (float)health.freeHeap / health.heapSize * 100,
             health.temperature, health.voltage, health.cpuFreq,
-            health.meshConnections, health.activeSims,
+            health.meshConnections, health.meshBufferPeak * 100,
+            health.meshBufferFailures, health.activeSims,
             health.overallHealth * 100,
             systemHealthy ? "HEALTHY" : "WARNING");
 
@@ -0,0 +1,128 @@
+// Benchmark: per-message HMAC key setup vs. cached SHA-256 midstates, one frame at a time and in bursts
+// Runs on target; reports microseconds per verified frame for small mesh frames.
+#include <unity.h>
+#include <Arduino.h>
+#include <mbedtls/md.h>
+#include "secure_key_manager.h"
+#include "hmac_handler.h"
+
+#define BENCH_FRAMES 32                    // One receive burst
+#define BENCH_ROUNDS 100
+#define BENCH_FRAME_CAP (256 + HMACHandler::OVERHEAD)
+
+SecureKeyManager* keyManager = nullptr;
+HMACHandler* hmacHandler = nullptr;
+static uint8_t key[32];
+static uint8_t sealed[BENCH_FRAMES][BENCH_FRAME_CAP];
+static HMACFrame frames[BENCH_FRAMES];
+static mbedtls_md_context_t md_ctx;
+static volatile int benchSink = 0;
+
+void setUp() {
+    keyManager = new SecureKeyManager();
+    keyManager->begin();
+    keyManager->getHMACKey(key, sizeof(key));
+    hmacHandler = new HMACHandler(keyManager);
+    hmacHandler->begin();
+
+    mbedtls_md_init(&md_ctx);
+    mbedtls_md_setup(&md_ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+}
+
+void tearDown() {
+    mbedtls_md_free(&md_ctx);
+    memset(key, 0, sizeof(key));
+    delete hmacHandler;
+    delete keyManager;
+}
+
+// Seal a fresh burst; sequenced so the replay filter sees each frame exactly once
+static void sealBurst(size_t payloadLen, uint32_t round) {
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        for (size_t j = 0; j < payloadLen; j++) {
+            sealed[i][j] = (uint8_t)(j * 7 + i + round);
+        }
+        frames[i].sealed = sealed[i];
+        hmacHandler->seal(sealed[i], payloadLen, sizeof(sealed[i]), &frames[i].sealedLen);
+        frames[i].peer = 1 + (uint32_t)(i % 8);
+        frames[i].sequence = round * BENCH_FRAMES + (uint32_t)i;
+        frames[i].sequenced = true;
+    }
+}
+
+// Mirrors the old computeHMAC: the key's pad blocks are hashed again for every message
+static bool legacyVerify(const uint8_t* frame, size_t frameLen) {
+    size_t signedLen = frameLen - HMACHandler::HMAC_SIZE;
+    uint8_t computed[HMACHandler::HMAC_SIZE];
+    mbedtls_md_hmac_starts(&md_ctx, key, sizeof(key));
+    mbedtls_md_hmac_update(&md_ctx, frame, signedLen);
+    mbedtls_md_hmac_finish(&md_ctx, computed);
+
+    int diff = 0;
+    for (size_t i = 0; i < HMACHandler::HMAC_SIZE; i++) {
+        diff |= frame[signedLen + i] ^ computed[i];
+    }
+    return diff == 0;
+}
+
+static void benchmarkPayload(size_t payloadLen) {
+    unsigned long legacyUs = 0;
+    unsigned long singleUs = 0;
+    unsigned long batchUs = 0;
+    uint32_t round = 0;
+
+    for (uint32_t r = 0; r < BENCH_ROUNDS; r++) {
+        sealBurst(payloadLen, round++);
+        unsigned long start = micros();
+        for (size_t i = 0; i < BENCH_FRAMES; i++) {
+            benchSink += legacyVerify(frames[i].sealed, frames[i].sealedLen);
+        }
+        legacyUs += micros() - start;
+
+        size_t messageLen;
+        start = micros();
+        for (size_t i = 0; i < BENCH_FRAMES; i++) {
+            benchSink += hmacHandler->unsealSequenced(frames[i].peer, frames[i].sequence,
+                                                      frames[i].sealed, frames[i].sealedLen, &messageLen);
+        }
+        singleUs += micros() - start;
+
+        sealBurst(payloadLen, round++);
+        start = micros();
+        TEST_ASSERT_EQUAL(BENCH_FRAMES, hmacHandler->verifyMany(frames, BENCH_FRAMES));
+        batchUs += micros() - start;
+    }
+
+    const double frameCount = (double)BENCH_FRAMES * BENCH_ROUNDS;
+    double legacy = legacyUs / frameCount;
+    double single = singleUs / frameCount;
+    double batch = batchUs / frameCount;
+    Serial.printf("%3u B frames | per-message key setup: %.2f us | midstates: %.2f us | verifyMany: %.2f us | %.1fx\n",
+                  (unsigned)payloadLen, legacy, single, batch, batch > 0 ? legacy / batch : 0.0);
+    TEST_ASSERT_TRUE(batch * 2 <= legacy);
+}
+
+void test_benchmark_64_byte_frames() {
+    benchmarkPayload(64);
+}
+
+void test_benchmark_128_byte_frames() {
+    benchmarkPayload(128);
+}
+
+void test_benchmark_256_byte_frames() {
+    benchmarkPayload(256);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_64_byte_frames);
+    RUN_TEST(test_benchmark_128_byte_frames);
+    RUN_TEST(test_benchmark_256_byte_frames);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
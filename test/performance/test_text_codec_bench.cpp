@@ -0,0 +1,179 @@
+// Benchmark: legacy sprintf/strtol hex and branchy base64 vs. the table-driven and vector codecs
+// Runs on the host (pio test -e native) or on target; reports bytes per CPU cycle.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/text_codec.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+typedef String BenchString;
+typedef uint32_t BenchTicks;               // Wraps after ~17 s at 240 MHz; each run is far shorter
+static BenchTicks benchCycles() { return ESP.getCycleCount(); }
+static BenchString benchSlice(const BenchString& s, size_t pos, size_t n) { return s.substring(pos, pos + n); }
+#define BENCH_ITERATIONS 2000
+#else
+#include <string>
+typedef std::string BenchString;
+typedef uint64_t BenchTicks;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static BenchTicks benchCycles() { return __rdtsc(); }   // TSC ticks at the nominal clock
+#else
+#include <chrono>
+static BenchTicks benchCycles() {                       // Nanoseconds stand in where no counter is exposed
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+static BenchString benchSlice(const BenchString& s, size_t pos, size_t n) { return s.substr(pos, n); }
+#define BENCH_ITERATIONS 20000
+#endif
+
+#define BENCH_PAYLOAD 256                  // A fragment-sized frame or SMS body
+
+static uint8_t payload[BENCH_PAYLOAD];
+static char text[BENCH_PAYLOAD * 2 + 1];
+static uint8_t decoded[BENCH_PAYLOAD];
+static volatile size_t benchSink = 0;
+
+void setUp() {
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i * 37 + 11);
+    }
+}
+
+void tearDown() {
+    TextCodec::setAccelerated(true);
+}
+
+// Mirrors the old AES256Encryption / PDU hex loops
+static size_t legacyHexEncode(const uint8_t* input, size_t len, BenchString& out) {
+    out = BenchString();
+    for (size_t i = 0; i < len; i++) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02X", input[i]);
+        out += hex;
+    }
+    return out.length();
+}
+
+static size_t legacyHexDecode(const BenchString& in, uint8_t* out) {
+    size_t len = in.length() / 2;
+    for (size_t i = 0; i < len; i++) {
+        BenchString byteStr = benchSlice(in, i * 2, 2);
+        out[i] = (uint8_t)strtol(byteStr.c_str(), NULL, 16);
+    }
+    return len;
+}
+
+// Mirrors the old MeshWireFrame::unarmor symbol lookup
+static int8_t legacyBase64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+static size_t legacyBase64Decode(const char* in, size_t len, uint8_t* out) {
+    size_t o = 0;
+    for (size_t i = 0; i + 4 <= len; i += 4) {
+        int8_t a = legacyBase64Value(in[i]);
+        int8_t b = legacyBase64Value(in[i + 1]);
+        int8_t c = in[i + 2] == '=' ? 0 : legacyBase64Value(in[i + 2]);
+        int8_t d = in[i + 3] == '=' ? 0 : legacyBase64Value(in[i + 3]);
+        if (a < 0 || b < 0 || c < 0 || d < 0) return 0;
+        uint32_t triple = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+        out[o++] = (uint8_t)(triple >> 16);
+        if (in[i + 2] != '=') out[o++] = (uint8_t)(triple >> 8);
+        if (in[i + 3] != '=') out[o++] = (uint8_t)triple;
+    }
+    return o;
+}
+
+static double bytesPerCycle(BenchTicks cycles) {
+    return cycles == 0 ? 0.0 : (double)BENCH_PAYLOAD * BENCH_ITERATIONS / (double)cycles;
+}
+
+void test_benchmark_hex() {
+    BenchString legacy;
+    size_t textLen;
+    size_t decodedLen;
+
+    BenchTicks start = benchCycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        benchSink += legacyHexEncode(payload, sizeof(payload), legacy);
+        benchSink += legacyHexDecode(legacy, decoded);
+    }
+    BenchTicks legacyCycles = benchCycles() - start;
+    TEST_ASSERT_EQUAL_MEMORY(payload, decoded, sizeof(payload));
+
+    double rates[2] = {0, 0};
+    for (int vector = 0; vector < 2; vector++) {
+        if (TextCodec::setAccelerated(vector == 1) != (vector == 1)) continue;
+        start = benchCycles();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            TextCodec::hexEncode(payload, sizeof(payload), text, sizeof(text), &textLen);
+            TextCodec::hexDecode(text, textLen, decoded, sizeof(decoded), &decodedLen);
+            benchSink += decodedLen;
+        }
+        rates[vector] = bytesPerCycle(benchCycles() - start);
+        TEST_ASSERT_EQUAL_MEMORY(payload, decoded, sizeof(payload));
+    }
+
+    printf("hex    %u B round trip | legacy sprintf/strtol: %.4f B/cycle | table: %.4f B/cycle | vector: %.4f B/cycle\n",
+           (unsigned)BENCH_PAYLOAD, bytesPerCycle(legacyCycles), rates[0], rates[1]);
+    TEST_ASSERT_TRUE(rates[0] > bytesPerCycle(legacyCycles) * 5);
+}
+
+void test_benchmark_base64() {
+    size_t textLen;
+    size_t decodedLen;
+    TextCodec::base64Encode(payload, sizeof(payload), text, sizeof(text), &textLen);
+
+    BenchTicks start = benchCycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        benchSink += legacyBase64Decode(text, textLen, decoded);
+    }
+    BenchTicks legacyCycles = benchCycles() - start;
+
+    double rates[2] = {0, 0};
+    for (int vector = 0; vector < 2; vector++) {
+        if (TextCodec::setAccelerated(vector == 1) != (vector == 1)) continue;
+        start = benchCycles();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            TextCodec::base64Decode(text, textLen, decoded, sizeof(decoded), &decodedLen);
+            benchSink += decodedLen;
+        }
+        rates[vector] = bytesPerCycle(benchCycles() - start);
+        TEST_ASSERT_EQUAL_MEMORY(payload, decoded, sizeof(payload));
+    }
+
+    printf("base64 %u B decode     | legacy branchy:        %.4f B/cycle | table: %.4f B/cycle | vector: %.4f B/cycle\n",
+           (unsigned)BENCH_PAYLOAD, bytesPerCycle(legacyCycles), rates[0], rates[1]);
+    TEST_ASSERT_TRUE(rates[0] > bytesPerCycle(legacyCycles));
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_hex);
+    RUN_TEST(test_benchmark_base64);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_hex);
+    RUN_TEST(test_benchmark_base64);
+    return UNITY_END();
+}
+#endif
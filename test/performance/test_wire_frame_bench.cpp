@@ -0,0 +1,254 @@
+// Benchmark: binary wire frame vs. legacy JSON + hex envelope
+// Runs on the host (pio test -e native) or on target.
+#include <unity.h>
+#include <ArduinoJson.h>
+#include "../../include/mesh_wire_frame.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+typedef String BenchString;
+static uint64_t benchNanos() { return (uint64_t)micros() * 1000ULL; }
+static BenchString benchSlice(const BenchString& s, size_t pos, size_t n) { return s.substring(pos, pos + n); }
+#else
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+typedef std::string BenchString;
+static uint64_t benchNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static BenchString benchSlice(const BenchString& s, size_t pos, size_t n) { return s.substr(pos, n); }
+#endif
+
+#define BENCH_ITERATIONS 20000
+#define BENCH_MAX_PAYLOAD 256
+
+static uint8_t ciphertext[BENCH_MAX_PAYLOAD];
+static volatile size_t benchSink = 0;
+
+void setUp() {
+    for (size_t i = 0; i < sizeof(ciphertext); i++) {
+        ciphertext[i] = (uint8_t)(i * 37 + 11);
+    }
+}
+
+void tearDown() {}
+
+// Mirrors the envelope MeshNetworkManager::sendMessage built before the binary frame
+static size_t legacyEncode(const uint8_t* payload, size_t len, uint32_t seq, BenchString& out) {
+    BenchString hex;
+    for (size_t i = 0; i < len; i++) {
+        char byteHex[3];
+        snprintf(byteHex, sizeof(byteHex), "%02x", payload[i]);
+        hex += byteHex;
+    }
+
+    DynamicJsonDocument doc(1024);
+    doc["type"] = "data";
+    doc["payload"] = hex;
+    doc["hops"] = 1;
+    doc["timestamp"] = seq * 10;
+    doc["source"] = 0x12345678;
+
+    out = BenchString();
+    serializeJson(doc, out);
+    return out.length();
+}
+
+// Mirrors the legacy onReceive parse + hex decode
+static size_t legacyDecode(const BenchString& in, uint8_t* out) {
+    DynamicJsonDocument doc(1024);
+    if (deserializeJson(doc, in)) {
+        return 0;
+    }
+
+    BenchString type = doc["type"].as<BenchString>();
+    BenchString payload = doc["payload"].as<BenchString>();
+    uint8_t hops = doc["hops"] | 0;
+    if (type != "data" || hops == 0) {
+        return 0;
+    }
+
+    size_t len = payload.length() / 2;
+    for (size_t i = 0; i < len; i++) {
+        BenchString byteStr = benchSlice(payload, i * 2, 2);
+        out[i] = (uint8_t)strtol(byteStr.c_str(), NULL, 16);
+    }
+    return len;
+}
+
+static size_t frameEncode(const uint8_t* payload, size_t len, uint32_t seq,
+                          uint8_t* frame, size_t frameCap, char* armored, size_t armoredCap) {
+    MeshFrameHeader header;
+    header.version = MeshWireFrame::VERSION;
+    header.type = MESH_MSG_DATA;
+    header.flags = 0;
+    header.hops = 1;
+    header.seq = seq;
+    header.source = 0x12345678;
+    header.dest = 0x0BADF00D;
+    header.sentMs = seq * 10;
+    header.keyEpoch = 1;
+    header.length = len;
+
+    size_t frameLen;
+    size_t armoredLen;
+    if (!MeshWireFrame::encode(header, payload, frame, frameCap, &frameLen) ||
+        !MeshWireFrame::armor(frame, frameLen, armored, armoredCap, &armoredLen)) {
+        return 0;
+    }
+    return armoredLen;
+}
+
+static size_t frameDecode(const char* armored, size_t armoredLen, uint8_t* frame, size_t frameCap) {
+    size_t frameLen;
+    if (!MeshWireFrame::unarmor(armored, armoredLen, frame, frameCap, &frameLen)) {
+        return 0;
+    }
+
+    MeshFrameHeader header;
+    const uint8_t* payload;
+    if (!MeshWireFrame::decode(frame, frameLen, &header, &payload) || header.type != MESH_MSG_DATA) {
+        return 0;
+    }
+    return header.length;
+}
+
+void test_frame_roundtrip() {
+    uint8_t frame[MeshWireFrame::HEADER_SIZE + BENCH_MAX_PAYLOAD];
+    char armored[((sizeof(frame) + 2) / 3) * 4 + 1];
+
+    MeshFrameHeader header;
+    header.version = MeshWireFrame::VERSION;
+    header.type = MESH_MSG_COMMAND;
+    header.flags = 0x5A;
+    header.hops = 3;
+    header.seq = 0xA1B2C3D4;
+    header.source = 0x01020304;
+    header.dest = 0xFFEEDDCC;
+    header.sentMs = 123456789;
+    header.keyEpoch = 0xBEEF;
+    header.length = 37;
+
+    size_t frameLen;
+    size_t armoredLen;
+    TEST_ASSERT_TRUE(MeshWireFrame::encode(header, ciphertext, frame, sizeof(frame), &frameLen));
+    TEST_ASSERT_EQUAL(MeshWireFrame::HEADER_SIZE + 37, frameLen);
+    TEST_ASSERT_TRUE(MeshWireFrame::armor(frame, frameLen, armored, sizeof(armored), &armoredLen));
+    TEST_ASSERT_EQUAL(MeshWireFrame::armoredSize(frameLen), armoredLen);
+
+    uint8_t decodedFrame[sizeof(frame)];
+    size_t decodedLen;
+    TEST_ASSERT_TRUE(MeshWireFrame::unarmor(armored, armoredLen, decodedFrame, sizeof(decodedFrame), &decodedLen));
+    TEST_ASSERT_EQUAL(frameLen, decodedLen);
+
+    MeshFrameHeader decoded;
+    const uint8_t* payload;
+    TEST_ASSERT_TRUE(MeshWireFrame::decode(decodedFrame, decodedLen, &decoded, &payload));
+    TEST_ASSERT_EQUAL(MESH_MSG_COMMAND, decoded.type);
+    TEST_ASSERT_EQUAL(0x5A, decoded.flags);
+    TEST_ASSERT_EQUAL(3, decoded.hops);
+    TEST_ASSERT_EQUAL(0xA1B2C3D4, decoded.seq);
+    TEST_ASSERT_EQUAL(0x01020304, decoded.source);
+    TEST_ASSERT_EQUAL(0xFFEEDDCC, decoded.dest);
+    TEST_ASSERT_EQUAL(123456789, decoded.sentMs);
+    TEST_ASSERT_EQUAL(0xBEEF, decoded.keyEpoch);
+    TEST_ASSERT_EQUAL(37, decoded.length);
+    TEST_ASSERT_TRUE(payload == decodedFrame + MeshWireFrame::HEADER_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(ciphertext, payload, 37);
+}
+
+void test_frame_rejects_malformed_input() {
+    uint8_t frame[MeshWireFrame::HEADER_SIZE + 16];
+    MeshFrameHeader header = {};
+    header.version = MeshWireFrame::VERSION;
+    header.type = MESH_MSG_DATA;
+    header.length = 16;
+
+    size_t frameLen;
+    TEST_ASSERT_TRUE(MeshWireFrame::encode(header, ciphertext, frame, sizeof(frame), &frameLen));
+
+    MeshFrameHeader decoded;
+    const uint8_t* payload;
+
+    // Truncated
+    TEST_ASSERT_FALSE(MeshWireFrame::decode(frame, frameLen - 1, &decoded, &payload));
+
+    // Unknown version
+    frame[0] = MeshWireFrame::VERSION + 1;
+    TEST_ASSERT_FALSE(MeshWireFrame::decode(frame, frameLen, &decoded, &payload));
+
+    // Output too small
+    TEST_ASSERT_FALSE(MeshWireFrame::encode(header, ciphertext, frame, sizeof(frame) - 1, &frameLen));
+
+    // Invalid armor
+    uint8_t out[16];
+    size_t outLen;
+    TEST_ASSERT_FALSE(MeshWireFrame::unarmor("ab$d", 4, out, sizeof(out), &outLen));
+    TEST_ASSERT_FALSE(MeshWireFrame::unarmor("abc", 3, out, sizeof(out), &outLen));
+}
+
+static void benchmarkPayload(size_t len) {
+    uint8_t frame[MeshWireFrame::HEADER_SIZE + BENCH_MAX_PAYLOAD];
+    char armored[((sizeof(frame) + 2) / 3) * 4 + 1];
+    uint8_t decoded[BENCH_MAX_PAYLOAD];
+
+    // Legacy envelope
+    BenchString legacy;
+    size_t legacyBytes = 0;
+    uint64_t start = benchNanos();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        legacyBytes = legacyEncode(ciphertext, len, i, legacy);
+        benchSink += legacyDecode(legacy, decoded);
+    }
+    uint64_t legacyNs = (benchNanos() - start) / BENCH_ITERATIONS;
+    TEST_ASSERT_EQUAL_MEMORY(ciphertext, decoded, len);
+
+    // Binary frame
+    size_t frameBytes = 0;
+    start = benchNanos();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        frameBytes = frameEncode(ciphertext, len, i, frame, sizeof(frame), armored, sizeof(armored));
+        benchSink += frameDecode(armored, frameBytes, frame, sizeof(frame));
+    }
+    uint64_t frameNs = (benchNanos() - start) / BENCH_ITERATIONS;
+
+    printf("payload %4u B | legacy JSON+hex: %5u ns/msg %4u B/msg | binary frame: %5u ns/msg %4u B/msg (%u raw)\n",
+           (unsigned)len, (unsigned)legacyNs, (unsigned)legacyBytes,
+           (unsigned)frameNs, (unsigned)frameBytes, (unsigned)(MeshWireFrame::HEADER_SIZE + len));
+
+    TEST_ASSERT_GREATER_THAN(0, frameBytes);
+    TEST_ASSERT_LESS_THAN(legacyBytes, frameBytes);
+    TEST_ASSERT_LESS_THAN(legacyNs, frameNs);
+}
+
+void test_benchmark_encode_decode() {
+    benchmarkPayload(16);   // Legacy single-block payload
+    benchmarkPayload(64);
+    benchmarkPayload(256);
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_roundtrip);
+    RUN_TEST(test_frame_rejects_malformed_input);
+    RUN_TEST(test_benchmark_encode_decode);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_roundtrip);
+    RUN_TEST(test_frame_rejects_malformed_input);
+    RUN_TEST(test_benchmark_encode_decode);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,198 @@
+// Unit test for the AES-256 cipher backends and modes
+#include <unity.h>
+#include <string.h>
+#include "../../include/aes_cipher.h"
+
+AesCipher* cipher;
+
+static uint8_t key[32];
+static uint8_t iv[16] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                         0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xff, 0xfe};
+static uint8_t plain[67];
+static uint8_t aad[20];
+
+// Reference outputs for the inputs above, cross-checked against OpenSSL
+static const uint8_t CBC_64[] = {
+    0x5a, 0x50, 0xa0, 0x2e, 0x20, 0x4e, 0xb8, 0x34, 0xc3, 0x68, 0x84, 0x1f, 0x60, 0xce, 0xbe, 0x83,
+    0xd5, 0x97, 0x5b, 0x3b, 0xdf, 0x93, 0x45, 0xb8, 0xe3, 0x1c, 0x48, 0xd9, 0x4c, 0xee, 0xaa, 0x25,
+    0xf8, 0x9a, 0xf7, 0x52, 0x93, 0x95, 0x8b, 0xca, 0x87, 0x48, 0x46, 0xce, 0x4d, 0x5f, 0x54, 0x12,
+    0xb0, 0x27, 0xaf, 0x42, 0x49, 0x92, 0x55, 0x1b, 0xe1, 0xc7, 0x8c, 0x64, 0xd5, 0x94, 0x4a, 0xa7
+};
+static const uint8_t CTR_67[] = {
+    0x71, 0xd2, 0x9b, 0x1e, 0x4a, 0xea, 0xca, 0x55, 0x4e, 0xe4, 0x19, 0x3b, 0x55, 0x82, 0x26, 0x9d,
+    0xeb, 0xe1, 0xcc, 0xeb, 0xee, 0xf1, 0x14, 0x77, 0xc0, 0x45, 0x96, 0x9f, 0x45, 0x16, 0x3c, 0x31,
+    0x23, 0xf4, 0xd7, 0x0e, 0x53, 0x5d, 0x30, 0xed, 0x24, 0x87, 0x77, 0x41, 0x18, 0x9d, 0xd5, 0xc6,
+    0x7b, 0xf2, 0x3c, 0x87, 0x7d, 0x11, 0x79, 0xae, 0x43, 0x08, 0xa0, 0xc2, 0xda, 0xb2, 0x96, 0x0b,
+    0x46, 0x97, 0xa6
+};
+static const uint8_t GCM_67[] = {
+    0x3c, 0x28, 0xdd, 0x11, 0xde, 0xfb, 0x86, 0xd8, 0x0c, 0x92, 0xdc, 0x00, 0x93, 0xdf, 0xc3, 0x01,
+    0x2d, 0x00, 0x4f, 0x79, 0x2c, 0x87, 0xc0, 0x41, 0xef, 0x82, 0x28, 0x90, 0x02, 0x95, 0x38, 0x10,
+    0xfe, 0xcb, 0x96, 0x43, 0x0d, 0xe4, 0x35, 0xa2, 0x46, 0x69, 0xed, 0xc8, 0xf8, 0xdd, 0xe3, 0x13,
+    0x81, 0x89, 0x89, 0x19, 0x25, 0x5c, 0x44, 0x4c, 0x91, 0x14, 0xd5, 0x37, 0xa6, 0x18, 0xe7, 0xc2,
+    0x9e, 0x07, 0x6f
+};
+static const uint8_t GCM_TAG[] = {
+    0x96, 0xe5, 0x2f, 0x4e, 0xe7, 0x7e, 0x19, 0x8e, 0x52, 0x93, 0xac, 0xd7, 0xe0, 0x2b, 0x60, 0x8e
+};
+static const uint8_t GCM_EMPTY_TAG[] = {
+    0xba, 0x8d, 0x13, 0x65, 0xd1, 0xe3, 0x7b, 0x83, 0xc2, 0x96, 0xfa, 0xa6, 0x7d, 0x36, 0x2d, 0xb6
+};
+
+void setUp() {
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = (uint8_t)(i * 7 + 3);
+    for (size_t i = 0; i < sizeof(plain); i++) plain[i] = (uint8_t)(i * 13 + 1);
+    for (size_t i = 0; i < sizeof(aad); i++) aad[i] = (uint8_t)(0xa0 + i);
+    cipher = new AesCipher();
+    TEST_ASSERT_TRUE(cipher->setKey(key, sizeof(key)));
+}
+
+void tearDown() {
+    delete cipher;
+}
+
+void test_fips197_block_and_key_rules() {
+    uint8_t fipsKey[32];
+    for (size_t i = 0; i < sizeof(fipsKey); i++) fipsKey[i] = (uint8_t)i;
+    const uint8_t input[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                               0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    const uint8_t expected[16] = {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+                                  0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89};
+    uint8_t output[16];
+
+    TEST_ASSERT_FALSE(cipher->setKey(fipsKey, 16));
+    TEST_ASSERT_FALSE(cipher->hasKey());
+    TEST_ASSERT_FALSE(cipher->encryptEcb(input, output, sizeof(output)));
+
+    TEST_ASSERT_TRUE(cipher->setKey(fipsKey, sizeof(fipsKey)));
+    TEST_ASSERT_FALSE(cipher->encryptEcb(input, output, 15));
+    TEST_ASSERT_TRUE(cipher->encryptEcb(input, output, sizeof(output)));
+    TEST_ASSERT_EQUAL_MEMORY(expected, output, sizeof(expected));
+    TEST_ASSERT_TRUE(cipher->decryptEcb(output, output, sizeof(output)));
+    TEST_ASSERT_EQUAL_MEMORY(input, output, sizeof(input));
+}
+
+void test_cbc_chains_and_runs_in_place() {
+    uint8_t chain[16];
+    uint8_t buffer[64];
+    memcpy(chain, iv, sizeof(chain));
+    memcpy(buffer, plain, sizeof(buffer));
+
+    // Two calls continue one stream through the updated IV
+    TEST_ASSERT_TRUE(cipher->encryptCbc(chain, buffer, buffer, 16));
+    TEST_ASSERT_TRUE(cipher->encryptCbc(chain, buffer + 16, buffer + 16, 48));
+    TEST_ASSERT_EQUAL_MEMORY(CBC_64, buffer, sizeof(CBC_64));
+    TEST_ASSERT_EQUAL_MEMORY(CBC_64 + 48, chain, sizeof(chain));
+
+    memcpy(chain, iv, sizeof(chain));
+    TEST_ASSERT_TRUE(cipher->decryptCbc(chain, buffer, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY(plain, buffer, sizeof(buffer));
+}
+
+void test_ctr_carries_across_the_counter() {
+    uint8_t output[sizeof(plain)];
+    uint8_t counter[16];
+    memcpy(counter, iv, sizeof(counter));
+
+    // The IV ends in ...ff fe, so the third block carries into the upper bytes
+    TEST_ASSERT_TRUE(cipher->cryptCtr(counter, plain, output, sizeof(plain)));
+    TEST_ASSERT_EQUAL_MEMORY(CTR_67, output, sizeof(CTR_67));
+    TEST_ASSERT_EQUAL_MEMORY(iv, counter, sizeof(counter));
+    TEST_ASSERT_TRUE(cipher->cryptCtr(counter, output, output, sizeof(output)));
+    TEST_ASSERT_EQUAL_MEMORY(plain, output, sizeof(plain));
+}
+
+void test_gcm_seals_and_rejects_tampering() {
+    uint8_t output[sizeof(plain)];
+    uint8_t tag[16];
+
+    TEST_ASSERT_TRUE(cipher->sealGcm(iv, aad, sizeof(aad), plain, output, sizeof(plain), tag));
+    TEST_ASSERT_EQUAL_MEMORY(GCM_67, output, sizeof(GCM_67));
+    TEST_ASSERT_EQUAL_MEMORY(GCM_TAG, tag, sizeof(GCM_TAG));
+
+    uint8_t opened[sizeof(plain)];
+    TEST_ASSERT_TRUE(cipher->openGcm(iv, aad, sizeof(aad), output, opened, sizeof(output), tag));
+    TEST_ASSERT_EQUAL_MEMORY(plain, opened, sizeof(plain));
+
+    output[40] ^= 0x01;
+    TEST_ASSERT_FALSE(cipher->openGcm(iv, aad, sizeof(aad), output, opened, sizeof(output), tag));
+    for (size_t i = 0; i < sizeof(opened); i++) TEST_ASSERT_EQUAL(0, opened[i]);
+    output[40] ^= 0x01;
+    aad[0] ^= 0x80;
+    TEST_ASSERT_FALSE(cipher->openGcm(iv, aad, sizeof(aad), output, opened, sizeof(output), tag));
+
+    TEST_ASSERT_TRUE(cipher->sealGcm(iv, nullptr, 0, nullptr, nullptr, 0, tag));
+    TEST_ASSERT_EQUAL_MEMORY(GCM_EMPTY_TAG, tag, sizeof(GCM_EMPTY_TAG));
+}
+
+void test_backends_agree() {
+#ifdef ARDUINO
+    TEST_ASSERT_EQUAL(AES_BACKEND_HARDWARE, cipher->getBackend());
+    TEST_ASSERT_FALSE(cipher->useBackend(AES_BACKEND_PORTABLE));
+#else
+    TEST_ASSERT_FALSE(cipher->useBackend(AES_BACKEND_HARDWARE));
+    if (!cipher->useBackend(AES_BACKEND_AESNI)) {
+        TEST_ASSERT_EQUAL(AES_BACKEND_PORTABLE, cipher->getBackend());
+        return;
+    }
+
+    // A long run exercises the multi-block paths on both sides
+    static uint8_t data[1024 + 48];
+    static uint8_t fast[sizeof(data)];
+    static uint8_t portable[sizeof(data)];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 31 + 5);
+    uint8_t chain[16];
+    uint8_t tag[16];
+    uint8_t portableTag[16];
+
+    TEST_ASSERT_TRUE(cipher->encryptEcb(data, fast, sizeof(data)));
+    TEST_ASSERT_TRUE(cipher->useBackend(AES_BACKEND_PORTABLE));
+    TEST_ASSERT_TRUE(cipher->encryptEcb(data, portable, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(portable, fast, sizeof(data));
+
+    TEST_ASSERT_TRUE(cipher->useBackend(AES_BACKEND_AESNI));
+    memcpy(chain, iv, sizeof(chain));
+    TEST_ASSERT_TRUE(cipher->decryptCbc(chain, data, fast, sizeof(data)));
+    TEST_ASSERT_TRUE(cipher->sealGcm(iv, aad, sizeof(aad), data, fast, sizeof(data) - 5, tag));
+    TEST_ASSERT_TRUE(cipher->useBackend(AES_BACKEND_PORTABLE));
+    TEST_ASSERT_TRUE(cipher->sealGcm(iv, aad, sizeof(aad), data, portable, sizeof(data) - 5, portableTag));
+    TEST_ASSERT_EQUAL_MEMORY(portable, fast, sizeof(data) - 5);
+    TEST_ASSERT_EQUAL_MEMORY(portableTag, tag, sizeof(tag));
+
+    memcpy(chain, iv, sizeof(chain));
+    TEST_ASSERT_TRUE(cipher->decryptCbc(chain, data, portable, sizeof(data)));
+    TEST_ASSERT_TRUE(cipher->useBackend(AES_BACKEND_AESNI));
+    memcpy(chain, iv, sizeof(chain));
+    TEST_ASSERT_TRUE(cipher->decryptCbc(chain, data, fast, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(portable, fast, sizeof(data));
+#endif
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_fips197_block_and_key_rules);
+    RUN_TEST(test_cbc_chains_and_runs_in_place);
+    RUN_TEST(test_ctr_carries_across_the_counter);
+    RUN_TEST(test_gcm_seals_and_rejects_tampering);
+    RUN_TEST(test_backends_agree);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fips197_block_and_key_rules);
+    RUN_TEST(test_cbc_chains_and_runs_in_place);
+    RUN_TEST(test_ctr_carries_across_the_counter);
+    RUN_TEST(test_gcm_seals_and_rejects_tampering);
+    RUN_TEST(test_backends_agree);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,214 @@
+// Unit test for the HMAC replay filter
+#include <unity.h>
+#include <stdio.h>
+#include "../../include/hmac_replay_filter.h"
+
+HMACReplayFilter* filter;
+
+static const uint32_t T0 = 10000000;       // Mesh time well away from zero
+
+void setUp() {
+    filter = new HMACReplayFilter();
+}
+
+void tearDown() {
+    delete filter;
+}
+
+// check + record, as HMACHandler does for a message whose HMAC verified
+static HMACReplayVerdict acceptSequence(uint32_t peer, uint32_t seq, uint32_t ts, uint32_t now) {
+    HMACReplayVerdict verdict = filter->checkSequence(peer, seq, ts, now);
+    if (verdict == REPLAY_ACCEPT) {
+        filter->recordSequence(peer, seq, ts, now);
+    }
+    return verdict;
+}
+
+static HMACReplayVerdict acceptNonce(uint32_t peer, uint32_t ts, uint32_t nonce, uint32_t now) {
+    HMACReplayVerdict verdict = filter->checkNonce(peer, ts, nonce, now);
+    if (verdict == REPLAY_ACCEPT) {
+        filter->recordNonce(peer, ts, nonce);
+    }
+    return verdict;
+}
+
+void test_sequence_window() {
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 100, T0, T0));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptSequence(7, 100, T0, T0));
+
+    // Reordering inside the window, then a jump that shifts across words
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 105, T0 + 5, T0 + 5));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 102, T0 + 2, T0 + 6));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptSequence(7, 102, T0 + 2, T0 + 7));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 105 + 40, T0 + 8, T0 + 8));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptSequence(7, 105, T0 + 5, T0 + 9));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptSequence(7, 100, T0, T0 + 9));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 101, T0 + 1, T0 + 9));
+
+    // Behind the window, and ahead but carrying an old timestamp
+    uint32_t top = 105 + 40;
+    TEST_ASSERT_EQUAL(REPLAY_OUT_OF_WINDOW, acceptSequence(7, top - HMAC_REPLAY_SEQ_WINDOW, T0, T0 + 10));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, top - HMAC_REPLAY_SEQ_WINDOW + 1, T0, T0 + 10));
+    TEST_ASSERT_EQUAL(REPLAY_OUT_OF_WINDOW,
+                      acceptSequence(7, top + 1, T0 + 8 - HMAC_REPLAY_REORDER_MS - 1, T0 + 10));
+
+    // Other senders have their own windows
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(8, 100, T0, T0 + 10));
+
+    // Timestamps outside the window, whatever the sequence number
+    TEST_ASSERT_EQUAL(REPLAY_STALE, acceptSequence(7, top + 2, T0 - HMAC_REPLAY_WINDOW_MS - 1, T0));
+    TEST_ASSERT_EQUAL(REPLAY_FUTURE, acceptSequence(7, top + 2, T0 + HMAC_REPLAY_FUTURE_MS + 1, T0));
+
+    HMACReplayStats stats = filter->getStats();
+    TEST_ASSERT_EQUAL(7, stats.accepted);
+    TEST_ASSERT_EQUAL(4, stats.duplicate);
+    TEST_ASSERT_EQUAL(2, stats.outOfWindow);
+    TEST_ASSERT_EQUAL(1, stats.stale);
+    TEST_ASSERT_EQUAL(1, stats.future);
+    TEST_ASSERT_EQUAL(2, stats.peers);
+}
+
+void test_sequence_restart_and_eviction() {
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 5000, T0, T0));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 5001, T0 + 10, T0 + 10));
+
+    // Rebooted sender counts from zero again with a later timestamp
+    uint32_t later = T0 + HMAC_REPLAY_REORDER_MS + 100;
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 0, later, later));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 1, later + 1, later + 1));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptSequence(7, 0, later, later + 2));
+
+    // Captures from before the reboot stay refused, whichever side of the new top they land
+    TEST_ASSERT_EQUAL(REPLAY_OUT_OF_WINDOW, acceptSequence(7, 5001, T0 + 10, later + 3));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(7, 5002, later + 4, later + 4));
+    TEST_ASSERT_EQUAL(REPLAY_OUT_OF_WINDOW, acceptSequence(7, 0, later, later + 5));
+    TEST_ASSERT_EQUAL(1, filter->getStats().restarts);
+
+    // More live senders than the table holds: the least recently heard make room
+    for (uint32_t peer = 1000; peer < 1000 + HMAC_REPLAY_PEERS * 2; peer++) {
+        TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(peer, 1, later, later + 10));
+    }
+    HMACReplayStats stats = filter->getStats();
+    TEST_ASSERT_TRUE(stats.peers <= HMAC_REPLAY_PEERS);
+    TEST_ASSERT_EQUAL(1 + HMAC_REPLAY_PEERS * 2, stats.peers + stats.evictions);
+
+    // Entries that went quiet past the window are reused without counting as evictions
+    uint32_t quiet = later + 10 + HMAC_REPLAY_WINDOW_MS + HMAC_REPLAY_FUTURE_MS + 1;
+    for (uint32_t peer = 5000; peer < 5000 + HMAC_REPLAY_PEERS / 8; peer++) {
+        TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptSequence(peer, 1, quiet, quiet));
+    }
+    TEST_ASSERT_EQUAL(stats.evictions, filter->getStats().evictions);
+}
+
+void test_nonce_buckets() {
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptNonce(1, T0, 0xDEADBEEF, T0));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptNonce(1, T0, 0xDEADBEEF, T0 + 1));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptNonce(1, T0 + 1, 0xDEADBEEF, T0 + 1));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptNonce(2, T0, 0xDEADBEEF, T0 + 1));
+
+    // Still refused at the very end of the window, stale just after it
+    uint32_t edge = T0 + HMAC_REPLAY_WINDOW_MS;
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptNonce(1, T0, 0xDEADBEEF, edge));
+    TEST_ASSERT_EQUAL(REPLAY_STALE, acceptNonce(1, T0, 0xDEADBEEF, edge + 1));
+
+    // Traffic in every slice of the ring never resurrects the old nonce
+    for (uint32_t t = T0; t < edge; t += HMAC_REPLAY_BUCKET_MS / 2) {
+        TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptNonce(3, t, t, t));
+        TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptNonce(1, T0, 0xDEADBEEF, t));
+    }
+
+    // A slice fills most of the way before a nonce finds both its rows full; that one is
+    // refused instead of dropping old ones, or let through unrecorded if so configured
+    uint32_t slice = (edge / HMAC_REPLAY_BUCKET_MS + 4) * HMAC_REPLAY_BUCKET_MS;
+    uint32_t stored = 0;
+    uint32_t nonce = 0;
+    while (filter->getStats().overflow == 0) {
+        stored += acceptNonce(4, slice, nonce++ * 2654435761U, slice) == REPLAY_ACCEPT;
+    }
+    stored -= HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT;
+    uint32_t last = (nonce - 1) * 2654435761U;
+    TEST_ASSERT_TRUE(stored >= HMAC_REPLAY_BUCKET_SLOTS * 3 / 4);
+    TEST_ASSERT_EQUAL(HMAC_REPLAY_NONCE_OVERFLOW_ACCEPT ? REPLAY_ACCEPT : REPLAY_OVERFLOW,
+                      acceptNonce(4, slice, last, slice));
+    TEST_ASSERT_EQUAL(REPLAY_DUPLICATE, acceptNonce(4, slice, 0, slice));
+    TEST_ASSERT_EQUAL(REPLAY_ACCEPT, acceptNonce(4, slice + HMAC_REPLAY_BUCKET_MS, last, slice));
+
+    HMACReplayStats stats = filter->getStats();
+    TEST_ASSERT_EQUAL(2, stats.overflow);
+    TEST_ASSERT_TRUE(stats.memoryBytes <= HMAC_REPLAY_MEMORY_LIMIT);
+}
+
+// 150 sequenced senders at 30 messages a minute each for ten minutes, delivered
+// out of order and each replayed once, alongside half of them also sending
+// nonce-only messages (2250 a minute, past the old 1300 ceiling): every
+// sequenced original passes, nonce fingerprints mistake no more than one
+// original in a thousand for a replay, and every replay is caught
+void test_many_peers_sustained() {
+    const uint32_t senders = 150;
+    const uint32_t perMinute = 30;
+    const uint32_t minutes = 10;
+    uint32_t accepted = 0;
+    uint32_t nonceAccepted = 0;
+    uint32_t refused = 0;
+
+    for (uint32_t m = 0; m < minutes * perMinute; m++) {
+        uint32_t now = T0 + m * (60000 / perMinute);
+        for (uint32_t p = 0; p < senders; p++) {
+            // Every pair arrives swapped
+            uint32_t seq = m ^ 1U;
+            uint32_t ts = T0 + seq * (60000 / perMinute);
+            accepted += acceptSequence(0x10000 + p * 7919, seq, ts, now) == REPLAY_ACCEPT;
+            if (p % 2 == 0) {
+                nonceAccepted += acceptNonce(0x10000 + p * 7919, ts, seq * 2654435761U + p, now) == REPLAY_ACCEPT;
+            }
+        }
+        for (uint32_t p = 0; p < senders && m > 4; p++) {
+            uint32_t old = m - 4;
+            uint32_t ts = T0 + old * (60000 / perMinute);
+            refused += acceptSequence(0x10000 + p * 7919, old, ts, now) == REPLAY_DUPLICATE;
+            if (p % 2 == 0) {
+                refused += acceptNonce(0x10000 + p * 7919, ts, old * 2654435761U + p, now) == REPLAY_DUPLICATE;
+            }
+        }
+    }
+
+    HMACReplayStats stats = filter->getStats();
+    const uint32_t nonceSent = (senders + 1) / 2 * perMinute * minutes;
+    printf("%u senders x %u msg/min + %u nonce-only/min: %u accepted, %u of %u nonces taken for replays, "
+           "%u replays refused, %u peers tracked, %u bytes\n",
+           (unsigned)senders, (unsigned)perMinute, (unsigned)((senders + 1) / 2 * perMinute),
+           (unsigned)stats.accepted, (unsigned)(nonceSent - nonceAccepted), (unsigned)nonceSent,
+           (unsigned)stats.duplicate, (unsigned)stats.peers, (unsigned)stats.memoryBytes);
+    TEST_ASSERT_EQUAL(senders * perMinute * minutes, accepted);
+    TEST_ASSERT_TRUE(nonceAccepted >= nonceSent - nonceSent / 1000);
+    TEST_ASSERT_EQUAL((senders + (senders + 1) / 2) * (perMinute * minutes - 5), refused);
+    TEST_ASSERT_EQUAL(0, stats.evictions);
+    TEST_ASSERT_EQUAL(0, stats.overflow);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_sequence_window);
+    RUN_TEST(test_sequence_restart_and_eviction);
+    RUN_TEST(test_nonce_buckets);
+    RUN_TEST(test_many_peers_sustained);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sequence_window);
+    RUN_TEST(test_sequence_restart_and_eviction);
+    RUN_TEST(test_nonce_buckets);
+    RUN_TEST(test_many_peers_sustained);
+    return UNITY_END();
+}
+#endif
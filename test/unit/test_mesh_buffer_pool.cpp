@@ -0,0 +1,264 @@
+// Unit test for the mesh frame buffer pool
+#include <unity.h>
+#include <string.h>
+#include <utility>
+#include "../../include/mesh_buffer_pool.h"
+#include "../../include/mesh_compressor.h"
+#include "../../include/mesh_dispatcher.h"
+#include "../../include/mesh_outbound_queue.h"
+#include "../../include/mesh_wire_frame.h"
+
+#ifndef ARDUINO
+#include <new>
+#include <stdlib.h>
+
+// Counts every global allocation so the codec-stage test can assert there are none
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+    heapAllocations++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) {
+    heapAllocations++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete[](void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+void operator delete[](void* block, size_t) noexcept { free(block); }
+#endif
+
+MeshBufferPool* pool;
+
+void setUp() {
+    pool = new MeshBufferPool();
+}
+
+void tearDown() {
+    delete pool;
+}
+
+void test_smallest_fitting_class_serves_request() {
+    MeshBuffer small = pool->acquire(10);
+    MeshBuffer medium = pool->acquire(MESH_BUFFER_SMALL_SIZE + 1);
+    MeshBuffer large = pool->acquire(MESH_BUFFER_LARGE_SIZE);
+
+    TEST_ASSERT_EQUAL(MESH_BUFFER_SMALL_SIZE, small.capacity());
+    TEST_ASSERT_EQUAL(MESH_BUFFER_MEDIUM_SIZE, medium.capacity());
+    TEST_ASSERT_EQUAL(MESH_BUFFER_LARGE_SIZE, large.capacity());
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_SMALL).inUse);
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_MEDIUM).inUse);
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_LARGE).inUse);
+
+    // Too big for any class
+    MeshBuffer oversized = pool->acquire(MESH_BUFFER_LARGE_SIZE + 1);
+    TEST_ASSERT_FALSE(oversized.valid());
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_LARGE).failures);
+}
+
+void test_blocks_return_when_handles_go_out_of_scope() {
+    {
+        MeshBuffer first = pool->acquire(32);
+        MeshBuffer second = pool->acquire(32);
+        TEST_ASSERT_TRUE(first.data() != second.data());
+        TEST_ASSERT_EQUAL(2, pool->getStats(MESH_BUFFER_SMALL).inUse);
+    }
+
+    MeshBufferPoolStats stats = pool->getStats(MESH_BUFFER_SMALL);
+    TEST_ASSERT_EQUAL(0, stats.inUse);
+    TEST_ASSERT_EQUAL(2, stats.highWater);
+    TEST_ASSERT_EQUAL(2, stats.acquired);
+
+    // High-water marks outlive a stats reset
+    pool->resetStats();
+    TEST_ASSERT_EQUAL(0, pool->getStats(MESH_BUFFER_SMALL).acquired);
+    TEST_ASSERT_EQUAL(2, pool->getStats(MESH_BUFFER_SMALL).highWater);
+}
+
+void test_move_transfers_ownership() {
+    MeshBuffer original = pool->acquire(32);
+    uint8_t* block = original.data();
+    block[0] = 0x5A;
+
+    MeshBuffer moved = std::move(original);
+    TEST_ASSERT_FALSE(original.valid());
+    TEST_ASSERT_TRUE(moved.data() == block);
+    TEST_ASSERT_EQUAL(0x5A, moved.data()[0]);
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_SMALL).inUse);
+
+    // Assigning over a live handle returns its old block first
+    MeshBuffer other = pool->acquire(32);
+    other = std::move(moved);
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_SMALL).inUse);
+
+    other.release();
+    other.release();
+    TEST_ASSERT_EQUAL(0, pool->getStats(MESH_BUFFER_SMALL).inUse);
+}
+
+void test_exhausted_class_falls_back_to_larger() {
+    MeshBuffer held[MESH_BUFFER_SMALL_COUNT];
+    for (size_t i = 0; i < MESH_BUFFER_SMALL_COUNT; i++) {
+        held[i] = pool->acquire(16);
+        TEST_ASSERT_TRUE(held[i].valid());
+    }
+
+    MeshBuffer spill = pool->acquire(16);
+    TEST_ASSERT_EQUAL(MESH_BUFFER_MEDIUM_SIZE, spill.capacity());
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_SMALL).fallbacks);
+    TEST_ASSERT_EQUAL(0, pool->getStats(MESH_BUFFER_SMALL).failures);
+
+    // Once every class is drained the request fails and is counted against the class asked for
+    MeshBuffer rest[MESH_BUFFER_MEDIUM_COUNT + MESH_BUFFER_LARGE_COUNT];
+    for (size_t i = 0; i + 1 < MESH_BUFFER_MEDIUM_COUNT + MESH_BUFFER_LARGE_COUNT; i++) {
+        rest[i] = pool->acquire(16);
+        TEST_ASSERT_TRUE(rest[i].valid());
+    }
+    TEST_ASSERT_FALSE(pool->acquire(16).valid());
+    TEST_ASSERT_EQUAL(1, pool->getStats(MESH_BUFFER_SMALL).failures);
+    TEST_ASSERT_EQUAL(MESH_BUFFER_LARGE_COUNT, pool->getStats(MESH_BUFFER_LARGE).highWater);
+}
+
+#ifndef ARDUINO
+static size_t delivered = 0;
+
+static void countDelivery(void* context, const MeshMessageInfo& info, const uint8_t* data, size_t len) {
+    delivered += len;
+}
+
+// One message through the pooled codec stages, buffers from the pool. MeshNetworkManager's own
+// path (AEAD, transmit, receive ring) is checked by the simulator's mesh_sim_heap tests.
+static void roundTrip(MeshOutboundQueue& queue, MeshCompressor& compressor, MeshDispatcher& dispatcher,
+                      const uint8_t* message, size_t messageLen, uint32_t seq) {
+    queue.enqueue(7, MESH_MSG_DATA, message, messageLen, 0, MESH_PRIORITY_SMS, seq);
+    queue.enqueue(7, MESH_MSG_DATA, message, messageLen / 2, 0, MESH_PRIORITY_SMS, seq);
+
+    MeshBuffer batch = pool->acquire(MESH_COALESCE_MAX_BYTES);
+    MeshOutboundFrame outFrame;
+    queue.nextFrame(seq, &outFrame, batch.data(), batch.capacity());
+
+    MeshBuffer packed = pool->acquire(outFrame.length);
+    size_t packedLen;
+    bool compressed = compressor.compress(outFrame.type, batch.data(), outFrame.length,
+                                          packed.data(), packed.capacity(), &packedLen);
+
+    MeshFrameHeader header = {};
+    header.version = MeshWireFrame::VERSION;
+    header.type = outFrame.type;
+    header.flags = compressed ? MeshWireFrame::FLAG_COMPRESSED : 0;
+    header.seq = seq;
+    header.source = 1;
+    header.dest = 7;
+    header.length = compressed ? packedLen : outFrame.length;
+
+    MeshBuffer frame = pool->acquire(MeshWireFrame::HEADER_SIZE + header.length);
+    size_t frameLen;
+    MeshWireFrame::encode(header, compressed ? packed.data() : batch.data(),
+                          frame.data(), frame.capacity(), &frameLen);
+    batch.release();
+    packed.release();
+
+    MeshBuffer text = pool->acquire(MeshWireFrame::armoredSize(frameLen) + 1);
+    size_t textLen;
+    MeshWireFrame::armor(frame.data(), frameLen, (char*)text.data(), text.capacity(), &textLen);
+    frame.release();
+
+    // Receive side
+    MeshBuffer rxFrame = pool->acquire(textLen / 4 * 3 + 3);
+    size_t rxLen;
+    MeshWireFrame::unarmor((const char*)text.data(), textLen, rxFrame.data(), rxFrame.capacity(), &rxLen);
+    text.release();
+
+    MeshFrameHeader rxHeader;
+    const uint8_t* payload;
+    MeshWireFrame::decode(rxFrame.data(), rxLen, &rxHeader, &payload);
+
+    MeshBuffer plain = pool->acquire(MeshCompressor::MAX_BLOCK);
+    size_t plainLen = rxHeader.length;
+    if (rxHeader.flags & MeshWireFrame::FLAG_COMPRESSED) {
+        compressor.decompress(rxHeader.type, payload, rxHeader.length, plain.data(), plain.capacity(), &plainLen);
+    } else {
+        memcpy(plain.data(), payload, plainLen);
+    }
+    rxFrame.release();
+
+    MeshMessageInfo info = {};
+    info.source = rxHeader.source;
+    size_t offset = 0;
+    uint8_t type;
+    const uint8_t* data;
+    size_t len;
+    while (MeshOutboundQueue::nextRecord(plain.data(), plainLen, &offset, &type, &data, &len)) {
+        info.type = type;
+        dispatcher.dispatch(info, data, len);
+    }
+}
+
+void test_codec_stages_do_not_allocate() {
+    MeshOutboundQueue* queue = new MeshOutboundQueue();
+    MeshCompressor* compressor = new MeshCompressor();
+    MeshDispatcher* dispatcher = new MeshDispatcher();
+    dispatcher->registerHandler(MESH_MSG_DATA, countDelivery, nullptr);
+
+    const char* job = "{\"job\":\"sms\",\"id\":48213,\"to\":\"+989121234567\",\"sim\":2,\"status\":\"queued\"}";
+    size_t jobLen = strlen(job);
+
+    // Warm-up, then every later message must come from fixed storage
+    for (uint32_t seq = 1; seq <= 8; seq++) {
+        roundTrip(*queue, *compressor, *dispatcher, (const uint8_t*)job, jobLen, seq);
+    }
+    delivered = 0;
+
+    size_t before = heapAllocations;
+    for (uint32_t seq = 9; seq < 1009; seq++) {
+        roundTrip(*queue, *compressor, *dispatcher, (const uint8_t*)job, jobLen, seq);
+    }
+    size_t allocations = heapAllocations - before;
+
+    TEST_ASSERT_EQUAL(0, allocations);
+    TEST_ASSERT_EQUAL(1000 * (jobLen + jobLen / 2), delivered);
+    TEST_ASSERT_EQUAL(0, pool->getStats(MESH_BUFFER_LARGE).failures);
+    for (int c = 0; c < MESH_BUFFER_CLASS_COUNT; c++) {
+        TEST_ASSERT_EQUAL(0, pool->getStats((MeshBufferClass)c).inUse);
+    }
+
+    delete dispatcher;
+    delete compressor;
+    delete queue;
+}
+#endif
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_smallest_fitting_class_serves_request);
+    RUN_TEST(test_blocks_return_when_handles_go_out_of_scope);
+    RUN_TEST(test_move_transfers_ownership);
+    RUN_TEST(test_exhausted_class_falls_back_to_larger);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_smallest_fitting_class_serves_request);
+    RUN_TEST(test_blocks_return_when_handles_go_out_of_scope);
+    RUN_TEST(test_move_transfers_ownership);
+    RUN_TEST(test_exhausted_class_falls_back_to_larger);
+    RUN_TEST(test_codec_stages_do_not_allocate);
+    return UNITY_END();
+}
+#endif
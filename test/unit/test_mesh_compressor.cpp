@@ -0,0 +1,137 @@
+// Unit test for mesh payload compression
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_compressor.h"
+#include "../../include/mesh_wire_frame.h"
+
+MeshCompressor* compressor;
+
+static uint8_t packed[MeshCompressor::MAX_BLOCK];
+static uint8_t unpacked[MeshCompressor::MAX_BLOCK];
+
+static const char* smsJob =
+    "{\"job\":\"sms\",\"id\":48213,\"to\":\"+989121234567\",\"sim\":2,\"slot\":1,"
+    "\"encoding\":\"ucs2\",\"text\":\"06440627063306270645\",\"retry\":0,\"ts\":1718000000}";
+
+void setUp() {
+    compressor = new MeshCompressor();
+}
+
+void tearDown() {
+    delete compressor;
+}
+
+void test_roundtrip_with_dictionary() {
+    size_t len = strlen(smsJob);
+    size_t packedLen;
+    size_t unpackedLen;
+    TEST_ASSERT_TRUE(compressor->compress(MESH_MSG_DATA, (const uint8_t*)smsJob, len, packed, sizeof(packed), &packedLen));
+    TEST_ASSERT_TRUE(packedLen + MESH_COMPRESS_MIN_SAVING <= len);
+
+    TEST_ASSERT_TRUE(compressor->decompress(MESH_MSG_DATA, packed, packedLen, unpacked, sizeof(unpacked), &unpackedLen));
+    TEST_ASSERT_EQUAL(len, unpackedLen);
+    TEST_ASSERT_EQUAL_MEMORY(smsJob, unpacked, len);
+
+    // The dictionary is what makes a single short job compressible
+    size_t plainLen;
+    bool withoutDictionary = compressor->compress(MESH_MSG_COMMAND, (const uint8_t*)smsJob, len,
+                                                  packed, sizeof(packed), &plainLen);
+    TEST_ASSERT_TRUE(!withoutDictionary || plainLen > packedLen);
+}
+
+void test_long_runs_and_overlapping_matches() {
+    uint8_t input[MeshCompressor::MAX_BLOCK];
+    memset(input, 'A', 600);
+    for (size_t i = 600; i < sizeof(input); i++) {
+        input[i] = (uint8_t)("0123456789abcdef"[i % 16]);
+    }
+
+    size_t packedLen;
+    size_t unpackedLen;
+    TEST_ASSERT_TRUE(compressor->compress(MESH_MSG_COMMAND, input, sizeof(input), packed, sizeof(packed), &packedLen));
+    TEST_ASSERT_TRUE(packedLen < 64);
+    TEST_ASSERT_TRUE(compressor->decompress(MESH_MSG_COMMAND, packed, packedLen, unpacked, sizeof(unpacked), &unpackedLen));
+    TEST_ASSERT_EQUAL(sizeof(input), unpackedLen);
+    TEST_ASSERT_EQUAL_MEMORY(input, unpacked, sizeof(input));
+}
+
+void test_incompressible_input_backs_off() {
+    uint8_t noise[200];
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < sizeof(noise); i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        noise[i] = (uint8_t)x;
+    }
+
+    size_t packedLen;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_FALSE(compressor->compress(MESH_MSG_COMMAND, noise, sizeof(noise), packed, sizeof(packed), &packedLen));
+    }
+    TEST_ASSERT_EQUAL(4, compressor->getStats().notSmaller);
+
+    // Further attempts are skipped without running the match finder
+    for (int i = 0; i < MESH_COMPRESS_BACKOFF; i++) {
+        compressor->compress(MESH_MSG_COMMAND, (const uint8_t*)smsJob, strlen(smsJob), packed, sizeof(packed), &packedLen);
+    }
+    MeshCompressionStats stats = compressor->getStats();
+    TEST_ASSERT_EQUAL(4, stats.attempted);
+    TEST_ASSERT_EQUAL(MESH_COMPRESS_BACKOFF, stats.skipped);
+
+    // Other types are unaffected, and the backed-off type is retried afterwards
+    TEST_ASSERT_TRUE(compressor->compress(MESH_MSG_DATA, (const uint8_t*)smsJob, strlen(smsJob), packed, sizeof(packed), &packedLen));
+    TEST_ASSERT_FALSE(compressor->compress(MESH_MSG_COMMAND, noise, sizeof(noise), packed, sizeof(packed), &packedLen));
+    TEST_ASSERT_EQUAL(6, compressor->getStats().attempted);
+}
+
+void test_small_payloads_skipped() {
+    size_t packedLen;
+    TEST_ASSERT_FALSE(compressor->compress(MESH_MSG_DATA, (const uint8_t*)smsJob, MESH_COMPRESS_MIN_BYTES - 1,
+                                           packed, sizeof(packed), &packedLen));
+    TEST_ASSERT_EQUAL(1, compressor->getStats().skipped);
+    TEST_ASSERT_EQUAL(0, compressor->getStats().attempted);
+}
+
+void test_malformed_blocks_rejected() {
+    size_t len = strlen(smsJob);
+    size_t packedLen;
+    size_t unpackedLen;
+    compressor->compress(MESH_MSG_DATA, (const uint8_t*)smsJob, len, packed, sizeof(packed), &packedLen);
+
+    // Truncated, undersized output, offset beyond the window, wrong dictionary
+    TEST_ASSERT_FALSE(compressor->decompress(MESH_MSG_DATA, packed, packedLen - 1, unpacked, sizeof(unpacked), &unpackedLen));
+    TEST_ASSERT_FALSE(compressor->decompress(MESH_MSG_DATA, packed, packedLen, unpacked, len - 1, &unpackedLen));
+
+    const uint8_t farOffset[] = {0x10, 'x', 0xFF, 0x7F, 0x00};
+    TEST_ASSERT_FALSE(compressor->decompress(MESH_MSG_DATA, farOffset, sizeof(farOffset), unpacked, sizeof(unpacked), &unpackedLen));
+    TEST_ASSERT_FALSE(compressor->decompress(MESH_MSG_COMMAND, packed, packedLen, unpacked, sizeof(unpacked), &unpackedLen));
+
+    TEST_ASSERT_EQUAL(4, compressor->getStats().decompressFailures);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip_with_dictionary);
+    RUN_TEST(test_long_runs_and_overlapping_matches);
+    RUN_TEST(test_incompressible_input_backs_off);
+    RUN_TEST(test_small_payloads_skipped);
+    RUN_TEST(test_malformed_blocks_rejected);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip_with_dictionary);
+    RUN_TEST(test_long_runs_and_overlapping_matches);
+    RUN_TEST(test_incompressible_input_backs_off);
+    RUN_TEST(test_small_payloads_skipped);
+    RUN_TEST(test_malformed_blocks_rejected);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,131 @@
+// Unit test for the mesh message-type dispatcher
+#include <unity.h>
+#include "../../include/mesh_dispatcher.h"
+#include "../../include/mesh_wire_frame.h"
+
+MeshDispatcher* dispatcher;
+
+struct Recorder {
+    int calls;
+    uint8_t lastType;
+    uint32_t lastSource;
+    size_t lastLen;
+};
+
+static void recordMessage(void* context, const MeshMessageInfo& info, const uint8_t* data, size_t len) {
+    Recorder* recorder = (Recorder*)context;
+    recorder->calls++;
+    recorder->lastType = info.type;
+    recorder->lastSource = info.source;
+    recorder->lastLen = len;
+}
+
+static void countMessage(void* context, const MeshMessageInfo& info, const uint8_t* data, size_t len) {
+    (*(int*)context)++;
+}
+
+static MeshMessageInfo makeInfo(uint8_t type) {
+    MeshMessageInfo info = {};
+    info.from = 0x2002;
+    info.source = 0x1001;
+    info.seq = 1;
+    info.type = type;
+    info.hops = 1;
+    return info;
+}
+
+void setUp() {
+    dispatcher = new MeshDispatcher();
+}
+
+void tearDown() {
+    delete dispatcher;
+}
+
+void test_dispatch_reaches_registered_handler() {
+    Recorder heartbeat = {};
+    Recorder data = {};
+    TEST_ASSERT_TRUE(dispatcher->registerHandler(MESH_MSG_HEARTBEAT, recordMessage, &heartbeat));
+    TEST_ASSERT_TRUE(dispatcher->registerHandler(MESH_MSG_DATA, recordMessage, &data));
+
+    const uint8_t payload[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_TRUE(dispatcher->dispatch(makeInfo(MESH_MSG_DATA), payload, sizeof(payload)));
+
+    TEST_ASSERT_EQUAL(0, heartbeat.calls);
+    TEST_ASSERT_EQUAL(1, data.calls);
+    TEST_ASSERT_EQUAL(MESH_MSG_DATA, data.lastType);
+    TEST_ASSERT_EQUAL(0x1001, data.lastSource);
+    TEST_ASSERT_EQUAL(5, data.lastLen);
+}
+
+void test_unhandled_and_out_of_range_types() {
+    TEST_ASSERT_FALSE(dispatcher->dispatch(makeInfo(MESH_MSG_COMMAND), nullptr, 0));
+    TEST_ASSERT_FALSE(dispatcher->dispatch(makeInfo(MESH_DISPATCH_TABLE_SIZE), nullptr, 0));
+    TEST_ASSERT_EQUAL(2, dispatcher->getUnhandledCount());
+
+    int calls = 0;
+    TEST_ASSERT_FALSE(dispatcher->registerHandler(MESH_DISPATCH_TABLE_SIZE, countMessage, &calls));
+    TEST_ASSERT_FALSE(dispatcher->registerHandler(MESH_MSG_DATA, nullptr, &calls));
+}
+
+void test_replace_and_unregister() {
+    int first = 0;
+    int second = 0;
+    dispatcher->registerHandler(MESH_MSG_APP_BASE, countMessage, &first);
+    dispatcher->dispatch(makeInfo(MESH_MSG_APP_BASE), nullptr, 0);
+
+    // Re-registering swaps the handler and keeps the counters
+    dispatcher->registerHandler(MESH_MSG_APP_BASE, countMessage, &second);
+    dispatcher->dispatch(makeInfo(MESH_MSG_APP_BASE), nullptr, 0);
+    TEST_ASSERT_EQUAL(1, first);
+    TEST_ASSERT_EQUAL(1, second);
+    TEST_ASSERT_EQUAL(2, dispatcher->getStats(MESH_MSG_APP_BASE).count);
+
+    TEST_ASSERT_TRUE(dispatcher->unregisterHandler(MESH_MSG_APP_BASE));
+    TEST_ASSERT_FALSE(dispatcher->hasHandler(MESH_MSG_APP_BASE));
+    TEST_ASSERT_FALSE(dispatcher->dispatch(makeInfo(MESH_MSG_APP_BASE), nullptr, 0));
+    TEST_ASSERT_EQUAL(1, second);
+}
+
+void test_per_type_stats() {
+    int calls = 0;
+    dispatcher->registerHandler(MESH_MSG_HEARTBEAT, countMessage, &calls);
+    for (int i = 0; i < 100; i++) {
+        dispatcher->dispatch(makeInfo(MESH_MSG_HEARTBEAT), nullptr, 0);
+    }
+
+    MeshHandlerStats stats = dispatcher->getStats(MESH_MSG_HEARTBEAT);
+    TEST_ASSERT_EQUAL(100, stats.count);
+    TEST_ASSERT_TRUE(stats.totalMicros >= stats.maxMicros);
+    TEST_ASSERT_EQUAL(0, dispatcher->getStats(MESH_MSG_DATA).count);
+
+    dispatcher->resetStats();
+    TEST_ASSERT_EQUAL(0, dispatcher->getStats(MESH_MSG_HEARTBEAT).count);
+    TEST_ASSERT_TRUE(dispatcher->hasHandler(MESH_MSG_HEARTBEAT));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_dispatch_reaches_registered_handler);
+    RUN_TEST(test_unhandled_and_out_of_range_types);
+    RUN_TEST(test_replace_and_unregister);
+    RUN_TEST(test_per_type_stats);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_dispatch_reaches_registered_handler);
+    RUN_TEST(test_unhandled_and_out_of_range_types);
+    RUN_TEST(test_replace_and_unregister);
+    RUN_TEST(test_per_type_stats);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,167 @@
+// Unit test for per-neighbor credit flow control
+#include <unity.h>
+#include "../../include/mesh_flow_control.h"
+
+MeshFlowControl* sender;
+MeshFlowControl* receiver;
+
+static const uint32_t SENDER_ID = 1;
+static const uint32_t RECEIVER_ID = 2;
+
+// Sends as many frames as credit allows; the receiver takes in every one
+static uint32_t sendBurst(uint32_t frames, uint32_t nowMs) {
+    uint32_t sent = 0;
+    while (sent < frames && sender->canSend(RECEIVER_ID, nowMs)) {
+        sender->onSent(RECEIVER_ID, nowMs);
+        receiver->onReceived(SENDER_ID, nowMs);
+        sent++;
+    }
+    return sent;
+}
+
+// Delivers pending grants from the receiver; returns how many went out
+static uint32_t deliverGrants(uint32_t nowMs, bool drop = false) {
+    uint32_t dest;
+    uint8_t grant[MeshFlowControl::GRANT_SIZE];
+    size_t len;
+    uint32_t count = 0;
+    while (receiver->nextGrant(nowMs, &dest, grant, sizeof(grant), &len)) {
+        if (dest == SENDER_ID && !drop) {
+            sender->onGrant(RECEIVER_ID, grant, len, nowMs);
+        }
+        count++;
+    }
+    return count;
+}
+
+void setUp() {
+    sender = new MeshFlowControl();
+    receiver = new MeshFlowControl();
+}
+
+void tearDown() {
+    delete sender;
+    delete receiver;
+}
+
+void test_unknown_neighbors_are_open() {
+    TEST_ASSERT_TRUE(sender->canSend(99, 0));
+    TEST_ASSERT_EQUAL(0, sender->getStats(99).nodeId);
+
+    // A receiver owes nothing to a neighbor that never sent
+    uint32_t dest;
+    uint8_t grant[MeshFlowControl::GRANT_SIZE];
+    size_t len;
+    TEST_ASSERT_FALSE(receiver->nextGrant(0, &dest, grant, sizeof(grant), &len));
+}
+
+void test_window_limits_burst() {
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, sendBurst(100, 0));
+    TEST_ASSERT_FALSE(sender->canSend(RECEIVER_ID, 0));
+
+    MeshFlowStats stats = sender->getStats(RECEIVER_ID);
+    TEST_ASSERT_EQUAL(0, stats.credits);
+    TEST_ASSERT_EQUAL(1, stats.stalls);
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, stats.sent);
+
+    // The grant reopens the full window
+    TEST_ASSERT_EQUAL(1, deliverGrants(10));
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, sender->getStats(RECEIVER_ID).credits);
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, sendBurst(100, 10));
+}
+
+void test_grants_every_half_window() {
+    sendBurst(MESH_FLOW_WINDOW / 2 - 1, 0);
+    TEST_ASSERT_EQUAL(0, deliverGrants(0));
+
+    sendBurst(1, 0);
+    TEST_ASSERT_EQUAL(1, deliverGrants(0));
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, sender->getStats(RECEIVER_ID).credits);
+
+    // A trailing frame is granted once the refresh interval passes
+    sendBurst(1, 0);
+    TEST_ASSERT_EQUAL(0, deliverGrants(MESH_FLOW_GRANT_INTERVAL_MS - 1));
+    TEST_ASSERT_EQUAL(1, deliverGrants(MESH_FLOW_GRANT_INTERVAL_MS));
+    TEST_ASSERT_EQUAL(2, receiver->getStats(SENDER_ID).grantsSent);
+}
+
+void test_pressure_closes_window() {
+    sendBurst(2, 0);
+    receiver->setWindow(0);
+    TEST_ASSERT_EQUAL(1, deliverGrants(0));
+    TEST_ASSERT_FALSE(sender->canSend(RECEIVER_ID, 0));
+    TEST_ASSERT_EQUAL(0, sender->getStats(RECEIVER_ID).peerWindow);
+
+    // Recovery is announced straight away
+    receiver->setWindow(MESH_FLOW_WINDOW);
+    TEST_ASSERT_EQUAL(1, deliverGrants(1));
+    TEST_ASSERT_TRUE(sender->canSend(RECEIVER_ID, 1));
+}
+
+void test_lost_grants_resync_after_stall() {
+    sendBurst(100, 0);
+    deliverGrants(0, true);
+    TEST_ASSERT_FALSE(sender->canSend(RECEIVER_ID, MESH_FLOW_STALL_MS - 1));
+
+    TEST_ASSERT_TRUE(sender->canSend(RECEIVER_ID, MESH_FLOW_STALL_MS));
+    MeshFlowStats stats = sender->getStats(RECEIVER_ID);
+    TEST_ASSERT_EQUAL(1, stats.resyncs);
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, stats.credits);
+}
+
+void test_restarted_neighbor_does_not_wedge() {
+    sendBurst(4, 0);
+
+    // A receiver that restarted reports a count that does not match what we sent
+    uint8_t grant[MeshFlowControl::GRANT_SIZE] = {0xFF, 0xFF, 0, 0, MESH_FLOW_WINDOW, 0};
+    TEST_ASSERT_TRUE(sender->onGrant(RECEIVER_ID, grant, sizeof(grant), 5));
+    TEST_ASSERT_EQUAL(MESH_FLOW_WINDOW, sender->getStats(RECEIVER_ID).credits);
+
+    TEST_ASSERT_FALSE(sender->onGrant(RECEIVER_ID, grant, 5, 5));
+
+    sender->removePeer(RECEIVER_ID);
+    TEST_ASSERT_EQUAL(0, sender->getStats(RECEIVER_ID).nodeId);
+}
+
+void test_peer_table_is_bounded() {
+    for (uint32_t id = 10; id < 10 + 2 * MESH_FLOW_PEERS; id++) {
+        sender->onSent(id, id);
+    }
+
+    MeshFlowStats peers[2 * MESH_FLOW_PEERS];
+    TEST_ASSERT_EQUAL(MESH_FLOW_PEERS, sender->getPeers(peers, 2 * MESH_FLOW_PEERS));
+    TEST_ASSERT_EQUAL(0, sender->getStats(10).nodeId);
+    TEST_ASSERT_EQUAL(10 + 2 * MESH_FLOW_PEERS - 1, sender->getStats(10 + 2 * MESH_FLOW_PEERS - 1).nodeId);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unknown_neighbors_are_open);
+    RUN_TEST(test_window_limits_burst);
+    RUN_TEST(test_grants_every_half_window);
+    RUN_TEST(test_pressure_closes_window);
+    RUN_TEST(test_lost_grants_resync_after_stall);
+    RUN_TEST(test_restarted_neighbor_does_not_wedge);
+    RUN_TEST(test_peer_table_is_bounded);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unknown_neighbors_are_open);
+    RUN_TEST(test_window_limits_burst);
+    RUN_TEST(test_grants_every_half_window);
+    RUN_TEST(test_pressure_closes_window);
+    RUN_TEST(test_lost_grants_resync_after_stall);
+    RUN_TEST(test_restarted_neighbor_does_not_wedge);
+    RUN_TEST(test_peer_table_is_bounded);
+    return UNITY_END();
+}
+#endif
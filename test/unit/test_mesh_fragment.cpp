@@ -0,0 +1,175 @@
+// Unit test for mesh fragmentation and pooled reassembly
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_fragment.h"
+
+MeshReassembler* reassembler;
+
+static uint8_t message[MeshFragmenter::MAX_MESSAGE];
+static uint8_t fragment[MeshFragmenter::HEADER_SIZE + MESH_FRAGMENT_SIZE];
+
+// Feeds one fragment of message[0..len) and returns the reassembler verdict
+static MeshReassemblyResult feed(uint32_t source, uint16_t id, size_t len, size_t index, uint32_t nowMs,
+                                 const uint8_t** out = nullptr, size_t* outLen = nullptr) {
+    size_t fragmentLen = 0;
+    MeshFragmenter::writeFragment(id, 20, message, len, index, fragment, sizeof(fragment), &fragmentLen);
+
+    uint8_t type;
+    const uint8_t* data;
+    size_t dataLen;
+    MeshReassemblyResult result = reassembler->onFragment(source, fragment, fragmentLen, nowMs,
+                                                          &type, &data, &dataLen);
+    if (out) *out = data;
+    if (outLen) *outLen = dataLen;
+    return result;
+}
+
+void setUp() {
+    reassembler = new MeshReassembler();
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (uint8_t)(i * 7 + 3);
+    }
+}
+
+void tearDown() {
+    delete reassembler;
+}
+
+void test_split_covers_payload() {
+    const size_t len = 3 * MESH_FRAGMENT_SIZE + 10;
+    TEST_ASSERT_EQUAL(4, MeshFragmenter::fragmentCount(len));
+    TEST_ASSERT_EQUAL(1, MeshFragmenter::fragmentCount(1));
+
+    size_t fragmentLen;
+    TEST_ASSERT_TRUE(MeshFragmenter::writeFragment(9, 20, message, len, 3, fragment, sizeof(fragment), &fragmentLen));
+    TEST_ASSERT_EQUAL(MeshFragmenter::HEADER_SIZE + 10, fragmentLen);
+    TEST_ASSERT_EQUAL_MEMORY(message + 3 * MESH_FRAGMENT_SIZE, fragment + MeshFragmenter::HEADER_SIZE, 10);
+
+    // Past the end, oversized or into a short buffer
+    TEST_ASSERT_FALSE(MeshFragmenter::writeFragment(9, 20, message, len, 4, fragment, sizeof(fragment), &fragmentLen));
+    TEST_ASSERT_FALSE(MeshFragmenter::writeFragment(9, 20, message, MeshFragmenter::MAX_MESSAGE + 1, 0,
+                                                    fragment, sizeof(fragment), &fragmentLen));
+    TEST_ASSERT_FALSE(MeshFragmenter::writeFragment(9, 20, message, len, 0, fragment, 100, &fragmentLen));
+}
+
+void test_out_of_order_reassembly() {
+    const size_t len = 4 * MESH_FRAGMENT_SIZE - 1;
+    const size_t order[] = {2, 0, 3};
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(MESH_REASSEMBLY_PENDING, feed(5, 1, len, order[i], 100));
+    }
+
+    // Repeated fragment is counted and ignored
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_PENDING, feed(5, 1, len, 0, 110));
+    TEST_ASSERT_EQUAL(1, reassembler->getStats().duplicates);
+
+    const uint8_t* out;
+    size_t outLen;
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_COMPLETE, feed(5, 1, len, 1, 120, &out, &outLen));
+    TEST_ASSERT_EQUAL(len, outLen);
+    TEST_ASSERT_EQUAL_MEMORY(message, out, len);
+
+    MeshReassemblyStats stats = reassembler->getStats();
+    TEST_ASSERT_EQUAL(1, stats.completed);
+    TEST_ASSERT_EQUAL(4, stats.blocksInUse);
+
+    // Completed message is released on the next call
+    reassembler->expire(130);
+    TEST_ASSERT_EQUAL(0, reassembler->getStats().blocksInUse);
+}
+
+void test_interleaved_senders() {
+    const size_t len = 2 * MESH_FRAGMENT_SIZE;
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_PENDING, feed(5, 7, len, 0, 100));
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_PENDING, feed(6, 7, len, 1, 100));
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_COMPLETE, feed(5, 7, len, 1, 100));
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_COMPLETE, feed(6, 7, len, 0, 100));
+    TEST_ASSERT_EQUAL(2, reassembler->getStats().started);
+}
+
+void test_malformed_fragments_rejected() {
+    size_t fragmentLen;
+    uint8_t type;
+    const uint8_t* data;
+    size_t dataLen;
+    MeshFragmenter::writeFragment(1, 20, message, 2 * MESH_FRAGMENT_SIZE, 0, fragment, sizeof(fragment), &fragmentLen);
+
+    // Truncated data, header only, misaligned offset, unknown source
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_DROPPED,
+                      reassembler->onFragment(5, fragment, fragmentLen - 1, 0, &type, &data, &dataLen));
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_DROPPED,
+                      reassembler->onFragment(5, fragment, MeshFragmenter::HEADER_SIZE, 0, &type, &data, &dataLen));
+    fragment[2] = 1;
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_DROPPED,
+                      reassembler->onFragment(5, fragment, fragmentLen, 0, &type, &data, &dataLen));
+    fragment[2] = 0;
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_DROPPED,
+                      reassembler->onFragment(0, fragment, fragmentLen, 0, &type, &data, &dataLen));
+
+    TEST_ASSERT_EQUAL(4, reassembler->getStats().rejected);
+    TEST_ASSERT_EQUAL(0, reassembler->getStats().started);
+}
+
+void test_stale_messages_time_out() {
+    feed(5, 1, 2 * MESH_FRAGMENT_SIZE, 0, 1000);
+    reassembler->expire(1000 + MESH_REASSEMBLY_TIMEOUT_MS - 1);
+    TEST_ASSERT_EQUAL(2, reassembler->getStats().blocksInUse);
+
+    reassembler->expire(1000 + MESH_REASSEMBLY_TIMEOUT_MS);
+    MeshReassemblyStats stats = reassembler->getStats();
+    TEST_ASSERT_EQUAL(1, stats.timedOut);
+    TEST_ASSERT_EQUAL(0, stats.blocksInUse);
+}
+
+void test_memory_pressure_evicts_oldest() {
+    // Every sender starts a half-pool message; the pool holds two at a time
+    const size_t half = MESH_REASSEMBLY_POOL_BLOCKS / 2 * MESH_FRAGMENT_SIZE;
+    for (uint32_t source = 1; source <= 20; source++) {
+        TEST_ASSERT_EQUAL(MESH_REASSEMBLY_PENDING, feed(source, 1, half, 0, source));
+        TEST_ASSERT_TRUE(reassembler->getStats().blocksInUse <= MESH_REASSEMBLY_POOL_BLOCKS);
+    }
+
+    MeshReassemblyStats stats = reassembler->getStats();
+    TEST_ASSERT_EQUAL(18, stats.evicted);
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_POOL_BLOCKS, stats.blocksHighWater);
+
+    // Small messages from many senders are limited by the slot table instead
+    for (uint32_t source = 100; source < 100 + 2 * MESH_REASSEMBLY_SLOTS; source++) {
+        feed(source, 1, MESH_FRAGMENT_SIZE + 1, 0, source);
+    }
+    TEST_ASSERT_TRUE(reassembler->getStats().blocksInUse <= 2 * MESH_REASSEMBLY_SLOTS);
+
+    // The newest sender survived and can finish
+    uint32_t last = 100 + 2 * MESH_REASSEMBLY_SLOTS - 1;
+    TEST_ASSERT_EQUAL(MESH_REASSEMBLY_COMPLETE, feed(last, 1, MESH_FRAGMENT_SIZE + 1, 1, last));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_split_covers_payload);
+    RUN_TEST(test_out_of_order_reassembly);
+    RUN_TEST(test_interleaved_senders);
+    RUN_TEST(test_malformed_fragments_rejected);
+    RUN_TEST(test_stale_messages_time_out);
+    RUN_TEST(test_memory_pressure_evicts_oldest);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_split_covers_payload);
+    RUN_TEST(test_out_of_order_reassembly);
+    RUN_TEST(test_interleaved_senders);
+    RUN_TEST(test_malformed_fragments_rejected);
+    RUN_TEST(test_stale_messages_time_out);
+    RUN_TEST(test_memory_pressure_evicts_oldest);
+    return UNITY_END();
+}
+#endif
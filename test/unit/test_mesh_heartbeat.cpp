@@ -0,0 +1,183 @@
+// Unit test for delta-encoded heartbeats
+#include <unity.h>
+#include "../../include/mesh_heartbeat.h"
+
+MeshHeartbeatEncoder* encoder;
+MeshHeartbeatTable* table;
+uint8_t beat[MeshHeartbeatEncoder::MAX_SIZE];
+size_t beatLen;
+
+void setUp() {
+    encoder = new MeshHeartbeatEncoder();
+    table = new MeshHeartbeatTable();
+}
+
+void tearDown() {
+    delete encoder;
+    delete table;
+}
+
+static MeshHeartbeatSnapshot makeSnapshot(uint8_t heap, uint16_t nodes, uint32_t sims) {
+    MeshHeartbeatSnapshot snapshot = {};
+    snapshot.freeHeapBucket = heap;
+    snapshot.nodeCount = nodes;
+    snapshot.simActiveMask = sims;
+    return snapshot;
+}
+
+void test_first_beat_is_keyframe() {
+    TEST_ASSERT_TRUE(encoder->encode(makeSnapshot(40, 12, 0xFFFFF), beat, sizeof(beat), &beatLen));
+    TEST_ASSERT_EQUAL(MeshHeartbeatEncoder::MAX_SIZE, beatLen);
+
+    TEST_ASSERT_TRUE(table->apply(0x100, beat, beatLen, 0));
+    const MeshPeerState* peer = table->find(0x100);
+    TEST_ASSERT_NOT_NULL(peer);
+    TEST_ASSERT_TRUE(peer->synced);
+    TEST_ASSERT_EQUAL(40, peer->snapshot.freeHeapBucket);
+    TEST_ASSERT_EQUAL(12, peer->snapshot.nodeCount);
+    TEST_ASSERT_EQUAL(0xFFFFF, peer->snapshot.simActiveMask);
+}
+
+void test_deltas_carry_only_changes() {
+    encoder->encode(makeSnapshot(40, 12, 0xFFFFF), beat, sizeof(beat), &beatLen);
+    table->apply(0x100, beat, beatLen, 0);
+
+    // Unchanged state: liveness only
+    TEST_ASSERT_TRUE(encoder->encode(makeSnapshot(40, 12, 0xFFFFF), beat, sizeof(beat), &beatLen));
+    TEST_ASSERT_EQUAL(3, beatLen);
+
+    // One SIM dropped out
+    TEST_ASSERT_TRUE(encoder->encode(makeSnapshot(40, 12, 0xFFFFE), beat, sizeof(beat), &beatLen));
+    TEST_ASSERT_EQUAL(7, beatLen);
+    TEST_ASSERT_TRUE(table->apply(0x100, beat, beatLen, 1000));
+    TEST_ASSERT_EQUAL(0xFFFFE, table->find(0x100)->snapshot.simActiveMask);
+
+    // SIM came back: delta is empty again and the receiver reverts to the keyframe
+    TEST_ASSERT_TRUE(encoder->encode(makeSnapshot(40, 12, 0xFFFFF), beat, sizeof(beat), &beatLen));
+    TEST_ASSERT_EQUAL(3, beatLen);
+    TEST_ASSERT_TRUE(table->apply(0x100, beat, beatLen, 2000));
+    TEST_ASSERT_EQUAL(0xFFFFF, table->find(0x100)->snapshot.simActiveMask);
+}
+
+void test_sms_load_fields() {
+    MeshHeartbeatSnapshot snapshot = makeSnapshot(40, 12, 0x3);
+    snapshot.smsQueueDepth = 4;
+    snapshot.smsSendTime = 35;
+    encoder->encode(snapshot, beat, sizeof(beat), &beatLen);
+    TEST_ASSERT_TRUE(table->apply(0x100, beat, beatLen, 0));
+    TEST_ASSERT_EQUAL(4, table->find(0x100)->snapshot.smsQueueDepth);
+    TEST_ASSERT_EQUAL(35, table->find(0x100)->snapshot.smsSendTime);
+
+    // A queue draining costs one byte per beat
+    snapshot.smsQueueDepth = 3;
+    TEST_ASSERT_TRUE(encoder->encode(snapshot, beat, sizeof(beat), &beatLen));
+    TEST_ASSERT_EQUAL(4, beatLen);
+    TEST_ASSERT_TRUE(table->apply(0x100, beat, beatLen, 1000));
+    TEST_ASSERT_EQUAL(3, table->find(0x100)->snapshot.smsQueueDepth);
+    TEST_ASSERT_EQUAL(35, table->find(0x100)->snapshot.smsSendTime);
+}
+
+void test_periodic_keyframe_resyncs_late_joiner() {
+    encoder->encode(makeSnapshot(40, 12, 1), beat, sizeof(beat), &beatLen);
+
+    // Receiver missed the keyframe: deltas alone leave it unsynced
+    encoder->encode(makeSnapshot(39, 12, 1), beat, sizeof(beat), &beatLen);
+    TEST_ASSERT_TRUE(table->apply(0x200, beat, beatLen, 0));
+    TEST_ASSERT_FALSE(table->find(0x200)->synced);
+    TEST_ASSERT_EQUAL(39, table->find(0x200)->snapshot.freeHeapBucket);
+
+    for (int i = 2; i < HEARTBEAT_KEYFRAME_EVERY; i++) {
+        encoder->encode(makeSnapshot(39, 12, 1), beat, sizeof(beat), &beatLen);
+    }
+
+    encoder->encode(makeSnapshot(39, 13, 1), beat, sizeof(beat), &beatLen);
+    TEST_ASSERT_EQUAL(MeshHeartbeatEncoder::MAX_SIZE, beatLen);
+    TEST_ASSERT_TRUE(table->apply(0x200, beat, beatLen, 1000));
+    TEST_ASSERT_TRUE(table->find(0x200)->synced);
+    TEST_ASSERT_EQUAL(13, table->find(0x200)->snapshot.nodeCount);
+}
+
+void test_interval_adapts_to_topology() {
+    TEST_ASSERT_EQUAL(HEARTBEAT_INTERVAL, encoder->getIntervalMs());
+
+    for (int i = 0; i < 20; i++) {
+        encoder->encode(makeSnapshot(40, 12, 1), beat, sizeof(beat), &beatLen);
+    }
+    TEST_ASSERT_EQUAL(HEARTBEAT_MAX_INTERVAL, encoder->getIntervalMs());
+
+    encoder->onTopologyChange();
+    TEST_ASSERT_EQUAL(HEARTBEAT_MIN_INTERVAL, encoder->getIntervalMs());
+
+    // The next beat is a keyframe sent at the tightened interval
+    encoder->encode(makeSnapshot(40, 13, 1), beat, sizeof(beat), &beatLen);
+    TEST_ASSERT_EQUAL(MeshHeartbeatEncoder::MAX_SIZE, beatLen);
+    TEST_ASSERT_EQUAL(HEARTBEAT_MIN_INTERVAL, encoder->getIntervalMs());
+
+    encoder->encode(makeSnapshot(40, 13, 1), beat, sizeof(beat), &beatLen);
+    TEST_ASSERT_GREATER_THAN(HEARTBEAT_MIN_INTERVAL, encoder->getIntervalMs());
+}
+
+void test_rejects_malformed_beats() {
+    const uint8_t truncated[] = {0x01, 0x01, 0x07, 0x10};
+    const uint8_t unknownField[] = {0x00, 0x01, 0x80};
+    TEST_ASSERT_FALSE(table->apply(0x300, truncated, sizeof(truncated), 0));
+    TEST_ASSERT_FALSE(table->apply(0x300, unknownField, sizeof(unknownField), 0));
+    TEST_ASSERT_NULL(table->find(0x300));
+}
+
+void test_peer_table_is_bounded() {
+    encoder->encode(makeSnapshot(40, 12, 1), beat, sizeof(beat), &beatLen);
+    for (uint32_t node = 1; node <= MESH_MAX_PEERS + 10; node++) {
+        TEST_ASSERT_TRUE(table->apply(node, beat, beatLen, node));
+    }
+
+    TEST_ASSERT_EQUAL(MESH_MAX_PEERS, table->getPeerCount());
+    TEST_ASSERT_NULL(table->find(1));
+    TEST_ASSERT_NOT_NULL(table->find(MESH_MAX_PEERS + 10));
+}
+
+void test_removed_peer_frees_its_slot() {
+    encoder->encode(makeSnapshot(40, 12, 1), beat, sizeof(beat), &beatLen);
+    table->apply(0x100, beat, beatLen, 0);
+    table->apply(0x200, beat, beatLen, 0);
+
+    TEST_ASSERT_TRUE(table->remove(0x100));
+    TEST_ASSERT_FALSE(table->remove(0x100));
+    TEST_ASSERT_EQUAL(1, table->getPeerCount());
+    TEST_ASSERT_NULL(table->find(0x100));
+    TEST_ASSERT_NOT_NULL(table->find(0x200));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_beat_is_keyframe);
+    RUN_TEST(test_deltas_carry_only_changes);
+    RUN_TEST(test_sms_load_fields);
+    RUN_TEST(test_periodic_keyframe_resyncs_late_joiner);
+    RUN_TEST(test_interval_adapts_to_topology);
+    RUN_TEST(test_rejects_malformed_beats);
+    RUN_TEST(test_peer_table_is_bounded);
+    RUN_TEST(test_removed_peer_frees_its_slot);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_beat_is_keyframe);
+    RUN_TEST(test_deltas_carry_only_changes);
+    RUN_TEST(test_sms_load_fields);
+    RUN_TEST(test_periodic_keyframe_resyncs_late_joiner);
+    RUN_TEST(test_interval_adapts_to_topology);
+    RUN_TEST(test_rejects_malformed_beats);
+    RUN_TEST(test_peer_table_is_bounded);
+    RUN_TEST(test_removed_peer_frees_its_slot);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,310 @@
+// Unit test for SMS job placement, work pulling and result reporting
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_job_balancer.h"
+
+MeshJobBalancer* coordinator;   // Node 1
+MeshJobBalancer* worker;        // Node 3
+
+uint8_t message[MeshJobBalancer::MAX_MESSAGE];
+size_t messageLen;
+uint32_t messageDest;
+
+static const uint8_t BODY[] = "+15550100|Meter reading due";
+
+static MeshPeerState makePeer(uint32_t nodeId, uint8_t heap, uint32_t sims, uint8_t depth, uint8_t sendTime) {
+    MeshPeerState peer = {};
+    peer.nodeId = nodeId;
+    peer.synced = true;
+    peer.snapshot.freeHeapBucket = heap;
+    peer.snapshot.simActiveMask = sims;
+    peer.snapshot.smsQueueDepth = depth;
+    peer.snapshot.smsSendTime = sendTime;
+    return peer;
+}
+
+// Delivers the next outgoing message from one balancer to another
+static void deliver(MeshJobBalancer* from, uint32_t fromId, MeshJobBalancer* to, uint32_t nowMs) {
+    TEST_ASSERT_TRUE(from->nextOutgoing(nowMs, &messageDest, message, sizeof(message), &messageLen));
+    from->outgoingDone(true, nowMs);
+    TEST_ASSERT_TRUE(to->receive(fromId, message, messageLen, nowMs));
+}
+
+void setUp() {
+    coordinator = new MeshJobBalancer();
+    coordinator->setSelf(1);
+    coordinator->setLocalCapacity(20, 0);
+
+    worker = new MeshJobBalancer();
+    worker->setSelf(3);
+    worker->setLocalCapacity(20, 0x3);
+}
+
+void tearDown() {
+    delete coordinator;
+    delete worker;
+}
+
+void test_lowest_capable_id_coordinates() {
+    // Node 1 has too little heap to coordinate, so node 2 is chosen by everyone
+    worker->onHeartbeat(makePeer(1, MESH_JOB_COORDINATOR_MIN_HEAP - 1, 0, 0, 0), true, 0);
+    worker->onHeartbeat(makePeer(2, MESH_JOB_COORDINATOR_MIN_HEAP, 0x1, 0, 0), true, 0);
+    TEST_ASSERT_EQUAL(2, worker->getCoordinator(0));
+
+    // Unsynced peers are not trusted with the role
+    MeshPeerState unsynced = makePeer(1, 40, 0, 0, 0);
+    unsynced.synced = false;
+    worker->onHeartbeat(unsynced, true, 1000);
+    TEST_ASSERT_EQUAL(2, worker->getCoordinator(1000));
+    worker->onHeartbeat(makePeer(1, 40, 0, 0, 0), true, 2000);
+    TEST_ASSERT_EQUAL(1, worker->getCoordinator(2000));
+
+    // Peers beyond reliable unicast range cannot coordinate for us
+    worker->onHeartbeat(makePeer(1, 40, 0, 0, 0), false, 3000);
+    TEST_ASSERT_EQUAL(2, worker->getCoordinator(3000));
+    worker->onHeartbeat(makePeer(1, 40, 0, 0, 0), true, 3000);
+
+    // Silent peers age out and the role falls back
+    TEST_ASSERT_EQUAL(3, worker->getCoordinator(3000 + 3 * HEARTBEAT_MAX_INTERVAL));
+    TEST_ASSERT_EQUAL(5, worker->getStats(0).elections);
+}
+
+void test_places_on_least_loaded_node() {
+    // Node 2: one SIM, one queued. Node 3: two SIMs, idle. Node 4: idle but slow.
+    coordinator->onHeartbeat(makePeer(2, 20, 0x1, 1, 30), true, 0);
+    coordinator->onHeartbeat(makePeer(3, 20, 0x3, 0, 30), true, 0);
+    coordinator->onHeartbeat(makePeer(4, 20, 0x1, 0, 200), true, 0);
+
+    uint32_t jobId;
+    TEST_ASSERT_TRUE(coordinator->submit(BODY, sizeof(BODY), 0, &jobId));
+    TEST_ASSERT_TRUE(coordinator->nextOutgoing(0, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(3, messageDest);
+    TEST_ASSERT_EQUAL(MeshJobBalancer::JOB_HEADER_SIZE + sizeof(BODY), messageLen);
+    coordinator->outgoingDone(true, 0);
+    TEST_ASSERT_TRUE(worker->receive(1, message, messageLen, 10));
+    TEST_ASSERT_EQUAL(1, worker->getQueueDepth());
+    TEST_ASSERT_EQUAL(1, worker->getStats(10).assigned);
+
+    MeshJobDecision decisions[4];
+    TEST_ASSERT_EQUAL(1, coordinator->getDecisions(decisions, 4));
+    TEST_ASSERT_EQUAL(1, decisions[0].submitter);
+    TEST_ASSERT_EQUAL(jobId, decisions[0].jobId);
+    TEST_ASSERT_EQUAL(3, decisions[0].worker);
+    TEST_ASSERT_EQUAL(1500, decisions[0].expectedWaitMs);
+    TEST_ASSERT_EQUAL(3, decisions[0].candidates);
+
+    // Jobs placed since node 3 last reported count against it, until node 2 ties
+    // on expected wait and wins on its shorter queue
+    for (int i = 0; i < 3; i++) {
+        coordinator->submit(BODY, sizeof(BODY), 20, nullptr);
+    }
+    uint32_t dests[3];
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(coordinator->nextOutgoing(20, &dests[i], message, sizeof(message), &messageLen));
+        coordinator->outgoingDone(true, 20);
+    }
+    TEST_ASSERT_EQUAL(3, dests[0]);
+    TEST_ASSERT_EQUAL(3, dests[1]);
+    TEST_ASSERT_EQUAL(2, dests[2]);
+    TEST_ASSERT_EQUAL(4, coordinator->getStats(20).placements);
+    TEST_ASSERT_EQUAL(4, coordinator->getDecisions(decisions, 4));
+    TEST_ASSERT_EQUAL(2, decisions[0].worker);
+}
+
+void test_refused_handoff_is_placed_again() {
+    coordinator->onHeartbeat(makePeer(3, 20, 0x3, 0, 0), true, 0);
+    coordinator->submit(BODY, sizeof(BODY), 0, nullptr);
+
+    TEST_ASSERT_TRUE(coordinator->nextOutgoing(0, &messageDest, message, sizeof(message), &messageLen));
+    coordinator->outgoingDone(false, 0);
+    TEST_ASSERT_TRUE(coordinator->nextOutgoing(100, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(3, messageDest);
+    coordinator->outgoingDone(true, 100);
+    TEST_ASSERT_FALSE(coordinator->nextOutgoing(200, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(2, coordinator->getStats(200).placements);
+}
+
+void test_submitter_asks_coordinator() {
+    worker->onHeartbeat(makePeer(1, 20, 0, 0, 0), true, 0);
+    coordinator->onHeartbeat(makePeer(3, 20, 0x3, 0, 0), true, 0);
+
+    // Only the job's identity goes to the coordinator; the body stays put
+    TEST_ASSERT_TRUE(worker->submit(BODY, sizeof(BODY), 0, nullptr));
+    deliver(worker, 3, coordinator, 500);
+    TEST_ASSERT_EQUAL(1, messageDest);
+    TEST_ASSERT_TRUE(messageLen < MeshJobBalancer::JOB_HEADER_SIZE);
+
+    // The coordinator answers with the only node that has SIMs: the submitter itself
+    deliver(coordinator, 1, worker, 700);
+    TEST_ASSERT_EQUAL(3, messageDest);
+    TEST_ASSERT_EQUAL(1, worker->getQueueDepth());
+    TEST_ASSERT_EQUAL(1, coordinator->getStats(700).placements);
+
+    MeshSmsJob job;
+    TEST_ASSERT_TRUE(worker->takeJob(1700, &job));
+    TEST_ASSERT_EQUAL(1700, job.waitMs);
+    TEST_ASSERT_EQUAL(3, job.submitter);
+    TEST_ASSERT_EQUAL(sizeof(BODY), job.length);
+    TEST_ASSERT_EQUAL(0, memcmp(job.body, BODY, sizeof(BODY)));
+    TEST_ASSERT_FALSE(worker->takeJob(1700, &job));
+
+    // An unanswered request is repeated once the timeout passes
+    TEST_ASSERT_TRUE(worker->submit(BODY, sizeof(BODY), 2000, nullptr));
+    TEST_ASSERT_TRUE(worker->nextOutgoing(2000, &messageDest, message, sizeof(message), &messageLen));
+    worker->outgoingDone(true, 2000);
+    TEST_ASSERT_FALSE(worker->nextOutgoing(2000 + MESH_JOB_PLACE_TIMEOUT_MS - 1, &messageDest, message,
+                                          sizeof(message), &messageLen));
+    TEST_ASSERT_TRUE(worker->nextOutgoing(2000 + MESH_JOB_PLACE_TIMEOUT_MS, &messageDest, message,
+                                         sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(1, messageDest);
+}
+
+void test_results_feed_fleet_statistics() {
+    worker->onHeartbeat(makePeer(1, 20, 0, 0, 0), true, 0);
+    coordinator->onHeartbeat(makePeer(3, 20, 0x3, 0, 0), true, 0);
+
+    for (int i = 0; i < 2; i++) {
+        coordinator->submit(BODY, sizeof(BODY), 0, nullptr);
+        deliver(coordinator, 1, worker, 0);
+    }
+
+    MeshSmsJob job;
+    TEST_ASSERT_TRUE(worker->takeJob(300, &job));
+    TEST_ASSERT_TRUE(worker->completeJob(job.jobId, job.submitter, true, 4000, 4300));
+    TEST_ASSERT_EQUAL(40, worker->getSendTimeUnits());
+    TEST_ASSERT_FALSE(worker->completeJob(job.jobId, job.submitter, true, 4000, 4300));
+
+    deliver(worker, 3, coordinator, 4300);
+    TEST_ASSERT_TRUE(worker->takeJob(4300, &job));
+    TEST_ASSERT_TRUE(worker->completeJob(job.jobId, job.submitter, true, 4800, 9100));
+    TEST_ASSERT_EQUAL(41, worker->getSendTimeUnits());
+    deliver(worker, 3, coordinator, 9100);
+
+    MeshJobStats fleet = coordinator->getStats(9100);
+    TEST_ASSERT_EQUAL(2, fleet.reported);
+    TEST_ASSERT_EQUAL(2, fleet.fleetSmsPerMinute);
+    TEST_ASSERT_EQUAL(4300, fleet.maxWaitMs);
+    TEST_ASSERT_EQUAL(1, fleet.waitHistogram[9]);     // 300 ms
+    TEST_ASSERT_EQUAL(1, fleet.waitHistogram[13]);    // 4300 ms
+
+    // The rate only covers the last minute
+    TEST_ASSERT_EQUAL(0, coordinator->getStats(9100 + 60000).fleetSmsPerMinute);
+    TEST_ASSERT_EQUAL(2, worker->getStats(0).completed);
+}
+
+void test_failed_sends_retry_then_report() {
+    worker->onHeartbeat(makePeer(1, 20, 0, 0, 0), true, 0);
+    coordinator->onHeartbeat(makePeer(3, 20, 0x3, 0, 0), true, 0);
+    coordinator->submit(BODY, sizeof(BODY), 0, nullptr);
+    deliver(coordinator, 1, worker, 0);
+
+    MeshSmsJob job;
+    for (int attempt = 1; attempt < MESH_JOB_MAX_ATTEMPTS; attempt++) {
+        TEST_ASSERT_TRUE(worker->takeJob(0, &job));
+        TEST_ASSERT_TRUE(worker->completeJob(job.jobId, job.submitter, false, 1000, 0));
+
+        // Back through the coordinator for another placement
+        deliver(worker, 3, coordinator, 0);
+        deliver(coordinator, 1, worker, 0);
+    }
+    TEST_ASSERT_TRUE(worker->takeJob(0, &job));
+    TEST_ASSERT_EQUAL(MESH_JOB_MAX_ATTEMPTS - 1, job.attempts);
+    TEST_ASSERT_TRUE(worker->completeJob(job.jobId, job.submitter, false, 1000, 0));
+
+    MeshJobStats stats = worker->getStats(0);
+    TEST_ASSERT_EQUAL(MESH_JOB_MAX_ATTEMPTS - 1, stats.retried);
+    TEST_ASSERT_EQUAL(1, stats.failed);
+    TEST_ASSERT_EQUAL(0, stats.completed);
+    TEST_ASSERT_EQUAL(0, stats.queueDepth);
+
+    deliver(worker, 3, coordinator, 0);
+    TEST_ASSERT_EQUAL(1, coordinator->getStats(0).reported);
+    TEST_ASSERT_EQUAL(0, coordinator->getStats(0).fleetSmsPerMinute);
+}
+
+void test_idle_node_pulls_backlog() {
+    // Node 1 coordinates and sends with its own SIM; its queue has built up
+    coordinator->setLocalCapacity(20, 0x1);
+    for (int i = 0; i < 6; i++) {
+        coordinator->submit(BODY, sizeof(BODY), i * 100, nullptr);
+    }
+    TEST_ASSERT_FALSE(coordinator->nextOutgoing(600, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(6, coordinator->getStats(600).placements);
+
+    // Node 3 joins with nothing to do and sees the depth in node 1's heartbeat
+    worker->onHeartbeat(makePeer(1, 20, 0x1, coordinator->getQueueDepth(), 0), true, 600);
+    deliver(worker, 3, coordinator, 600);
+    TEST_ASSERT_EQUAL(1, messageDest);
+
+    // Half the backlog moves over, newest first
+    deliver(coordinator, 1, worker, 700);
+    deliver(coordinator, 1, worker, 700);
+    deliver(coordinator, 1, worker, 700);
+    TEST_ASSERT_FALSE(coordinator->nextOutgoing(700, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(3, coordinator->getQueueDepth());
+    TEST_ASSERT_EQUAL(3, worker->getQueueDepth());
+    TEST_ASSERT_EQUAL(3, coordinator->getStats(700).pulledOut);
+    TEST_ASSERT_EQUAL(3, worker->getStats(700).pulledIn);
+
+    MeshSmsJob job;
+    // Each side starts with the job that has waited longest overall
+    TEST_ASSERT_TRUE(worker->takeJob(700, &job));
+    TEST_ASSERT_EQUAL(4, job.jobId);
+    TEST_ASSERT_TRUE(coordinator->takeJob(700, &job));
+    TEST_ASSERT_EQUAL(1, job.jobId);
+
+    // No second request until the interval passes, and only while idle
+    TEST_ASSERT_FALSE(worker->nextOutgoing(800, &messageDest, message, sizeof(message), &messageLen));
+}
+
+void test_no_sims_anywhere() {
+    coordinator->onHeartbeat(makePeer(2, 20, 0, 0, 0), true, 0);
+    TEST_ASSERT_TRUE(coordinator->submit(BODY, sizeof(BODY), 0, nullptr));
+    TEST_ASSERT_FALSE(coordinator->nextOutgoing(0, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_FALSE(coordinator->nextOutgoing(100, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(1, coordinator->getStats(100).unplaceable);
+
+    // Held until a SIM comes up
+    coordinator->onHeartbeat(makePeer(2, 20, 0x1, 0, 0), true, 200);
+    TEST_ASSERT_TRUE(coordinator->nextOutgoing(200, &messageDest, message, sizeof(message), &messageLen));
+    TEST_ASSERT_EQUAL(2, messageDest);
+
+    uint8_t tooLong[MESH_JOB_MAX_BODY + 1] = {0};
+    TEST_ASSERT_FALSE(coordinator->submit(tooLong, sizeof(tooLong), 0, nullptr));
+    TEST_ASSERT_FALSE(coordinator->receive(2, message, 5, 0));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_lowest_capable_id_coordinates);
+    RUN_TEST(test_places_on_least_loaded_node);
+    RUN_TEST(test_refused_handoff_is_placed_again);
+    RUN_TEST(test_submitter_asks_coordinator);
+    RUN_TEST(test_results_feed_fleet_statistics);
+    RUN_TEST(test_failed_sends_retry_then_report);
+    RUN_TEST(test_idle_node_pulls_backlog);
+    RUN_TEST(test_no_sims_anywhere);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_lowest_capable_id_coordinates);
+    RUN_TEST(test_places_on_least_loaded_node);
+    RUN_TEST(test_refused_handoff_is_placed_again);
+    RUN_TEST(test_submitter_asks_coordinator);
+    RUN_TEST(test_results_feed_fleet_statistics);
+    RUN_TEST(test_failed_sends_retry_then_report);
+    RUN_TEST(test_idle_node_pulls_backlog);
+    RUN_TEST(test_no_sims_anywhere);
+    return UNITY_END();
+}
+#endif
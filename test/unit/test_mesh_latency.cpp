@@ -0,0 +1,183 @@
+// Unit test for the log-linear latency histograms and their report encoding
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_latency.h"
+
+MeshLatencyHistogram* histogram;
+MeshLatencyRecorder* recorder;
+
+void setUp() {
+    histogram = new MeshLatencyHistogram();
+    recorder = new MeshLatencyRecorder();
+}
+
+void tearDown() {
+    delete histogram;
+    delete recorder;
+}
+
+void test_buckets_keep_relative_precision() {
+    // Exact at the bottom, contiguous throughout, and never wider than 1/SUB_BUCKETS of their values
+    for (uint32_t v = 0; v < 2 * MeshLatencyHistogram::SUB_BUCKETS; v++) {
+        TEST_ASSERT_EQUAL(v, MeshLatencyHistogram::bucketOf(v));
+    }
+    for (size_t b = 0; b < MeshLatencyHistogram::BUCKETS; b++) {
+        uint32_t low = MeshLatencyHistogram::bucketLow(b);
+        uint32_t high = MeshLatencyHistogram::bucketHigh(b);
+        TEST_ASSERT_EQUAL(b, MeshLatencyHistogram::bucketOf(low));
+        TEST_ASSERT_EQUAL(b, MeshLatencyHistogram::bucketOf(high));
+        if (b + 1 < MeshLatencyHistogram::BUCKETS) {
+            TEST_ASSERT_EQUAL(high + 1, MeshLatencyHistogram::bucketLow(b + 1));
+        }
+        TEST_ASSERT_TRUE((uint64_t)(high - low) * MeshLatencyHistogram::SUB_BUCKETS <= low);
+    }
+    TEST_ASSERT_EQUAL(MeshLatencyHistogram::MAX_VALUE,
+                      MeshLatencyHistogram::bucketHigh(MeshLatencyHistogram::BUCKETS - 1));
+}
+
+void test_percentiles_within_bucket_precision() {
+    // 1..10000 us uniformly
+    for (uint32_t v = 1; v <= 10000; v++) {
+        histogram->record(v);
+    }
+    TEST_ASSERT_EQUAL(10000, histogram->getCount());
+    TEST_ASSERT_EQUAL(1, histogram->getMin());
+    TEST_ASSERT_EQUAL(10000, histogram->getMax());
+    TEST_ASSERT_INT_WITHIN(5000 / 8, 5000, histogram->getPercentile(50));
+    TEST_ASSERT_INT_WITHIN(9900 / 8, 9900, histogram->getPercentile(99));
+    TEST_ASSERT_EQUAL(10000, histogram->getPercentile(100));
+    TEST_ASSERT_INT_WITHIN(5000 / 8, 5000, histogram->getMean());
+
+    // Beyond the range everything lands in the top bucket
+    histogram->clear();
+    histogram->record(UINT32_MAX);
+    TEST_ASSERT_EQUAL(MeshLatencyHistogram::MAX_VALUE, histogram->getMax());
+    TEST_ASSERT_EQUAL(1, histogram->getBucketCount(MeshLatencyHistogram::BUCKETS - 1));
+}
+
+void test_saturation_halves_and_keeps_shape() {
+    for (uint32_t i = 0; i < 70000; i++) {
+        histogram->record(100);
+        if (i % 10 == 0) {
+            histogram->record(1000);
+        }
+    }
+    TEST_ASSERT_EQUAL(77000, histogram->getCount());
+    uint16_t small = histogram->getBucketCount(MeshLatencyHistogram::bucketOf(100));
+    uint16_t large = histogram->getBucketCount(MeshLatencyHistogram::bucketOf(1000));
+    TEST_ASSERT_TRUE(small < 65535);
+    TEST_ASSERT_INT_WITHIN(small / 50, small / 10, large);
+    TEST_ASSERT_INT_WITHIN(13, 100, histogram->getPercentile(50));
+    TEST_ASSERT_INT_WITHIN(125, 1000, histogram->getPercentile(95));
+}
+
+void test_series_keyed_by_stage_type_and_hops() {
+    recorder->record(MESH_LATENCY_TRANSIT, 2, 1, 5000);
+    recorder->record(MESH_LATENCY_TRANSIT, 2, 3, 15000);
+    recorder->record(MESH_LATENCY_TRANSIT, 2, 3, 16000);
+    recorder->record(MESH_LATENCY_HANDLER, 2, 0, 40);
+
+    MeshLatencyHistogram found;
+    TEST_ASSERT_TRUE(recorder->get(MESH_LATENCY_TRANSIT, 2, 3, &found));
+    TEST_ASSERT_EQUAL(2, found.getCount());
+    TEST_ASSERT_EQUAL(15000, found.getMin());
+    TEST_ASSERT_TRUE(recorder->get(MESH_LATENCY_HANDLER, 2, 0, &found));
+    TEST_ASSERT_EQUAL(1, found.getCount());
+    TEST_ASSERT_FALSE(recorder->get(MESH_LATENCY_QUEUED, 2, 0, &found));
+
+    MeshLatencyKey keys[8];
+    TEST_ASSERT_EQUAL(3, recorder->getKeys(keys, 8));
+    TEST_ASSERT_EQUAL(MESH_LATENCY_TRANSIT, keys[1].stage);
+    TEST_ASSERT_EQUAL(3, keys[1].hops);
+
+    // Once the table is full, new keys are only counted
+    for (uint32_t type = 16; type < 16 + MESH_LATENCY_MAX_SERIES; type++) {
+        recorder->record(MESH_LATENCY_QUEUED, (uint8_t)type, 0, 10);
+    }
+    MeshLatencyStats stats = recorder->getStats();
+    TEST_ASSERT_EQUAL(MESH_LATENCY_MAX_SERIES, stats.series);
+    TEST_ASSERT_EQUAL(3, stats.dropped);
+    TEST_ASSERT_EQUAL(4 + MESH_LATENCY_MAX_SERIES - 3, stats.recorded);
+
+    // Existing keys still record
+    recorder->record(MESH_LATENCY_TRANSIT, 2, 1, 6000);
+    TEST_ASSERT_TRUE(recorder->get(MESH_LATENCY_TRANSIT, 2, 1, &found));
+    TEST_ASSERT_EQUAL(2, found.getCount());
+}
+
+void test_report_round_trip_and_merge() {
+    for (uint32_t v = 1; v <= 500; v++) {
+        recorder->record(MESH_LATENCY_TRANSIT, 2, 2, v * 100);
+        recorder->record(MESH_LATENCY_QUEUED, 2, 0, v);
+    }
+
+    uint8_t report[1024];
+    size_t reportLen;
+    TEST_ASSERT_TRUE(recorder->encodeReport(report, sizeof(report), &reportLen));
+    // Two series in less space than the raw counters of one
+    TEST_ASSERT_TRUE(reportLen < MeshLatencyHistogram::BUCKETS * sizeof(uint16_t));
+
+    // The collector merges what it hears into its own view
+    MeshLatencyHistogram merged;
+    size_t offset = 0;
+    MeshLatencyKey key;
+    MeshLatencyHistogram series;
+    size_t seen = 0;
+    while (MeshLatencyRecorder::nextSeries(report, reportLen, &offset, &key, &series)) {
+        seen++;
+        if (key.stage == MESH_LATENCY_TRANSIT) {
+            TEST_ASSERT_EQUAL(2, key.hops);
+            merged.merge(series);
+            merged.merge(series);
+        }
+    }
+    TEST_ASSERT_EQUAL(2, seen);
+    TEST_ASSERT_EQUAL(reportLen, offset);
+
+    MeshLatencyHistogram original;
+    TEST_ASSERT_TRUE(recorder->get(MESH_LATENCY_TRANSIT, 2, 2, &original));
+    TEST_ASSERT_EQUAL(1000, merged.getCount());
+    TEST_ASSERT_EQUAL(original.getMin(), merged.getMin());
+    TEST_ASSERT_EQUAL(original.getMax(), merged.getMax());
+    TEST_ASSERT_EQUAL(original.getPercentile(99), merged.getPercentile(99));
+
+    // Truncated or foreign reports are refused
+    offset = 0;
+    TEST_ASSERT_FALSE(MeshLatencyRecorder::nextSeries(report, 6, &offset, &key, &series));
+    report[0] = 0x7F;
+    offset = 0;
+    TEST_ASSERT_FALSE(MeshLatencyRecorder::nextSeries(report, reportLen, &offset, &key, &series));
+
+    // Series that do not fit are left out rather than cut
+    TEST_ASSERT_TRUE(recorder->encodeReport(report, 40, &reportLen));
+    TEST_ASSERT_TRUE(reportLen <= 40);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets_keep_relative_precision);
+    RUN_TEST(test_percentiles_within_bucket_precision);
+    RUN_TEST(test_saturation_halves_and_keeps_shape);
+    RUN_TEST(test_series_keyed_by_stage_type_and_hops);
+    RUN_TEST(test_report_round_trip_and_merge);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets_keep_relative_precision);
+    RUN_TEST(test_percentiles_within_bucket_precision);
+    RUN_TEST(test_saturation_halves_and_keeps_shape);
+    RUN_TEST(test_series_keyed_by_stage_type_and_hops);
+    RUN_TEST(test_report_round_trip_and_merge);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,194 @@
+// Unit test for per-neighbor link probes and ETX-style costs
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_link_quality.h"
+
+MeshLinkQuality* nodeA;   // Node 1
+MeshLinkQuality* nodeB;   // Node 2
+
+// Probes in flight between the two nodes
+struct InFlight {
+    bool used;
+    bool toB;
+    uint32_t atMs;
+    uint8_t data[MeshLinkQuality::PROBE_SIZE];
+};
+static InFlight wire[8];
+static uint32_t probesFromA;
+static uint32_t probesFromB;
+
+// Steps both nodes through [fromMs, toMs); every dropEvery-th probe in a direction is lost
+static void run(uint32_t fromMs, uint32_t toMs, uint32_t delayMs, uint32_t dropAEvery, uint32_t dropBEvery,
+                bool silentB = false) {
+    for (uint32_t now = fromMs; now < toMs; now += 10) {
+        for (size_t i = 0; i < 8; i++) {
+            if (!wire[i].used || wire[i].atMs > now) continue;
+            if (wire[i].toB) {
+                nodeB->onProbe(1, wire[i].data, MeshLinkQuality::PROBE_SIZE, now);
+            } else {
+                nodeA->onProbe(2, wire[i].data, MeshLinkQuality::PROBE_SIZE, now);
+            }
+            wire[i].used = false;
+        }
+
+        uint8_t probe[MeshLinkQuality::PROBE_SIZE];
+        uint32_t dest;
+        size_t len;
+        for (int from = 0; from < 2; from++) {
+            MeshLinkQuality* sender = from == 0 ? nodeA : nodeB;
+            if (!sender->nextProbe(now, &dest, probe, sizeof(probe), &len)) continue;
+            uint32_t sent = from == 0 ? ++probesFromA : ++probesFromB;
+            uint32_t dropEvery = from == 0 ? dropAEvery : dropBEvery;
+            if ((from == 1 && silentB) || (dropEvery && sent % dropEvery == 0)) continue;
+            for (size_t i = 0; i < 8; i++) {
+                if (wire[i].used) continue;
+                wire[i].used = true;
+                wire[i].toB = from == 0;
+                wire[i].atMs = now + delayMs;
+                memcpy(wire[i].data, probe, len);
+                break;
+            }
+        }
+    }
+}
+
+void setUp() {
+    nodeA = new MeshLinkQuality();
+    nodeB = new MeshLinkQuality();
+    nodeA->addNeighbor(2, 0);
+    nodeB->addNeighbor(1, 0);
+    memset(wire, 0, sizeof(wire));
+    probesFromA = 0;
+    probesFromB = 0;
+}
+
+void tearDown() {
+    delete nodeA;
+    delete nodeB;
+}
+
+void test_clean_link_costs_one_unit() {
+    TEST_ASSERT_FALSE(nodeA->addNeighbor(2, 0));
+    TEST_ASSERT_FALSE(nodeA->getStats(2, 0).measured);
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT, nodeA->getCost(2));
+
+    run(0, 30 * MESH_LINK_PROBE_MS, 20, 0, 0);
+
+    MeshLinkStats stats = nodeA->getStats(2, 30 * MESH_LINK_PROBE_MS);
+    TEST_ASSERT_TRUE(stats.measured);
+    TEST_ASSERT_EQUAL(MESH_LINK_WINDOW, stats.forwardSent);
+    TEST_ASSERT_EQUAL(stats.forwardSent, stats.forwardHeard);
+    TEST_ASSERT_EQUAL(stats.reverseSent, stats.reverseHeard);
+    TEST_ASSERT_INT_WITHIN(10, 2 * 20, stats.srttMs);
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT, stats.measuredCost);
+
+    uint32_t nodeId;
+    uint8_t cost;
+    TEST_ASSERT_FALSE(nodeA->nextCostChange(30 * MESH_LINK_PROBE_MS, &nodeId, &cost));
+}
+
+void test_loss_either_way_raises_cost_on_both_ends() {
+    // Half of A's probes are lost; both ends see an ETX of about two
+    run(0, 40 * MESH_LINK_PROBE_MS, 20, 2, 0);
+    uint32_t now = 40 * MESH_LINK_PROBE_MS;
+
+    MeshLinkStats statsA = nodeA->getStats(2, now);
+    TEST_ASSERT_INT_WITHIN(1, statsA.forwardSent / 2, statsA.forwardHeard);
+    TEST_ASSERT_EQUAL(statsA.reverseSent, statsA.reverseHeard);
+    TEST_ASSERT_INT_WITHIN(MESH_LINK_COST_UNIT / 4, 2 * MESH_LINK_COST_UNIT, statsA.measuredCost);
+
+    MeshLinkStats statsB = nodeB->getStats(1, now);
+    TEST_ASSERT_INT_WITHIN(1, statsB.reverseSent / 2, statsB.reverseHeard);
+    TEST_ASSERT_INT_WITHIN(MESH_LINK_COST_UNIT / 4, 2 * MESH_LINK_COST_UNIT, statsB.measuredCost);
+
+    // Routing follows in steps past the hysteresis band, each reported once
+    uint32_t nodeId;
+    uint8_t cost;
+    TEST_ASSERT_TRUE(nodeA->nextCostChange(now, &nodeId, &cost));
+    TEST_ASSERT_EQUAL(2, nodeId);
+    TEST_ASSERT_EQUAL(nodeA->getCost(2), cost);
+    TEST_ASSERT_TRUE(cost > MESH_LINK_COST_UNIT * 3 / 2);
+    TEST_ASSERT_TRUE((statsA.measuredCost - cost) * 100 <= cost * MESH_LINK_COST_HYSTERESIS);
+    TEST_ASSERT_FALSE(nodeA->nextCostChange(now, &nodeId, &cost));
+}
+
+void test_hysteresis_holds_small_changes() {
+    // One probe in 16 lost keeps the estimate within the band of a clean link
+    run(0, 40 * MESH_LINK_PROBE_MS, 20, 16, 0);
+    uint32_t now = 40 * MESH_LINK_PROBE_MS;
+
+    MeshLinkStats stats = nodeA->getStats(2, now);
+    TEST_ASSERT_TRUE(stats.forwardHeard < stats.forwardSent);
+    TEST_ASSERT_TRUE(stats.measuredCost > MESH_LINK_COST_UNIT);
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT, stats.cost);
+
+    uint32_t nodeId;
+    uint8_t cost;
+    TEST_ASSERT_FALSE(nodeA->nextCostChange(now, &nodeId, &cost));
+}
+
+void test_slow_and_retransmitting_links_cost_more() {
+    run(0, 30 * MESH_LINK_PROBE_MS, 400, 0, 0);
+    uint32_t now = 30 * MESH_LINK_PROBE_MS;
+
+    MeshLinkStats stats = nodeA->getStats(2, now);
+    TEST_ASSERT_INT_WITHIN(20, 2 * 400, stats.srttMs);
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT + stats.srttMs / MESH_LINK_RTT_UNIT_MS, stats.measuredCost);
+
+    // Every other reliable message handed to this neighbor needed a retry: about one UNIT more
+    for (int i = 0; i < 64; i++) {
+        nodeA->onReliableSent(2);
+        nodeA->onRetransmit(2);
+    }
+    stats = nodeA->getStats(2, now);
+    TEST_ASSERT_EQUAL(64, stats.retransmits);
+    TEST_ASSERT_INT_WITHIN(3, 2 * MESH_LINK_COST_UNIT + stats.srttMs / MESH_LINK_RTT_UNIT_MS,
+                           stats.measuredCost);
+}
+
+void test_silent_neighbor_becomes_unusable() {
+    run(0, 20 * MESH_LINK_PROBE_MS, 20, 0, 0);
+    run(20 * MESH_LINK_PROBE_MS, 40 * MESH_LINK_PROBE_MS, 20, 0, 0, true);
+    uint32_t now = 40 * MESH_LINK_PROBE_MS;
+
+    uint32_t nodeId;
+    uint8_t cost;
+    TEST_ASSERT_TRUE(nodeA->nextCostChange(now, &nodeId, &cost));
+    TEST_ASSERT_EQUAL(255, cost);
+
+    // A dropped neighbor is forgotten; a reconnect starts unmeasured
+    TEST_ASSERT_TRUE(nodeA->removeNeighbor(2));
+    TEST_ASSERT_FALSE(nodeA->removeNeighbor(2));
+    TEST_ASSERT_TRUE(nodeA->addNeighbor(2, now));
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT, nodeA->getCost(2));
+    TEST_ASSERT_FALSE(nodeA->onProbe(3, wire[0].data, MeshLinkQuality::PROBE_SIZE, now));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_link_costs_one_unit);
+    RUN_TEST(test_loss_either_way_raises_cost_on_both_ends);
+    RUN_TEST(test_hysteresis_holds_small_changes);
+    RUN_TEST(test_slow_and_retransmitting_links_cost_more);
+    RUN_TEST(test_silent_neighbor_becomes_unusable);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_link_costs_one_unit);
+    RUN_TEST(test_loss_either_way_raises_cost_on_both_ends);
+    RUN_TEST(test_hysteresis_holds_small_changes);
+    RUN_TEST(test_slow_and_retransmitting_links_cost_more);
+    RUN_TEST(test_silent_neighbor_becomes_unusable);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,215 @@
+// Unit test for the mesh outbound priority queue
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_outbound_queue.h"
+#include "../../include/mesh_wire_frame.h"
+
+MeshOutboundQueue* queue;
+uint8_t frameBuffer[MESH_COALESCE_MAX_BYTES];
+
+void setUp() {
+    queue = new MeshOutboundQueue();
+}
+
+void tearDown() {
+    delete queue;
+}
+
+static bool enqueueText(uint32_t dest, const char* text, MeshPriority priority, uint32_t nowMs) {
+    return queue->enqueue(dest, MESH_MSG_DATA, (const uint8_t*)text, strlen(text), 0, priority, nowMs);
+}
+
+void test_priority_order() {
+    enqueueText(10, "log", MESH_PRIORITY_LOG, 0);
+    enqueueText(20, "telemetry", MESH_PRIORITY_TELEMETRY, 0);
+    enqueueText(30, "sms", MESH_PRIORITY_SMS, 0);
+    enqueueText(40, "control", MESH_PRIORITY_CONTROL, 0);
+
+    // Bulk classes are held back until their coalescing deadline
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(40, frame.dest);
+    TEST_ASSERT_TRUE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(30, frame.dest);
+    TEST_ASSERT_FALSE(queue->nextFrame(MESH_COALESCE_DELAY_MS - 1, &frame, frameBuffer, sizeof(frameBuffer)));
+
+    TEST_ASSERT_TRUE(queue->nextFrame(MESH_COALESCE_DELAY_MS, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(20, frame.dest);
+    TEST_ASSERT_EQUAL(MESH_MSG_DATA, frame.type);
+    TEST_ASSERT_EQUAL(9, frame.length);
+    TEST_ASSERT_EQUAL_MEMORY("telemetry", frameBuffer, 9);
+
+    TEST_ASSERT_TRUE(queue->nextFrame(MESH_COALESCE_DELAY_MS, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(10, frame.dest);
+    TEST_ASSERT_TRUE(queue->isEmpty());
+}
+
+void test_coalesces_same_destination() {
+    enqueueText(7, "a1", MESH_PRIORITY_TELEMETRY, 0);
+    enqueueText(8, "b1", MESH_PRIORITY_TELEMETRY, 0);
+    enqueueText(7, "a2", MESH_PRIORITY_LOG, 0);
+    enqueueText(7, "job", MESH_PRIORITY_SMS, 0);
+
+    // The SMS job leads and picks up the waiting bulk traffic for node 7
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(1, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(7, frame.dest);
+    TEST_ASSERT_EQUAL(MESH_MSG_BATCH, frame.type);
+    TEST_ASSERT_EQUAL(3, frame.records);
+
+    const char* expected[] = {"job", "a1", "a2"};
+    size_t offset = 0;
+    for (int i = 0; i < 3; i++) {
+        uint8_t type;
+        const uint8_t* data;
+        size_t len;
+        TEST_ASSERT_TRUE(MeshOutboundQueue::nextRecord(frameBuffer, frame.length, &offset, &type, &data, &len));
+        TEST_ASSERT_EQUAL(MESH_MSG_DATA, type);
+        TEST_ASSERT_EQUAL(strlen(expected[i]), len);
+        TEST_ASSERT_EQUAL_MEMORY(expected[i], data, len);
+    }
+    TEST_ASSERT_EQUAL(frame.length, offset);
+
+    // Node 8 is still waiting on its own deadline
+    TEST_ASSERT_EQUAL(1, queue->getDepth(MESH_PRIORITY_TELEMETRY));
+    TEST_ASSERT_FALSE(queue->nextFrame(1, &frame, frameBuffer, sizeof(frameBuffer)));
+}
+
+void test_full_frame_is_sent_early() {
+    uint8_t chunk[MESH_OUTBOUND_MAX_RECORD];
+    memset(chunk, 0xAB, sizeof(chunk));
+
+    // Enough bulk bytes for one destination to fill the coalescing budget
+    size_t queued = 0;
+    while (queued < MESH_COALESCE_MAX_BYTES) {
+        TEST_ASSERT_TRUE(queue->enqueue(5, MESH_MSG_DATA, chunk, sizeof(chunk), 0, MESH_PRIORITY_LOG, 0));
+        queued += sizeof(chunk) + MeshOutboundQueue::RECORD_OVERHEAD;
+    }
+
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_LESS_OR_EQUAL(MESH_COALESCE_MAX_BYTES, frame.length);
+}
+
+void test_bounded_depth_and_stats() {
+    for (int i = 0; i < MESH_OUTBOUND_QUEUE_DEPTH; i++) {
+        TEST_ASSERT_TRUE(enqueueText(1, "x", MESH_PRIORITY_LOG, 0));
+    }
+    TEST_ASSERT_FALSE(enqueueText(1, "overflow", MESH_PRIORITY_LOG, 0));
+
+    MeshQueueStats stats = queue->getStats(MESH_PRIORITY_LOG);
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH, stats.depth);
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH, stats.highWater);
+    TEST_ASSERT_EQUAL(1, stats.dropped);
+
+    // All eight coalesce into one frame after waiting 100 ms
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(100, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH, frame.records);
+
+    stats = queue->getStats(MESH_PRIORITY_LOG);
+    TEST_ASSERT_EQUAL(0, stats.depth);
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH, stats.sent);
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH, stats.waitHistogram[7]); // 64..127 ms
+}
+
+void test_reclaims_coalesced_slots() {
+    // Interleave two destinations so coalescing leaves holes mid-ring
+    for (int i = 0; i < MESH_OUTBOUND_QUEUE_DEPTH; i++) {
+        TEST_ASSERT_TRUE(enqueueText(i % 2 ? 2 : 3, "m", MESH_PRIORITY_LOG, 0));
+    }
+
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(100, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(3, frame.dest);
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH / 2, queue->getDepth(MESH_PRIORITY_LOG));
+
+    for (int i = 0; i < MESH_OUTBOUND_QUEUE_DEPTH / 2; i++) {
+        TEST_ASSERT_TRUE(enqueueText(4, "n", MESH_PRIORITY_LOG, 100));
+    }
+    TEST_ASSERT_EQUAL(MESH_OUTBOUND_QUEUE_DEPTH, queue->getDepth(MESH_PRIORITY_LOG));
+
+    TEST_ASSERT_TRUE(queue->nextFrame(200, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(2, frame.dest);
+    TEST_ASSERT_TRUE(queue->nextFrame(200, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(4, frame.dest);
+    TEST_ASSERT_TRUE(queue->isEmpty());
+}
+
+static bool blockNode5(void* context, uint32_t dest) {
+    return dest != 5;
+}
+
+void test_filter_holds_blocked_destinations() {
+    enqueueText(5, "held", MESH_PRIORITY_SMS, 0);
+    enqueueText(6, "next", MESH_PRIORITY_SMS, 0);
+    enqueueText(5, "ctl", MESH_PRIORITY_CONTROL, 0);
+
+    // Control traffic ignores the filter; the blocked SMS does not hold up node 6
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer), blockNode5, nullptr));
+    TEST_ASSERT_EQUAL(5, frame.dest);
+    TEST_ASSERT_EQUAL(MESH_PRIORITY_CONTROL, frame.lowestPriority);
+    TEST_ASSERT_EQUAL(1, frame.records);
+
+    TEST_ASSERT_TRUE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer), blockNode5, nullptr));
+    TEST_ASSERT_EQUAL(6, frame.dest);
+    TEST_ASSERT_EQUAL(MESH_PRIORITY_SMS, frame.lowestPriority);
+    TEST_ASSERT_FALSE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer), blockNode5, nullptr));
+    TEST_ASSERT_EQUAL(1, queue->getDepth(MESH_PRIORITY_SMS));
+
+    // Once unblocked the held message goes out
+    TEST_ASSERT_TRUE(queue->nextFrame(0, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(5, frame.dest);
+    TEST_ASSERT_EQUAL_MEMORY("held", frameBuffer, 4);
+    TEST_ASSERT_TRUE(queue->isEmpty());
+}
+
+void test_flags_keep_frames_apart() {
+    // A topic ID that happens to equal a node ID must not share that node's frames
+    queue->enqueue(7, MESH_MSG_DATA, (const uint8_t*)"topic", 5, 0, MESH_PRIORITY_TELEMETRY, 0,
+                   MeshWireFrame::FLAG_TOPIC);
+    enqueueText(7, "node", MESH_PRIORITY_TELEMETRY, 0);
+
+    MeshOutboundFrame frame;
+    TEST_ASSERT_TRUE(queue->nextFrame(MESH_COALESCE_DELAY_MS, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(MESH_MSG_DATA, frame.type);
+    TEST_ASSERT_EQUAL(MeshWireFrame::FLAG_TOPIC, frame.flags);
+    TEST_ASSERT_EQUAL_MEMORY("topic", frameBuffer, 5);
+
+    TEST_ASSERT_TRUE(queue->nextFrame(MESH_COALESCE_DELAY_MS, &frame, frameBuffer, sizeof(frameBuffer)));
+    TEST_ASSERT_EQUAL(0, frame.flags);
+    TEST_ASSERT_EQUAL_MEMORY("node", frameBuffer, 4);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_coalesces_same_destination);
+    RUN_TEST(test_full_frame_is_sent_early);
+    RUN_TEST(test_bounded_depth_and_stats);
+    RUN_TEST(test_reclaims_coalesced_slots);
+    RUN_TEST(test_filter_holds_blocked_destinations);
+    RUN_TEST(test_flags_keep_frames_apart);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_coalesces_same_destination);
+    RUN_TEST(test_full_frame_is_sent_early);
+    RUN_TEST(test_bounded_depth_and_stats);
+    RUN_TEST(test_reclaims_coalesced_slots);
+    RUN_TEST(test_filter_holds_blocked_destinations);
+    RUN_TEST(test_flags_keep_frames_apart);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,189 @@
+// Unit test for topic subscriptions and branch selection
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_pubsub.h"
+
+MeshSubscriptions* subs;
+
+static const uint32_t TELEMETRY = MeshSubscriptions::topicId("telemetry/root");
+static const uint32_t COMMANDS = MeshSubscriptions::topicId("sim/operator-7");
+
+// Self (1) with neighbors 2 and 3; 4 and 5 sit behind 2, 6 behind 3
+static const MeshRouteEntry ROUTES[] = {
+    {1, 0, 0, 0, 0},
+    {2, 2, 1, 0, MESH_LINK_COST_UNIT},
+    {3, 3, 1, 0, MESH_LINK_COST_UNIT},
+    {4, 2, 2, 0, 2 * MESH_LINK_COST_UNIT},
+    {5, 2, 3, 0, 3 * MESH_LINK_COST_UNIT},
+    {6, 3, 2, 0, 2 * MESH_LINK_COST_UNIT},
+};
+static const size_t ROUTE_COUNT = sizeof(ROUTES) / sizeof(ROUTES[0]);
+static const size_t MAX_BRANCHES = 8;
+
+// Builds the advert a node subscribed to the given topic would send
+static void advertise(uint32_t nodeId, uint32_t topic, uint32_t nowMs) {
+    MeshSubscriptions remote;
+    remote.subscribe(topic);
+    uint8_t advert[MeshSubscriptions::ADVERT_SIZE];
+    size_t len;
+    TEST_ASSERT_TRUE(remote.encodeAdvert(advert, sizeof(advert), &len));
+    TEST_ASSERT_TRUE(subs->applyAdvert(nodeId, advert, len, nowMs));
+}
+
+void setUp() {
+    subs = new MeshSubscriptions();
+}
+
+void tearDown() {
+    delete subs;
+}
+
+void test_local_subscriptions() {
+    uint8_t advert[MeshSubscriptions::ADVERT_SIZE];
+    size_t len;
+
+    // Nothing to advertise until the first subscription
+    TEST_ASSERT_FALSE(subs->encodeAdvert(advert, sizeof(advert), &len));
+
+    TEST_ASSERT_TRUE(subs->subscribe(TELEMETRY));
+    TEST_ASSERT_FALSE(subs->subscribe(TELEMETRY));
+    TEST_ASSERT_TRUE(subs->isSubscribed(TELEMETRY));
+    TEST_ASSERT_FALSE(subs->isSubscribed(COMMANDS));
+    TEST_ASSERT_TRUE(subs->encodeAdvert(advert, sizeof(advert), &len));
+    TEST_ASSERT_EQUAL(MeshSubscriptions::ADVERT_SIZE, len);
+
+    TEST_ASSERT_TRUE(subs->deliverLocally(TELEMETRY));
+    TEST_ASSERT_FALSE(subs->deliverLocally(COMMANDS));
+
+    TEST_ASSERT_TRUE(subs->unsubscribe(TELEMETRY));
+    TEST_ASSERT_FALSE(subs->unsubscribe(TELEMETRY));
+    TEST_ASSERT_FALSE(subs->isSubscribed(TELEMETRY));
+
+    // An emptied digest is still advertised so others forget the old one
+    TEST_ASSERT_TRUE(subs->encodeAdvert(advert, sizeof(advert), &len));
+
+    MeshPubSubStats stats = subs->getStats();
+    TEST_ASSERT_EQUAL(0, stats.localTopics);
+    TEST_ASSERT_EQUAL(1, stats.delivered);
+    TEST_ASSERT_EQUAL(1, stats.passedThrough);
+}
+
+void test_adverts_update_and_expire() {
+    advertise(4, TELEMETRY, 1000);
+    TEST_ASSERT_TRUE(subs->mayReach(4, TELEMETRY));
+    TEST_ASSERT_FALSE(subs->mayReach(5, TELEMETRY));
+
+    // Same version again only refreshes the entry
+    advertise(4, TELEMETRY, 2000);
+    TEST_ASSERT_EQUAL(1, subs->getStats().advertsApplied);
+    TEST_ASSERT_EQUAL(1, subs->getStats().knownSubscribers);
+
+    uint8_t truncated[MeshSubscriptions::ADVERT_SIZE - 1] = {0};
+    TEST_ASSERT_FALSE(subs->applyAdvert(4, truncated, sizeof(truncated), 2000));
+
+    subs->expire(2000 + MESH_LINK_STATE_MAX_AGE_MS - 1);
+    TEST_ASSERT_TRUE(subs->mayReach(4, TELEMETRY));
+    subs->expire(2000 + MESH_LINK_STATE_MAX_AGE_MS);
+    TEST_ASSERT_FALSE(subs->mayReach(4, TELEMETRY));
+}
+
+void test_branches_follow_subscribers() {
+    uint32_t branches[MAX_BRANCHES];
+
+    // No subscribers: nothing goes out and every neighbor is pruned
+    TEST_ASSERT_FALSE(subs->hasSubscribers(TELEMETRY, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS));
+    TEST_ASSERT_EQUAL(0, subs->selectBranches(TELEMETRY, 0, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS,
+                                              branches, MAX_BRANCHES));
+
+    // Two subscribers behind neighbor 2 still mean one copy to it
+    advertise(4, TELEMETRY, 0);
+    advertise(5, TELEMETRY, 0);
+    advertise(6, COMMANDS, 0);
+    TEST_ASSERT_TRUE(subs->hasSubscribers(TELEMETRY, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS));
+    TEST_ASSERT_EQUAL(1, subs->selectBranches(TELEMETRY, 0, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS,
+                                              branches, MAX_BRANCHES));
+    TEST_ASSERT_EQUAL(2, branches[0]);
+
+    TEST_ASSERT_EQUAL(1, subs->selectBranches(COMMANDS, 0, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS,
+                                              branches, MAX_BRANCHES));
+    TEST_ASSERT_EQUAL(3, branches[0]);
+
+    // Never sent back towards the neighbor it came from
+    TEST_ASSERT_EQUAL(0, subs->selectBranches(TELEMETRY, 2, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS,
+                                              branches, MAX_BRANCHES));
+
+    MeshPubSubStats stats = subs->getStats();
+    TEST_ASSERT_EQUAL(1, stats.unrouted);
+    TEST_ASSERT_EQUAL(2, stats.branchesUsed);
+    TEST_ASSERT_EQUAL(2 + 1 + 1 + 1, stats.branchesPruned);
+}
+
+void test_hop_limit_and_unrouted_subscribers() {
+    uint32_t branches[MAX_BRANCHES];
+
+    // Node 5 is three hops out; with two hops left it is out of reach
+    advertise(5, TELEMETRY, 0);
+    TEST_ASSERT_EQUAL(0, subs->selectBranches(TELEMETRY, 0, ROUTES, ROUTE_COUNT, 2, branches, MAX_BRANCHES));
+    TEST_ASSERT_FALSE(subs->hasSubscribers(TELEMETRY, ROUTES, ROUTE_COUNT, 2));
+
+    // Node 9 has advertised but is not in the route table: the publisher names it directly,
+    // a relay leaves it to whoever does have a route
+    advertise(9, COMMANDS, 0);
+    TEST_ASSERT_TRUE(subs->hasSubscribers(COMMANDS, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS));
+    TEST_ASSERT_EQUAL(1, subs->selectBranches(COMMANDS, 0, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS,
+                                              branches, MAX_BRANCHES));
+    TEST_ASSERT_EQUAL(9, branches[0]);
+    TEST_ASSERT_EQUAL(0, subs->selectBranches(COMMANDS, 2, ROUTES, ROUTE_COUNT, MAX_NETWORK_HOPS,
+                                              branches, MAX_BRANCHES));
+}
+
+void test_each_frame_forwarded_once() {
+    TEST_ASSERT_TRUE(subs->firstCopy(7, 100));
+    TEST_ASSERT_FALSE(subs->firstCopy(7, 100));
+    TEST_ASSERT_TRUE(subs->firstCopy(7, 101));
+    TEST_ASSERT_TRUE(subs->firstCopy(8, 100));
+    TEST_ASSERT_EQUAL(1, subs->getStats().duplicatesDropped);
+
+    // The memory is a ring: old frames are forgotten once it wraps
+    for (uint32_t seq = 0; seq < MESH_TOPIC_FORWARD_MEMORY; seq++) {
+        subs->firstCopy(9, seq);
+    }
+    TEST_ASSERT_TRUE(subs->firstCopy(7, 100));
+}
+
+void test_topic_ids_are_stable() {
+    TEST_ASSERT_EQUAL(MeshSubscriptions::topicId("telemetry/root"), TELEMETRY);
+    TEST_ASSERT_TRUE(TELEMETRY != COMMANDS);
+    TEST_ASSERT_TRUE(MeshSubscriptions::topicId("") != 0);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_local_subscriptions);
+    RUN_TEST(test_adverts_update_and_expire);
+    RUN_TEST(test_branches_follow_subscribers);
+    RUN_TEST(test_hop_limit_and_unrouted_subscribers);
+    RUN_TEST(test_each_frame_forwarded_once);
+    RUN_TEST(test_topic_ids_are_stable);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_local_subscriptions);
+    RUN_TEST(test_adverts_update_and_expire);
+    RUN_TEST(test_branches_follow_subscribers);
+    RUN_TEST(test_hop_limit_and_unrouted_subscribers);
+    RUN_TEST(test_each_frame_forwarded_once);
+    RUN_TEST(test_topic_ids_are_stable);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,194 @@
+// Unit test for the lock-free receive ring
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_receive_ring.h"
+
+MeshReceiveRing* ring;
+
+static bool pushFrame(uint32_t from, uint16_t length, uint32_t nowUs) {
+    MeshReceiveSlot* slot = ring->beginPush();
+    if (!slot) {
+        return false;
+    }
+    slot->from = from;
+    slot->length = length;
+    memset(slot->frame, (uint8_t)from, length);
+    ring->commitPush(slot, nowUs);
+    return true;
+}
+
+void setUp() {
+    ring = new MeshReceiveRing();
+}
+
+void tearDown() {
+    delete ring;
+}
+
+void test_frames_come_out_in_order() {
+    TEST_ASSERT_TRUE(ring->front() == nullptr);
+
+    for (uint32_t i = 1; i <= 3; i++) {
+        TEST_ASSERT_TRUE(pushFrame(i, 10 * i, 0));
+    }
+
+    for (uint32_t i = 1; i <= 3; i++) {
+        MeshReceiveSlot* slot = ring->front();
+        TEST_ASSERT_TRUE(slot != nullptr);
+        TEST_ASSERT_EQUAL(i, slot->from);
+        TEST_ASSERT_EQUAL(10 * i, slot->length);
+        TEST_ASSERT_EQUAL(i, slot->frame[0]);
+        ring->pop(0);
+    }
+    TEST_ASSERT_TRUE(ring->front() == nullptr);
+}
+
+void test_full_ring_drops_and_recovers() {
+    for (uint32_t i = 0; i < MESH_RX_RING_SLOTS; i++) {
+        TEST_ASSERT_TRUE(pushFrame(i + 1, 1, 0));
+    }
+    TEST_ASSERT_FALSE(pushFrame(99, 1, 0));
+
+    MeshReceiveRingStats stats = ring->getStats();
+    TEST_ASSERT_EQUAL(MESH_RX_RING_SLOTS, stats.depth);
+    TEST_ASSERT_EQUAL(MESH_RX_RING_SLOTS, stats.highWater);
+    TEST_ASSERT_EQUAL(1, stats.dropped);
+
+    // Freeing one slot lets the next frame in, behind the ones already queued
+    ring->pop(0);
+    TEST_ASSERT_TRUE(pushFrame(100, 1, 0));
+    for (uint32_t i = 2; i <= MESH_RX_RING_SLOTS; i++) {
+        TEST_ASSERT_EQUAL(i, ring->front()->from);
+        ring->pop(0);
+    }
+    TEST_ASSERT_EQUAL(100, ring->front()->from);
+}
+
+void test_wraps_around_many_laps() {
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        TEST_ASSERT_TRUE(pushFrame(i, 4, i));
+        if (i % 3 == 2) {
+            // Consumer lags the producer but keeps up overall
+            while (ring->front()) {
+                TEST_ASSERT_EQUAL(next, ring->front()->from);
+                ring->pop(i);
+                next++;
+            }
+        }
+    }
+    while (ring->front()) {
+        ring->pop(0);
+        next++;
+    }
+    TEST_ASSERT_EQUAL(1000, next);
+    TEST_ASSERT_EQUAL(1000, ring->getStats().dispatched);
+}
+
+void test_latency_and_empty_slots_are_accounted() {
+    // Empty slots keep ring order but are neither enqueued nor dispatched traffic
+    TEST_ASSERT_TRUE(pushFrame(1, 0, 100));
+    TEST_ASSERT_TRUE(pushFrame(2, 8, 100));
+    TEST_ASSERT_TRUE(pushFrame(3, 8, 100));
+
+    ring->pop(5000);
+    ring->pop(100);    // Dispatched immediately: bucket 0
+    ring->pop(1124);   // 1024 us: bucket 11
+
+    MeshReceiveRingStats stats = ring->getStats();
+    TEST_ASSERT_EQUAL(2, stats.enqueued);
+    TEST_ASSERT_EQUAL(2, stats.dispatched);
+    TEST_ASSERT_EQUAL(0, stats.depth);
+    TEST_ASSERT_EQUAL(1024, stats.maxLatencyUs);
+    TEST_ASSERT_EQUAL(1, stats.latencyHistogram[0]);
+    TEST_ASSERT_EQUAL(1, stats.latencyHistogram[11]);
+
+    ring->resetStats();
+    stats = ring->getStats();
+    TEST_ASSERT_EQUAL(0, stats.dispatched);
+    TEST_ASSERT_EQUAL(0, stats.maxLatencyUs);
+    TEST_ASSERT_EQUAL(3, stats.highWater);
+}
+
+#ifndef ARDUINO
+#include <thread>
+
+// Producers on several threads against one consumer; each producer's frames stay in order
+void test_concurrent_producers() {
+    const uint32_t producers = 4;
+    const uint32_t perProducer = 20000;
+    uint32_t nextExpected[producers] = {0};
+    uint32_t received = 0;
+    bool ordered = true;
+
+    std::thread threads[producers];
+    for (uint32_t p = 0; p < producers; p++) {
+        threads[p] = std::thread([p]() {
+            for (uint32_t n = 0; n < perProducer; n++) {
+                MeshReceiveSlot* slot;
+                while ((slot = ring->beginPush()) == nullptr) {
+                    std::this_thread::yield();
+                }
+                slot->from = p;
+                slot->length = 4;
+                memcpy(slot->frame, &n, sizeof(n));
+                ring->commitPush(slot, 0);
+            }
+        });
+    }
+
+    while (received < producers * perProducer) {
+        MeshReceiveSlot* slot = ring->front();
+        if (!slot) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t n;
+        memcpy(&n, slot->frame, sizeof(n));
+        if (n != nextExpected[slot->from]) {
+            ordered = false;
+        }
+        nextExpected[slot->from] = n + 1;
+        ring->pop(0);
+        received++;
+    }
+
+    for (uint32_t p = 0; p < producers; p++) {
+        threads[p].join();
+    }
+
+    TEST_ASSERT_TRUE(ordered);
+    MeshReceiveRingStats stats = ring->getStats();
+    TEST_ASSERT_EQUAL(producers * perProducer, stats.enqueued);
+    TEST_ASSERT_EQUAL(producers * perProducer, stats.dispatched);
+    TEST_ASSERT_EQUAL(0, stats.depth);
+}
+#endif
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_come_out_in_order);
+    RUN_TEST(test_full_ring_drops_and_recovers);
+    RUN_TEST(test_wraps_around_many_laps);
+    RUN_TEST(test_latency_and_empty_slots_are_accounted);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_come_out_in_order);
+    RUN_TEST(test_full_ring_drops_and_recovers);
+    RUN_TEST(test_wraps_around_many_laps);
+    RUN_TEST(test_latency_and_empty_slots_are_accounted);
+    RUN_TEST(test_concurrent_producers);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,260 @@
+// Unit test for reliable unicast (sliding window, SACK, RTO)
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_reliable.h"
+
+#define SENDER_ID 0x1001
+#define RECEIVER_ID 0x2002
+
+MeshReliable* sender;
+MeshReliable* receiver;
+
+static uint8_t packet[MESH_OUTBOUND_MAX_RECORD];
+static uint8_t ack[MeshReliable::ACK_SIZE];
+
+static size_t sendText(const char* text, uint32_t nowMs) {
+    size_t len = 0;
+    if (!sender->send(RECEIVER_ID, 2, (const uint8_t*)text, strlen(text), nowMs, packet, sizeof(packet), &len)) {
+        return 0;
+    }
+    return len;
+}
+
+static MeshReliableVerdict receive(const uint8_t* data, size_t len, uint32_t nowMs) {
+    uint8_t type;
+    const uint8_t* payload;
+    size_t payloadLen;
+    return receiver->onData(SENDER_ID, data, len, nowMs, &type, &payload, &payloadLen);
+}
+
+static void deliverAck(uint32_t nowMs) {
+    uint32_t dest;
+    size_t len;
+    TEST_ASSERT_TRUE(receiver->nextAck(&dest, ack, sizeof(ack), &len));
+    TEST_ASSERT_EQUAL(SENDER_ID, dest);
+    TEST_ASSERT_TRUE(sender->onAck(RECEIVER_ID, ack, len, nowMs));
+}
+
+void setUp() {
+    sender = new MeshReliable();
+    receiver = new MeshReliable();
+    sender->begin(0x5A5A);
+    receiver->begin(0x1234);
+}
+
+void tearDown() {
+    delete sender;
+    delete receiver;
+}
+
+void test_delivery_and_ack() {
+    size_t len = sendText("job-1", 0);
+
+    uint8_t type;
+    const uint8_t* payload;
+    size_t payloadLen;
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER,
+                      receiver->onData(SENDER_ID, packet, len, 10, &type, &payload, &payloadLen));
+    TEST_ASSERT_EQUAL(2, type);
+    TEST_ASSERT_EQUAL(5, payloadLen);
+    TEST_ASSERT_EQUAL_MEMORY("job-1", payload, 5);
+
+    TEST_ASSERT_EQUAL(1, sender->getInFlight(RECEIVER_ID));
+    deliverAck(40);
+    TEST_ASSERT_EQUAL(0, sender->getInFlight(RECEIVER_ID));
+    TEST_ASSERT_EQUAL(1, sender->getStats().acked);
+
+    // Nothing left to acknowledge
+    uint32_t dest;
+    size_t ackLen;
+    TEST_ASSERT_FALSE(receiver->nextAck(&dest, ack, sizeof(ack), &ackLen));
+}
+
+void test_duplicates_suppressed_and_reacked() {
+    size_t len = sendText("job-1", 0);
+    uint8_t first[MESH_OUTBOUND_MAX_RECORD];
+    memcpy(first, packet, len);
+
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(first, len, 10));
+    uint32_t dest;
+    size_t ackLen;
+    receiver->nextAck(&dest, ack, sizeof(ack), &ackLen);   // ACK lost
+
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DUPLICATE, receive(first, len, 20));
+    TEST_ASSERT_EQUAL(1, receiver->getStats().duplicates);
+    deliverAck(30);
+    TEST_ASSERT_EQUAL(0, sender->getInFlight(RECEIVER_ID));
+}
+
+void test_window_limits_in_flight() {
+    for (int i = 0; i < MESH_RELIABLE_WINDOW; i++) {
+        sendText("x", 0);
+    }
+
+    size_t len;
+    TEST_ASSERT_FALSE(sender->send(RECEIVER_ID, 2, (const uint8_t*)"x", 1, 0, packet, sizeof(packet), &len));
+    TEST_ASSERT_EQUAL(1, sender->getStats().windowFull);
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_WINDOW, sender->getInFlight(RECEIVER_ID));
+}
+
+void test_selective_ack_and_retransmit_of_gap() {
+    // Seq 0 is lost, 1..3 arrive
+    uint8_t packets[4][MESH_OUTBOUND_MAX_RECORD];
+    size_t lens[4];
+    for (int i = 0; i < 4; i++) {
+        lens[i] = sendText("m", 0);
+        memcpy(packets[i], packet, lens[i]);
+    }
+    for (int i = 1; i < 4; i++) {
+        TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(packets[i], lens[i], 10));
+    }
+    deliverAck(20);
+    TEST_ASSERT_EQUAL(3, sender->getStats().acked);
+    TEST_ASSERT_EQUAL(4, sender->getInFlight(RECEIVER_ID));   // Base still held by seq 0
+
+    // Only the gap is retransmitted once its timeout expires
+    uint32_t dest;
+    size_t len;
+    TEST_ASSERT_FALSE(sender->nextRetransmit(20, &dest, packet, sizeof(packet), &len));
+    uint32_t later = sender->getRtoMs(RECEIVER_ID) + 1;
+    TEST_ASSERT_TRUE(sender->nextRetransmit(later, &dest, packet, sizeof(packet), &len));
+    TEST_ASSERT_EQUAL(RECEIVER_ID, dest);
+    TEST_ASSERT_FALSE(sender->nextRetransmit(later, &dest, packet, sizeof(packet), &len));
+
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(packet, len, later + 5));
+    deliverAck(later + 10);
+    TEST_ASSERT_EQUAL(0, sender->getInFlight(RECEIVER_ID));
+    TEST_ASSERT_EQUAL(1, sender->getStats().retransmits);
+}
+
+void test_rto_adapts_to_measured_rtt() {
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_RTO_INITIAL_MS, sender->getRtoMs(RECEIVER_ID));
+
+    uint32_t now = 0;
+    for (int i = 0; i < 20; i++) {
+        size_t len = sendText("rtt", now);
+        receive(packet, len, now + 20);
+        deliverAck(now + 40);
+        now += 100;
+    }
+
+    // Steady 40 ms RTT settles well below the initial guess, clamped to the floor
+    uint32_t rto = sender->getRtoMs(RECEIVER_ID);
+    TEST_ASSERT_TRUE(rto < MESH_RELIABLE_RTO_INITIAL_MS);
+    TEST_ASSERT_TRUE(rto >= MESH_RELIABLE_RTO_MIN_MS);
+}
+
+void test_gives_up_after_max_retries() {
+    sendText("lost", 0);
+
+    uint32_t dest;
+    size_t len;
+    uint32_t now = 0;
+    for (int i = 0; i < 100 && sender->getInFlight(RECEIVER_ID) > 0; i++) {
+        now += MESH_RELIABLE_RTO_MAX_MS;
+        sender->nextRetransmit(now, &dest, packet, sizeof(packet), &len);
+    }
+
+    MeshReliableStats stats = sender->getStats();
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_MAX_RETRIES, stats.retransmits);
+    TEST_ASSERT_EQUAL(1, stats.failed);
+    TEST_ASSERT_EQUAL(0, sender->getInFlight(RECEIVER_ID));
+}
+
+void test_receiver_resyncs_after_sender_reboot() {
+    for (int i = 0; i < 3; i++) {
+        size_t len = sendText("a", 0);
+        receive(packet, len, 10);
+    }
+    deliverAck(20);
+
+    // Rebooted sender starts over at seq 0 with a new session
+    delete sender;
+    sender = new MeshReliable();
+    sender->begin(0x7777);
+    size_t len = sendText("b", 100);
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(packet, len, 110));
+}
+
+void test_duplicate_after_peer_eviction() {
+    size_t len = sendText("sms", 0);
+    uint8_t first[MESH_OUTBOUND_MAX_RECORD];
+    memcpy(first, packet, len);
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(first, len, 10));
+
+    // Other senders push this peer out of the receive table
+    for (uint32_t other = 1; other <= MESH_RELIABLE_PEERS; other++) {
+        MeshReliable otherSender;
+        otherSender.begin(other);
+        size_t otherLen;
+        otherSender.send(RECEIVER_ID, 2, (const uint8_t*)"x", 1, 20, packet, sizeof(packet), &otherLen);
+        uint8_t type;
+        const uint8_t* payload;
+        size_t payloadLen;
+        receiver->onData(0x9000 + other, packet, otherLen, 20 + other, &type, &payload, &payloadLen);
+    }
+
+    // The retransmission is still recognised
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DUPLICATE, receive(first, len, 100));
+}
+
+void test_recycled_send_peer_is_not_duplicate() {
+    size_t len = sendText("first", 0);
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(packet, len, 10));
+    deliverAck(20);
+
+    // Acknowledged traffic to other nodes recycles the idle entry for RECEIVER_ID
+    for (uint32_t other = 1; other <= MESH_RELIABLE_PEERS; other++) {
+        MeshReliable otherReceiver;
+        size_t otherLen;
+        uint8_t type;
+        const uint8_t* payload;
+        size_t payloadLen;
+        uint32_t dest;
+        sender->send(0x9000 + other, 2, (const uint8_t*)"x", 1, 30, packet, sizeof(packet), &otherLen);
+        otherReceiver.onData(SENDER_ID, packet, otherLen, 30, &type, &payload, &payloadLen);
+        otherReceiver.nextAck(&dest, ack, sizeof(ack), &otherLen);
+        TEST_ASSERT_TRUE(sender->onAck(0x9000 + other, ack, otherLen, 40 + other));
+    }
+    TEST_ASSERT_EQUAL(0, sender->getInFlight(RECEIVER_ID));
+
+    // Its sequence numbers start over, under a session the receiver has not seen
+    len = sendText("second", 100);
+    TEST_ASSERT_EQUAL(MESH_RELIABLE_DELIVER, receive(packet, len, 110));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_delivery_and_ack);
+    RUN_TEST(test_duplicates_suppressed_and_reacked);
+    RUN_TEST(test_window_limits_in_flight);
+    RUN_TEST(test_selective_ack_and_retransmit_of_gap);
+    RUN_TEST(test_rto_adapts_to_measured_rtt);
+    RUN_TEST(test_gives_up_after_max_retries);
+    RUN_TEST(test_receiver_resyncs_after_sender_reboot);
+    RUN_TEST(test_duplicate_after_peer_eviction);
+    RUN_TEST(test_recycled_send_peer_is_not_duplicate);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_delivery_and_ack);
+    RUN_TEST(test_duplicates_suppressed_and_reacked);
+    RUN_TEST(test_window_limits_in_flight);
+    RUN_TEST(test_selective_ack_and_retransmit_of_gap);
+    RUN_TEST(test_rto_adapts_to_measured_rtt);
+    RUN_TEST(test_gives_up_after_max_retries);
+    RUN_TEST(test_receiver_resyncs_after_sender_reboot);
+    RUN_TEST(test_duplicate_after_peer_eviction);
+    RUN_TEST(test_recycled_send_peer_is_not_duplicate);
+    return UNITY_END();
+}
+#endif
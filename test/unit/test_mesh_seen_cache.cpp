@@ -0,0 +1,100 @@
+// Unit test for the mesh seen-message cache
+#include <unity.h>
+#include "../../include/mesh_seen_cache.h"
+
+MeshSeenCache* cache;
+
+void setUp() {
+    cache = new MeshSeenCache();
+}
+
+void tearDown() {
+    delete cache;
+}
+
+void test_duplicate_is_detected() {
+    TEST_ASSERT_FALSE(cache->contains(0x1001, 7, 1000));
+    cache->insert(0x1001, 7, 1000);
+
+    TEST_ASSERT_TRUE(cache->contains(0x1001, 7, 1500));
+    TEST_ASSERT_FALSE(cache->contains(0x1001, 8, 1500));
+    TEST_ASSERT_FALSE(cache->contains(0x1002, 7, 1500));
+
+    MeshSeenCacheStats stats = cache->getStats();
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL(3, stats.misses);
+}
+
+void test_entries_expire() {
+    cache->insert(0x1001, 7, 1000);
+    TEST_ASSERT_TRUE(cache->contains(0x1001, 7, 1000 + MESH_SEEN_CACHE_TTL_MS - 1));
+    TEST_ASSERT_FALSE(cache->contains(0x1001, 7, 1000 + MESH_SEEN_CACHE_TTL_MS));
+}
+
+void test_expiry_survives_clock_wrap() {
+    uint32_t nearWrap = 0xFFFFFF00u;
+    cache->insert(0x1001, 7, nearWrap);
+    TEST_ASSERT_TRUE(cache->contains(0x1001, 7, nearWrap + 0x200));
+}
+
+void test_memory_is_bounded_under_flood() {
+    // Far more distinct frames than slots: older ones get evicted, newest stay
+    const uint32_t capacity = MESH_SEEN_CACHE_SETS * MESH_SEEN_CACHE_WAYS;
+    for (uint32_t seq = 0; seq < capacity * 4; seq++) {
+        cache->insert(0x2000 + (seq % 40), seq, 5000 + seq);
+    }
+
+    TEST_ASSERT_GREATER_THAN(0, cache->getStats().evictions);
+
+    uint32_t recentHits = 0;
+    for (uint32_t seq = capacity * 4 - 32; seq < capacity * 4; seq++) {
+        if (cache->contains(0x2000 + (seq % 40), seq, 5000 + capacity * 4)) recentHits++;
+    }
+    TEST_ASSERT_EQUAL(32, recentHits);
+}
+
+void test_heartbeat_duplicates_from_many_nodes() {
+    // 40 nodes, each heartbeat relayed to us 5 times
+    uint32_t dropped = 0;
+    for (uint32_t node = 1; node <= 40; node++) {
+        for (int copy = 0; copy < 5; copy++) {
+            if (cache->contains(node, 100, 2000)) {
+                dropped++;
+            } else {
+                cache->insert(node, 100, 2000);
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(160, dropped);
+    TEST_ASSERT_EQUAL(160, cache->getStats().hits);
+    TEST_ASSERT_EQUAL(40, cache->getStats().misses);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicate_is_detected);
+    RUN_TEST(test_entries_expire);
+    RUN_TEST(test_expiry_survives_clock_wrap);
+    RUN_TEST(test_memory_is_bounded_under_flood);
+    RUN_TEST(test_heartbeat_duplicates_from_many_nodes);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicate_is_detected);
+    RUN_TEST(test_entries_expire);
+    RUN_TEST(test_expiry_survives_clock_wrap);
+    RUN_TEST(test_memory_is_bounded_under_flood);
+    RUN_TEST(test_heartbeat_duplicates_from_many_nodes);
+    return UNITY_END();
+}
+#endif
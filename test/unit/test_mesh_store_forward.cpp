@@ -0,0 +1,255 @@
+// Unit test for the flash-backed store-and-forward queue
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_store_forward.h"
+
+MeshFlash* flash;
+MeshStoreForward* store;
+
+static uint8_t message[MESH_OUTBOUND_MAX_RECORD];
+static size_t messageLen;
+static uint32_t messageDest;
+static MeshPriority messagePriority;
+
+static bool notNine(void* context, uint32_t dest) {
+    return dest != 9;
+}
+
+static bool replay(uint32_t nowMs) {
+    return store->nextReplay(nowMs, notNine, nullptr, &messageDest, &messagePriority, message, sizeof(message),
+                             &messageLen);
+}
+
+// The ACK the destination of the last replayed message would send back
+static void ackLast() {
+    uint8_t ack[MeshStoreForward::ACK_SIZE] = {1};
+    memcpy(ack + 1, message + 1, 4);
+    TEST_ASSERT_TRUE(store->onAck(messageDest, ack, sizeof(ack)));
+}
+
+void setUp() {
+    flash = new MeshFlash();
+    flash->begin(MESH_STORE_PARTITION);
+    store = new MeshStoreForward();
+    TEST_ASSERT_TRUE(store->begin(flash, 0));
+}
+
+void tearDown() {
+    delete store;
+    delete flash;
+}
+
+void test_replays_by_priority_at_the_rate_limit() {
+    const uint8_t log[] = "log";
+    const uint8_t sms[] = "sms";
+    const uint8_t alarm[] = "alarm";
+    TEST_ASSERT_TRUE(store->append(2, 40, log, sizeof(log), MESH_PRIORITY_LOG, 0));
+    TEST_ASSERT_TRUE(store->append(9, 41, sms, sizeof(sms), MESH_PRIORITY_SMS, 0));
+    TEST_ASSERT_TRUE(store->append(3, 42, sms, sizeof(sms), MESH_PRIORITY_SMS, 0));
+    TEST_ASSERT_TRUE(store->append(4, 43, alarm, sizeof(alarm), MESH_PRIORITY_CONTROL, 0));
+    TEST_ASSERT_EQUAL(2, store->getDepth(MESH_PRIORITY_SMS));
+
+    // Unreachable destination 9 waits; the rest go most urgent first
+    TEST_ASSERT_TRUE(replay(0));
+    TEST_ASSERT_EQUAL(4, messageDest);
+    TEST_ASSERT_EQUAL(MESH_PRIORITY_CONTROL, messagePriority);
+    TEST_ASSERT_EQUAL(MeshStoreForward::DATA_HEADER_SIZE + sizeof(alarm), messageLen);
+    TEST_ASSERT_EQUAL(0, message[0]);
+    TEST_ASSERT_EQUAL(43, message[5]);
+    TEST_ASSERT_EQUAL_MEMORY(alarm, message + MeshStoreForward::DATA_HEADER_SIZE, sizeof(alarm));
+    TEST_ASSERT_TRUE(replay(0));
+    TEST_ASSERT_EQUAL(3, messageDest);
+    TEST_ASSERT_TRUE(replay(0));
+    TEST_ASSERT_EQUAL(2, messageDest);
+    TEST_ASSERT_FALSE(replay(0));
+
+    // A burst after a partition drains at MESH_STORE_REPLAY_PER_SEC
+    for (uint32_t i = 0; i < 3 * MESH_STORE_REPLAY_PER_SEC; i++) {
+        TEST_ASSERT_TRUE(store->append(5, 44, log, sizeof(log), MESH_PRIORITY_SMS, 10));
+    }
+    uint32_t sent = 0;
+    for (uint32_t now = 10; now < 1010; now += 10) {
+        if (replay(now)) sent++;
+    }
+    // The bucket still held one token from the first round
+    TEST_ASSERT_INT_WITHIN(1, MESH_STORE_REPLAY_PER_SEC + 1, sent);
+
+    MeshStoreStats stats = store->getStats(1010);
+    TEST_ASSERT_EQUAL(4 + 3 * MESH_STORE_REPLAY_PER_SEC, stats.appended);
+    TEST_ASSERT_EQUAL(stats.appended, stats.records);
+    TEST_ASSERT_EQUAL(1010, stats.oldestAgeMs);
+    TEST_ASSERT_EQUAL(3 + sent, stats.replayed);
+}
+
+void test_ack_retires_and_unacked_back_off() {
+    const uint8_t report[] = "delivered";
+    TEST_ASSERT_TRUE(store->append(2, 40, report, sizeof(report), MESH_PRIORITY_SMS, 0));
+
+    TEST_ASSERT_TRUE(replay(0));
+    TEST_ASSERT_FALSE(replay(MESH_STORE_RETRY_MS - 1));
+    TEST_ASSERT_TRUE(replay(MESH_STORE_RETRY_MS));
+    TEST_ASSERT_FALSE(replay(3 * MESH_STORE_RETRY_MS - 1));
+    TEST_ASSERT_TRUE(replay(3 * MESH_STORE_RETRY_MS));
+
+    // A new connection makes it due at once
+    uint32_t now = 3 * MESH_STORE_RETRY_MS + 1000;
+    TEST_ASSERT_FALSE(replay(now));
+    store->onConnectivity(now);
+    TEST_ASSERT_TRUE(replay(now));
+    TEST_ASSERT_EQUAL(3, store->getStats(now).retries);
+
+    // Only the destination's ACK retires it
+    uint32_t dest = messageDest;
+    messageDest = 7;
+    ackLast();
+    TEST_ASSERT_EQUAL(1, store->getStats(now).records);
+    messageDest = dest;
+    ackLast();
+    MeshStoreStats stats = store->getStats(now);
+    TEST_ASSERT_EQUAL(0, stats.records);
+    TEST_ASSERT_EQUAL(1, stats.delivered);
+    TEST_ASSERT_FALSE(replay(now + MESH_STORE_RETRY_MAX_MS));
+
+    const uint8_t data[] = {0, 1, 0, 0, 0, 40};
+    TEST_ASSERT_FALSE(store->onAck(2, data, sizeof(data)));
+}
+
+void test_reboot_restores_waiting_records() {
+    const uint8_t a[] = "first";
+    const uint8_t b[] = "second";
+    const uint8_t c[] = "third";
+    TEST_ASSERT_TRUE(store->append(2, 40, a, sizeof(a), MESH_PRIORITY_SMS, 0));
+    TEST_ASSERT_TRUE(store->append(3, 41, b, sizeof(b), MESH_PRIORITY_CONTROL, 0));
+    TEST_ASSERT_TRUE(store->append(4, 42, c, sizeof(c), MESH_PRIORITY_LOG, 0));
+    TEST_ASSERT_TRUE(replay(0));
+    ackLast();
+
+    // Power lost part-way through programming the last record
+    uint8_t torn = 0;
+    flash->write(8 + 2 * 24 + 16 + 1, &torn, 1);
+
+    delete store;
+    store = new MeshStoreForward();
+    TEST_ASSERT_TRUE(store->begin(flash, 50000));
+    MeshStoreStats stats = store->getStats(50000);
+    TEST_ASSERT_EQUAL(1, stats.recovered);
+    TEST_ASSERT_EQUAL(1, stats.records);
+    TEST_ASSERT_EQUAL(0, stats.oldestAgeMs);
+
+    TEST_ASSERT_TRUE(replay(50000));
+    TEST_ASSERT_EQUAL(2, messageDest);
+    TEST_ASSERT_EQUAL(40, message[5]);
+    TEST_ASSERT_EQUAL_MEMORY(a, message + MeshStoreForward::DATA_HEADER_SIZE, sizeof(a));
+
+    // Appends resume past the damage and survive the next reboot too
+    TEST_ASSERT_TRUE(store->append(5, 43, c, sizeof(c), MESH_PRIORITY_SMS, 50000));
+    delete store;
+    store = new MeshStoreForward();
+    TEST_ASSERT_TRUE(store->begin(flash, 60000));
+    TEST_ASSERT_EQUAL(2, store->getStats(60000).recovered);
+    TEST_ASSERT_EQUAL(2, store->getDepth(MESH_PRIORITY_SMS));
+}
+
+void test_log_wraps_and_keeps_live_records() {
+    uint8_t payload[MeshStoreForward::MAX_PAYLOAD];
+    memset(payload, 0xA5, sizeof(payload));
+    const uint8_t keep[] = "keep me";
+    TEST_ASSERT_TRUE(store->append(2, 40, keep, sizeof(keep), MESH_PRIORITY_LOG, 0));
+
+    // Many times the segment's capacity goes through while one record stays live
+    uint32_t now = 0;
+    for (uint32_t i = 0; i < 3 * MESH_STORE_SECTORS * (MESH_STORE_SECTOR_SIZE / 256); i++) {
+        now += 1000;
+        TEST_ASSERT_TRUE(store->append(3, 41, payload, sizeof(payload), MESH_PRIORITY_CONTROL, now));
+        TEST_ASSERT_TRUE(replay(now));
+        TEST_ASSERT_EQUAL(3, messageDest);
+        ackLast();
+    }
+    MeshStoreStats stats = store->getStats(now);
+    TEST_ASSERT_TRUE(stats.erases > MESH_STORE_SECTORS);
+    TEST_ASSERT_EQUAL(1, stats.records);
+    TEST_ASSERT_EQUAL(0, stats.dropped);
+
+    delete store;
+    store = new MeshStoreForward();
+    TEST_ASSERT_TRUE(store->begin(flash, now));
+    TEST_ASSERT_EQUAL(1, store->getStats(now).recovered);
+    TEST_ASSERT_TRUE(replay(now));
+    TEST_ASSERT_EQUAL(2, messageDest);
+    TEST_ASSERT_EQUAL_MEMORY(keep, message + MeshStoreForward::DATA_HEADER_SIZE, sizeof(keep));
+
+    // Once the index is full, appends are refused and counted
+    size_t accepted = 0;
+    while (store->append(4, 42, payload, 8, MESH_PRIORITY_SMS, now)) accepted++;
+    TEST_ASSERT_EQUAL(MESH_STORE_MAX_RECORDS - 1, accepted);
+    TEST_ASSERT_EQUAL(1, store->getStats(now).dropped);
+    TEST_ASSERT_FALSE(store->append(4, 42, payload, sizeof(payload) + 1, MESH_PRIORITY_SMS, now));
+}
+
+void test_receiver_suppresses_duplicates_and_sender_expires() {
+    const uint8_t data[] = {0, 0x34, 0x12, 0, 0, 40, 'h', 'i'};
+    uint8_t type;
+    const uint8_t* payload;
+    size_t payloadLen;
+    uint8_t ack[MeshStoreForward::ACK_SIZE];
+    size_t ackLen;
+
+    TEST_ASSERT_TRUE(store->receive(2, data, sizeof(data), 0, &type, &payload, &payloadLen, ack, sizeof(ack), &ackLen));
+    TEST_ASSERT_EQUAL(40, type);
+    TEST_ASSERT_EQUAL(2, payloadLen);
+    TEST_ASSERT_EQUAL('h', payload[0]);
+    TEST_ASSERT_EQUAL(MeshStoreForward::ACK_SIZE, ackLen);
+    TEST_ASSERT_EQUAL(1, ack[0]);
+    TEST_ASSERT_EQUAL_MEMORY(data + 1, ack + 1, 4);
+
+    // The replay after a lost ACK is acknowledged again but handed up once
+    ackLen = 0;
+    TEST_ASSERT_FALSE(store->receive(2, data, sizeof(data), 1000, &type, &payload, &payloadLen, ack, sizeof(ack), &ackLen));
+    TEST_ASSERT_EQUAL(MeshStoreForward::ACK_SIZE, ackLen);
+    // Same ID from another origin is a different message
+    TEST_ASSERT_TRUE(store->receive(3, data, sizeof(data), 1000, &type, &payload, &payloadLen, ack, sizeof(ack), &ackLen));
+    TEST_ASSERT_TRUE(store->receive(2, data, sizeof(data), MESH_STORE_DEDUP_MS, &type, &payload, &payloadLen, ack,
+                                    sizeof(ack), &ackLen));
+    TEST_ASSERT_FALSE(store->receive(2, data, 5, 0, &type, &payload, &payloadLen, ack, sizeof(ack), &ackLen));
+    TEST_ASSERT_EQUAL(0, ackLen);
+
+    MeshStoreStats stats = store->getStats(0);
+    TEST_ASSERT_EQUAL(3, stats.received);
+    TEST_ASSERT_EQUAL(1, stats.duplicates);
+
+    // A destination that never comes back is given up on
+    TEST_ASSERT_TRUE(store->append(9, 40, data, sizeof(data), MESH_PRIORITY_SMS, 0));
+    TEST_ASSERT_FALSE(replay(MESH_STORE_MAX_AGE_MS));
+    stats = store->getStats(MESH_STORE_MAX_AGE_MS);
+    TEST_ASSERT_EQUAL(1, stats.expired);
+    TEST_ASSERT_EQUAL(0, stats.records);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_replays_by_priority_at_the_rate_limit);
+    RUN_TEST(test_ack_retires_and_unacked_back_off);
+    RUN_TEST(test_reboot_restores_waiting_records);
+    RUN_TEST(test_log_wraps_and_keeps_live_records);
+    RUN_TEST(test_receiver_suppresses_duplicates_and_sender_expires);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_replays_by_priority_at_the_rate_limit);
+    RUN_TEST(test_ack_retires_and_unacked_back_off);
+    RUN_TEST(test_reboot_restores_waiting_records);
+    RUN_TEST(test_log_wraps_and_keeps_live_records);
+    RUN_TEST(test_receiver_suppresses_duplicates_and_sender_expires);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,305 @@
+// Unit test for mesh time synchronization (offset, error bound, skew, monotonic clock)
+#include <unity.h>
+#include <string.h>
+#include "../../include/mesh_time_sync.h"
+
+// Local clocks in terms of true time: base + t, running ppm fast
+struct TestClock {
+    uint32_t base;
+    int32_t ppm;
+
+    uint32_t at(uint32_t trueMs) const {
+        return base + trueMs + (uint32_t)((int64_t)trueMs * ppm / 1000000);
+    }
+};
+
+MeshTimeSync* master;   // Node 1
+MeshTimeSync* child;    // Node 2, parent is node 1
+MeshTimeSync* grandchild;   // Node 3, parent is node 2
+
+TestClock masterClock;
+TestClock childClock;
+TestClock grandchildClock;
+
+// One exchange starting at true time t: the request takes up ms, the parent
+// answers after hold ms and the response takes down ms to come back
+static bool exchange(MeshTimeSync* node, uint32_t nodeId, const TestClock& nodeClock,
+                     MeshTimeSync* parent, uint32_t parentId, const TestClock& parentClock,
+                     uint32_t t, uint32_t up, uint32_t hold, uint32_t down) {
+    uint8_t request[MeshTimeSync::MAX_MESSAGE];
+    uint8_t response[MeshTimeSync::MAX_MESSAGE];
+    size_t requestLen, responseLen;
+    uint32_t dest;
+
+    if (!node->nextRequest(nodeClock.at(t), &dest, request, sizeof(request), &requestLen) || dest != parentId ||
+        !parent->receive(nodeId, 0, parentClock.at(t + up), request, requestLen,
+                         response, sizeof(response), &responseLen)) {
+        return false;
+    }
+    uint32_t t3 = parent->toMesh(parentClock.at(t + up + hold));
+    return node->receive(parentId, t3, nodeClock.at(t + up + hold + down), response, responseLen,
+                         nullptr, 0, nullptr);
+}
+
+// Signed distance between a node's mesh time and the master's clock at true time t
+static int32_t meshError(MeshTimeSync* node, const TestClock& nodeClock, uint32_t t) {
+    return (int32_t)(node->toMesh(nodeClock.at(t)) - master->toMesh(masterClock.at(t)));
+}
+
+void setUp() {
+    masterClock = {3600000, 0};
+    childClock = {1000, 0};
+    grandchildClock = {7000000, 0};
+
+    master = new MeshTimeSync();
+    master->setSelf(1);
+    master->setUpstream(1, 0, masterClock.at(0));
+
+    child = new MeshTimeSync();
+    child->setSelf(2);
+    child->setUpstream(1, 1, childClock.at(0));
+
+    grandchild = new MeshTimeSync();
+    grandchild->setSelf(3);
+    grandchild->setUpstream(1, 2, grandchildClock.at(0));
+}
+
+void tearDown() {
+    delete master;
+    delete child;
+    delete grandchild;
+}
+
+void test_master_defines_time() {
+    uint32_t meshMs, errorMs;
+    uint8_t request[MeshTimeSync::MAX_MESSAGE];
+    size_t requestLen;
+    uint32_t dest;
+
+    TEST_ASSERT_TRUE(master->now(masterClock.at(500), &meshMs, &errorMs));
+    TEST_ASSERT_EQUAL(masterClock.at(500), meshMs);
+    TEST_ASSERT_EQUAL(0, errorMs);
+    TEST_ASSERT_FALSE(master->nextRequest(masterClock.at(500), &dest, request, sizeof(request), &requestLen));
+    TEST_ASSERT_EQUAL(0, master->getStats(0).stratum);
+
+    // Until it hears from its parent a node runs on its own clock and says so
+    TEST_ASSERT_FALSE(child->now(childClock.at(500), &meshMs, &errorMs));
+    TEST_ASSERT_EQUAL(childClock.at(500), meshMs);
+    TEST_ASSERT_EQUAL(UINT32_MAX, errorMs);
+}
+
+void test_exchange_estimates_offset() {
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, 1000, 10, 3, 10));
+
+    uint32_t meshMs, errorMs;
+    TEST_ASSERT_TRUE(child->now(childClock.at(1100), &meshMs, &errorMs));
+    TEST_ASSERT_INT_WITHIN(1, masterClock.at(1100), meshMs);
+    TEST_ASSERT_TRUE(errorMs >= 10 && errorMs <= 14);
+
+    MeshTimeStats stats = child->getStats(childClock.at(1100));
+    TEST_ASSERT_EQUAL(1, stats.stratum);
+    TEST_ASSERT_EQUAL(20, stats.delayMs);
+    TEST_ASSERT_EQUAL(1, stats.samples);
+
+    // The next poll waits for the fast interval
+    uint8_t request[MeshTimeSync::MAX_MESSAGE];
+    size_t requestLen;
+    uint32_t dest;
+    TEST_ASSERT_FALSE(child->nextRequest(childClock.at(1500), &dest, request, sizeof(request), &requestLen));
+    TEST_ASSERT_TRUE(child->nextRequest(childClock.at(1000 + MESH_TIME_FAST_POLL_MS), &dest, request,
+                                        sizeof(request), &requestLen));
+}
+
+void test_asymmetric_path_stays_within_bound() {
+    // Up 40 ms, down 2 ms: the estimate is off by half the difference, which the bound covers
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, 1000, 40, 1, 2));
+    int32_t error = meshError(child, childClock, 1100);
+    TEST_ASSERT_INT_WITHIN(2, 19, error < 0 ? -error : error);
+    TEST_ASSERT_TRUE((uint32_t)(error < 0 ? -error : error) <= child->getErrorMs(childClock.at(1100)));
+
+    // A quicker exchange later replaces it
+    uint32_t t = 1000 + MESH_TIME_FAST_POLL_MS;
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, t, 3, 1, 3));
+    TEST_ASSERT_INT_WITHIN(1, 0, meshError(child, childClock, t + 100));
+    TEST_ASSERT_EQUAL(6, child->getStats(childClock.at(t)).delayMs);
+}
+
+void test_bounds_accumulate_down_the_tree() {
+    // The grandchild's parent has nothing to offer until it is synced itself
+    TEST_ASSERT_FALSE(exchange(grandchild, 3, grandchildClock, child, 2, childClock, 500, 5, 1, 5));
+    TEST_ASSERT_EQUAL(1, grandchild->getStats(0).rejected);
+
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, 1000, 5, 1, 5));
+    TEST_ASSERT_TRUE(exchange(grandchild, 3, grandchildClock, child, 2, childClock,
+                              500 + MESH_TIME_FAST_POLL_MS, 5, 1, 5));
+
+    uint32_t t = 600 + MESH_TIME_FAST_POLL_MS;
+    TEST_ASSERT_INT_WITHIN(2, 0, meshError(grandchild, grandchildClock, t));
+    TEST_ASSERT_EQUAL(2, grandchild->getStats(grandchildClock.at(t)).stratum);
+    TEST_ASSERT_TRUE(grandchild->getErrorMs(grandchildClock.at(t)) > child->getErrorMs(childClock.at(t)));
+}
+
+void test_rejects_unexpected_responses() {
+    uint8_t request[MeshTimeSync::MAX_MESSAGE];
+    uint8_t response[MeshTimeSync::MAX_MESSAGE];
+    size_t requestLen, responseLen;
+    uint32_t dest;
+
+    TEST_ASSERT_TRUE(child->nextRequest(childClock.at(1000), &dest, request, sizeof(request), &requestLen));
+    TEST_ASSERT_TRUE(master->receive(2, 0, masterClock.at(1005), request, requestLen,
+                                     response, sizeof(response), &responseLen));
+    uint32_t t3 = masterClock.at(1006);
+
+    // From a node we did not ask
+    TEST_ASSERT_FALSE(child->receive(5, t3, childClock.at(1010), response, responseLen, nullptr, 0, nullptr));
+
+    // Answering a different request
+    response[1] ^= 0x01;
+    TEST_ASSERT_FALSE(child->receive(1, t3, childClock.at(1010), response, responseLen, nullptr, 0, nullptr));
+    response[1] ^= 0x01;
+
+    // Rooted at another master
+    response[9] = 9;
+    TEST_ASSERT_FALSE(child->receive(1, t3, childClock.at(1010), response, responseLen, nullptr, 0, nullptr));
+    TEST_ASSERT_EQUAL(3, child->getStats(0).rejected);
+    TEST_ASSERT_FALSE(child->getStats(0).synced);
+
+    // Far too slow to be worth anything
+    uint32_t t = 1000 + MESH_TIME_FAST_POLL_MS;
+    TEST_ASSERT_FALSE(exchange(child, 2, childClock, master, 1, masterClock, t, MESH_TIME_MAX_DELAY_MS, 1, 5));
+    TEST_ASSERT_EQUAL(4, child->getStats(0).rejected);
+
+    // Stamped as sent after it arrived, as a rewritten t3 would be: a negative round trip
+    t += MESH_TIME_FAST_POLL_MS;
+    TEST_ASSERT_TRUE(child->nextRequest(childClock.at(t), &dest, request, sizeof(request), &requestLen));
+    TEST_ASSERT_TRUE(master->receive(2, 0, masterClock.at(t + 5), request, requestLen,
+                                     response, sizeof(response), &responseLen));
+    TEST_ASSERT_FALSE(child->receive(1, masterClock.at(t + 500), childClock.at(t + 10), response, responseLen,
+                                     nullptr, 0, nullptr));
+    TEST_ASSERT_EQUAL(5, child->getStats(0).rejected);
+    TEST_ASSERT_FALSE(child->getStats(0).synced);
+
+    // Truncated messages are refused outright
+    TEST_ASSERT_FALSE(master->receive(2, 0, 0, request, requestLen - 1, response, sizeof(response), &responseLen));
+}
+
+void test_clock_never_runs_backwards() {
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, 1000, 5, 1, 5));
+    uint32_t t = 1000 + MESH_TIME_FAST_POLL_MS;
+    uint32_t before;
+    child->now(childClock.at(t + 15), &before);
+
+    // The master's clock is really 50 ms behind where we put it: hold, then resume
+    masterClock.base -= 50;
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, t, 5, 1, 5));
+    uint32_t held, errorMs;
+    child->now(childClock.at(t + 20), &held, &errorMs);
+    TEST_ASSERT_TRUE((int32_t)(held - before) >= 0);
+    TEST_ASSERT_TRUE(errorMs > 50);
+    TEST_ASSERT_EQUAL(0, child->getStats(0).steps);
+
+    // A jump beyond MESH_TIME_MAX_HOLD_MS is taken and counted
+    masterClock.base -= MESH_TIME_FAST_POLL_MS + 2 * MESH_TIME_MAX_HOLD_MS;
+    t += MESH_TIME_FAST_POLL_MS;
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, t, 5, 1, 5));
+    uint32_t stepped;
+    child->now(childClock.at(t + 20), &stepped);
+    TEST_ASSERT_INT_WITHIN(1, masterClock.at(t + 20), stepped);
+    TEST_ASSERT_EQUAL(1, child->getStats(0).steps);
+}
+
+void test_skew_is_measured_and_corrected() {
+    // Our crystal runs 200 ppm fast
+    childClock.ppm = 200;
+    uint32_t t = 1000;
+    for (int i = 0; i < 24; i++) {
+        exchange(child, 2, childClock, master, 1, masterClock, t, 4, 1, 4);
+        t += MESH_TIME_POLL_MS;
+    }
+
+    MeshTimeStats stats = child->getStats(childClock.at(t));
+    TEST_ASSERT_INT_WITHIN(40000, -200000, stats.skewPpb);
+
+    // Five minutes without an exchange: uncorrected this would be 60 ms out
+    TEST_ASSERT_INT_WITHIN(15, 0, meshError(child, childClock, t + 300000));
+    int32_t error = meshError(child, childClock, t + 300000);
+    TEST_ASSERT_TRUE((uint32_t)(error < 0 ? -error : error) <= child->getErrorMs(childClock.at(t + 300000)));
+}
+
+void test_new_master_keeps_mesh_time() {
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, 1000, 5, 1, 5));
+    uint32_t before = child->toMesh(childClock.at(5000));
+
+    // Node 1 leaves and node 2 takes over: its mesh clock carries on from where it was
+    child->setUpstream(2, 0, childClock.at(5000));
+    uint32_t after, errorMs;
+    TEST_ASSERT_TRUE(child->now(childClock.at(5000), &after, &errorMs));
+    TEST_ASSERT_EQUAL(before, after);
+    TEST_ASSERT_EQUAL(0, errorMs);
+    TEST_ASSERT_EQUAL(1, child->getStats(0).masterChanges);
+
+    // Answers now name the new master
+    grandchild->setUpstream(2, 2, grandchildClock.at(5000));
+    TEST_ASSERT_TRUE(exchange(grandchild, 3, grandchildClock, child, 2, childClock, 6000, 5, 1, 5));
+    TEST_ASSERT_EQUAL(2, grandchild->getStats(grandchildClock.at(6100)).master);
+    TEST_ASSERT_EQUAL(1, grandchild->getStats(grandchildClock.at(6100)).stratum);
+}
+
+void test_adopts_lower_master_from_parent() {
+    TEST_ASSERT_TRUE(exchange(child, 2, childClock, master, 1, masterClock, 1000, 5, 1, 5));
+
+    // The grandchild's peer table lost node 1, so it believes in node 9 reached through node 2
+    grandchild->setUpstream(9, 2, grandchildClock.at(1500));
+    TEST_ASSERT_TRUE(exchange(grandchild, 3, grandchildClock, child, 2, childClock, 2000, 5, 1, 5));
+    MeshTimeStats stats = grandchild->getStats(grandchildClock.at(2100));
+    TEST_ASSERT_EQUAL(1, stats.master);
+    TEST_ASSERT_EQUAL(2, stats.parent);
+    TEST_ASSERT_EQUAL(2, stats.stratum);
+    TEST_ASSERT_INT_WITHIN(2, 0, meshError(grandchild, grandchildClock, 2100));
+
+    // Its own view no longer overrides what it heard...
+    grandchild->setUpstream(9, 4, grandchildClock.at(3000));
+    TEST_ASSERT_EQUAL(1, grandchild->getStats(0).master);
+
+    // ...until node 1 has gone unconfirmed for MESH_TIME_MASTER_TIMEOUT_MS
+    grandchild->setUpstream(9, 4, grandchildClock.at(2100 + MESH_TIME_MASTER_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL(9, grandchild->getStats(0).master);
+    TEST_ASSERT_EQUAL(4, grandchild->getStats(0).parent);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_master_defines_time);
+    RUN_TEST(test_exchange_estimates_offset);
+    RUN_TEST(test_asymmetric_path_stays_within_bound);
+    RUN_TEST(test_bounds_accumulate_down_the_tree);
+    RUN_TEST(test_rejects_unexpected_responses);
+    RUN_TEST(test_clock_never_runs_backwards);
+    RUN_TEST(test_skew_is_measured_and_corrected);
+    RUN_TEST(test_new_master_keeps_mesh_time);
+    RUN_TEST(test_adopts_lower_master_from_parent);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_master_defines_time);
+    RUN_TEST(test_exchange_estimates_offset);
+    RUN_TEST(test_asymmetric_path_stays_within_bound);
+    RUN_TEST(test_bounds_accumulate_down_the_tree);
+    RUN_TEST(test_rejects_unexpected_responses);
+    RUN_TEST(test_clock_never_runs_backwards);
+    RUN_TEST(test_skew_is_measured_and_corrected);
+    RUN_TEST(test_new_master_keeps_mesh_time);
+    RUN_TEST(test_adopts_lower_master_from_parent);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,287 @@
+// Unit test for the mesh topology graph and next-hop cache
+#include <unity.h>
+#include "../../include/mesh_topology.h"
+
+MeshTopology* topology;
+
+// Builds the advert a remote node would broadcast (clean links unless costs are given)
+static size_t makeAdvert(uint8_t* out, uint16_t version, const uint32_t* links, uint8_t count,
+                         const uint8_t* costs = nullptr) {
+    out[0] = (uint8_t)version;
+    out[1] = (uint8_t)(version >> 8);
+    out[2] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        for (int b = 0; b < 4; b++) {
+            out[3 + i * 5 + b] = (uint8_t)(links[i] >> (8 * b));
+        }
+        out[3 + i * 5 + 4] = costs ? costs[i] : MESH_LINK_COST_UNIT;
+    }
+    return 3 + count * 5;
+}
+
+static void applyAdvert(uint32_t origin, uint16_t version, const uint32_t* links, uint8_t count,
+                        const uint8_t* costs = nullptr) {
+    uint8_t advert[MeshTopology::MAX_ADVERT_SIZE];
+    size_t len = makeAdvert(advert, version, links, count, costs);
+    TEST_ASSERT_TRUE(topology->applyLinkState(origin, advert, len, 1000));
+}
+
+void setUp() {
+    topology = new MeshTopology();
+    topology->setSelf(1);
+}
+
+void tearDown() {
+    delete topology;
+}
+
+void test_direct_neighbors_are_one_hop() {
+    TEST_ASSERT_TRUE(topology->addLink(2, 0));
+    TEST_ASSERT_FALSE(topology->addLink(2, 0));
+
+    TEST_ASSERT_EQUAL(0, topology->getHopDistance(1));
+    TEST_ASSERT_EQUAL(1, topology->getHopDistance(2));
+    TEST_ASSERT_EQUAL(2, topology->getNextHop(2));
+    TEST_ASSERT_EQUAL(MeshTopology::UNREACHABLE, topology->getHopDistance(99));
+    TEST_ASSERT_EQUAL(0, topology->getNextHop(99));
+    TEST_ASSERT_EQUAL(1, topology->getReachableCount());
+}
+
+void test_line_routes_through_first_hop() {
+    // 1 - 2 - 3 - 4
+    topology->addLink(2, 0);
+    const uint32_t links2[] = {1, 3};
+    const uint32_t links3[] = {2, 4};
+    applyAdvert(2, 1, links2, 2);
+    applyAdvert(3, 1, links3, 2);
+
+    TEST_ASSERT_EQUAL(2, topology->getHopDistance(3));
+    TEST_ASSERT_EQUAL(3, topology->getHopDistance(4));
+    TEST_ASSERT_EQUAL(2, topology->getNextHop(4));
+    TEST_ASSERT_EQUAL(3, topology->getReachableCount());
+}
+
+void test_shortest_path_wins() {
+    // 1 - 2 - 3 - 4 and a shortcut 1 - 5 - 4
+    topology->addLink(2, 0);
+    topology->addLink(5, 0);
+    const uint32_t links2[] = {1, 3};
+    const uint32_t links3[] = {2, 4};
+    const uint32_t links5[] = {1, 4};
+    applyAdvert(2, 1, links2, 2);
+    applyAdvert(3, 1, links3, 2);
+    applyAdvert(5, 1, links5, 2);
+
+    TEST_ASSERT_EQUAL(2, topology->getHopDistance(4));
+    TEST_ASSERT_EQUAL(5, topology->getNextHop(4));
+
+    // Shortcut goes away: route falls back to the long way
+    topology->removeLink(5);
+    TEST_ASSERT_EQUAL(3, topology->getHopDistance(4));
+    TEST_ASSERT_EQUAL(2, topology->getNextHop(4));
+}
+
+void test_costly_links_are_routed_around() {
+    // 1 - 2 - 4 and a longer way 1 - 5 - 6 - 4
+    topology->addLink(2, 0);
+    topology->addLink(5, 0);
+    const uint32_t links2[] = {1, 4};
+    const uint32_t links5[] = {1, 6};
+    const uint32_t links6[] = {5, 4};
+    applyAdvert(2, 1, links2, 2);
+    applyAdvert(5, 1, links5, 2);
+    applyAdvert(6, 1, links6, 2);
+
+    TEST_ASSERT_EQUAL(2, topology->getNextHop(4));
+    TEST_ASSERT_EQUAL(2 * MESH_LINK_COST_UNIT, topology->getPathCost(4));
+
+    // Our link to 2 degrades: one more hop over clean links is cheaper
+    TEST_ASSERT_TRUE(topology->setLinkCost(2, 5 * MESH_LINK_COST_UNIT));
+    TEST_ASSERT_FALSE(topology->setLinkCost(2, 5 * MESH_LINK_COST_UNIT));
+    TEST_ASSERT_EQUAL(5, topology->getNextHop(4));
+    TEST_ASSERT_EQUAL(3, topology->getHopDistance(4));
+    TEST_ASSERT_EQUAL(3 * MESH_LINK_COST_UNIT, topology->getPathCost(4));
+    // Even 2 itself is cheaper the long way round
+    TEST_ASSERT_EQUAL(4 * MESH_LINK_COST_UNIT, topology->getPathCost(2));
+
+    // A remote end's worse view of a link counts: 6 reports its link to 5 as lossy
+    const uint8_t costs6[] = {10 * MESH_LINK_COST_UNIT, MESH_LINK_COST_UNIT};
+    applyAdvert(6, 2, links6, 2, costs6);
+    TEST_ASSERT_EQUAL(2, topology->getNextHop(4));
+    TEST_ASSERT_EQUAL(6 * MESH_LINK_COST_UNIT, topology->getPathCost(4));
+
+    // Our cost goes out in our advert; for its own links the remote end trusts its own probes
+    uint8_t advert[MeshTopology::MAX_ADVERT_SIZE];
+    size_t len;
+    TEST_ASSERT_TRUE(topology->encodeLinkState(advert, sizeof(advert), &len));
+    MeshTopology remote;
+    remote.setSelf(2);
+    remote.addLink(1, 0);
+    TEST_ASSERT_TRUE(remote.applyLinkState(1, advert, len, 0));
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT, remote.getPathCost(1));
+    TEST_ASSERT_EQUAL(2 * MESH_LINK_COST_UNIT, remote.getPathCost(5));
+    TEST_ASSERT_EQUAL(MeshTopology::NO_PATH, remote.getPathCost(99));
+
+    MeshRouteEntry routes[4];
+    TEST_ASSERT_EQUAL(2, remote.getNodesWithin(1, routes, 4));
+    TEST_ASSERT_EQUAL(MESH_LINK_COST_UNIT, routes[1].cost);
+}
+
+void test_recompute_only_on_deltas() {
+    topology->addLink(2, 0);
+    const uint32_t links2[] = {1, 3};
+    applyAdvert(2, 1, links2, 2);
+
+    topology->getHopDistance(3);
+    uint32_t recomputes = topology->getStats().recomputes;
+
+    // Queries and identical refreshes reuse the cache
+    topology->getHopDistance(3);
+    topology->getNextHop(3);
+    applyAdvert(2, 1, links2, 2);
+    topology->getHopDistance(3);
+    TEST_ASSERT_EQUAL(recomputes, topology->getStats().recomputes);
+
+    // A changed advert triggers exactly one rebuild however many queries follow
+    const uint32_t changed[] = {1, 3, 4};
+    applyAdvert(2, 2, changed, 3);
+    topology->getHopDistance(3);
+    topology->getHopDistance(4);
+    TEST_ASSERT_EQUAL(recomputes + 1, topology->getStats().recomputes);
+}
+
+void test_advert_roundtrip_and_malformed() {
+    topology->addLink(7, 0);
+    topology->addLink(8, 0);
+
+    uint8_t advert[MeshTopology::MAX_ADVERT_SIZE];
+    size_t len;
+    TEST_ASSERT_TRUE(topology->encodeLinkState(advert, sizeof(advert), &len));
+    TEST_ASSERT_EQUAL(3 + 2 * 5, len);
+
+    MeshTopology remote;
+    remote.setSelf(9);
+    remote.addLink(7, 0);
+    TEST_ASSERT_TRUE(remote.applyLinkState(1, advert, len, 0));
+    TEST_ASSERT_EQUAL(2, remote.getHopDistance(1));
+    TEST_ASSERT_EQUAL(3, remote.getHopDistance(8));
+
+    // Length must match the declared link count
+    TEST_ASSERT_FALSE(remote.applyLinkState(1, advert, len - 1, 0));
+    TEST_ASSERT_FALSE(remote.applyLinkState(9, advert, len, 0));
+}
+
+void test_stale_nodes_expire() {
+    topology->addLink(2, 0);
+    const uint32_t links3[] = {2};
+    applyAdvert(3, 1, links3, 1);
+    TEST_ASSERT_EQUAL(2, topology->getHopDistance(3));
+
+    topology->expire(1000 + MESH_LINK_STATE_MAX_AGE_MS);
+    TEST_ASSERT_EQUAL(MeshTopology::UNREACHABLE, topology->getHopDistance(3));
+    // Direct neighbours stay while connected
+    TEST_ASSERT_EQUAL(1, topology->getHopDistance(2));
+}
+
+void test_memory_is_bounded() {
+    topology->addLink(2, 0);
+    for (uint32_t origin = 100; origin < 100 + 4 * MESH_TOPOLOGY_MAX_NODES; origin++) {
+        const uint32_t links[] = {2};
+        uint8_t advert[MeshTopology::MAX_ADVERT_SIZE];
+        size_t len = makeAdvert(advert, 1, links, 1);
+        topology->applyLinkState(origin, advert, len, origin);
+    }
+
+    TEST_ASSERT_EQUAL(MESH_TOPOLOGY_MAX_NODES - 1, topology->getReachableCount());
+    TEST_ASSERT_EQUAL(1, topology->getHopDistance(2));
+    TEST_ASSERT_TRUE(topology->getStats().evictions > 0);
+}
+
+void test_full_graph_keeps_nearest_nodes() {
+    topology->addLink(2, 0);
+    for (uint32_t origin = 100; origin < 100 + MESH_TOPOLOGY_MAX_NODES - 2; origin++) {
+        const uint32_t links[] = {2};
+        applyAdvert(origin, 1, links, 1);
+    }
+    TEST_ASSERT_EQUAL(MESH_TOPOLOGY_MAX_NODES - 1, topology->getReachableCount());
+
+    // Nothing held leads to this one, so it may not push out a node we can route to
+    const uint32_t farLinks[] = {5000};
+    uint8_t advert[MeshTopology::MAX_ADVERT_SIZE];
+    size_t len = makeAdvert(advert, 1, farLinks, 1);
+    TEST_ASSERT_FALSE(topology->applyLinkState(900, advert, len, 2000));
+    TEST_ASSERT_EQUAL(MeshTopology::UNREACHABLE, topology->getHopDistance(900));
+
+    // One as near as those held takes the stalest slot
+    const uint32_t nearLinks[] = {2};
+    applyAdvert(901, 1, nearLinks, 1);
+    TEST_ASSERT_EQUAL(2, topology->getHopDistance(901));
+    TEST_ASSERT_EQUAL(MESH_TOPOLOGY_MAX_NODES - 1, topology->getReachableCount());
+}
+
+void test_load_aware_queries() {
+    topology->addLink(2, 0);
+    topology->addLink(3, 0);
+    const uint32_t links3[] = {1, 4};
+    applyAdvert(3, 1, links3, 2);
+
+    topology->setLoad(1, 200);
+    topology->setLoad(2, 50);
+    topology->setLoad(3, 50);
+    topology->setLoad(4, 10);
+
+    // Least loaded within reach; ties go to the closer node
+    TEST_ASSERT_EQUAL(4, topology->findLeastLoaded(2, true));
+    TEST_ASSERT_EQUAL(2, topology->findLeastLoaded(1, true));
+    TEST_ASSERT_FALSE(topology->setLoad(99, 1));
+
+    MeshRouteEntry routes[8];
+    size_t count = topology->getNodesWithin(1, routes, 8);
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL(1, routes[0].nodeId);
+    TEST_ASSERT_EQUAL(0, routes[0].hops);
+    TEST_ASSERT_EQUAL(1, routes[1].hops);
+
+    count = topology->getNodesWithin(2, routes, 8);
+    TEST_ASSERT_EQUAL(4, count);
+    TEST_ASSERT_EQUAL(4, routes[3].nodeId);
+    TEST_ASSERT_EQUAL(3, routes[3].nextHop);
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_direct_neighbors_are_one_hop);
+    RUN_TEST(test_line_routes_through_first_hop);
+    RUN_TEST(test_shortest_path_wins);
+    RUN_TEST(test_costly_links_are_routed_around);
+    RUN_TEST(test_recompute_only_on_deltas);
+    RUN_TEST(test_advert_roundtrip_and_malformed);
+    RUN_TEST(test_stale_nodes_expire);
+    RUN_TEST(test_memory_is_bounded);
+    RUN_TEST(test_full_graph_keeps_nearest_nodes);
+    RUN_TEST(test_load_aware_queries);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_direct_neighbors_are_one_hop);
+    RUN_TEST(test_line_routes_through_first_hop);
+    RUN_TEST(test_shortest_path_wins);
+    RUN_TEST(test_costly_links_are_routed_around);
+    RUN_TEST(test_recompute_only_on_deltas);
+    RUN_TEST(test_advert_roundtrip_and_malformed);
+    RUN_TEST(test_stale_nodes_expire);
+    RUN_TEST(test_memory_is_bounded);
+    RUN_TEST(test_full_graph_keeps_nearest_nodes);
+    RUN_TEST(test_load_aware_queries);
+    return UNITY_END();
+}
+#endif
@@ -1,6 +1,7 @@
 #include <unity.h>
 #include "secure_key_manager.h"
 #include "hmac_handler.h"
+#include <mbedtls/md.h>
 
 SecureKeyManager* keyManager = nullptr;
 HMACHandler* hmacHandler = nullptr;
@@ -164,6 +165,7 @@ void test_hmac_append_and_verify() {
         (const uint8_t*)originalMessage,
         originalLen,
         signedMessage,
+        sizeof(signedMessage),
         &signedLen
     ));
     
@@ -204,6 +206,7 @@ void test_hmac_tampered_message() {
         (const uint8_t*)originalMessage,
         originalLen,
         signedMessage,
+        sizeof(signedMessage),
         &signedLen
     ));
     
@@ -242,6 +245,7 @@ void test_hmac_replay_attack_prevention() {
         (const uint8_t*)message,
         messageLen,
         signedMessage,
+        sizeof(signedMessage),
         &signedLen
     ));
     
@@ -271,6 +275,183 @@ void test_hmac_replay_attack_prevention() {
     delete keyManager;
 }
 
+void test_hmac_seal_in_place_and_segments() {
+    keyManager = new SecureKeyManager();
+    keyManager->begin();
+    hmacHandler = new HMACHandler(keyManager);
+    hmacHandler->begin();
+    
+    const char* header = "HDR:";
+    const char* body = "payload split across two buffers";
+    uint8_t buffer[128];
+    size_t messageLen = strlen(header) + strlen(body);
+    memcpy(buffer, header, strlen(header));
+    memcpy(buffer + strlen(header), body, strlen(body));
+    
+    // No tail room, then exactly enough
+    size_t sealedLen;
+    TEST_ASSERT_FALSE(hmacHandler->seal(buffer, messageLen, messageLen + HMACHandler::OVERHEAD - 1, &sealedLen));
+    TEST_ASSERT_TRUE(hmacHandler->seal(buffer, messageLen, messageLen + HMACHandler::OVERHEAD, &sealedLen));
+    TEST_ASSERT_EQUAL(messageLen + HMACHandler::OVERHEAD, sealedLen);
+    
+    size_t openedLen;
+    TEST_ASSERT_TRUE(hmacHandler->unseal(buffer, sealedLen, &openedLen));
+    TEST_ASSERT_EQUAL(messageLen, openedLen);
+    TEST_ASSERT_FALSE(hmacHandler->unseal(buffer, sealedLen, &openedLen)); // Replay
+    
+    // The same bytes signed from two segments verify as one sealed message
+    HMACSegment segments[2] = {
+        {(const uint8_t*)header, strlen(header)},
+        {(const uint8_t*)body, strlen(body)}
+    };
+    uint8_t trailer[HMACHandler::OVERHEAD];
+    size_t trailerLen;
+    TEST_ASSERT_TRUE(hmacHandler->sealSegments(segments, 2, trailer, sizeof(trailer), &trailerLen));
+    TEST_ASSERT_EQUAL(HMACHandler::OVERHEAD, trailerLen);
+    memcpy(buffer + messageLen, trailer, trailerLen);
+    TEST_ASSERT_TRUE(hmacHandler->unseal(buffer, messageLen + trailerLen, &openedLen));
+    
+    TEST_ASSERT_TRUE(hmacHandler->sealSegments(segments, 2, trailer, sizeof(trailer), &trailerLen));
+    segments[1].len--;
+    TEST_ASSERT_FALSE(hmacHandler->verifySegments(segments, 2, trailer, trailerLen));
+    segments[1].len++;
+    TEST_ASSERT_TRUE(hmacHandler->verifySegments(segments, 2, trailer, trailerLen));
+    
+    // appendHMAC refuses an output without room for the trailer
+    uint8_t small[HMACHandler::OVERHEAD + 4];
+    size_t smallLen;
+    TEST_ASSERT_FALSE(hmacHandler->appendHMAC((const uint8_t*)body, 5, small, sizeof(small), &smallLen));
+    TEST_ASSERT_TRUE(hmacHandler->appendHMAC((const uint8_t*)body, 4, small, sizeof(small), &smallLen));
+    
+    delete hmacHandler;
+    delete keyManager;
+}
+
+void test_hmac_sequenced_replay_tracking() {
+    keyManager = new SecureKeyManager();
+    keyManager->begin();
+    hmacHandler = new HMACHandler(keyManager);
+    hmacHandler->begin();
+    
+    // Sender and sequence number travel in the signed header
+    uint8_t frames[3][64];
+    size_t frameLens[3];
+    for (uint32_t seq = 0; seq < 3; seq++) {
+        uint32_t header[2] = {0xA1B2C3D4, seq + 1};
+        memcpy(frames[seq], header, sizeof(header));
+        TEST_ASSERT_TRUE(hmacHandler->seal(frames[seq], sizeof(header), sizeof(frames[seq]), &frameLens[seq]));
+    }
+    
+    // Out of order is fine, each frame once
+    size_t openedLen;
+    TEST_ASSERT_TRUE(hmacHandler->unsealSequenced(0xA1B2C3D4, 3, frames[2], frameLens[2], &openedLen));
+    TEST_ASSERT_TRUE(hmacHandler->unsealSequenced(0xA1B2C3D4, 1, frames[0], frameLens[0], &openedLen));
+    TEST_ASSERT_FALSE(hmacHandler->unsealSequenced(0xA1B2C3D4, 1, frames[0], frameLens[0], &openedLen));
+    TEST_ASSERT_TRUE(hmacHandler->unsealSequenced(0xA1B2C3D4, 2, frames[1], frameLens[1], &openedLen));
+    TEST_ASSERT_FALSE(hmacHandler->unsealSequenced(0xA1B2C3D4, 3, frames[2], frameLens[2], &openedLen));
+    
+    // A forged frame is not recorded, so it cannot block the genuine one
+    uint8_t frame[64];
+    size_t frameLen;
+    uint32_t header[2] = {0xA1B2C3D4, 4};
+    memcpy(frame, header, sizeof(header));
+    TEST_ASSERT_TRUE(hmacHandler->seal(frame, sizeof(header), sizeof(frame), &frameLen));
+    frame[frameLen - 1] ^= 0x01;
+    TEST_ASSERT_FALSE(hmacHandler->unsealSequenced(0xA1B2C3D4, 4, frame, frameLen, &openedLen));
+    frame[frameLen - 1] ^= 0x01;
+    TEST_ASSERT_TRUE(hmacHandler->unsealSequenced(0xA1B2C3D4, 4, frame, frameLen, &openedLen));
+    
+    HMACReplayStats stats = hmacHandler->getReplayStats();
+    TEST_ASSERT_EQUAL(4, stats.accepted);
+    TEST_ASSERT_EQUAL(2, stats.duplicate);
+    TEST_ASSERT_EQUAL(1, stats.peers);
+    TEST_ASSERT_TRUE(stats.memoryBytes <= HMAC_REPLAY_MEMORY_LIMIT);
+    
+    delete hmacHandler;
+    delete keyManager;
+}
+
+void test_hmac_midstates_match_reference() {
+    keyManager = new SecureKeyManager();
+    keyManager->begin();
+    hmacHandler = new HMACHandler(keyManager);
+    hmacHandler->begin();
+    
+    uint8_t key[32];
+    TEST_ASSERT_TRUE(keyManager->getHMACKey(key, sizeof(key)));
+    const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    
+    // Lengths either side of the SHA-256 block and padding boundaries
+    const size_t lengths[] = {0, 1, 47, 48, 55, 56, 64, 119, 120, 200};
+    uint8_t buffer[256];
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        size_t messageLen = lengths[i];
+        for (size_t j = 0; j < messageLen; j++) {
+            buffer[j] = (uint8_t)(j * 13 + messageLen);
+        }
+        
+        size_t sealedLen;
+        TEST_ASSERT_TRUE(hmacHandler->seal(buffer, messageLen, sizeof(buffer), &sealedLen));
+        
+        // The trailer tag is HMAC(key, payload + timestamp + nonce)
+        uint8_t expected[HMACHandler::HMAC_SIZE];
+        TEST_ASSERT_EQUAL(0, mbedtls_md_hmac(md_info, key, sizeof(key), buffer,
+                                             messageLen + HMACHandler::TIMESTAMP_SIZE + HMACHandler::NONCE_SIZE,
+                                             expected));
+        TEST_ASSERT_EQUAL_MEMORY(expected, buffer + sealedLen - HMACHandler::HMAC_SIZE, HMACHandler::HMAC_SIZE);
+    }
+    
+    // Rebuilding the midstates for the same key changes nothing
+    TEST_ASSERT_TRUE(hmacHandler->reloadKey());
+    size_t sealedLen;
+    size_t openedLen;
+    TEST_ASSERT_TRUE(hmacHandler->seal(buffer, 10, sizeof(buffer), &sealedLen));
+    TEST_ASSERT_TRUE(hmacHandler->unseal(buffer, sealedLen, &openedLen));
+    
+    memset(key, 0, sizeof(key));
+    delete hmacHandler;
+    delete keyManager;
+}
+
+void test_hmac_verify_many() {
+    keyManager = new SecureKeyManager();
+    keyManager->begin();
+    hmacHandler = new HMACHandler(keyManager);
+    hmacHandler->begin();
+    
+    // A burst of eight frames: one tampered, one a copy of another
+    uint8_t sealed[8][96];
+    HMACFrame frames[8];
+    for (size_t i = 0; i < 8; i++) {
+        size_t messageLen = 16 + i * 4;
+        memset(sealed[i], (int)i, messageLen);
+        TEST_ASSERT_TRUE(hmacHandler->seal(sealed[i], messageLen, sizeof(sealed[i]), &frames[i].sealedLen));
+        frames[i].sealed = sealed[i];
+        frames[i].peer = 0x100 + (uint32_t)(i % 2);
+        frames[i].sequence = (uint32_t)(i / 2);
+        frames[i].sequenced = (i % 4) != 3;
+    }
+    sealed[2][0] ^= 0x01;
+    frames[7] = frames[5];
+    
+    TEST_ASSERT_EQUAL(6, hmacHandler->verifyMany(frames, 8));
+    for (size_t i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL(i != 2 && i != 7, frames[i].verified);
+        if (frames[i].verified) {
+            TEST_ASSERT_EQUAL(frames[i].sealedLen - HMACHandler::OVERHEAD, frames[i].messageLen);
+        }
+    }
+    
+    // The tampered frame never reached the replay filter, so the genuine one still passes
+    sealed[2][0] ^= 0x01;
+    TEST_ASSERT_EQUAL(1, hmacHandler->verifyMany(frames, 3));
+    TEST_ASSERT_TRUE(frames[2].verified);
+    TEST_ASSERT_EQUAL(3, hmacHandler->getReplayStats().duplicate);
+    
+    delete hmacHandler;
+    delete keyManager;
+}
+
 void test_hmac_performance() {
     keyManager = new SecureKeyManager();
     keyManager->begin();
@@ -291,6 +472,7 @@ void test_hmac_performance() {
             (const uint8_t*)message,
             messageLen,
             signedMessage,
+            sizeof(signedMessage),
             &signedLen
         );
     }
@@ -313,6 +495,7 @@ void test_hmac_performance() {
             (const uint8_t*)message,
             messageLen,
             signedMessage,
+            sizeof(signedMessage),
             &signedLen
         );
         
@@ -356,6 +539,10 @@ void setup() {
     RUN_TEST(test_hmac_append_and_verify);
     RUN_TEST(test_hmac_tampered_message);
     RUN_TEST(test_hmac_replay_attack_prevention);
+    RUN_TEST(test_hmac_seal_in_place_and_segments);
+    RUN_TEST(test_hmac_sequenced_replay_tracking);
+    RUN_TEST(test_hmac_midstates_match_reference);
+    RUN_TEST(test_hmac_verify_many);
     RUN_TEST(test_hmac_performance);
     
     UNITY_END();
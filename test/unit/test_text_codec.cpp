@@ -0,0 +1,137 @@
+// Unit test for the hex and base64 codecs
+#include <unity.h>
+#include <string.h>
+#include "../../include/text_codec.h"
+
+static uint8_t data[300];
+static char text[700];
+static uint8_t decoded[300];
+
+void setUp() {
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 167 + 13);
+    }
+}
+
+void tearDown() {
+    TextCodec::setAccelerated(true);
+}
+
+static void checkBase64(const char* plain, const char* expected) {
+    size_t len = strlen(plain);
+    size_t textLen;
+    size_t decodedLen;
+    TEST_ASSERT_TRUE(TextCodec::base64Encode((const uint8_t*)plain, len, text, sizeof(text), &textLen));
+    TEST_ASSERT_EQUAL(strlen(expected), textLen);
+    TEST_ASSERT_EQUAL_STRING(expected, text);
+    TEST_ASSERT_TRUE(TextCodec::base64Decode(text, textLen, decoded, sizeof(decoded), &decodedLen));
+    TEST_ASSERT_EQUAL(len, decodedLen);
+    TEST_ASSERT_EQUAL_MEMORY(plain, decoded, len);
+}
+
+void test_rfc4648_vectors() {
+    checkBase64("", "");
+    checkBase64("f", "Zg==");
+    checkBase64("fo", "Zm8=");
+    checkBase64("foo", "Zm9v");
+    checkBase64("foobar", "Zm9vYmFy");
+    checkBase64("Many hands make light work. Many hands make light work.",
+                "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsuIE1hbnkgaGFuZHMgbWFrZSBsaWdodCB3b3JrLg==");
+
+    const uint8_t bytes[] = {0x00, 0x7F, 0x80, 0xAB, 0xFF};
+    size_t textLen;
+    size_t decodedLen;
+    TEST_ASSERT_TRUE(TextCodec::hexEncode(bytes, sizeof(bytes), text, sizeof(text), &textLen));
+    TEST_ASSERT_EQUAL_STRING("007F80ABFF", text);
+    TEST_ASSERT_TRUE(TextCodec::hexDecode("007f80AbfF", 10, decoded, sizeof(decoded), &decodedLen));
+    TEST_ASSERT_EQUAL(sizeof(bytes), decodedLen);
+    TEST_ASSERT_EQUAL_MEMORY(bytes, decoded, sizeof(bytes));
+}
+
+void test_strict_rejection_and_bounds() {
+    size_t outLen;
+    char small[8];
+
+    // Hex: odd length, bad digits (in the scalar tail and inside a vector block), no room
+    TEST_ASSERT_FALSE(TextCodec::hexDecode("ABC", 3, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::hexDecode("0G", 2, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::hexDecode("0000000000000000000000000000000 00000000", 40, decoded, sizeof(decoded),
+                                           &outLen));
+    TEST_ASSERT_FALSE(TextCodec::hexDecode("0011", 4, decoded, 1, &outLen));
+    TEST_ASSERT_FALSE(TextCodec::hexEncode(data, 4, small, sizeof(small), &outLen));
+    TEST_ASSERT_TRUE(TextCodec::hexEncode(data, 3, small, sizeof(small), &outLen));
+
+    // Base64: length, alphabet, misplaced padding, non-zero pad bits, no room
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zm9", 3, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zm9-", 4, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zg==Zm9v", 8, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Z===", 4, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zh==", 4, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zm9=", 4, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zm9vYmFy Zm9vYmFyZm9vYmF", 24, decoded, sizeof(decoded), &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Decode("Zm9vYmFy", 8, decoded, 5, &outLen));
+    TEST_ASSERT_FALSE(TextCodec::base64Encode(data, 4, small, sizeof(small), &outLen));
+    TEST_ASSERT_TRUE(TextCodec::base64Encode(data, 3, small, sizeof(small), &outLen));
+}
+
+void test_scalar_and_vector_kernels_agree() {
+    static char scalarText[sizeof(text)];
+    size_t textLen;
+    size_t scalarLen;
+    size_t decodedLen;
+
+    for (size_t len = 0; len <= sizeof(data); len += (len < 70 ? 1 : 23)) {
+        TextCodec::setAccelerated(false);
+        TEST_ASSERT_TRUE(TextCodec::hexEncode(data, len, scalarText, sizeof(scalarText), &scalarLen));
+        TextCodec::setAccelerated(true);
+        TEST_ASSERT_TRUE(TextCodec::hexEncode(data, len, text, sizeof(text), &textLen));
+        TEST_ASSERT_EQUAL(scalarLen, textLen);
+        TEST_ASSERT_EQUAL_MEMORY(scalarText, text, textLen + 1);
+        TEST_ASSERT_TRUE(TextCodec::hexDecode(text, textLen, decoded, sizeof(decoded), &decodedLen));
+        TEST_ASSERT_EQUAL(len, decodedLen);
+        TEST_ASSERT_EQUAL_MEMORY(data, decoded, len);
+
+        TextCodec::setAccelerated(false);
+        TEST_ASSERT_TRUE(TextCodec::base64Encode(data, len, scalarText, sizeof(scalarText), &scalarLen));
+        TextCodec::setAccelerated(true);
+        TEST_ASSERT_TRUE(TextCodec::base64Encode(data, len, text, sizeof(text), &textLen));
+        TEST_ASSERT_EQUAL(scalarLen, textLen);
+        TEST_ASSERT_EQUAL_MEMORY(scalarText, text, textLen + 1);
+        TEST_ASSERT_TRUE(TextCodec::base64Decode(text, textLen, decoded, sizeof(decoded), &decodedLen));
+        TEST_ASSERT_EQUAL(len, decodedLen);
+        TEST_ASSERT_EQUAL_MEMORY(data, decoded, len);
+    }
+
+    // Every byte value through both alphabets' full ranges
+    uint8_t all[256];
+    for (size_t i = 0; i < sizeof(all); i++) all[i] = (uint8_t)i;
+    TEST_ASSERT_TRUE(TextCodec::base64Encode(all, sizeof(all), text, sizeof(text), &textLen));
+    TextCodec::setAccelerated(false);
+    TEST_ASSERT_TRUE(TextCodec::base64Decode(text, textLen, decoded, sizeof(decoded), &decodedLen));
+    TEST_ASSERT_EQUAL_MEMORY(all, decoded, sizeof(all));
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_rfc4648_vectors);
+    RUN_TEST(test_strict_rejection_and_bounds);
+    RUN_TEST(test_scalar_and_vector_kernels_agree);
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+#else
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rfc4648_vectors);
+    RUN_TEST(test_strict_rejection_and_bounds);
+    RUN_TEST(test_scalar_and_vector_kernels_agree);
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,199 @@
+// Mesh Simulator - runs many MeshNetworkManager nodes in virtual time on a host
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Arduino.h"
+#include "sim_network.h"
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [options]\n"
+           "  --nodes N[,N...]     Node counts to simulate (default 10,100,1000)\n"
+           "  --topology T         line | grid | random (default grid)\n"
+           "  --degree D           Average degree for random topology (default 6)\n"
+           "  --latency-ms MS      Per-link base latency (default 5)\n"
+           "  --jitter-ms MS       Per-link uniform jitter (default 5)\n"
+           "  --loss P             Per-link loss probability (default 0)\n"
+           "  --lossy-links F:P    Give a share F of tree links loss P on top, and report their costs\n"
+           "  --duration-s S       Virtual run time (default 120)\n"
+           "  --rate R             DATA messages per node per second (default 0.05)\n"
+           "  --reliable           Send DATA with end-to-end ACKs and retransmission\n"
+           "  --stored             Send DATA through the flash-backed store-and-forward queue\n"
+           "  --subscribers F      Publish DATA to a topic this share of nodes subscribes to\n"
+           "  --sms-rate R         Submit R SMS jobs per second across the mesh\n"
+           "  --sim-share F        Share of nodes with a SIM in SMS mode (default 0.5)\n"
+           "  --clock-ppm P        Give each node its own clock, drifting up to P ppm, and report sync error\n"
+           "  --payload-bytes N    Pad DATA messages to N bytes (default: timestamp only)\n"
+           "  --tick-ms MS         update() period (default 10)\n"
+           "  --boot-spacing-ms MS Join delay after the tree parent (default 20)\n"
+           "  --seed N             Random seed (default 1)\n"
+           "  --heap-check         Report node heap allocations after warm-up; fail if there are any\n"
+           "  --verbose            Show node Serial output\n",
+           program);
+}
+
+static bool parseTopology(const char* name, SimTopology* topology) {
+    if (strcmp(name, "line") == 0) *topology = SIM_TOPOLOGY_LINE;
+    else if (strcmp(name, "grid") == 0) *topology = SIM_TOPOLOGY_GRID;
+    else if (strcmp(name, "random") == 0) *topology = SIM_TOPOLOGY_RANDOM;
+    else return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    SimConfig config;
+    std::vector<size_t> nodeCounts = {10, 100, 1000};
+    bool heapCheck = false;
+    int status = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--verbose") == 0) {
+            Serial.enabled = true;
+            continue;
+        }
+        if (strcmp(arg, "--reliable") == 0) {
+            config.reliable = true;
+            continue;
+        }
+        if (strcmp(arg, "--stored") == 0) {
+            config.stored = true;
+            continue;
+        }
+        if (strcmp(arg, "--heap-check") == 0) {
+            heapCheck = true;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || !value) {
+            printUsage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--nodes") == 0) {
+            nodeCounts.clear();
+            for (char* end = (char*)value; *end; ) {
+                nodeCounts.push_back(strtoul(end, &end, 10));
+                if (*end == ',') end++;
+            }
+        } else if (strcmp(arg, "--topology") == 0) {
+            if (!parseTopology(value, &config.topology)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--degree") == 0) {
+            config.averageDegree = atof(value);
+        } else if (strcmp(arg, "--latency-ms") == 0) {
+            config.latencyUs = (uint32_t)(atof(value) * 1000);
+        } else if (strcmp(arg, "--jitter-ms") == 0) {
+            config.jitterUs = (uint32_t)(atof(value) * 1000);
+        } else if (strcmp(arg, "--loss") == 0) {
+            config.loss = atof(value);
+        } else if (strcmp(arg, "--lossy-links") == 0) {
+            char* end;
+            config.lossyShare = strtod(value, &end);
+            config.lossyLoss = *end == ':' ? atof(end + 1) : 0.0;
+        } else if (strcmp(arg, "--duration-s") == 0) {
+            config.durationMs = (uint32_t)(atof(value) * 1000);
+        } else if (strcmp(arg, "--rate") == 0) {
+            config.dataRate = atof(value);
+        } else if (strcmp(arg, "--subscribers") == 0) {
+            config.subscribers = atof(value);
+        } else if (strcmp(arg, "--sms-rate") == 0) {
+            config.smsRate = atof(value);
+        } else if (strcmp(arg, "--sim-share") == 0) {
+            config.simShare = atof(value);
+        } else if (strcmp(arg, "--clock-ppm") == 0) {
+            config.nodeClocks = true;
+            config.clockPpm = atof(value);
+        } else if (strcmp(arg, "--payload-bytes") == 0) {
+            config.payloadBytes = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--tick-ms") == 0) {
+            config.tickMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--boot-spacing-ms") == 0) {
+            config.bootSpacingMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoul(value, nullptr, 10);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (config.tickMs == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    printf("conv_ms: every node has a synced heartbeat and a route for each node within %d hops,\n"
+           "         or for as many as its tables hold (%d heartbeat peers, %d topology nodes)\n",
+           MAX_NETWORK_HOPS, MESH_MAX_PEERS, MESH_TOPOLOGY_MAX_NODES - 1);
+    printf("%6s %5s %9s %8s %6s %6s %8s %8s %7s %8s %8s %8s %9s %9s %7s\n",
+           "nodes", "depth", "conv_ms", "bcasts", "reach", "ampl", "dups",
+           "data_ok", "rtx", "p50_ms", "p99_ms", "max_ms", "work_us/s", "p99_us/s", "wall_s");
+
+    for (size_t count : nodeCounts) {
+        if (count < 2) continue;
+        config.nodes = count;
+
+        SimNetwork network(config);
+        SimReport r = network.run();
+
+        double delivered = r.dataSent > 0 ? 100.0 * r.dataReceived / r.dataSent : 0.0;
+        char convergence[16];
+        if (r.convergenceMs > 0) {
+            snprintf(convergence, sizeof(convergence), "%u", r.convergenceMs);
+        } else {
+            snprintf(convergence, sizeof(convergence), "-");
+        }
+
+        printf("%6zu %5zu %9s %8llu %5.0f%% %6.2f %8llu %7.1f%% %7llu %8.1f %8.1f %8.1f %9.0f %9.0f %7.1f\n",
+               r.nodes, r.treeDepth, convergence, (unsigned long long)r.broadcasts,
+               r.broadcastReach * 100, r.amplification, (unsigned long long)r.duplicatesDropped,
+               delivered, (unsigned long long)r.retransmits, r.latencyP50Us / 1000.0, r.latencyP99Us / 1000.0, r.latencyMaxUs / 1000.0,
+               r.workMeanUsPerSec, r.workP99UsPerSec, r.wallSeconds);
+        if (r.convergenceMs == 0) {
+            printf("       unconverged: of %llu node pairs in reach, %llu lack a synced heartbeat, %llu a route\n",
+                   (unsigned long long)r.trackedPairs, (unsigned long long)r.unsyncedPairs,
+                   (unsigned long long)r.unroutedPairs);
+        }
+        if (config.smsRate > 0) {
+            printf("       sms: %llu submitted, %llu sent, %llu pulled, wait p50 %.1fs p99 %.1fs max %.1fs, "
+                   "deepest queue %u\n",
+                   (unsigned long long)r.smsSubmitted, (unsigned long long)r.smsSent,
+                   (unsigned long long)r.smsPulled, r.smsWaitP50Ms / 1000.0, r.smsWaitP99Ms / 1000.0,
+                   r.smsWaitMaxMs / 1000.0, r.smsQueueMax);
+        }
+        if (config.nodeClocks) {
+            printf("       time: %zu/%zu synced, error p50 %u ms p99 %u ms max %u ms, bound p99 %u ms, "
+                   "%llu samples outside their bound\n",
+                   r.timeSynced, r.nodes - 1, r.timeErrorP50Ms, r.timeErrorP99Ms, r.timeErrorMaxMs,
+                   r.timeBoundP99Ms, (unsigned long long)r.timeBoundMisses);
+            printf("       histograms: DATA transit p50 %.1f ms p99 %.1f ms over %u frames\n",
+                   r.transitP50Us / 1000.0, r.transitP99Us / 1000.0, r.transitSamples);
+        }
+        if (config.stored) {
+            printf("       stored: %llu replayed (%llu retries), %llu acknowledged, %llu duplicates suppressed, "
+                   "deepest queue at end %u, %u sector erases\n",
+                   (unsigned long long)r.storedReplayed, (unsigned long long)r.storedRetries,
+                   (unsigned long long)r.storedDelivered, (unsigned long long)r.storedDuplicates,
+                   r.storedDepthMax, r.storedErases);
+        }
+        if (config.lossyShare > 0) {
+            printf("       links: %zu lossy (%.0f%% loss) cost mean %.1f, clean cost mean %.1f (unit %u)\n",
+                   r.lossyLinks, config.lossyLoss * 100, r.lossyCostMean, r.cleanCostMean, MESH_LINK_COST_UNIT);
+        }
+        if (heapCheck) {
+            printf("       heap: %llu allocations by node code in the second half of the run\n",
+                   (unsigned long long)r.heapAllocations);
+            if (r.heapAllocations > 0) {
+                status = 1;
+            }
+        }
+        fflush(stdout);
+    }
+
+    return status;
+}
@@ -0,0 +1,73 @@
+// Arduino Core Stand-in for the host mesh simulator
+#ifndef MESH_SIM_ARDUINO_H
+#define MESH_SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "sim_heap.h"
+
+/**
+ * @brief Minimal Arduino surface needed by the mesh modules
+ *
+ * millis()/micros() read the simulator's virtual clock, esp_random() is a
+ * seeded PRNG so runs are reproducible, and Serial output is discarded
+ * unless the simulator is run with --verbose.
+ */
+
+// Virtual clock and randomness (defined in sim_port.cpp)
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+uint32_t esp_random();
+
+// Arduino's String allocates on the target too, so its storage is not charged to node code
+class String {
+public:
+    String() {}
+    String(const char* text) { SimHeapScope exempt(false); value = text ? text : ""; }
+    String(const char* text, size_t len) { SimHeapScope exempt(false); value.assign(text, len); }
+    String(const String& other) { SimHeapScope exempt(false); value = other.value; }
+    String& operator=(const String& other) { SimHeapScope exempt(false); value = other.value; return *this; }
+
+    const char* c_str() const { return value.c_str(); }
+    size_t length() const { return value.length(); }
+    bool operator==(const String& other) const { return value == other.value; }
+    String& operator+=(const String& other) { SimHeapScope exempt(false); value += other.value; return *this; }
+
+private:
+    std::string value;
+};
+
+class SimSerial {
+public:
+    bool enabled = false;
+
+    void begin(unsigned long) {}
+    void print(const char* text) { if (enabled) fputs(text, stdout); }
+    void print(const String& text) { print(text.c_str()); }
+    void println(const char* text = "") { if (enabled) { fputs(text, stdout); fputc('\n', stdout); } }
+    void println(const String& text) { println(text.c_str()); }
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (!enabled) return 0;
+        va_list args;
+        va_start(args, format);
+        int written = vprintf(format, args);
+        va_end(args);
+        return written;
+    }
+};
+
+class SimEsp {
+public:
+    uint32_t getFreeHeap() { return 180 * 1024; }
+};
+
+extern SimSerial Serial;
+extern SimEsp ESP;
+
+#endif // MESH_SIM_ARDUINO_H
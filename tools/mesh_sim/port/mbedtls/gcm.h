@@ -0,0 +1,42 @@
+// mbedtls GCM Stand-in for the host mesh simulator (backed by OpenSSL)
+#ifndef MESH_SIM_MBEDTLS_GCM_H
+#define MESH_SIM_MBEDTLS_GCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The subset of mbedtls_gcm used by MeshAEAD
+ *
+ * Implemented on OpenSSL's EVP AES-GCM so simulated nodes pay a realistic
+ * per-message crypto cost. Contexts are pre-keyed once, as with mbedtls.
+ */
+
+#define MBEDTLS_GCM_ENCRYPT 1
+#define MBEDTLS_GCM_DECRYPT 0
+#define MBEDTLS_ERR_GCM_AUTH_FAILED -0x0012
+#define MBEDTLS_ERR_GCM_BAD_INPUT -0x0014
+
+typedef enum { MBEDTLS_CIPHER_ID_AES = 2 } mbedtls_cipher_id_t;
+
+typedef struct {
+    void* encrypt;  // EVP_CIPHER_CTX*, keyed for encryption
+    void* decrypt;  // EVP_CIPHER_CTX*, keyed for decryption
+} mbedtls_gcm_context;
+
+void mbedtls_gcm_init(mbedtls_gcm_context* ctx);
+void mbedtls_gcm_free(mbedtls_gcm_context* ctx);
+int mbedtls_gcm_setkey(mbedtls_gcm_context* ctx, mbedtls_cipher_id_t cipher,
+                       const unsigned char* key, unsigned int keybits);
+int mbedtls_gcm_crypt_and_tag(mbedtls_gcm_context* ctx, int mode, size_t length,
+                              const unsigned char* iv, size_t iv_len,
+                              const unsigned char* add, size_t add_len,
+                              const unsigned char* input, unsigned char* output,
+                              size_t tag_len, unsigned char* tag);
+int mbedtls_gcm_auth_decrypt(mbedtls_gcm_context* ctx, size_t length,
+                             const unsigned char* iv, size_t iv_len,
+                             const unsigned char* add, size_t add_len,
+                             const unsigned char* tag, size_t tag_len,
+                             const unsigned char* input, unsigned char* output);
+
+#endif // MESH_SIM_MBEDTLS_GCM_H
@@ -0,0 +1,71 @@
+// painlessMesh Stand-in for the host mesh simulator
+#ifndef MESH_SIM_PAINLESS_MESH_H
+#define MESH_SIM_PAINLESS_MESH_H
+
+#include <functional>
+#include "Arduino.h"
+
+class SimNetwork;
+
+// Debug categories accepted by setDebugMsgTypes (ignored)
+enum SimDebugType { ERROR = 1, STARTUP = 2, CONNECTION = 4 };
+
+/**
+ * @brief Node list view over the simulated mesh (every joined node but self)
+ *
+ * painlessMesh returns a std::list; with thousands of simulated nodes the
+ * manager only ever needs size(), so the view avoids building one per call.
+ */
+class SimNodeList {
+public:
+    SimNodeList(size_t count) : count(count) {}
+    size_t size() const { return count; }
+
+private:
+    size_t count;
+};
+
+/**
+ * @brief In-memory transport with painlessMesh's API
+ *
+ * init() attaches the instance to the simulator's current node slot. Sends
+ * are handed to SimNetwork, which models the painlessMesh tree: broadcasts
+ * flood every tree link once and single sends follow the tree path, with
+ * per-link latency and loss applied in virtual time.
+ */
+class painlessMesh {
+public:
+    typedef std::function<void(uint32_t, String&)> receivedCallback_t;
+    typedef std::function<void(uint32_t)> connectionCallback_t;
+    typedef std::function<void()> changedConnectionsCallback_t;
+
+    painlessMesh() : network(nullptr), nodeId(0) {}
+
+    void setDebugMsgTypes(uint16_t) {}
+    void init(const char* prefix, const char* password, uint16_t port);
+    void setContainsRoot(bool) {}
+    void update() {}
+
+    void onReceive(receivedCallback_t callback) { receivedCallback = callback; }
+    void onNewConnection(connectionCallback_t callback) { newConnectionCallback = callback; }
+    void onDroppedConnection(connectionCallback_t callback) { droppedConnectionCallback = callback; }
+    void onChangedConnections(changedConnectionsCallback_t callback) { changedConnectionsCallback = callback; }
+
+    bool sendSingle(uint32_t destId, const String& msg);
+    bool sendBroadcast(const String& msg, bool includeSelf = false);
+
+    uint32_t getNodeId() { return nodeId; }
+    SimNodeList getNodeList();
+
+private:
+    friend class SimNetwork;
+
+    SimNetwork* network;
+    uint32_t nodeId;
+    receivedCallback_t receivedCallback;
+    connectionCallback_t newConnectionCallback;
+    connectionCallback_t droppedConnectionCallback;
+    changedConnectionsCallback_t changedConnectionsCallback;
+};
+
+#endif // MESH_SIM_PAINLESS_MESH_H
@@ -0,0 +1,24 @@
+// Mesh Simulator Clock Header
+#ifndef MESH_SIM_CLOCK_H
+#define MESH_SIM_CLOCK_H
+
+#include <stdint.h>
+
+// Virtual time read by millis()/micros(); advanced only by the event loop
+extern uint64_t simNowUs;
+
+// A node's own clock: startUs at boot, then running at rate against virtual time
+struct SimNodeClock {
+    uint64_t bootUs;
+    uint64_t startUs;
+    double rate;
+};
+
+// Clock of the node whose code is running; nullptr = every node reads simNowUs
+extern const SimNodeClock* simActiveClock;
+
+uint64_t simLocalUs();
+
+void simSeedRandom(uint64_t seed);
+
+#endif // MESH_SIM_CLOCK_H
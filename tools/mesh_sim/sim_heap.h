@@ -0,0 +1,21 @@
+// Mesh Simulator Heap Header
+#ifndef MESH_SIM_HEAP_H
+#define MESH_SIM_HEAP_H
+
+#include <stdint.h>
+
+// operator new calls made while simHeapCounting is set (defined in sim_port.cpp)
+extern uint64_t simHeapAllocations;
+extern bool simHeapCounting;
+
+// Counts node allocations (true) or exempts port and simulator code (false) while in scope
+class SimHeapScope {
+public:
+    SimHeapScope(bool counting) : previous(simHeapCounting) { simHeapCounting = counting; }
+    ~SimHeapScope() { simHeapCounting = previous; }
+
+private:
+    bool previous;
+};
+
+#endif // MESH_SIM_HEAP_H
@@ -0,0 +1,735 @@
+// Mesh Simulator Network - virtual-time transport and topology for many mesh nodes
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include "sim_network.h"
+#include "sim_clock.h"
+#include "sim_heap.h"
+
+SimNetwork* SimNetwork::current = nullptr;
+
+static const uint8_t SIM_MESH_KEY[32] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+};
+
+static const uint32_t SIM_SAMPLE_INTERVAL_US = 1000000;
+static const char* SIM_TOPIC = "sim/data";
+static const uint32_t SIM_SMS_MIN_MS = 3000;     // Modem send time, uniform in [min, min + spread)
+static const uint32_t SIM_SMS_SPREAD_MS = 4000;
+
+// Other nodes a node can hold in both its heartbeat and topology tables
+static const size_t SIM_TABLE_NODES = std::min<size_t>(MESH_MAX_PEERS, MESH_TOPOLOGY_MAX_NODES - 1);
+
+// Node IDs are index + 1 so that 0 stays the broadcast address
+static inline uint32_t nodeIdOf(uint32_t index) { return index + 1; }
+
+// Host CPU time around a node's work, charged to that node
+class SimWorkTimer {
+public:
+    SimWorkTimer(uint64_t* total) : total(total), start(std::chrono::steady_clock::now()) {}
+    ~SimWorkTimer() {
+        *total += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    uint64_t* total;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Node code reads its own clock while one of these is in scope
+class SimClockScope {
+public:
+    SimClockScope(const SimNodeClock* clock) : previous(simActiveClock) { simActiveClock = clock; }
+    ~SimClockScope() { simActiveClock = previous; }
+
+private:
+    const SimNodeClock* previous;
+};
+
+SimNetwork::SimNetwork(const SimConfig& config) :
+    config(config),
+    nodes(config.nodes),
+    rng(config.seed),
+    eventOrder(0),
+    attachIndex(0),
+    receivingIndex(0),
+    topologyGeneration(0),
+    joinedCount(0),
+    convergenceMs(0),
+    report() {}
+
+SimNetwork::~SimNetwork() {
+    if (current == this) {
+        current = nullptr;
+    }
+}
+
+void SimNetwork::buildTopology() {
+    size_t n = nodes.size();
+    auto link = [this](uint32_t a, uint32_t b) {
+        nodes[a].links.push_back(b);
+        nodes[b].links.push_back(a);
+    };
+
+    if (config.topology == SIM_TOPOLOGY_LINE) {
+        for (uint32_t i = 1; i < n; i++) {
+            link(i - 1, i);
+        }
+        return;
+    }
+
+    if (config.topology == SIM_TOPOLOGY_GRID) {
+        size_t side = (size_t)ceil(sqrt((double)n));
+        for (uint32_t i = 0; i < n; i++) {
+            if ((i % side) + 1 < side && i + 1 < n) link(i, i + 1);
+            if (i + side < n) link(i, i + side);
+        }
+        return;
+    }
+
+    // Random geometric: grow the radius until the graph is connected
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<double> x(n), y(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = unit(rng);
+        y[i] = unit(rng);
+    }
+
+    double radius = sqrt(config.averageDegree / (M_PI * (double)n));
+    for (;;) {
+        for (Node& node : nodes) {
+            node.links.clear();
+        }
+
+        // Bucket points into radius-sized cells so only nearby cells are compared
+        size_t cells = std::max<size_t>(1, (size_t)(1.0 / radius));
+        std::vector<std::vector<uint32_t>> grid(cells * cells);
+        for (uint32_t i = 0; i < n; i++) {
+            size_t cx = std::min(cells - 1, (size_t)(x[i] * cells));
+            size_t cy = std::min(cells - 1, (size_t)(y[i] * cells));
+            grid[cy * cells + cx].push_back(i);
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            long cx = std::min(cells - 1, (size_t)(x[i] * cells));
+            long cy = std::min(cells - 1, (size_t)(y[i] * cells));
+            for (long gy = cy - 1; gy <= cy + 1; gy++) {
+                for (long gx = cx - 1; gx <= cx + 1; gx++) {
+                    if (gx < 0 || gy < 0 || gx >= (long)cells || gy >= (long)cells) continue;
+                    for (uint32_t j : grid[gy * cells + gx]) {
+                        double dx = x[i] - x[j];
+                        double dy = y[i] - y[j];
+                        if (j > i && dx * dx + dy * dy <= radius * radius) link(i, j);
+                    }
+                }
+            }
+        }
+
+        // Connected if a BFS from the root reaches everyone
+        std::vector<bool> seen(n, false);
+        std::vector<uint32_t> frontier(1, 0);
+        seen[0] = true;
+        size_t reached = 1;
+        while (!frontier.empty()) {
+            uint32_t at = frontier.back();
+            frontier.pop_back();
+            for (uint32_t next : nodes[at].links) {
+                if (!seen[next]) {
+                    seen[next] = true;
+                    reached++;
+                    frontier.push_back(next);
+                }
+            }
+        }
+        if (reached == n) {
+            return;
+        }
+        radius *= 1.1;
+    }
+}
+
+void SimNetwork::buildTree() {
+    // BFS spanning tree from the root: painlessMesh's best-case layout
+    std::vector<uint32_t> order(1, 0);
+    nodes[0].parent = 0;
+    for (size_t head = 0; head < order.size(); head++) {
+        uint32_t at = order[head];
+        for (uint32_t next : nodes[at].links) {
+            if (nodes[next].parent == UINT32_MAX) {
+                nodes[next].parent = at;
+                nodes[next].depth = nodes[at].depth + 1;
+                nodes[at].children.push_back(next);
+                order.push_back(next);
+            }
+        }
+    }
+
+    // Iterative DFS numbering; children are visited in list order so their tin ascends
+    uint32_t clock = 0;
+    std::vector<std::pair<uint32_t, size_t>> stack(1, std::make_pair(0u, (size_t)0));
+    nodes[0].tin = clock++;
+    while (!stack.empty()) {
+        uint32_t at = stack.back().first;
+        size_t& child = stack.back().second;
+        if (child < nodes[at].children.size()) {
+            uint32_t next = nodes[at].children[child++];
+            nodes[next].tin = clock++;
+            stack.push_back(std::make_pair(next, (size_t)0));
+        } else {
+            nodes[at].tout = clock - 1;
+            stack.pop_back();
+        }
+    }
+
+    report.treeDepth = 0;
+    for (const Node& node : nodes) {
+        report.treeDepth = std::max<size_t>(report.treeDepth, node.depth);
+    }
+
+    // Nodes beyond the hop limit cannot be sent to, so convergence only asks for those within it
+    for (uint32_t a = 0; a < nodes.size(); a++) {
+        for (uint32_t b = 0; b < nodes.size(); b++) {
+            if (a != b && treeDistance(a, b) <= MAX_NETWORK_HOPS) {
+                nodes[a].inReach.push_back(b);
+            }
+        }
+    }
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t i = 1; i < nodes.size() && config.lossyShare > 0; i++) {
+        if (unit(rng) < config.lossyShare) {
+            nodes[i].uplinkLoss = config.lossyLoss;
+            report.lossyLinks++;
+        }
+    }
+}
+
+uint32_t SimNetwork::nextHop(uint32_t at, uint32_t dest) {
+    const Node& here = nodes[at];
+    uint32_t target = nodes[dest].tin;
+
+    // Down into the child subtree holding the destination, otherwise up
+    if (target > here.tin && target <= here.tout) {
+        auto it = std::upper_bound(here.children.begin(), here.children.end(), target,
+                                   [this](uint32_t tin, uint32_t child) { return tin < nodes[child].tin; });
+        return *(it - 1);
+    }
+    return here.parent;
+}
+
+uint32_t SimNetwork::treeDistance(uint32_t a, uint32_t b) {
+    uint32_t hops = 0;
+    while (nodes[a].depth > nodes[b].depth) {
+        a = nodes[a].parent;
+        hops++;
+    }
+    while (nodes[b].depth > nodes[a].depth) {
+        b = nodes[b].parent;
+        hops++;
+    }
+    while (a != b) {
+        a = nodes[a].parent;
+        b = nodes[b].parent;
+        hops += 2;
+    }
+    return hops;
+}
+
+void SimNetwork::schedule(uint64_t atUs, EventKind kind, uint32_t node, uint32_t from, uint32_t dest,
+                          uint32_t originId, uint64_t sentUs, std::shared_ptr<const std::string> payload) {
+    Event event;
+    event.atUs = atUs;
+    event.order = eventOrder++;
+    event.kind = kind;
+    event.node = node;
+    event.from = from;
+    event.dest = dest;
+    event.originId = originId;
+    event.sentUs = sentUs;
+    event.payload = std::move(payload);
+    events.push(std::move(event));
+}
+
+void SimNetwork::transmit(uint32_t from, uint32_t to, EventKind kind, uint32_t dest, uint32_t originId,
+                          uint64_t sentUs, const std::shared_ptr<const std::string>& payload) {
+    report.linkTransmissions++;
+    if (kind == EVENT_BROADCAST) {
+        report.broadcastTransmissions++;
+    }
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double uplinkLoss = nodes[from].parent == to ? nodes[from].uplinkLoss :
+                        nodes[to].parent == from ? nodes[to].uplinkLoss : 0.0;
+    if ((config.loss > 0.0 && unit(rng) < config.loss) || (uplinkLoss > 0.0 && unit(rng) < uplinkLoss)) {
+        report.linkLosses++;
+        return;
+    }
+
+    uint64_t latency = config.latencyUs;
+    if (config.jitterUs > 0) {
+        latency += rng() % (config.jitterUs + 1);
+    }
+    schedule(simNowUs + latency, kind, to, from, dest, originId, sentUs, payload);
+}
+
+void SimNetwork::attach(painlessMesh* mesh) {
+    Node& node = nodes[attachIndex];
+    node.mesh = mesh;
+    mesh->network = this;
+    mesh->nodeId = nodeIdOf(attachIndex);
+}
+
+size_t SimNetwork::getJoinedCount() {
+    return joinedCount;
+}
+
+bool SimNetwork::sendSingle(painlessMesh* mesh, uint32_t destId, const String& msg) {
+    uint32_t from = mesh->nodeId - 1;
+    uint32_t dest = destId - 1;
+    if (destId == 0 || dest >= nodes.size() || !nodes[dest].joined || dest == from) {
+        return false;
+    }
+
+    report.unicasts++;
+    auto payload = std::make_shared<const std::string>(msg.c_str(), msg.length());
+    transmit(from, nextHop(from, dest), EVENT_SINGLE, dest, mesh->nodeId, simNowUs, payload);
+    return true;
+}
+
+bool SimNetwork::sendBroadcast(painlessMesh* mesh, const String& msg) {
+    uint32_t from = mesh->nodeId - 1;
+    const Node& node = nodes[from];
+
+    report.broadcasts++;
+    report.broadcastAudience += joinedCount - 1;
+    auto payload = std::make_shared<const std::string>(msg.c_str(), msg.length());
+    if (from != 0 && nodes[node.parent].joined) {
+        transmit(from, node.parent, EVENT_BROADCAST, 0, mesh->nodeId, simNowUs, payload);
+    }
+    for (uint32_t child : node.children) {
+        if (nodes[child].joined) {
+            transmit(from, child, EVENT_BROADCAST, 0, mesh->nodeId, simNowUs, payload);
+        }
+    }
+    return true;
+}
+
+const SimNodeClock* SimNetwork::clockOf(uint32_t index) {
+    return config.nodeClocks ? &nodes[index].clock : nullptr;
+}
+
+void SimNetwork::bootNode(uint32_t index) {
+    Node& node = nodes[index];
+    node.bootUs = simNowUs;
+    node.joined = true;
+    joinedCount++;
+    topologyGeneration++;
+
+    // Each node's clock reads some uptime already (up to an hour) and drifts within clockPpm
+    if (config.nodeClocks) {
+        std::uniform_real_distribution<double> drift(-config.clockPpm, config.clockPpm);
+        node.clock.bootUs = simNowUs;
+        node.clock.startUs = rng() % 3600000000ULL;
+        node.clock.rate = 1.0 + drift(rng) * 1e-6;
+    }
+
+    {
+        SimWorkTimer timer(&node.workNs);
+        SimClockScope clock(clockOf(index));
+        attachIndex = index;
+        node.manager.reset(new MeshNetworkManager());
+        node.manager->registerHandler(MESH_MSG_DATA, onData, this);
+        node.manager->begin(SIM_MESH_KEY, sizeof(SIM_MESH_KEY));
+        node.topologySeen = topologyGeneration;
+
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        if (config.subscribers > 0 && unit(rng) < config.subscribers) {
+            node.subscribed = node.manager->subscribe(SIM_TOPIC);
+        }
+        if (config.smsRate > 0 && unit(rng) < config.simShare) {
+            node.hasSim = true;
+            node.manager->setSimStatus(0x1);
+        }
+    }
+
+    // The new link is reported at both ends; the rest of the mesh hears on its next tick
+    if (index != 0) {
+        Node& parent = nodes[node.parent];
+        SimWorkTimer timer(&parent.workNs);
+        SimClockScope clock(clockOf(node.parent));
+        SimHeapScope heap(true);
+        if (parent.mesh->newConnectionCallback) parent.mesh->newConnectionCallback(nodeIdOf(index));
+        parent.topologySeen = topologyGeneration;
+    }
+    {
+        SimWorkTimer timer(&node.workNs);
+        SimClockScope clock(clockOf(index));
+        SimHeapScope heap(true);
+        if (index != 0 && node.mesh->newConnectionCallback) {
+            node.mesh->newConnectionCallback(nodeIdOf(node.parent));
+        }
+    }
+
+    schedule(simNowUs + (rng() % (config.tickMs * 1000)), EVENT_TICK, index);
+
+    // Children join once their parent is up
+    for (uint32_t child : node.children) {
+        uint64_t spacing = (uint64_t)config.bootSpacingMs * 1000;
+        schedule(simNowUs + spacing + (spacing > 0 ? rng() % spacing : 0), EVENT_BOOT, child);
+    }
+}
+
+void SimNetwork::tickNode(uint32_t index) {
+    Node& node = nodes[index];
+    {
+        SimWorkTimer timer(&node.workNs);
+        SimClockScope clock(clockOf(index));
+        SimHeapScope heap(true);
+        if (node.topologySeen != topologyGeneration) {
+            node.topologySeen = topologyGeneration;
+            if (node.mesh->changedConnectionsCallback) node.mesh->changedConnectionsCallback();
+        }
+
+        // Poisson application traffic to a random joined node; the last tenth
+        // of the run is left quiet so in-flight messages can land
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        bool sending = simNowUs < (uint64_t)config.durationMs * 900;
+        if (sending && joinedCount > 1 && unit(rng) < config.dataRate * config.tickMs / 1000.0) {
+            uint32_t dest;
+            do {
+                dest = rng() % nodes.size();
+            } while (dest == index || !nodes[dest].joined);
+
+            char text[24];
+            snprintf(text, sizeof(text), "%llu", (unsigned long long)simNowUs);
+            String message;
+            {
+                SimHeapScope exempt(false);
+                std::string padded(text);
+                if (padded.size() < config.payloadBytes) {
+                    padded.resize(config.payloadBytes, ' ');
+                }
+                message = String(padded.c_str(), padded.size());
+            }
+            if (config.subscribers > 0) {
+                // Every other subscriber within the hop limit should get a copy
+                if (node.manager->publish(SIM_TOPIC, message)) {
+                    for (uint32_t other = 0; other < nodes.size(); other++) {
+                        if (other != index && nodes[other].subscribed &&
+                            treeDistance(index, other) <= MAX_NETWORK_HOPS) {
+                            report.dataSent++;
+                        }
+                    }
+                }
+            } else {
+                bool queued = config.stored ? node.manager->sendStored(nodeIdOf(dest), message) :
+                              config.reliable ? node.manager->sendReliable(nodeIdOf(dest), message) :
+                              node.manager->sendMessage(nodeIdOf(dest), message);
+                if (queued) {
+                    report.dataSent++;
+                }
+            }
+        }
+
+        if (config.smsRate > 0) {
+            runModem(index);
+            if (sending && unit(rng) < config.smsRate / nodes.size() * config.tickMs / 1000.0) {
+                static const uint8_t body[] = "+15550100|Simulated message text";
+                if (node.manager->submitSmsJob(body, sizeof(body))) {
+                    report.smsSubmitted++;
+                }
+            }
+        }
+
+        node.manager->update();
+    }
+
+    schedule(simNowUs + (uint64_t)config.tickMs * 1000, EVENT_TICK, index);
+}
+
+void SimNetwork::runModem(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.modemBusy && simNowUs >= node.modemDoneUs) {
+        node.manager->completeSmsJob(node.smsJob, true, node.modemSendMs);
+        node.modemBusy = false;
+        report.smsSent++;
+    }
+    if (node.hasSim && !node.modemBusy && node.manager->takeSmsJob(&node.smsJob)) {
+        node.modemBusy = true;
+        node.modemSendMs = SIM_SMS_MIN_MS + rng() % SIM_SMS_SPREAD_MS;
+        node.modemDoneUs = simNowUs + (uint64_t)node.modemSendMs * 1000;
+        SimHeapScope exempt(false);
+        smsWaitMs.push_back(node.smsJob.waitMs);
+    }
+}
+
+void SimNetwork::deliver(uint32_t index, uint32_t originId, const std::string& payload) {
+    Node& node = nodes[index];
+    if (!node.joined || !node.mesh->receivedCallback) {
+        return;
+    }
+
+    SimWorkTimer timer(&node.workNs);
+    SimClockScope clock(clockOf(index));
+    SimHeapScope heap(true);
+    String msg(payload.data(), payload.size());
+    receivingIndex = index;
+    node.mesh->receivedCallback(originId, msg);
+}
+
+void SimNetwork::onData(void* context, const MeshMessageInfo& info, const uint8_t* data, size_t len) {
+    SimNetwork* self = (SimNetwork*)context;
+    SimHeapScope exempt(false);
+
+    // Payload is the sender's virtual time when sendMessage() was called
+    char text[24];
+    size_t copy = len < sizeof(text) - 1 ? len : sizeof(text) - 1;
+    memcpy(text, data, copy);
+    text[copy] = '\0';
+    uint64_t sentUs = strtoull(text, nullptr, 10);
+
+    // Published copies that found subscribers beyond the hop limit are not counted against the expected set
+    if (info.topic != 0 && self->treeDistance(info.source - 1, self->receivingIndex) > MAX_NETWORK_HOPS) {
+        return;
+    }
+
+    self->report.dataReceived++;
+    self->dataLatencyUs.push_back((uint32_t)(simNowUs - sentUs));
+}
+
+void SimNetwork::sample() {
+    if (convergenceMs == 0 && joinedCount == nodes.size()) {
+        uint64_t tracked, unsynced, unrouted;
+        countPending(&tracked, &unsynced, &unrouted);
+        if (unsynced == 0 && unrouted == 0) {
+            convergenceMs = (uint32_t)(simNowUs / 1000);
+        }
+    }
+
+    if (config.nodeClocks) {
+        sampleTime();
+    }
+
+    schedule(simNowUs + SIM_SAMPLE_INTERVAL_US, EVENT_SAMPLE, 0);
+}
+
+void SimNetwork::countPending(uint64_t* tracked, uint64_t* unsynced, uint64_t* unrouted) {
+    *tracked = 0;
+    *unsynced = 0;
+    *unrouted = 0;
+    for (uint32_t index = 0; index < nodes.size(); index++) {
+        Node& node = nodes[index];
+        if (!node.joined) continue;
+
+        SimClockScope clock(clockOf(index));
+        size_t synced = 0;
+        size_t routed = 0;
+        for (uint32_t other : node.inReach) {
+            const MeshPeerState* peer = node.manager->getPeerState(nodeIdOf(other));
+            if (peer && peer->synced) synced++;
+            if (node.manager->getHopDistance(nodeIdOf(other)) != MeshTopology::UNREACHABLE) routed++;
+        }
+
+        // A neighbourhood larger than the tables counts once they are full of it
+        size_t target = std::min(node.inReach.size(), SIM_TABLE_NODES);
+        *tracked += target;
+        *unsynced += synced < target ? target - synced : 0;
+        *unrouted += routed < target ? target - routed : 0;
+    }
+}
+
+void SimNetwork::sampleTime() {
+    // Every synced node's mesh clock against its master's, read at the same virtual instant
+    for (uint32_t index = 0; index < nodes.size(); index++) {
+        Node& node = nodes[index];
+        if (!node.joined) continue;
+
+        MeshTimeStats stats;
+        uint32_t meshMs;
+        {
+            SimClockScope clock(clockOf(index));
+            stats = node.manager->getTimeStats();
+            meshMs = node.manager->toMeshTime(millis());
+        }
+        uint32_t master = stats.master - 1;
+        if (!stats.synced || master == index || master >= nodes.size() || !nodes[master].joined) continue;
+
+        uint32_t masterMs;
+        {
+            SimClockScope clock(clockOf(master));
+            masterMs = nodes[master].manager->toMeshTime(millis());
+        }
+        int32_t error = (int32_t)(meshMs - masterMs);
+        uint32_t magnitude = (uint32_t)(error < 0 ? -error : error);
+        timeErrorMs.push_back(magnitude);
+        timeBoundMs.push_back(stats.errorMs);
+        if (magnitude > stats.errorMs) {
+            report.timeBoundMisses++;
+        }
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t>& values, double p) {
+    if (values.empty()) return 0;
+    size_t rank = (size_t)(p * (values.size() - 1) + 0.5);
+    return values[rank];
+}
+
+SimReport SimNetwork::run() {
+    auto wallStart = std::chrono::steady_clock::now();
+    current = this;
+    simNowUs = 0;
+    simSeedRandom(config.seed);
+
+    report = SimReport();
+    report.nodes = nodes.size();
+    buildTopology();
+    buildTree();
+
+    schedule(0, EVENT_BOOT, 0);
+    schedule(SIM_SAMPLE_INTERVAL_US, EVENT_SAMPLE, 0);
+
+    uint64_t endUs = (uint64_t)config.durationMs * 1000;
+    uint64_t heapStart = 0;
+    bool heapWarm = false;
+    while (!events.empty() && events.top().atUs <= endUs) {
+        Event event = events.top();
+        events.pop();
+        simNowUs = event.atUs;
+        report.events++;
+
+        if (!heapWarm && simNowUs >= endUs / 2) {
+            heapWarm = true;
+            heapStart = simHeapAllocations;
+        }
+
+        switch (event.kind) {
+            case EVENT_BOOT:
+                bootNode(event.node);
+                break;
+            case EVENT_TICK:
+                tickNode(event.node);
+                break;
+            case EVENT_BROADCAST: {
+                // painlessMesh relays on every other tree link, then hands the frame up
+                const Node& node = nodes[event.node];
+                if (!node.joined) break;
+                if (event.node != 0 && node.parent != event.from && nodes[node.parent].joined) {
+                    transmit(event.node, node.parent, EVENT_BROADCAST, 0, event.originId, event.sentUs, event.payload);
+                }
+                for (uint32_t child : node.children) {
+                    if (child != event.from && nodes[child].joined) {
+                        transmit(event.node, child, EVENT_BROADCAST, 0, event.originId, event.sentUs, event.payload);
+                    }
+                }
+                report.broadcastReceptions++;
+                if (node.bootUs <= event.sentUs) {
+                    report.broadcastReached++;
+                }
+                deliver(event.node, event.originId, *event.payload);
+                break;
+            }
+            case EVENT_SINGLE:
+                if (event.node == event.dest) {
+                    deliver(event.node, event.originId, *event.payload);
+                } else {
+                    transmit(event.node, nextHop(event.node, event.dest), EVENT_SINGLE,
+                             event.dest, event.originId, event.sentUs, event.payload);
+                }
+                break;
+            case EVENT_SAMPLE:
+                sample();
+                break;
+        }
+    }
+    simNowUs = endUs;
+    report.heapAllocations = heapWarm ? simHeapAllocations - heapStart : 0;
+
+    // Summaries
+    report.convergenceMs = convergenceMs;
+    countPending(&report.trackedPairs, &report.unsyncedPairs, &report.unroutedPairs);
+    report.amplification = report.broadcastReceptions > 0 ?
+        (double)report.broadcastTransmissions / report.broadcastReceptions : 0.0;
+    report.broadcastReach = report.broadcastAudience > 0 ?
+        (double)report.broadcastReached / report.broadcastAudience : 0.0;
+
+    std::vector<double> work;
+    double lossyCost = 0;
+    double cleanCost = 0;
+    MeshLatencyHistogram transit;
+    MeshLatencyKey latencyKeys[MESH_LATENCY_MAX_SERIES];
+    for (Node& node : nodes) {
+        if (!node.joined) continue;
+        SimClockScope clock(clockOf(&node - &nodes[0]));
+        report.duplicatesDropped += node.manager->getSeenCacheStats().hits;
+        MeshReliableStats reliableStats = node.manager->getReliableStats();
+        report.retransmits += reliableStats.retransmits;
+        report.reliableFailed += reliableStats.failed;
+        MeshStoreStats storeStats = node.manager->getStoreStats();
+        report.storedReplayed += storeStats.replayed;
+        report.storedRetries += storeStats.retries;
+        report.storedDelivered += storeStats.delivered;
+        report.storedDuplicates += storeStats.duplicates;
+        report.storedDepthMax = std::max(report.storedDepthMax, storeStats.records);
+        report.storedErases += storeStats.erases;
+        MeshJobStats jobStats = node.manager->getJobStats();
+        report.smsPulled += jobStats.pulledIn;
+        report.smsQueueMax = std::max(report.smsQueueMax, jobStats.queueHighWater);
+        MeshTimeStats timeStats = node.manager->getTimeStats();
+        if (config.nodeClocks && timeStats.synced && timeStats.stratum > 0) {
+            report.timeSynced++;
+        }
+        size_t keyCount = node.manager->getLatencySeries(latencyKeys, MESH_LATENCY_MAX_SERIES);
+        for (size_t i = 0; i < keyCount; i++) {
+            MeshLatencyHistogram series;
+            if (latencyKeys[i].stage == MESH_LATENCY_TRANSIT && latencyKeys[i].type == MESH_MSG_DATA &&
+                node.manager->getLatency(MESH_LATENCY_TRANSIT, MESH_MSG_DATA, latencyKeys[i].hops, &series)) {
+                transit.merge(series);
+            }
+        }
+        if (&node != &nodes[0]) {
+            MeshLinkStats link = node.manager->getLinkStats(nodeIdOf(node.parent));
+            (node.uplinkLoss > 0 ? lossyCost : cleanCost) += link.cost;
+        }
+        double aliveSec = (double)(endUs - node.bootUs) / 1e6;
+        work.push_back(aliveSec > 0 ? node.workNs / 1000.0 / aliveSec : 0.0);
+    }
+    std::sort(work.begin(), work.end());
+    if (!work.empty()) {
+        double sum = 0;
+        for (double w : work) sum += w;
+        report.workMeanUsPerSec = sum / work.size();
+        report.workP99UsPerSec = work[(size_t)(0.99 * (work.size() - 1) + 0.5)];
+        report.workMaxUsPerSec = work.back();
+    }
+
+    std::sort(dataLatencyUs.begin(), dataLatencyUs.end());
+    report.latencyP50Us = percentile(dataLatencyUs, 0.50);
+    report.latencyP90Us = percentile(dataLatencyUs, 0.90);
+    report.latencyP99Us = percentile(dataLatencyUs, 0.99);
+    report.latencyMaxUs = dataLatencyUs.empty() ? 0 : dataLatencyUs.back();
+
+    std::sort(smsWaitMs.begin(), smsWaitMs.end());
+    report.smsWaitP50Ms = percentile(smsWaitMs, 0.50);
+    report.smsWaitP99Ms = percentile(smsWaitMs, 0.99);
+    report.smsWaitMaxMs = smsWaitMs.empty() ? 0 : smsWaitMs.back();
+
+    std::sort(timeErrorMs.begin(), timeErrorMs.end());
+    std::sort(timeBoundMs.begin(), timeBoundMs.end());
+    report.timeErrorP50Ms = percentile(timeErrorMs, 0.50);
+    report.timeErrorP99Ms = percentile(timeErrorMs, 0.99);
+    report.timeErrorMaxMs = timeErrorMs.empty() ? 0 : timeErrorMs.back();
+    report.timeBoundP99Ms = percentile(timeBoundMs, 0.99);
+    report.transitP50Us = transit.getPercentile(50);
+    report.transitP99Us = transit.getPercentile(99);
+    report.transitSamples = transit.getCount();
+    report.lossyCostMean = report.lossyLinks > 0 ? lossyCost / report.lossyLinks : 0.0;
+    size_t cleanLinks = nodes.size() - 1 - report.lossyLinks;
+    report.cleanCostMean = cleanLinks > 0 ? cleanCost / cleanLinks : 0.0;
+
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return report;
+}
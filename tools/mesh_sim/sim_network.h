@@ -0,0 +1,226 @@
+// Mesh Simulator Network Header
+#ifndef MESH_SIM_NETWORK_H
+#define MESH_SIM_NETWORK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "mesh_network_manager.h"
+#include "sim_clock.h"
+
+enum SimTopology {
+    SIM_TOPOLOGY_LINE,
+    SIM_TOPOLOGY_GRID,
+    SIM_TOPOLOGY_RANDOM   // Random geometric graph in the unit square
+};
+
+struct SimConfig {
+    size_t nodes = 100;
+    SimTopology topology = SIM_TOPOLOGY_GRID;
+    double averageDegree = 6.0;   // Random geometric only
+    uint32_t latencyUs = 5000;    // Per-link base latency
+    uint32_t jitterUs = 5000;     // Uniform extra latency per link
+    double loss = 0.0;            // Per-link transmission loss probability
+    double lossyShare = 0.0;      // Share of tree links given lossyLoss on top of loss
+    double lossyLoss = 0.0;
+    uint32_t tickMs = 10;         // update() period, as in main.cpp loop()
+    uint32_t bootSpacingMs = 20;  // Delay between a node and its tree parent joining
+    uint32_t durationMs = 120000;
+    double dataRate = 0.05;       // Unicast DATA messages per node per second
+    uint32_t payloadBytes = 0;    // Pad DATA messages to this size (large ones are fragmented)
+    bool reliable = false;        // Send DATA through MeshNetworkManager::sendReliable
+    bool stored = false;          // Send DATA through MeshNetworkManager::sendStored
+    double subscribers = 0.0;     // Share of nodes subscribed to a topic; DATA is published to it when > 0
+    double smsRate = 0.0;         // SMS jobs per second across the mesh, submitted at random nodes
+    double simShare = 0.5;        // Share of nodes with a SIM to send them (SMS mode)
+    bool nodeClocks = false;      // Give each node its own clock instead of one shared virtual clock
+    double clockPpm = 0.0;        // Node clocks drift by up to this much either way
+    uint32_t seed = 1;
+};
+
+struct SimReport {
+    size_t nodes;
+    size_t treeDepth;
+    uint32_t convergenceMs;       // 0 if the run ended first
+    uint64_t trackedPairs;        // Node pairs within MAX_NETWORK_HOPS, capped per node at its table sizes
+    uint64_t unsyncedPairs;       // Of those, still without a synced heartbeat view at the end
+    uint64_t unroutedPairs;       // Of those, still without a route at the end
+    uint64_t broadcasts;          // Broadcast frames originated
+    uint64_t unicasts;            // Single-destination frames originated
+    uint64_t linkTransmissions;
+    uint64_t linkLosses;
+    uint64_t broadcastTransmissions;
+    uint64_t broadcastReceptions;
+    uint64_t broadcastAudience;   // Other nodes joined when each broadcast was originated
+    uint64_t broadcastReached;    // Receptions by those nodes
+    uint64_t duplicatesDropped;   // Seen-cache hits across all nodes
+    double amplification;         // Broadcast link transmissions per node reached
+    double broadcastReach;        // Share of the audience that received each broadcast
+    uint64_t dataSent;            // Topic mode: one per subscriber within the hop limit
+    uint64_t dataReceived;
+    uint64_t retransmits;         // Reliable mode: end-to-end retransmissions
+    uint64_t reliableFailed;      // Reliable mode: messages given up on
+    uint32_t latencyP50Us;
+    uint32_t latencyP90Us;
+    uint32_t latencyP99Us;
+    uint32_t latencyMaxUs;
+    double workMeanUsPerSec;      // Host CPU spent per node per virtual second
+    double workP99UsPerSec;
+    double workMaxUsPerSec;
+    uint64_t smsSubmitted;        // SMS mode: jobs accepted by submitSmsJob
+    uint64_t smsSent;
+    uint64_t smsPulled;           // Jobs moved by idle nodes pulling
+    uint32_t smsWaitP50Ms;        // Submit to modem start
+    uint32_t smsWaitP99Ms;
+    uint32_t smsWaitMaxMs;
+    uint32_t smsQueueMax;         // Deepest queue any node reached
+    size_t timeSynced;            // Node clocks: nodes synced to the mesh master at the end
+    uint32_t timeErrorP50Ms;      // |mesh time - master's clock| over per-second samples of synced nodes
+    uint32_t timeErrorP99Ms;
+    uint32_t timeErrorMaxMs;
+    uint32_t timeBoundP99Ms;      // Error bound the nodes reported
+    uint64_t timeBoundMisses;     // Samples whose error exceeded the reported bound
+    uint32_t transitP50Us;        // Node clocks: DATA frame send to receive, from the nodes' histograms
+    uint32_t transitP99Us;
+    uint32_t transitSamples;
+    uint64_t storedReplayed;      // Stored mode: transmissions from the flash queues
+    uint64_t storedRetries;
+    uint64_t storedDelivered;     // Acknowledged and retired
+    uint64_t storedDuplicates;    // Replays the receivers suppressed
+    uint32_t storedDepthMax;      // Most records any node still held at the end
+    uint32_t storedErases;
+    size_t lossyLinks;            // Lossy links: tree links made lossy, and the link costs
+    double lossyCostMean;         // their lower end reports toward its parent at the end
+    double cleanCostMean;
+    uint64_t heapAllocations;     // operator new calls by node code in the second half of the run
+    uint64_t events;
+    double wallSeconds;
+};
+
+/**
+ * @brief Discrete-event simulation of many MeshNetworkManager nodes
+ *
+ * Each node is a real MeshNetworkManager built against the port/ stand-ins.
+ * painlessMesh is modelled as a spanning tree over the physical topology
+ * (BFS from node 0, the root): broadcasts flood every tree link once and
+ * single sends follow the tree path. Every link transmission takes
+ * latency + jitter in virtual time and may be lost. Nodes join outward from
+ * the root, each bootSpacingMs after its parent.
+ *
+ * The mesh has converged once every node holds a synced heartbeat view of,
+ * and a route to, each node within MAX_NETWORK_HOPS tree hops. Where that is
+ * more than the peer or topology table holds, a full table counts.
+ *
+ * Per-node work is host CPU time spent inside that node's update() and
+ * receive callbacks, scaled to one virtual second. Heap allocations made in
+ * the same calls are counted too, except String storage and the simulated
+ * transport, which stand in for painlessMesh's own; construction and
+ * begin() are left out, and the first half of the run is warm-up.
+ */
+class SimNetwork {
+public:
+    SimNetwork(const SimConfig& config);
+    ~SimNetwork();
+
+    SimReport run();
+
+    // painlessMesh stand-in hooks
+    static SimNetwork* current;
+    void attach(painlessMesh* mesh);
+    bool sendSingle(painlessMesh* mesh, uint32_t destId, const String& msg);
+    bool sendBroadcast(painlessMesh* mesh, const String& msg);
+    size_t getJoinedCount();
+
+private:
+    enum EventKind : uint8_t {
+        EVENT_BOOT,
+        EVENT_TICK,
+        EVENT_BROADCAST,
+        EVENT_SINGLE,
+        EVENT_SAMPLE
+    };
+
+    struct Event {
+        uint64_t atUs;
+        uint64_t order;          // FIFO among simultaneous events
+        EventKind kind;
+        uint32_t node;           // Node the event happens at
+        uint32_t from;           // Previous hop (index) for in-flight frames
+        uint32_t dest;           // Final destination (index) for single sends
+        uint32_t originId;       // Sending node ID as reported to onReceive
+        uint64_t sentUs;         // When the origin sent it
+        std::shared_ptr<const std::string> payload;
+    };
+
+    struct EventLater {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.atUs != b.atUs ? a.atUs > b.atUs : a.order > b.order;
+        }
+    };
+
+    struct Node {
+        std::unique_ptr<MeshNetworkManager> manager;
+        painlessMesh* mesh = nullptr;
+        std::vector<uint32_t> links;     // Physical neighbours
+        std::vector<uint32_t> children;  // Tree children, in DFS (tin) order
+        std::vector<uint32_t> inReach;   // Other nodes within MAX_NETWORK_HOPS tree hops
+        uint32_t parent = UINT32_MAX;
+        double uplinkLoss = 0.0;         // Extra loss on the link to the parent
+        uint32_t depth = 0;
+        uint32_t tin = 0;
+        uint32_t tout = 0;
+        uint64_t bootUs = 0;
+        uint64_t workNs = 0;
+        uint32_t topologySeen = 0;
+        bool joined = false;
+        bool subscribed = false;
+        bool hasSim = false;
+        bool modemBusy = false;          // SMS mode: one send at a time per SIM node
+        uint64_t modemDoneUs = 0;
+        uint32_t modemSendMs = 0;
+        MeshSmsJob smsJob;
+        SimNodeClock clock;
+    };
+
+    SimConfig config;
+    std::vector<Node> nodes;
+    std::priority_queue<Event, std::vector<Event>, EventLater> events;
+    std::mt19937_64 rng;
+    uint64_t eventOrder;
+    uint32_t attachIndex;
+    uint32_t receivingIndex;     // Node whose receive callback is running
+    uint32_t topologyGeneration;
+    size_t joinedCount;
+    uint32_t convergenceMs;
+    SimReport report;
+    std::vector<uint32_t> dataLatencyUs;
+    std::vector<uint32_t> smsWaitMs;
+    std::vector<uint32_t> timeErrorMs;
+    std::vector<uint32_t> timeBoundMs;
+
+    void buildTopology();
+    void buildTree();
+    void schedule(uint64_t atUs, EventKind kind, uint32_t node, uint32_t from = 0, uint32_t dest = 0,
+                  uint32_t originId = 0, uint64_t sentUs = 0, std::shared_ptr<const std::string> payload = nullptr);
+    void transmit(uint32_t from, uint32_t to, EventKind kind, uint32_t dest, uint32_t originId, uint64_t sentUs,
+                  const std::shared_ptr<const std::string>& payload);
+    uint32_t nextHop(uint32_t at, uint32_t dest);
+    uint32_t treeDistance(uint32_t a, uint32_t b);
+    const SimNodeClock* clockOf(uint32_t index);
+
+    void bootNode(uint32_t index);
+    void tickNode(uint32_t index);
+    void runModem(uint32_t index);
+    void deliver(uint32_t index, uint32_t originId, const std::string& payload);
+    void sample();
+    void countPending(uint64_t* tracked, uint64_t* unsynced, uint64_t* unrouted);
+    void sampleTime();
+
+    static void onData(void* context, const MeshMessageInfo& info, const uint8_t* data, size_t len);
+};
+
+#endif // MESH_SIM_NETWORK_H
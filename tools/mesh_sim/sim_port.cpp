@@ -0,0 +1,176 @@
+// Mesh Simulator Port - Arduino, painlessMesh and mbedtls stand-ins for host builds
+#include <stdlib.h>
+#include <new>
+#include <openssl/evp.h>
+#include "Arduino.h"
+#include "painlessMesh.h"
+#include "mbedtls/gcm.h"
+#include "sim_clock.h"
+#include "sim_heap.h"
+#include "sim_network.h"
+
+SimSerial Serial;
+SimEsp ESP;
+
+uint64_t simNowUs = 0;
+const SimNodeClock* simActiveClock = nullptr;
+static uint64_t simRandomState = 0x9E3779B97F4A7C15ULL;
+
+void simSeedRandom(uint64_t seed) {
+    simRandomState = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+uint64_t simLocalUs() {
+    if (!simActiveClock) {
+        return simNowUs;
+    }
+    return simActiveClock->startUs + (uint64_t)((simNowUs - simActiveClock->bootUs) * simActiveClock->rate);
+}
+
+uint32_t millis() {
+    return (uint32_t)(simLocalUs() / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)simLocalUs();
+}
+
+void delay(uint32_t ms) {
+    // Nodes are driven by the event loop; blocking has no meaning here
+}
+
+uint32_t esp_random() {
+    // xorshift64*: reproducible per seed
+    simRandomState ^= simRandomState >> 12;
+    simRandomState ^= simRandomState << 25;
+    simRandomState ^= simRandomState >> 27;
+    return (uint32_t)((simRandomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// --- heap accounting ---
+
+uint64_t simHeapAllocations = 0;
+bool simHeapCounting = false;
+
+void* operator new(size_t size) {
+    if (simHeapCounting) {
+        simHeapAllocations++;
+    }
+    void* block = malloc(size ? size : 1);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    free(block);
+}
+
+// --- painlessMesh ---
+
+void painlessMesh::init(const char* prefix, const char* password, uint16_t port) {
+    SimNetwork::current->attach(this);
+}
+
+// The simulated transport's queues stand in for painlessMesh's own
+bool painlessMesh::sendSingle(uint32_t destId, const String& msg) {
+    SimHeapScope exempt(false);
+    return network && network->sendSingle(this, destId, msg);
+}
+
+bool painlessMesh::sendBroadcast(const String& msg, bool includeSelf) {
+    SimHeapScope exempt(false);
+    return network && network->sendBroadcast(this, msg);
+}
+
+SimNodeList painlessMesh::getNodeList() {
+    size_t joined = network ? network->getJoinedCount() : 0;
+    return SimNodeList(joined > 0 ? joined - 1 : 0);
+}
+
+// --- mbedtls GCM on OpenSSL EVP ---
+
+void mbedtls_gcm_init(mbedtls_gcm_context* ctx) {
+    ctx->encrypt = EVP_CIPHER_CTX_new();
+    ctx->decrypt = EVP_CIPHER_CTX_new();
+}
+
+void mbedtls_gcm_free(mbedtls_gcm_context* ctx) {
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx->encrypt);
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx->decrypt);
+    ctx->encrypt = nullptr;
+    ctx->decrypt = nullptr;
+}
+
+int mbedtls_gcm_setkey(mbedtls_gcm_context* ctx, mbedtls_cipher_id_t cipher,
+                       const unsigned char* key, unsigned int keybits) {
+    if (cipher != MBEDTLS_CIPHER_ID_AES || keybits != 256) {
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+    }
+
+    // Key schedule is expanded once; later calls only supply the IV
+    if (EVP_EncryptInit_ex((EVP_CIPHER_CTX*)ctx->encrypt, EVP_aes_256_gcm(), nullptr, key, nullptr) != 1 ||
+        EVP_DecryptInit_ex((EVP_CIPHER_CTX*)ctx->decrypt, EVP_aes_256_gcm(), nullptr, key, nullptr) != 1) {
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+    }
+    return 0;
+}
+
+int mbedtls_gcm_crypt_and_tag(mbedtls_gcm_context* ctx, int mode, size_t length,
+                              const unsigned char* iv, size_t iv_len,
+                              const unsigned char* add, size_t add_len,
+                              const unsigned char* input, unsigned char* output,
+                              size_t tag_len, unsigned char* tag) {
+    EVP_CIPHER_CTX* evp = (EVP_CIPHER_CTX*)ctx->encrypt;
+    int outLen;
+
+    if (mode != MBEDTLS_GCM_ENCRYPT || iv_len != 12 ||
+        EVP_EncryptInit_ex(evp, nullptr, nullptr, nullptr, iv) != 1 ||
+        (add_len > 0 && EVP_EncryptUpdate(evp, nullptr, &outLen, add, (int)add_len) != 1) ||
+        (length > 0 && EVP_EncryptUpdate(evp, output, &outLen, input, (int)length) != 1) ||
+        EVP_EncryptFinal_ex(evp, output + length, &outLen) != 1 ||
+        EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_GET_TAG, (int)tag_len, tag) != 1) {
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+    }
+    return 0;
+}
+
+int mbedtls_gcm_auth_decrypt(mbedtls_gcm_context* ctx, size_t length,
+                             const unsigned char* iv, size_t iv_len,
+                             const unsigned char* add, size_t add_len,
+                             const unsigned char* tag, size_t tag_len,
+                             const unsigned char* input, unsigned char* output) {
+    EVP_CIPHER_CTX* evp = (EVP_CIPHER_CTX*)ctx->decrypt;
+    int outLen;
+
+    if (iv_len != 12 ||
+        EVP_DecryptInit_ex(evp, nullptr, nullptr, nullptr, iv) != 1 ||
+        (add_len > 0 && EVP_DecryptUpdate(evp, nullptr, &outLen, add, (int)add_len) != 1) ||
+        (length > 0 && EVP_DecryptUpdate(evp, output, &outLen, input, (int)length) != 1) ||
+        EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_SET_TAG, (int)tag_len, (void*)tag) != 1) {
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+    }
+
+    if (EVP_DecryptFinal_ex(evp, output + length, &outLen) != 1) {
+        memset(output, 0, length);
+        return MBEDTLS_ERR_GCM_AUTH_FAILED;
+    }
+    return 0;
+}